@@ -39,10 +39,14 @@ class libhal_stm32f1_conan(ConanFile):
     generators = "CMakeToolchain", "CMakeDeps", "VirtualBuildEnv"
 
     options = {
-        "platform": ["ANY"]
+        "platform": ["ANY"],
+        "external_sram": [True, False],
+        "isr_statistics": [True, False],
     }
     default_options = {
-        "platform": "ANY"
+        "platform": "ANY",
+        "external_sram": False,
+        "isr_statistics": False,
     }
 
     @property
@@ -71,6 +75,9 @@ class libhal_stm32f1_conan(ConanFile):
     def package_id(self):
         if self.info.options.get_safe("platform"):
             del self.info.options.platform
+        # Only selects the linker script, the binary is the same
+        if self.info.options.get_safe("external_sram") is not None:
+            del self.info.options.external_sram
 
     def validate(self):
         if self.settings.get_safe("compiler.cppstd"):
@@ -91,7 +98,9 @@ class libhal_stm32f1_conan(ConanFile):
 
     def build(self):
         cmake = CMake(self)
-        cmake.configure()
+        cmake.configure(variables={
+            "HAL_STM32F1_ISR_STATISTICS": bool(self.options.isr_statistics)
+        })
         cmake.build()
 
     def package(self):
@@ -119,6 +128,9 @@ class libhal_stm32f1_conan(ConanFile):
         self.cpp_info.set_property("cmake_target_name", "libhal::stm32f1")
         self.cpp_info.libs = ["libhal-stm32f1"]
 
+        if self.options.isr_statistics:
+            self.cpp_info.defines = ["HAL_STM32F1_ISR_STATISTICS=1"]
+
         if self._bare_metal and self._is_me:
             linker_script_name = list(str(self.options.platform))
             # Replace the MCU number and pin count number with 'x' (don't care)
@@ -126,6 +138,8 @@ class libhal_stm32f1_conan(ConanFile):
             linker_script_name[8] = 'x'
             linker_script_name[9] = 'x'
             linker_script_name = "".join(linker_script_name)
+            if self.options.external_sram:
+                linker_script_name += "_external_sram"
 
             linker_path = os.path.join(self.package_folder, "linker_scripts")
             link_script = "-Tlibhal-stm32f1/" + linker_script_name + ".ld"
@@ -0,0 +1,58 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <string_view>
+
+#include <libhal-armcortex/dwt_counter.hpp>
+#include <libhal-stm32f1/clock.hpp>
+#include <libhal-stm32f1/constants.hpp>
+
+#include "benchmark.hpp"
+
+namespace {
+/// Print through the SYS_WRITE0 semihosting call. Needs a debugger with
+/// semihosting enabled, such as OpenOCD after `arm semihosting enable`,
+/// otherwise the breakpoint faults.
+void semihosting_write(std::string_view p_text)
+{
+  constexpr int sys_write0 = 0x04;
+
+  std::array<char, 128> text{};
+  auto length = std::min(p_text.size(), text.size() - 1);
+  std::copy_n(p_text.begin(), length, text.begin());
+
+  asm volatile("mov r0, %0\n"
+               "mov r1, %1\n"
+               "bkpt 0xAB"
+               :
+               : "r"(sys_write0), "r"(text.data())
+               : "r0", "r1", "memory");
+}
+}  // namespace
+
+hal::status application()
+{
+  auto cpu_frequency = hal::stm32f1::frequency(hal::stm32f1::peripheral::cpu);
+  hal::cortex_m::dwt_counter steady_clock(cpu_frequency);
+
+  // The DWT counter counts CPU cycles
+  auto cycles = [&steady_clock]() -> std::uint64_t {
+    return steady_clock.uptime().value().ticks;
+  };
+
+  return benchmark::run_library_benchmarks(cycles, semihosting_write);
+}
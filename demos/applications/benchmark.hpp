@@ -0,0 +1,161 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <charconv>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string_view>
+
+#include <libhal-stm32f1/clock.hpp>
+#include <libhal-stm32f1/constants.hpp>
+#include <libhal-stm32f1/output_pin.hpp>
+#include <libhal-stm32f1/power_domain.hpp>
+#include <libhal/error.hpp>
+
+/// Benchmark harness shared by the benchmark demo and its host build in
+/// tests/benchmark.test.cpp. The counter is any callable returning a
+/// monotonic std::uint64_t: CPU cycles on the device and register accesses
+/// on the host.
+namespace benchmark {
+/// Samples per benchmark
+inline constexpr std::size_t iterations = 64;
+
+/// Cost of one call of an operation over every iteration
+struct statistics
+{
+  std::uint64_t min;
+  std::uint64_t median;
+  std::uint64_t max;
+};
+
+/**
+ * @brief Measure an operation
+ *
+ * The cost of reading the counter back to back is subtracted from each
+ * sample.
+ *
+ * @param p_counter - counter to sample before and after each call
+ * @param p_operation - operation to measure
+ * @return statistics - min, median and max cost
+ */
+template<class Counter, class Operation>
+statistics measure(Counter& p_counter, Operation&& p_operation)
+{
+  std::array<std::uint64_t, iterations> samples{};
+
+  auto overhead_start = p_counter();
+  auto overhead = p_counter() - overhead_start;
+
+  for (auto& sample : samples) {
+    auto start = p_counter();
+    p_operation();
+    auto elapsed = p_counter() - start;
+    sample = elapsed > overhead ? elapsed - overhead : 0;
+  }
+
+  std::sort(samples.begin(), samples.end());
+  return statistics{
+    .min = samples.front(),
+    .median = samples[samples.size() / 2],
+    .max = samples.back(),
+  };
+}
+
+/**
+ * @brief Format a result as a CSV line
+ *
+ * @param p_buffer - space for the line
+ * @param p_name - benchmark name, must not contain commas
+ * @param p_statistics - result of measure()
+ * @return std::string_view - "name,iterations,min,median,max\n", truncated
+ * to the buffer
+ */
+inline std::string_view format(std::span<char> p_buffer,
+                               std::string_view p_name,
+                               const statistics& p_statistics)
+{
+  auto* position = p_buffer.data();
+  auto* end = p_buffer.data() + p_buffer.size();
+
+  auto append = [&position, end](std::string_view p_text) {
+    auto length = std::min<std::size_t>(p_text.size(), end - position);
+    position = std::copy_n(p_text.begin(), length, position);
+  };
+  auto append_number = [&position, end, &append](std::uint64_t p_number) {
+    append(",");
+    position = std::to_chars(position, end, p_number).ptr;
+  };
+
+  append(p_name);
+  append_number(iterations);
+  append_number(p_statistics.min);
+  append_number(p_statistics.median);
+  append_number(p_statistics.max);
+  append("\n");
+
+  return std::string_view(p_buffer.data(), position - p_buffer.data());
+}
+
+/**
+ * @brief Run the library benchmarks
+ *
+ * Uses pin PC13. configure_clocks() is measured with the default clock tree,
+ * so the device ends up running from the HSI.
+ *
+ * @param p_counter - counter to measure with
+ * @param p_write - callable taking a std::string_view, called once per line
+ * @return hal::status - fails if PC13 cannot be acquired
+ */
+template<class Counter, class Writer>
+hal::status run_library_benchmarks(Counter p_counter, Writer p_write)
+{
+  using namespace hal::stm32f1;
+
+  std::array<char, 96> line{};
+  auto report = [&line, &p_write](std::string_view p_name,
+                                  const statistics& p_statistics) {
+    p_write(format(line, p_name, p_statistics));
+  };
+
+  p_write("benchmark,iterations,min,median,max\n");
+
+  auto pin = HAL_CHECK(output_pin::get('C', 13));
+
+  report("output_pin::level(bool)",
+         measure(p_counter, [&pin]() { (void)pin.level(true); }));
+  report("output_pin::level()",
+         measure(p_counter, [&pin]() { (void)pin.level(); }));
+  // Goes through configure_pin()
+  report("output_pin::configure()",
+         measure(p_counter, [&pin]() { (void)pin.configure({}); }));
+  // The first acquire turns the clock on and the last release turns it off
+  report("acquire_power()+release_power()", measure(p_counter, []() {
+           acquire_power(peripheral::usart3);
+           release_power(peripheral::usart3);
+         }));
+  report("frequency()", measure(p_counter, []() {
+           volatile auto rate = frequency(peripheral::usart3);
+           (void)rate;
+         }));
+  report("configure_clocks()",
+         measure(p_counter, []() { configure_clocks(clock_tree{}); }));
+
+  return hal::success();
+}
+}  // namespace benchmark
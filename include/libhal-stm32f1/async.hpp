@@ -0,0 +1,453 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <array>
+#include <coroutine>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+
+/// Size in bytes of each coroutine frame in the static task frame pool. A
+/// task whose frame is larger fails to start, see task::valid(). Define it
+/// for the whole build, as the pool lives in the library.
+#if !defined(HAL_STM32F1_TASK_FRAME_SIZE)
+#define HAL_STM32F1_TASK_FRAME_SIZE 256
+#endif
+
+/// Number of frames in the static task frame pool, from 1 to 32. Define it
+/// for the whole build, as the pool lives in the library.
+#if !defined(HAL_STM32F1_TASK_FRAME_COUNT)
+#define HAL_STM32F1_TASK_FRAME_COUNT 8
+#endif
+
+namespace hal::stm32f1 {
+/// Size in bytes of each frame of the task frame pool
+static constexpr std::size_t task_frame_size = HAL_STM32F1_TASK_FRAME_SIZE;
+/// Number of frames in the task frame pool, which bounds the number of
+/// tasks alive at once, including the tasks awaited by other tasks.
+static constexpr std::size_t task_frame_count = HAL_STM32F1_TASK_FRAME_COUNT;
+
+static_assert(task_frame_count >= 1 && task_frame_count <= 32,
+              "The frame pool tracks its frames with a 32-bit mask");
+
+class executor;
+
+/**
+ * @brief Take a frame from the task frame pool
+ *
+ * @param p_size - size of the coroutine frame
+ * @return void* - the frame or nullptr if it is too large or every frame is
+ * in use
+ */
+void* allocate_task_frame(std::size_t p_size) noexcept;
+
+/**
+ * @brief Return a frame to the task frame pool
+ *
+ * @param p_frame - frame returned by allocate_task_frame()
+ */
+void free_task_frame(void* p_frame) noexcept;
+
+/**
+ * @brief Number of frames of the task frame pool in use
+ *
+ * @return std::size_t - frames in use
+ */
+[[nodiscard]] std::size_t task_frames_in_use() noexcept;
+
+/**
+ * @brief Coroutine run by an executor
+ *
+ * Frames come from a static pool rather than the heap, so a task that does
+ * not fit or finds the pool empty is invalid and never runs. Tasks start
+ * suspended and run once spawned on an executor or awaited by another task.
+ * Tasks must be created outside of interrupt handlers.
+ *
+ *     task transfer_pair(completion& p_first, completion& p_second)
+ *     {
+ *       co_await p_first;
+ *       co_await p_second;
+ *     }
+ *
+ */
+class task
+{
+public:
+  class promise_type;
+
+  /// Awaits a task from another task, which resumes once it returns
+  class awaiter
+  {
+  public:
+    [[nodiscard]] bool await_ready() const noexcept
+    {
+      return !m_handle || m_handle.done();
+    }
+
+    std::coroutine_handle<> await_suspend(
+      std::coroutine_handle<promise_type> p_parent) noexcept;
+
+    void await_resume() const noexcept
+    {
+    }
+
+  private:
+    friend class task;
+
+    explicit awaiter(std::coroutine_handle<promise_type> p_handle)
+      : m_handle(p_handle)
+    {
+    }
+
+    std::coroutine_handle<promise_type> m_handle;
+  };
+
+  class promise_type
+  {
+  public:
+    static void* operator new(std::size_t p_size) noexcept
+    {
+      return allocate_task_frame(p_size);
+    }
+
+    static void operator delete(void* p_frame) noexcept
+    {
+      free_task_frame(p_frame);
+    }
+
+    static task get_return_object_on_allocation_failure() noexcept
+    {
+      return task{};
+    }
+
+    task get_return_object() noexcept
+    {
+      return task{ std::coroutine_handle<promise_type>::from_promise(*this) };
+    }
+
+    std::suspend_always initial_suspend() const noexcept
+    {
+      return {};
+    }
+
+    auto final_suspend() const noexcept
+    {
+      struct resume_continuation
+      {
+        bool await_ready() const noexcept
+        {
+          return false;
+        }
+
+        std::coroutine_handle<> await_suspend(
+          std::coroutine_handle<promise_type> p_handle) const noexcept
+        {
+          auto continuation = p_handle.promise().m_continuation;
+          if (continuation) {
+            return continuation;
+          }
+          return std::noop_coroutine();
+        }
+
+        void await_resume() const noexcept
+        {
+        }
+      };
+      return resume_continuation{};
+    }
+
+    void return_void() const noexcept
+    {
+    }
+
+    [[noreturn]] void unhandled_exception() const noexcept;
+
+    /**
+     * @brief Executor running the task
+     *
+     * @return executor* - executor, nullptr until the task is spawned or
+     * awaited
+     */
+    [[nodiscard]] executor* owner() const noexcept
+    {
+      return m_owner;
+    }
+
+  private:
+    friend class task;
+    friend class awaiter;
+    friend class executor;
+
+    executor* m_owner = nullptr;
+    std::coroutine_handle<> m_continuation{};
+  };
+
+  task() = default;
+
+  task(task&& p_other) noexcept
+    : m_handle(std::exchange(p_other.m_handle, nullptr))
+  {
+  }
+
+  task& operator=(task&& p_other) noexcept
+  {
+    if (this != &p_other) {
+      destroy();
+      m_handle = std::exchange(p_other.m_handle, nullptr);
+    }
+    return *this;
+  }
+
+  task(const task&) = delete;
+  task& operator=(const task&) = delete;
+
+  ~task()
+  {
+    destroy();
+  }
+
+  /**
+   * @brief Determine if the task has a frame
+   *
+   * @return true - the task can run
+   * @return false - the frame pool had no room for the task
+   */
+  [[nodiscard]] bool valid() const noexcept
+  {
+    return static_cast<bool>(m_handle);
+  }
+
+  /**
+   * @brief Determine if the task has returned
+   *
+   * @return true - the task has returned or is invalid
+   * @return false - the task has not run to completion
+   */
+  [[nodiscard]] bool done() const noexcept
+  {
+    return !m_handle || m_handle.done();
+  }
+
+  awaiter operator co_await() && noexcept
+  {
+    return awaiter{ m_handle };
+  }
+
+private:
+  friend class executor;
+
+  explicit task(std::coroutine_handle<promise_type> p_handle)
+    : m_handle(p_handle)
+  {
+  }
+
+  void destroy() noexcept
+  {
+    if (m_handle) {
+      m_handle.destroy();
+      m_handle = nullptr;
+    }
+  }
+
+  std::coroutine_handle<promise_type> m_handle{};
+};
+
+/**
+ * @brief Runs tasks on a single core, sleeping while none can make progress
+ *
+ * Tasks wait on completions signaled by interrupt handlers. The executor
+ * resumes them from thread mode and executes WFI when no task is ready, with
+ * interrupts masked between the check and the WFI so a completion signaled
+ * in between is never missed.
+ *
+ *     executor tasks;
+ *     tasks.spawn(read_sensor());
+ *     tasks.spawn(refresh_display());
+ *     tasks.run();
+ *
+ */
+class executor
+{
+public:
+  /// Called instead of WFI when no task is ready, such as to simulate
+  /// interrupts on the host
+  using idle_handler = void (*)();
+
+  executor() = default;
+  executor(const executor&) = delete;
+  executor& operator=(const executor&) = delete;
+
+  /**
+   * @brief Hand a task to the executor
+   *
+   * The task runs on the next run() or run_ready() call and is destroyed
+   * once it returns.
+   *
+   * @param p_task - task to run
+   * @return true - the task is scheduled
+   * @return false - the task is invalid or the executor holds
+   * task_frame_count tasks already
+   */
+  bool spawn(task&& p_task) noexcept;
+
+  /**
+   * @brief Queue a suspended coroutine to be resumed
+   *
+   * Safe to call from interrupt handlers.
+   *
+   * @param p_handle - coroutine to resume
+   */
+  void schedule(std::coroutine_handle<> p_handle) noexcept;
+
+  /**
+   * @brief Resume every coroutine ready at the time of the call
+   *
+   * @return true - at least one coroutine ran
+   * @return false - no coroutine was ready
+   */
+  bool run_ready() noexcept;
+
+  /**
+   * @brief Run until every spawned task has returned
+   *
+   * @param p_idle - called when no task is ready, nullptr executes WFI
+   */
+  void run(idle_handler p_idle = nullptr) noexcept;
+
+  /**
+   * @brief Number of spawned tasks that have not returned
+   *
+   * @return std::size_t - tasks alive
+   */
+  [[nodiscard]] std::size_t tasks() const noexcept;
+
+private:
+  std::array<task, task_frame_count> m_tasks{};
+  std::array<std::coroutine_handle<>, task_frame_count> m_ready{};
+  std::size_t m_ready_head = 0;
+  std::size_t m_ready_count = 0;
+};
+
+inline std::coroutine_handle<> task::awaiter::await_suspend(
+  std::coroutine_handle<promise_type> p_parent) noexcept
+{
+  auto& child = m_handle.promise();
+  child.m_continuation = p_parent;
+  child.m_owner = p_parent.promise().m_owner;
+  return m_handle;
+}
+
+/**
+ * @brief One shot event signaled from an interrupt handler
+ *
+ * Coroutines await it and other code can block on wait(). Only one
+ * coroutine may await a completion at a time. Reset it before starting the
+ * operation it reports on.
+ *
+ *     completion dma_done;
+ *
+ *     void dma_interrupt()
+ *     {
+ *       clear_dma_flags(channel);
+ *       dma_done.signal();
+ *     }
+ *
+ *     task send(std::span<const hal::byte> p_data)
+ *     {
+ *       dma_done.reset();
+ *       start_transfer(p_data);
+ *       co_await dma_done;
+ *     }
+ *
+ */
+class completion
+{
+public:
+  completion() = default;
+  completion(const completion&) = delete;
+  completion& operator=(const completion&) = delete;
+
+  /**
+   * @brief Mark the operation as complete and resume the waiting coroutine
+   *
+   * Safe to call from interrupt handlers.
+   *
+   */
+  void signal() noexcept;
+
+  /**
+   * @brief Clear the completion before starting a new operation
+   *
+   */
+  void reset() noexcept;
+
+  /**
+   * @brief Determine if the completion was signaled
+   *
+   * @return true - signaled since the last reset
+   * @return false - not signaled
+   */
+  [[nodiscard]] bool done() const noexcept
+  {
+    return m_done;
+  }
+
+  /**
+   * @brief Block the caller until signaled, sleeping in between interrupts
+   *
+   * For code outside of coroutines.
+   *
+   */
+  void wait() const noexcept;
+
+  /// Suspends the awaiting task until the completion is signaled
+  class awaiter
+  {
+  public:
+    [[nodiscard]] bool await_ready() const noexcept
+    {
+      return m_completion->m_done;
+    }
+
+    bool await_suspend(
+      std::coroutine_handle<task::promise_type> p_waiter) const noexcept;
+
+    void await_resume() const noexcept
+    {
+    }
+
+  private:
+    friend class completion;
+
+    explicit awaiter(completion& p_completion)
+      : m_completion(&p_completion)
+    {
+    }
+
+    completion* m_completion;
+  };
+
+  awaiter operator co_await() noexcept
+  {
+    return awaiter{ *this };
+  }
+
+private:
+  volatile bool m_done = false;
+  std::coroutine_handle<> m_waiter{};
+  executor* m_executor = nullptr;
+};
+}  // namespace hal::stm32f1
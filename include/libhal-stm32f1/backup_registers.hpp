@@ -0,0 +1,175 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <optional>
+#include <span>
+#include <type_traits>
+
+namespace hal::stm32f1 {
+/// Number of 16-bit backup data registers on low and medium density devices
+static constexpr std::size_t backup_register_count = 10;
+
+/// Number of 16-bit backup data registers on high density, XL density and
+/// connectivity line devices
+static constexpr std::size_t extended_backup_register_count = 42;
+
+/**
+ * @brief Read consecutive backup data registers
+ *
+ * Registers beyond the last one read as 0.
+ *
+ * @param p_first - index of the first register, 0 is BKP_DR1
+ * @param p_data - destination, one element per register
+ */
+void read_backup_registers(std::size_t p_first,
+                           std::span<std::uint16_t> p_data);
+
+/**
+ * @brief Write consecutive backup data registers
+ *
+ * Handles the backup domain write protection. Writes beyond the last
+ * register are ignored.
+ *
+ * @param p_first - index of the first register, 0 is BKP_DR1
+ * @param p_data - values to write, one element per register
+ */
+void write_backup_registers(std::size_t p_first,
+                            std::span<const std::uint16_t> p_data);
+
+/**
+ * @brief Compute the check word stored alongside a backup_value
+ *
+ * Fletcher-16 over the data, offset so that registers cleared by a backup
+ * domain reset never hold a valid check word.
+ *
+ * @param p_data - register contents
+ * @return constexpr std::uint16_t - check word
+ */
+constexpr std::uint16_t backup_check_word(std::span<const std::uint16_t> p_data)
+{
+  std::uint32_t sum1 = 0;
+  std::uint32_t sum2 = 0;
+  for (auto word : p_data) {
+    sum1 = (sum1 + (word & 0xFF)) % 255;
+    sum2 = (sum2 + sum1) % 255;
+    sum1 = (sum1 + (word >> 8)) % 255;
+    sum2 = (sum2 + sum1) % 255;
+  }
+  return static_cast<std::uint16_t>(((sum2 << 8) | sum1) ^ 0xB5A5);
+}
+
+/**
+ * @brief A value of type T kept in the backup data registers
+ *
+ * The backup registers are powered by VBAT when VDD is off and keep their
+ * contents through resets and standby mode. They are cleared by a backup
+ * domain reset, which configure_clocks() performs unless
+ * `clock_tree::rtc_t::preserve_backup_domain` is set, and by a tamper event.
+ *
+ * The value is followed by a check word, so a value that was never stored or
+ * was cleared loads as std::nullopt. Values are laid out at compile time:
+ *
+ *     struct boot_state {
+ *       std::uint8_t reason;
+ *       std::uint8_t clock_profile;
+ *       std::uint32_t boot_count;
+ *     };
+ *
+ *     using boot_state_store = backup_value<boot_state, 0>;
+ *     using calibration_store =
+ *       backup_value<std::uint16_t, boot_state_store::end_register>;
+ *
+ *     auto state = boot_state_store::load().value_or(boot_state{});
+ *     state.boot_count++;
+ *     boot_state_store::store(state);
+ *
+ * The stm32f1 has no battery backed SRAM, so the registers are the only
+ * storage of this kind: 20 bytes on low and medium density devices and 84
+ * bytes on the others.
+ *
+ * @tparam T - trivially copyable type to store
+ * @tparam FirstRegister - index of the first register, 0 is BKP_DR1
+ * @tparam RegisterCount - number of registers available on the target device
+ */
+template<typename T,
+         std::size_t FirstRegister,
+         std::size_t RegisterCount = backup_register_count>
+class backup_value
+{
+public:
+  static_assert(std::is_trivially_copyable_v<T>,
+                "Backup values are copied byte for byte");
+
+  /// Number of registers holding the value, excluding the check word
+  static constexpr std::size_t data_registers = (sizeof(T) + 1) / 2;
+  /// Number of registers used, including the check word
+  static constexpr std::size_t register_count = data_registers + 1;
+  /// Index of the first register after this value
+  static constexpr std::size_t end_register = FirstRegister + register_count;
+
+  static_assert(end_register <= RegisterCount,
+                "Value does not fit in the backup registers of the device");
+
+  /**
+   * @brief Load the value
+   *
+   * @return std::optional<T> - the value or std::nullopt if it was never
+   * stored or the backup domain has been reset.
+   */
+  [[nodiscard]] static std::optional<T> load()
+  {
+    std::array<std::uint16_t, register_count> registers{};
+    read_backup_registers(FirstRegister, registers);
+
+    auto data = std::span(registers).template first<data_registers>();
+    if (registers.back() != backup_check_word(data)) {
+      return std::nullopt;
+    }
+
+    T value;
+    std::memcpy(&value, data.data(), sizeof(T));
+    return value;
+  }
+
+  /**
+   * @brief Store the value
+   *
+   * @param p_value - value to store
+   */
+  static void store(const T& p_value)
+  {
+    std::array<std::uint16_t, register_count> registers{};
+    std::memcpy(registers.data(), &p_value, sizeof(T));
+    registers.back() = backup_check_word(
+      std::span(registers).template first<data_registers>());
+    write_backup_registers(FirstRegister, registers);
+  }
+
+  /**
+   * @brief Invalidate the stored value
+   *
+   */
+  static void clear()
+  {
+    std::array<std::uint16_t, register_count> registers{};
+    write_backup_registers(FirstRegister, registers);
+  }
+};
+}  // namespace hal::stm32f1
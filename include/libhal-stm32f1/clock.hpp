@@ -16,6 +16,8 @@
 
 #include "constants.hpp"
 
+#include <cstdint>
+
 #include <libhal/error.hpp>
 #include <libhal/units.hpp>
 
@@ -23,17 +25,50 @@ namespace hal::stm32f1 {
 
 using namespace hal::literals;
 
-/// Constant for the frequency of the LSE
-constexpr auto internal_low_speed_oscillator = 20.0_kHz;
+/// Typical frequency of the LSI in Hz
+constexpr std::uint32_t internal_low_speed_oscillator_hz = 40'000;
+
+/// Slowest frequency of the LSI in Hz, across devices and temperature
+constexpr std::uint32_t internal_low_speed_oscillator_min_hz = 30'000;
+
+/// Fastest frequency of the LSI in Hz, across devices and temperature
+constexpr std::uint32_t internal_low_speed_oscillator_max_hz = 60'000;
+
+/// Frequency of the HSI in Hz
+constexpr std::uint32_t internal_high_speed_oscillator_hz = 8'000'000;
+
+/// Constant for the typical frequency of the LSI
+constexpr hal::hertz internal_low_speed_oscillator =
+  internal_low_speed_oscillator_hz;
 
-/// Constant for the frequency of the HSE
-constexpr auto internal_high_speed_oscillator = 8.0_MHz;
+/// Constant for the frequency of the HSI
+constexpr hal::hertz internal_high_speed_oscillator =
+  internal_high_speed_oscillator_hz;
 
 /// Constant for the frequency of the Flash Controller
 constexpr auto flash_clock = internal_high_speed_oscillator;
 
-/// Constant for the frequency of the Watch Dog Peripheral
-constexpr auto watchdog_clock_rate = internal_low_speed_oscillator;
+/// Clock rate used to size the independent watchdog. This is the fastest LSI,
+/// so a watchdog never resets the device sooner than its requested timeout.
+constexpr hal::hertz watchdog_clock_rate = internal_low_speed_oscillator_max_hz;
+
+/**
+ * @brief Round a rate to integer Hz
+ *
+ * Used to convert a user supplied rate once, so the prescaler helpers can
+ * compute in integers.
+ *
+ * @param p_rate - rate to round
+ * @return constexpr std::uint32_t - nearest whole Hz, 0 if the rate is not
+ * positive
+ */
+constexpr std::uint32_t to_hz(hal::hertz p_rate)
+{
+  if (p_rate <= 0.0f) {
+    return 0;
+  }
+  return static_cast<std::uint32_t>(p_rate + 0.5f);
+}
 
 /// Available dividers for the APB bus
 enum class apb_divider : std::uint8_t
@@ -152,8 +187,17 @@ struct clock_tree
   /// Defines the configuration for the RTC
   struct rtc_t
   {
+    /// Feed the RTC from its source. While disabled the RTC has no clock and
+    /// frequency_hz(peripheral::rtc) is 0.
     bool enable = false;
+    /// RTC clock source, the LSI is started by configure_clocks() when the
+    /// RTC is enabled
     rtc_source source = rtc_source::low_speed_internal;
+    /// Keep the backup domain, which holds the RTC counter, its clock source
+    /// selection and the backup registers, rather than resetting it. The RTC
+    /// source can only be changed after a backup domain reset, so a source
+    /// selected before the last reset stays in effect.
+    bool preserve_backup_domain = false;
   } rtc = {};
 
   /// Defines the configuration of the dividers beyond system clock mux.
@@ -191,6 +235,30 @@ struct clock_tree
 ///      https://www.st.com/resource/en/reference_manual/cd00171190-stm32f101xx-stm32f102xx-stm32f103xx-stm32f105xx-and-stm32f107xx-advanced-arm-based-32-bit-mcus-stmicroelectronics.pdf#page=126
 void configure_clocks(clock_tree p_clock_tree);
 
+/**
+ * @brief Re-establish the clock tree last passed to configure_clocks()
+ *
+ * Stop mode turns off the HSE and PLL and leaves the system running from the
+ * HSI. The dividers, PLL settings and flash wait states are retained, so only
+ * the oscillators and system clock switch are brought back. This is much
+ * faster than a second call to configure_clocks() and leaves the RTC and the
+ * backup domain untouched.
+ *
+ */
+void restore_clocks();
+
+/**
+ * @brief Get the clock rate of a peripheral in integer Hz
+ *
+ * The clock tree is tracked in integer Hz, so the result is exact and can be
+ * used to compute prescalers without floating point arithmetic, which the
+ * Cortex-M3 has to emulate in software.
+ *
+ * @param p_id - peripheral
+ * @return std::uint32_t - clock rate of the peripheral, 0 if it has no clock
+ */
+std::uint32_t frequency_hz(peripheral p_id);
+
 /// @return the clock rate frequency of a peripheral
 hal::hertz frequency(peripheral p_id);
 }  // namespace hal::stm32f1
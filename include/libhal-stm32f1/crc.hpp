@@ -0,0 +1,179 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <type_traits>
+
+#include <libhal/error.hpp>
+#include <libhal/units.hpp>
+
+namespace hal::stm32f1 {
+/**
+ * @brief Reverse the order of the bits in a word
+ *
+ * Compiles to a single RBIT instruction on the device.
+ *
+ * @param p_value - word to reverse
+ * @return constexpr std::uint32_t - bit reversed word
+ */
+constexpr std::uint32_t bit_reverse(std::uint32_t p_value)
+{
+#if defined(__arm__)
+  if (!std::is_constant_evaluated()) {
+    std::uint32_t result;
+    asm("rbit %0, %1" : "=r"(result) : "r"(p_value));
+    return result;
+  }
+#endif
+  std::uint32_t result = 0;
+  for (int i = 0; i < 32; i++) {
+    result = (result << 1) | (p_value & 1U);
+    p_value >>= 1;
+  }
+  return result;
+}
+
+/// CRC-32 polynomial used by the stm32f1 CRC unit, Ethernet and zlib
+static constexpr std::uint32_t crc32_polynomial = 0x04C1'1DB7;
+
+/// Lookup table for the reflected (LSB first) CRC-32 algorithm
+static constexpr auto reflected_crc32_table = []() {
+  std::array<std::uint32_t, 256> table{};
+  constexpr auto reflected_polynomial = bit_reverse(crc32_polynomial);
+  for (std::uint32_t i = 0; i < table.size(); i++) {
+    std::uint32_t crc = i;
+    for (int bit = 0; bit < 8; bit++) {
+      crc = (crc & 1U) ? (crc >> 1) ^ reflected_polynomial : crc >> 1;
+    }
+    table[i] = crc;
+  }
+  return table;
+}();
+
+/**
+ * @brief Software CRC-32 matching Ethernet, zlib and PNG
+ *
+ * Can be chained in the same way as zlib's crc32() by passing the result of
+ * the previous call as p_previous.
+ *
+ * @param p_data - bytes to checksum
+ * @param p_previous - result of the checksum of the preceding bytes
+ * @return constexpr std::uint32_t - CRC-32 of the data
+ */
+constexpr std::uint32_t software_crc32(std::span<const hal::byte> p_data,
+                                       std::uint32_t p_previous = 0)
+{
+  std::uint32_t crc = ~p_previous;
+  for (auto byte : p_data) {
+    crc = (crc >> 8) ^ reflected_crc32_table[(crc ^ byte) & 0xFF];
+  }
+  return ~crc;
+}
+
+/**
+ * @brief Software model of the stm32f1 CRC unit
+ *
+ * The CRC unit shifts each 32-bit word in MSB first, starting from
+ * 0xFFFFFFFF, without reflecting its input or output and without a final
+ * XOR. This is the CRC-32/MPEG-2 algorithm applied to 32-bit words.
+ *
+ * @param p_data - words to checksum
+ * @param p_initial - CRC register value before the first word
+ * @return constexpr std::uint32_t - value of the CRC data register
+ */
+constexpr std::uint32_t software_native_crc32(
+  std::span<const std::uint32_t> p_data,
+  std::uint32_t p_initial = 0xFFFF'FFFF)
+{
+  std::uint32_t crc = p_initial;
+  for (auto word : p_data) {
+    crc ^= word;
+    for (int bit = 0; bit < 32; bit++) {
+      crc = (crc & 0x8000'0000) ? (crc << 1) ^ crc32_polynomial : crc << 1;
+    }
+  }
+  return crc;
+}
+
+/**
+ * @brief Driver for the stm32f1 CRC calculation unit
+ *
+ */
+class crc32
+{
+public:
+  /// Driver settings
+  struct settings
+  {
+    /// Buffers of at least this many words are transferred to the CRC unit
+    /// by a free DMA1 channel, shorter buffers are written by the CPU. Set to
+    /// 0 to never use DMA.
+    std::size_t dma_threshold = 64;
+  };
+
+  /**
+   * @brief Get the CRC unit
+   *
+   * @param p_settings - driver settings
+   * @return result<crc32> - CRC driver
+   */
+  static result<crc32> get(settings p_settings);
+
+  /// The power reference moves with the driver
+  crc32(crc32&& p_other) noexcept;
+  crc32& operator=(crc32&& p_other) noexcept;
+  crc32(const crc32&) = delete;
+  crc32& operator=(const crc32&) = delete;
+  /// Releases the CRC unit's power reference
+  ~crc32();
+
+  /**
+   * @brief Hardware CRC of 32-bit words in the unit's native format
+   *
+   * Matches software_native_crc32(). This is the fastest form of the CRC and
+   * the one to use when both ends of a link, such as a bootloader and its
+   * image tool, can agree on it. If a DMA transfer fails with a transfer
+   * error, the CPU computes the CRC again from the first word.
+   *
+   * @param p_data - words to checksum
+   * @return std::uint32_t - CRC of the data
+   */
+  std::uint32_t compute(std::span<const std::uint32_t> p_data);
+
+  /**
+   * @brief Hardware assisted CRC-32 matching Ethernet, zlib and PNG
+   *
+   * The CPU bit reverses each word before writing it to the unit, as the
+   * unit has no input reflection. Trailing bytes which do not fill a word are
+   * finished in software. Matches software_crc32().
+   *
+   * @param p_data - bytes to checksum, no alignment requirement
+   * @return std::uint32_t - CRC-32 of the data
+   */
+  std::uint32_t compute_reflected(std::span<const hal::byte> p_data);
+
+private:
+  crc32(settings p_settings);
+
+  void feed_with_dma(std::span<const std::uint32_t> p_data);
+
+  settings m_settings;
+  bool m_owner = true;
+};
+}  // namespace hal::stm32f1
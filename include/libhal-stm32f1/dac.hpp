@@ -0,0 +1,203 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <span>
+
+#include <libhal/dac.hpp>
+#include <libhal/error.hpp>
+#include <libhal/units.hpp>
+
+#include "timer.hpp"
+
+namespace hal::stm32f1 {
+/// Basic timer whose update event paces a DAC stream. The values are the
+/// CR.TSEL trigger selections.
+enum class dac_trigger : std::uint8_t
+{
+  timer6 = 0b000,
+  timer7 = 0b010,
+};
+
+/**
+ * @brief Pack one sample of each channel for the dual channel register
+ *
+ * @param p_channel1 - 12-bit sample of channel 1
+ * @param p_channel2 - 12-bit sample of channel 2
+ * @return constexpr std::uint32_t - value of DHR12RD
+ */
+constexpr std::uint32_t pack_dac_samples(std::uint16_t p_channel1,
+                                         std::uint16_t p_channel2)
+{
+  return (static_cast<std::uint32_t>(p_channel2 & 0xFFF) << 16) |
+         (p_channel1 & 0xFFFU);
+}
+
+/// DAC output settings
+struct dac_settings
+{
+  /// Enable the output buffer, which lowers the output impedance at the cost
+  /// of not reaching the supply rails.
+  bool output_buffer = true;
+};
+
+/// Settings of a timer paced DAC stream
+struct dac_stream_settings
+{
+  /// Samples output per second
+  hal::hertz sample_rate;
+  /// Timer pacing the stream, reserved until the stream is stopped
+  dac_trigger trigger = dac_trigger::timer6;
+};
+
+/**
+ * @brief Digital to analog converter implementation for the stm32f1
+ *
+ * Available on high density and connectivity line devices. Channel 1 outputs
+ * on PA4 and channel 2 on PA5.
+ *
+ * Beyond single writes, a channel can stream samples from a buffer in a
+ * loop: TIM6 or TIM7 triggers the conversions and DMA2 refills the holding
+ * register, so the waveform has no CPU involvement and no jitter beyond that
+ * of the timer clock. Channel 1 uses DMA2 channel 3 and channel 2 uses DMA2
+ * channel 4.
+ *
+ */
+class dac : public hal::dac
+{
+public:
+  /**
+   * @brief Get a DAC channel
+   *
+   * @param p_channel - channel 1 (PA4) or 2 (PA5)
+   * @param p_settings - output settings
+   * @return result<dac> - DAC driver, fails with `invalid_argument` if the
+   * channel does not exist.
+   */
+  static result<dac> get(std::uint8_t p_channel, dac_settings p_settings = {});
+
+  /// A running stream moves with the driver, the source is left without one
+  dac(dac&& p_other) noexcept;
+  dac& operator=(dac&& p_other) noexcept;
+  dac(const dac&) = delete;
+  dac& operator=(const dac&) = delete;
+  /// Stops a running stream and releases the DAC and port A power references
+  ~dac();
+
+  /**
+   * @brief Output a raw 12-bit value
+   *
+   * @param p_value - value from 0 to 4095, upper bits are ignored
+   */
+  void write_raw(std::uint16_t p_value);
+
+  /**
+   * @brief Output a buffer of 12-bit samples in a loop
+   *
+   * The buffer is read by DMA until stop_stream() is called or the driver is
+   * destroyed, so it must stay alive for as long as the stream runs. Writing
+   * to the buffer while it streams updates the waveform in place.
+   *
+   * @param p_samples - samples, 1 to 65535 of them
+   * @param p_settings - rate and pacing timer
+   * @return status - fails with `invalid_argument` if the buffer size is out
+   * of range, `argument_out_of_domain` if the timer cannot produce the sample
+   * rate, and `device_or_resource_busy` if the timer or DMA channel is in use.
+   */
+  status stream(std::span<const std::uint16_t> p_samples,
+                dac_stream_settings p_settings);
+
+  /**
+   * @brief Stop a running stream and release its timer and DMA channel
+   *
+   * The output holds the last sample.
+   */
+  void stop_stream();
+
+private:
+  dac(std::uint8_t p_channel);
+
+  result<write_t> driver_write(float p_percentage) override;
+  void release();
+
+  std::uint8_t m_channel;
+  std::optional<dac_trigger> m_trigger{};
+  bool m_owner = true;
+};
+
+/**
+ * @brief Both DAC channels updated together
+ *
+ * Each write of the dual channel register DHR12RD updates both outputs at
+ * the same time, which keeps X/Y or I/Q signal pairs in step.
+ *
+ */
+class dual_dac
+{
+public:
+  /**
+   * @brief Get both DAC channels
+   *
+   * @param p_settings - output settings of both channels
+   * @return result<dual_dac> - DAC driver
+   */
+  static result<dual_dac> get(dac_settings p_settings = {});
+
+  /// A running stream moves with the driver, the source is left without one
+  dual_dac(dual_dac&& p_other) noexcept;
+  dual_dac& operator=(dual_dac&& p_other) noexcept;
+  dual_dac(const dual_dac&) = delete;
+  dual_dac& operator=(const dual_dac&) = delete;
+  /// Stops a running stream and releases the DAC and port A power references
+  ~dual_dac();
+
+  /**
+   * @brief Output a pair of raw 12-bit values with a single register write
+   *
+   * @param p_channel1 - value of channel 1 from 0 to 4095
+   * @param p_channel2 - value of channel 2 from 0 to 4095
+   */
+  void write(std::uint16_t p_channel1, std::uint16_t p_channel2);
+
+  /**
+   * @brief Output a buffer of sample pairs in a loop
+   *
+   * Uses DMA2 channel 3 to write DHR12RD. See dac::stream() for the
+   * lifetime of the buffer.
+   *
+   * @param p_samples - samples packed with pack_dac_samples()
+   * @param p_settings - rate and pacing timer
+   * @return status - fails like dac::stream()
+   */
+  status stream(std::span<const std::uint32_t> p_samples,
+                dac_stream_settings p_settings);
+
+  /**
+   * @brief Stop a running stream and release its timer and DMA channel
+   *
+   */
+  void stop_stream();
+
+private:
+  dual_dac() = default;
+
+  void release();
+
+  std::optional<dac_trigger> m_trigger{};
+  bool m_owner = true;
+};
+}  // namespace hal::stm32f1
@@ -0,0 +1,118 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include <libhal/error.hpp>
+
+#include "ramfunc.hpp"
+
+/// Number of work items the deferred work queue holds, a power of 2. Define
+/// it for the whole build, as the queue lives in the library.
+#if !defined(HAL_STM32F1_DEFERRED_WORK_CAPACITY)
+#define HAL_STM32F1_DEFERRED_WORK_CAPACITY 32
+#endif
+
+namespace hal::stm32f1 {
+/// Number of work items the deferred work queue holds
+static constexpr std::size_t deferred_work_capacity =
+  HAL_STM32F1_DEFERRED_WORK_CAPACITY;
+
+static_assert(deferred_work_capacity >= 2 &&
+                (deferred_work_capacity & (deferred_work_capacity - 1)) == 0,
+              "The deferred work capacity must be a power of 2");
+
+/// Function run by the deferred work handler
+using deferred_function = void (*)(std::uintptr_t p_argument);
+
+/// Counters of the deferred work queue for sizing its capacity
+struct deferred_work_statistics
+{
+  /// Items accepted by post_deferred_work()
+  std::uint32_t posted = 0;
+  /// Items rejected because the queue was full
+  std::uint32_t overflows = 0;
+  /// Most items waiting in the queue at once
+  std::uint32_t max_depth = 0;
+};
+
+/**
+ * @brief PendSV handler that runs the deferred work
+ *
+ * Installed by start_deferred_work(). Applications using a static vector
+ * table must place it in the table themselves.
+ *
+ */
+HAL_STM32F1_RAMFUNC void deferred_work_interrupt();
+
+/**
+ * @brief Install the deferred work handler at the lowest priority
+ *
+ * PendSV is given the lowest priority, so deferred work runs once every
+ * interrupt handler has returned and never delays one. Other users of
+ * PendSV, such as an RTOS context switch, cannot share it.
+ *
+ * @return status - fails with `operation_not_permitted` if the vector table
+ * is in flash and does not hold deferred_work_interrupt().
+ */
+status start_deferred_work();
+
+/**
+ * @brief Queue a function to run after the interrupt handlers return
+ *
+ * Lock free and safe to call from any interrupt priority and from thread
+ * mode, so an interrupt handler only has to clear its flags, capture its
+ * data and post the rest of its work. Items run in the order they were
+ * posted.
+ *
+ * Usage:
+ *
+ *     void can_rx_interrupt()
+ *     {
+ *       auto frame = read_mailbox();
+ *       post_deferred_work(parse_frame, frame.id);
+ *     }
+ *
+ * @param p_function - function to run
+ * @param p_argument - argument passed to the function
+ * @return true - the item is queued
+ * @return false - the queue is full, the item is dropped and counted as an
+ * overflow
+ */
+bool post_deferred_work(deferred_function p_function,
+                        std::uintptr_t p_argument = 0);
+
+/**
+ * @brief Number of items waiting in the queue
+ *
+ * @return std::size_t - items posted and not yet run
+ */
+[[nodiscard]] std::size_t pending_deferred_work();
+
+/**
+ * @brief Read the counters of the deferred work queue
+ *
+ * @return deferred_work_statistics - counters since the last reset
+ */
+[[nodiscard]] deferred_work_statistics read_deferred_work_statistics();
+
+/**
+ * @brief Clear the counters of the deferred work queue
+ *
+ */
+void reset_deferred_work_statistics();
+}  // namespace hal::stm32f1
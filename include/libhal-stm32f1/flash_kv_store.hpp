@@ -0,0 +1,238 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <cstdint>
+#include <span>
+
+#include <libhal/error.hpp>
+#include <libhal/units.hpp>
+
+namespace hal::stm32f1 {
+/**
+ * @brief Page erasable, half-word programmable storage
+ *
+ * Models the programming rules of the stm32f1 flash: a page must be erased
+ * (all bits set to 1) before any half-word within it can be programmed, and a
+ * half-word can only be programmed once between erases.
+ *
+ */
+class flash_page_storage
+{
+public:
+  /// Value of a half-word that has been erased and not yet programmed
+  static constexpr std::uint16_t erased_half_word = 0xFFFF;
+
+  /**
+   * @brief Size of each page in bytes
+   *
+   * @return std::uint32_t - page size in bytes
+   */
+  [[nodiscard]] std::uint32_t page_size()
+  {
+    return driver_page_size();
+  }
+
+  /**
+   * @brief Number of pages available to this storage
+   *
+   * @return std::uint32_t - number of pages
+   */
+  [[nodiscard]] std::uint32_t page_count()
+  {
+    return driver_page_count();
+  }
+
+  /**
+   * @brief Read a half-word from a page
+   *
+   * @param p_page - page index
+   * @param p_offset - byte offset within the page, must be half-word aligned
+   * @return std::uint16_t - contents of the half-word
+   */
+  [[nodiscard]] std::uint16_t read(std::uint32_t p_page,
+                                   std::uint32_t p_offset)
+  {
+    return driver_read(p_page, p_offset);
+  }
+
+  /**
+   * @brief Program an erased half-word within a page
+   *
+   * @param p_page - page index
+   * @param p_offset - byte offset within the page, must be half-word aligned
+   * @param p_value - value to program
+   * @return status - success or failure, fails if the half-word was not
+   * erased prior to programming.
+   */
+  [[nodiscard]] status program(std::uint32_t p_page,
+                               std::uint32_t p_offset,
+                               std::uint16_t p_value)
+  {
+    return driver_program(p_page, p_offset, p_value);
+  }
+
+  /**
+   * @brief Erase every half-word in a page back to `erased_half_word`
+   *
+   * @param p_page - page index
+   * @return status - success or failure
+   */
+  [[nodiscard]] status erase(std::uint32_t p_page)
+  {
+    return driver_erase(p_page);
+  }
+
+  virtual ~flash_page_storage() = default;
+
+private:
+  virtual std::uint32_t driver_page_size() = 0;
+  virtual std::uint32_t driver_page_count() = 0;
+  virtual std::uint16_t driver_read(std::uint32_t p_page,
+                                    std::uint32_t p_offset) = 0;
+  virtual status driver_program(std::uint32_t p_page,
+                                std::uint32_t p_offset,
+                                std::uint16_t p_value) = 0;
+  virtual status driver_erase(std::uint32_t p_page) = 0;
+};
+
+/**
+ * @brief Log structured key/value store spread across flash pages
+ *
+ * Values are appended to the active page as records of half-words, so
+ * updating a value never requires a page erase. When the active page fills,
+ * the latest copy of each value is compacted into the next page of the ring
+ * and the old page is erased. This spreads erase cycles evenly across every
+ * page given to the store.
+ *
+ * Page layout:
+ *
+ *     [magic][generation][record]...[record][0xFFFF...]
+ *
+ * Record layout, written in order, with the key written last to commit the
+ * record:
+ *
+ *     [length][data half-words...][key]
+ *
+ * The location of the latest record for each key is held in a caller
+ * provided RAM index which is rebuilt by scanning the active page when the
+ * store is created. Keys are used directly as indices into that table, making
+ * lookups O(1).
+ *
+ * This class is not thread or interrupt safe.
+ *
+ */
+class flash_kv_store
+{
+public:
+  /// Key type for the store, keys must be less than the size of the index.
+  using key_t = std::uint16_t;
+
+  /// Value held within the index for keys that do not have a value
+  static constexpr std::uint32_t no_record = 0xFFFF'FFFF;
+
+  /**
+   * @brief Create a store over the storage and rebuild its index
+   *
+   * If no valid page is found, the first page is formatted as an empty store.
+   *
+   * @param p_storage - storage to persist records into, must have at least 2
+   * pages.
+   * @param p_index - RAM index, one entry per usable key. Must outlive the
+   * store.
+   * @return result<flash_kv_store> - the store or an error if the storage or
+   * index are unusable.
+   */
+  static result<flash_kv_store> create(flash_page_storage& p_storage,
+                                       std::span<std::uint32_t> p_index);
+
+  /**
+   * @brief Read the latest value for a key
+   *
+   * @param p_key - key to read
+   * @param p_buffer - buffer to fill with the value
+   * @return result<std::span<hal::byte>> - the portion of p_buffer filled
+   * with the value. Fails with `no_such_file_or_directory` if the key has no
+   * value and `message_size` if p_buffer is too small.
+   */
+  result<std::span<hal::byte>> read(key_t p_key,
+                                    std::span<hal::byte> p_buffer);
+
+  /**
+   * @brief Append a new value for a key
+   *
+   * @param p_key - key to write
+   * @param p_value - bytes of the value
+   * @return status - success or failure. Fails with `no_space_on_device` if
+   * the value does not fit in a page after compaction.
+   */
+  status write(key_t p_key, std::span<const hal::byte> p_value);
+
+  /**
+   * @brief Remove the value for a key
+   *
+   * @param p_key - key to remove
+   * @return status - success or failure
+   */
+  status remove(key_t p_key);
+
+  /**
+   * @brief Determine if a key has a value
+   *
+   * @param p_key - key to check
+   * @return true - the key has a value
+   * @return false - the key does not have a value or is out of range
+   */
+  [[nodiscard]] bool contains(key_t p_key) const;
+
+  /**
+   * @brief Length of the value for a key
+   *
+   * @param p_key - key to check
+   * @return std::uint16_t - length of the value in bytes, 0 if the key has no
+   * value.
+   */
+  [[nodiscard]] std::uint16_t size(key_t p_key);
+
+  /**
+   * @brief Bytes left in the active page before a compaction is required
+   *
+   * @return std::uint32_t - number of free bytes
+   */
+  [[nodiscard]] std::uint32_t free_space();
+
+private:
+  flash_kv_store(flash_page_storage& p_storage,
+                 std::span<std::uint32_t> p_index);
+
+  status mount();
+  status format(std::uint32_t p_page, std::uint16_t p_generation);
+  status erase_if_not_blank(std::uint32_t p_page);
+  status compact();
+  status append_record(std::uint16_t p_length_field,
+                       key_t p_key,
+                       std::span<const hal::byte> p_value);
+  result<std::uint32_t> copy_record(std::uint32_t p_location,
+                                    std::uint32_t p_page,
+                                    std::uint32_t p_offset);
+
+  flash_page_storage* m_storage;
+  std::span<std::uint32_t> m_index;
+  std::uint32_t m_page_size = 0;
+  std::uint32_t m_active_page = 0;
+  std::uint32_t m_write_offset = 0;
+  std::uint16_t m_generation = 0;
+};
+}  // namespace hal::stm32f1
@@ -0,0 +1,348 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <optional>
+#include <span>
+
+#include <libhal/error.hpp>
+#include <libhal/units.hpp>
+
+#include "clock.hpp"
+#include "peripheral_set.hpp"
+
+/**
+ * @brief Place a variable in the external SRAM region of the linker script
+ *
+ * Requires one of the `stm32f10xx?_external_sram.ld` linker scripts. The
+ * section is not loaded or zeroed at startup, as the FSMC is not running
+ * yet. Call initialize_external_sram_section() once fsmc_sram::get() has
+ * succeeded and before the variables are used, and keep the driver alive
+ * for as long as they are. Variables with constructors must be constructed
+ * in place after that point. Usage:
+ *
+ *     HAL_STM32F1_EXTERNAL_SRAM std::array<std::uint16_t, 320 * 240> frame;
+ *
+ * The attribute has no effect when building for the host.
+ */
+#if defined(__arm__)
+#define HAL_STM32F1_EXTERNAL_SRAM __attribute__((section(".external_sram")))
+#else
+#define HAL_STM32F1_EXTERNAL_SRAM
+#endif
+
+namespace hal::stm32f1 {
+/// NOR/SRAM chip select, each selects a 64MB region starting at 0x6000'0000
+enum class fsmc_bank : std::uint8_t
+{
+  /// FSMC_NE1 on PD7
+  ne1 = 0,
+  /// FSMC_NE2 on PG9
+  ne2 = 1,
+  /// FSMC_NE3 on PG10
+  ne3 = 2,
+  /// FSMC_NE4 on PG12
+  ne4 = 3,
+};
+
+/// Kind of memory on a bank, the values are the BCR.MTYP field
+enum class fsmc_memory_type : std::uint8_t
+{
+  sram = 0b00,
+  psram = 0b01,
+  nor = 0b10,
+};
+
+/// Width of the data bus, the values are the BCR.MWID field
+enum class fsmc_data_width : std::uint8_t
+{
+  bits8 = 0b00,
+  bits16 = 0b01,
+};
+
+/// Asynchronous timing requirements of a device, taken from its datasheet
+struct fsmc_device
+{
+  /// Kind of memory
+  fsmc_memory_type type = fsmc_memory_type::sram;
+  /// Width of the data bus
+  fsmc_data_width width = fsmc_data_width::bits16;
+  /// Number of address lines wired to the device, A0 upwards
+  std::uint8_t address_lines = 19;
+  /// Minimum address setup time before the read or write strobe
+  hal::time_duration address_setup = std::chrono::nanoseconds(0);
+  /// Minimum width of the read or write strobe
+  hal::time_duration data_setup = std::chrono::nanoseconds(55);
+  /// Minimum time between the end of an access and the next one
+  hal::time_duration bus_turnaround = std::chrono::nanoseconds(0);
+};
+
+/// Phase durations of an asynchronous access in HCLK cycles
+struct fsmc_timing
+{
+  /// Value of the ADDSET field, 0 to 15
+  std::uint8_t address_setup;
+  /// Value of the DATAST field, 1 to 255
+  std::uint8_t data_setup;
+  /// Value of the BUSTURN field, 0 to 15
+  std::uint8_t bus_turnaround;
+};
+
+/**
+ * @brief Compute the FSMC timing for a device
+ *
+ * Each phase is rounded up to whole HCLK cycles, so the device timings are
+ * met at any clock rate.
+ *
+ * @param p_device - device timing requirements
+ * @param p_hclk_hz - AHB clock rate, frequency_hz(peripheral::fsmc)
+ * @return constexpr std::optional<fsmc_timing> - timing or nothing if a phase
+ * does not fit in its field
+ */
+constexpr std::optional<fsmc_timing> calculate_fsmc_timing(
+  const fsmc_device& p_device,
+  std::uint32_t p_hclk_hz)
+{
+  std::uint64_t clock = p_hclk_hz;
+  auto cycles = [clock](hal::time_duration p_time) -> std::int64_t {
+    if (p_time.count() <= 0) {
+      return 0;
+    }
+    auto ticks = static_cast<std::uint64_t>(p_time.count()) * clock;
+    return static_cast<std::int64_t>((ticks + 999'999'999) / 1'000'000'000);
+  };
+
+  auto address_setup = cycles(p_device.address_setup);
+  auto data_setup = cycles(p_device.data_setup);
+  auto bus_turnaround = cycles(p_device.bus_turnaround);
+
+  if (address_setup > 15 || data_setup > 255 || bus_turnaround > 15) {
+    return std::nullopt;
+  }
+
+  return fsmc_timing{
+    .address_setup = static_cast<std::uint8_t>(address_setup),
+    .data_setup = static_cast<std::uint8_t>(data_setup == 0 ? 1 : data_setup),
+    .bus_turnaround = static_cast<std::uint8_t>(bus_turnaround),
+  };
+}
+
+/**
+ * @brief Compute the FSMC timing for a device
+ *
+ * @param p_device - device timing requirements
+ * @param p_hclk - AHB clock rate, rounded to whole Hz
+ * @return constexpr std::optional<fsmc_timing> - timing or nothing if a phase
+ * does not fit in its field
+ */
+constexpr std::optional<fsmc_timing> calculate_fsmc_timing(
+  const fsmc_device& p_device,
+  hal::hertz p_hclk)
+{
+  return calculate_fsmc_timing(p_device, to_hz(p_hclk));
+}
+
+/**
+ * @brief Base address of a bank in the CPU address space
+ *
+ * @param p_bank - chip select
+ * @return constexpr std::uintptr_t - address of the first byte of the bank
+ */
+constexpr std::uintptr_t fsmc_bank_address(fsmc_bank p_bank)
+{
+  return 0x6000'0000 + static_cast<std::uintptr_t>(p_bank) * 0x0400'0000;
+}
+
+/**
+ * @brief External SRAM, PSRAM or NOR flash mapped into the address space
+ *
+ * Available on high density devices in 100 and 144 pin packages. Configures
+ * the data, address, strobe, byte lane and chip select pins for the device
+ * and enables the bank. Afterwards the memory is accessed with ordinary loads
+ * and stores.
+ *
+ * Destroying the driver disables the bank and powers down the FSMC and the
+ * ports it acquired, once no other driver uses them.
+ *
+ */
+class fsmc_sram
+{
+public:
+  /**
+   * @brief Configure a bank for an external memory
+   *
+   * @param p_bank - chip select the device is wired to
+   * @param p_device - device description
+   * @return result<fsmc_sram> - the memory, fails with `invalid_argument` if
+   * the device has more than 26 address lines and `argument_out_of_domain` if
+   * its timing cannot be met at the current HCLK.
+   */
+  static result<fsmc_sram> get(fsmc_bank p_bank, const fsmc_device& p_device);
+
+  /// The bank moves with the driver, the source is left without it
+  fsmc_sram(fsmc_sram&& p_other) noexcept;
+  fsmc_sram& operator=(fsmc_sram&& p_other) noexcept;
+  fsmc_sram(const fsmc_sram&) = delete;
+  fsmc_sram& operator=(const fsmc_sram&) = delete;
+  /// Disables the bank and releases the FSMC and port power references
+  ~fsmc_sram();
+
+  /**
+   * @brief Get the memory of the device
+   *
+   * @return std::span<hal::byte> - every byte addressable by the wired
+   * address lines
+   */
+  [[nodiscard]] std::span<hal::byte> memory();
+
+private:
+  fsmc_sram(fsmc_bank p_bank,
+            peripheral_set p_power,
+            std::span<hal::byte> p_memory);
+
+  void release();
+
+  fsmc_bank m_bank;
+  peripheral_set m_power;
+  std::span<hal::byte> m_memory;
+  bool m_owner = true;
+};
+
+/**
+ * @brief Zero the .external_sram section of the linker script
+ *
+ * Does nothing if the linker script has no external SRAM.
+ *
+ */
+void initialize_external_sram_section();
+
+/**
+ * @brief Get the part of external SRAM not used by the .external_sram
+ * section
+ *
+ * Intended as the buffer of an allocator such as
+ * std::pmr::monotonic_buffer_resource.
+ *
+ * @return std::span<hal::byte> - free external memory, empty if the linker
+ * script has no external SRAM.
+ */
+[[nodiscard]] std::span<hal::byte> external_sram_heap();
+
+/// Settings of an 8080 style LCD controller interface
+struct fsmc_lcd_settings
+{
+  /// Address line wired to the D/C (RS) pin of the controller, 0 to 24
+  std::uint8_t register_select_line = 16;
+  /// Minimum address setup time before the write strobe
+  hal::time_duration address_setup = std::chrono::nanoseconds(10);
+  /// Minimum write strobe width, tWRL in most controller datasheets
+  hal::time_duration data_setup = std::chrono::nanoseconds(50);
+};
+
+/**
+ * @brief 16-bit 8080 parallel LCD controller interface, such as ILI9341 or
+ * ST7789
+ *
+ * The controller's D/C pin is wired to an address line, so writing to the
+ * bank with that line low sends a command and with it high sends data. Each
+ * RGB565 pixel is a single store that the FSMC turns into a write strobe.
+ *
+ * Destroying the driver disables the bank, as fsmc_sram does.
+ *
+ */
+class fsmc_lcd
+{
+public:
+  /**
+   * @brief Configure a bank for an LCD controller
+   *
+   * @param p_bank - chip select the controller is wired to
+   * @param p_settings - interface settings
+   * @return result<fsmc_lcd> - the interface, fails with `invalid_argument`
+   * if the register select line does not exist and `argument_out_of_domain`
+   * if the timing cannot be met at the current HCLK.
+   */
+  static result<fsmc_lcd> get(fsmc_bank p_bank,
+                              const fsmc_lcd_settings& p_settings);
+
+  /// The bank moves with the driver, the source is left without it
+  fsmc_lcd(fsmc_lcd&& p_other) noexcept;
+  fsmc_lcd& operator=(fsmc_lcd&& p_other) noexcept;
+  fsmc_lcd(const fsmc_lcd&) = delete;
+  fsmc_lcd& operator=(const fsmc_lcd&) = delete;
+  /// Disables the bank and releases the FSMC and port power references
+  ~fsmc_lcd();
+
+  /**
+   * @brief Send a command
+   *
+   * @param p_command - command byte or word
+   */
+  void command(std::uint16_t p_command)
+  {
+    *m_command = p_command;
+  }
+
+  /**
+   * @brief Send a data word, such as a command parameter or a pixel
+   *
+   * @param p_data - data byte or word
+   */
+  void data(std::uint16_t p_data)
+  {
+    *m_data = p_data;
+  }
+
+  /**
+   * @brief Send a run of data words
+   *
+   * @param p_data - data words such as RGB565 pixels
+   */
+  void data(std::span<const std::uint16_t> p_data)
+  {
+    for (auto word : p_data) {
+      *m_data = word;
+    }
+  }
+
+  /**
+   * @brief Address that sends data when written
+   *
+   * Usable as the destination of a memory to memory DMA transfer.
+   *
+   * @return volatile std::uint16_t* - data address
+   */
+  [[nodiscard]] volatile std::uint16_t* data_address()
+  {
+    return m_data;
+  }
+
+private:
+  fsmc_lcd(fsmc_bank p_bank,
+           peripheral_set p_power,
+           volatile std::uint16_t* p_command,
+           volatile std::uint16_t* p_data);
+
+  void release();
+
+  fsmc_bank m_bank;
+  peripheral_set m_power;
+  volatile std::uint16_t* m_command;
+  volatile std::uint16_t* m_data;
+  bool m_owner = true;
+};
+}  // namespace hal::stm32f1
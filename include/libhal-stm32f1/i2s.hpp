@@ -0,0 +1,309 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <cstdint>
+#include <initializer_list>
+#include <optional>
+#include <span>
+
+#include <libhal/error.hpp>
+#include <libhal/units.hpp>
+
+#include "clock.hpp"
+#include "peripheral_set.hpp"
+#include "ramfunc.hpp"
+
+namespace hal::stm32f1 {
+/// SPI peripheral used for I2S
+enum class i2s_bus : std::uint8_t
+{
+  /// WS on PB12, CK on PB13, SD on PB15 and MCK on PC6
+  spi2 = 0,
+  /// WS on PA15, CK on PB3, SD on PB5 and MCK on PC7. PA15 and PB3 are JTAG
+  /// pins, so JTAG is released in favor of SWD.
+  spi3 = 1,
+};
+
+/// Clock and data direction, the values are the I2SCFGR.I2SCFG field
+enum class i2s_mode : std::uint8_t
+{
+  slave_transmit = 0b00,
+  slave_receive = 0b01,
+  master_transmit = 0b10,
+  master_receive = 0b11,
+};
+
+/// Frame format, the values are the I2SCFGR.I2SSTD field
+enum class i2s_standard : std::uint8_t
+{
+  philips = 0b00,
+  msb_justified = 0b01,
+  lsb_justified = 0b10,
+  pcm = 0b11,
+};
+
+/// Sample size and channel size
+enum class i2s_data_format : std::uint8_t
+{
+  /// 16-bit samples in 16-bit channels
+  bits16,
+  /// 16-bit samples in 32-bit channels
+  bits16_in_32,
+  /// 24-bit samples in 32-bit channels, two buffer words per sample
+  bits24,
+  /// 32-bit samples in 32-bit channels, two buffer words per sample
+  bits32,
+};
+
+/// Prescaler of an I2S clock and the sample rate it produces
+struct i2s_clock
+{
+  /// Value of the I2SPR.I2SDIV field, 2 to 255
+  std::uint8_t divider;
+  /// Value of the I2SPR.ODD field
+  bool odd;
+  /// Sample rate produced by the prescaler
+  hal::hertz sample_rate;
+};
+
+/**
+ * @brief Find the prescaler giving the sample rate closest to a target
+ *
+ * @param p_clock_hz - I2S clock, frequency_hz(peripheral::i2s)
+ * @param p_sample_rate_hz - target sample rate
+ * @param p_32_bit_channels - channels are 32 bits long
+ * @param p_master_clock_output - MCK is output at 256 times the sample rate
+ * @return constexpr std::optional<i2s_clock> - prescaler or nothing if the
+ * sample rate is outside of the prescaler's range.
+ */
+constexpr std::optional<i2s_clock> calculate_i2s_clock(
+  std::uint32_t p_clock_hz,
+  std::uint32_t p_sample_rate_hz,
+  bool p_32_bit_channels,
+  bool p_master_clock_output)
+{
+  // The prescaler divides by 2 * I2SDIV + ODD, with I2SDIV from 2 to 255
+  constexpr std::uint64_t min_divide = 4;
+  constexpr std::uint64_t max_divide = 511;
+
+  if (p_clock_hz == 0 || p_sample_rate_hz == 0) {
+    return std::nullopt;
+  }
+
+  // Clock cycles of the prescaler input per sample
+  std::uint64_t frame_clocks = p_32_bit_channels ? 64 : 32;
+  if (p_master_clock_output) {
+    frame_clocks = 256;
+  }
+
+  std::uint64_t clock = p_clock_hz;
+  auto target = frame_clocks * p_sample_rate_hz;
+  auto below = clock / target;
+  auto above = below + 1;
+
+  // The rate error of a divide is |clock - target * divide| / divide, up to
+  // the common factor frame_clocks, so errors are compared cross multiplied.
+  std::optional<i2s_clock> best;
+  std::uint64_t best_error = 0;
+  std::uint64_t best_divide = 1;
+  for (auto divide : { below, above }) {
+    if (divide < min_divide || max_divide < divide) {
+      continue;
+    }
+    auto reached = target * divide;
+    auto error = clock > reached ? clock - reached : reached - clock;
+    if (!best || error * best_divide < best_error * divide) {
+      best_error = error;
+      best_divide = divide;
+      best = i2s_clock{
+        .divider = static_cast<std::uint8_t>(divide / 2),
+        .odd = (divide & 1) != 0,
+        .sample_rate = static_cast<hal::hertz>(p_clock_hz) /
+                       static_cast<hal::hertz>(frame_clocks * divide),
+      };
+    }
+  }
+  return best;
+}
+
+/**
+ * @brief Find the prescaler giving the sample rate closest to a target
+ *
+ * @param p_clock - I2S clock
+ * @param p_sample_rate - target sample rate, rounded to whole Hz
+ * @param p_32_bit_channels - channels are 32 bits long
+ * @param p_master_clock_output - MCK is output at 256 times the sample rate
+ * @return constexpr std::optional<i2s_clock> - prescaler or nothing if the
+ * sample rate is outside of the prescaler's range.
+ */
+constexpr std::optional<i2s_clock> calculate_i2s_clock(
+  hal::hertz p_clock,
+  hal::hertz p_sample_rate,
+  bool p_32_bit_channels,
+  bool p_master_clock_output)
+{
+  return calculate_i2s_clock(to_hz(p_clock),
+                             to_hz(p_sample_rate),
+                             p_32_bit_channels,
+                             p_master_clock_output);
+}
+
+/// I2S settings
+struct i2s_settings
+{
+  /// Clock and data direction
+  i2s_mode mode = i2s_mode::master_transmit;
+  /// Target sample rate, only used by master modes
+  hal::hertz sample_rate = 48'000.0f;
+  /// Frame format
+  i2s_standard standard = i2s_standard::philips;
+  /// Sample and channel size
+  i2s_data_format format = i2s_data_format::bits16;
+  /// Output a 256 times sample rate master clock on MCK
+  bool master_clock_output = false;
+};
+
+/**
+ * @brief Handler called each time DMA finishes with half of a stream buffer
+ *
+ * For transmit streams the half should be refilled with the next samples.
+ * For receive streams it holds the newest samples. Runs in interrupt context
+ * and must finish before DMA wraps around to the same half again.
+ */
+using i2s_buffer_handler = void (*)(std::span<std::uint16_t> p_half);
+
+/**
+ * @brief Interrupt service routine for the DMA channel of an I2S2 stream
+ *
+ * Installed by i2s::stream() on irq::dma1_channel5 for transmit streams or
+ * irq::dma1_channel4 for receive streams. Applications using a static vector
+ * table must place it in the table themselves.
+ *
+ */
+HAL_STM32F1_RAMFUNC void i2s2_dma_interrupt();
+
+/**
+ * @brief Interrupt service routine for the DMA channel of an I2S3 stream
+ *
+ * Installed by i2s::stream() on irq::dma2_channel2 for transmit streams or
+ * irq::dma2_channel1 for receive streams. Applications using a static vector
+ * table must place it in the table themselves.
+ *
+ */
+HAL_STM32F1_RAMFUNC void i2s3_dma_interrupt();
+
+/**
+ * @brief I2S audio interface on SPI2 or SPI3
+ *
+ * Available on high density and connectivity line devices. Audio is streamed
+ * through a circular DMA buffer split in two halves: while DMA works on one
+ * half, the handler gets the other one, so the CPU only touches the samples
+ * once per half buffer.
+ *
+ * The buffer holds the interleaved left and right channel words, in the
+ * order they appear on the bus. 24 and 32-bit samples take two words, most
+ * significant half first.
+ *
+ * Only one driver can own a bus at a time. Destroying the driver stops its
+ * stream and powers down the SPI peripheral and pin ports it acquired.
+ *
+ */
+class i2s
+{
+public:
+  /**
+   * @brief Get an I2S interface
+   *
+   * In master modes the prescaler is chosen for the sample rate closest to
+   * the target at the current I2S clock.
+   *
+   * @param p_bus - SPI peripheral to use
+   * @param p_settings - interface settings
+   * @return result<i2s> - I2S interface, fails with `argument_out_of_domain`
+   * if the sample rate cannot be produced from the I2S clock and with
+   * `device_or_resource_busy` if another driver owns the bus.
+   */
+  static result<i2s> get(i2s_bus p_bus, const i2s_settings& p_settings = {});
+
+  /// A running stream and the bus move with the driver, the source is left
+  /// without either
+  i2s(i2s&& p_other) noexcept;
+  i2s& operator=(i2s&& p_other) noexcept;
+  i2s(const i2s&) = delete;
+  i2s& operator=(const i2s&) = delete;
+  /// Stops the stream and releases the bus
+  ~i2s();
+
+  /**
+   * @brief Get the sample rate produced by the prescaler
+   *
+   * @return hal::hertz - actual sample rate, 0 in slave modes
+   */
+  [[nodiscard]] hal::hertz sample_rate() const
+  {
+    return m_sample_rate;
+  }
+
+  /**
+   * @brief Get the relative error of the sample rate
+   *
+   * @return float - (actual - target) / target, 0 in slave modes
+   */
+  [[nodiscard]] float sample_rate_error() const
+  {
+    return m_sample_rate_error;
+  }
+
+  /**
+   * @brief Start streaming through a circular buffer
+   *
+   * The buffer is used until stop() is called, so it must stay alive for as
+   * long as the stream runs. Transmit buffers should hold the first samples
+   * before the stream starts.
+   *
+   * @param p_buffer - buffer, an even number of words up to 65534
+   * @param p_handler - called with each half once DMA is done with it
+   * @return status - fails with `invalid_argument` if the buffer size is
+   * invalid, `device_or_resource_busy` if the DMA channel is in use or the
+   * driver was moved from, and `operation_not_permitted` if the vector table
+   * is in flash and does not hold the interrupt service routine.
+   */
+  status stream(std::span<std::uint16_t> p_buffer,
+                i2s_buffer_handler p_handler);
+
+  /**
+   * @brief Stop a running stream and release its DMA channel
+   *
+   */
+  void stop();
+
+private:
+  i2s(i2s_bus p_bus,
+      i2s_mode p_mode,
+      peripheral_set p_power,
+      hal::hertz p_sample_rate,
+      float p_sample_rate_error);
+
+  void release();
+
+  i2s_bus m_bus;
+  i2s_mode m_mode;
+  peripheral_set m_power;
+  hal::hertz m_sample_rate;
+  float m_sample_rate_error;
+  bool m_owner = true;
+};
+}  // namespace hal::stm32f1
@@ -0,0 +1,66 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <cstdint>
+
+#include <libhal/error.hpp>
+
+#include "flash_kv_store.hpp"
+
+namespace hal::stm32f1 {
+/**
+ * @brief Page storage backed by the stm32f1 internal flash
+ *
+ * Low and medium density devices have 1 KiB pages. High density, XL density
+ * and connectivity line devices have 2 KiB pages. The pages used should be
+ * kept out of the application image by shrinking the flash region of the
+ * linker script.
+ *
+ */
+class internal_flash : public flash_page_storage
+{
+public:
+  /**
+   * @brief Get an internal flash storage object
+   *
+   * @param p_address - address of the first page, must be page aligned
+   * @param p_page_size - size of each page in bytes, either 1024 or 2048
+   * @param p_page_count - number of consecutive pages to use
+   * @return result<internal_flash> - internal flash storage object
+   */
+  static result<internal_flash> get(std::uint32_t p_address,
+                                    std::uint32_t p_page_size,
+                                    std::uint32_t p_page_count);
+
+private:
+  internal_flash(std::uint32_t p_address,
+                 std::uint32_t p_page_size,
+                 std::uint32_t p_page_count);
+
+  std::uint32_t driver_page_size() override;
+  std::uint32_t driver_page_count() override;
+  std::uint16_t driver_read(std::uint32_t p_page,
+                            std::uint32_t p_offset) override;
+  status driver_program(std::uint32_t p_page,
+                        std::uint32_t p_offset,
+                        std::uint16_t p_value) override;
+  status driver_erase(std::uint32_t p_page) override;
+
+  std::uint32_t m_address = 0;
+  std::uint32_t m_page_size = 0;
+  std::uint32_t m_page_count = 0;
+};
+}  // namespace hal::stm32f1
@@ -0,0 +1,320 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+
+#include <libhal/error.hpp>
+
+#include "constants.hpp"
+
+namespace hal::stm32f1 {
+/// Function signature of an interrupt service routine
+using interrupt_handler = void (*)();
+
+/// Number of vectors used by the Cortex-M3 core before the first irq
+static constexpr std::size_t core_vector_count = 16;
+
+/// Number of vectors in the stm32f1 vector table
+static constexpr std::size_t vector_count =
+  core_vector_count + static_cast<std::size_t>(irq::max);
+
+/// VTOR requires the table to be aligned to its size rounded up to the next
+/// power of 2.
+static constexpr std::size_t vector_table_alignment =
+  std::bit_ceil(vector_count * sizeof(interrupt_handler));
+
+/// Complete vector table, index 0 holds the initial stack pointer and index 1
+/// the reset handler.
+using vector_table = std::array<interrupt_handler, vector_count>;
+
+/// Cortex-M3 system exceptions that can be given a handler
+enum class exception : std::uint8_t
+{
+  non_maskable_interrupt = 2,
+  hard_fault = 3,
+  memory_management_fault = 4,
+  bus_fault = 5,
+  usage_fault = 6,
+  supervisor_call = 11,
+  debug_monitor = 12,
+  pend_sv = 14,
+  system_tick = 15,
+};
+
+/// Split of the 4 implemented priority bits between preemption priority and
+/// sub-priority. Only the preemption priority decides if an interrupt can
+/// interrupt another. The sub-priority decides which of two pending
+/// interrupts of equal preemption priority is serviced first.
+enum class priority_group : std::uint8_t
+{
+  preempt_4_bits_sub_0_bits = 3,
+  preempt_3_bits_sub_1_bits = 4,
+  preempt_2_bits_sub_2_bits = 5,
+  preempt_1_bits_sub_3_bits = 6,
+  preempt_0_bits_sub_4_bits = 7,
+};
+
+/// Priority assignment for a single interrupt. Lower numbers are higher
+/// priority.
+struct irq_priority
+{
+  irq id;
+  std::uint8_t preempt;
+  std::uint8_t sub = 0;
+};
+
+/**
+ * @brief Default handler for vectors without a handler
+ *
+ * Halts the device. A debugger can read the IPSR register to find out which
+ * vector was taken.
+ *
+ */
+void unhandled_interrupt();
+
+/**
+ * @brief Builds a complete vector table at compile time
+ *
+ * Usage:
+ *
+ *     constexpr auto table = vector_table_builder{}
+ *                              .set(irq::dma1_channel1, dma_handler)
+ *                              .set(exception::hard_fault, fault_handler)
+ *                              .build();
+ *     use_static_vector_table<table>();
+ *
+ */
+class vector_table_builder
+{
+public:
+  /**
+   * @brief Start with every vector set to p_default_handler
+   *
+   * @param p_default_handler - handler for vectors that are not set
+   */
+  constexpr vector_table_builder(
+    interrupt_handler p_default_handler = unhandled_interrupt)
+  {
+    m_table.fill(p_default_handler);
+    // The stack pointer and reset vector are only read from the boot table
+    m_table[0] = nullptr;
+    m_table[1] = nullptr;
+  }
+
+  /**
+   * @brief Set the handler for an interrupt request
+   *
+   * @param p_irq - interrupt request
+   * @param p_handler - handler to run
+   * @return constexpr vector_table_builder& - this builder
+   */
+  constexpr vector_table_builder& set(irq p_irq, interrupt_handler p_handler)
+  {
+    m_table[core_vector_count + static_cast<std::size_t>(p_irq)] = p_handler;
+    return *this;
+  }
+
+  /**
+   * @brief Set the handler for a system exception
+   *
+   * @param p_exception - system exception
+   * @param p_handler - handler to run
+   * @return constexpr vector_table_builder& - this builder
+   */
+  constexpr vector_table_builder& set(exception p_exception,
+                                      interrupt_handler p_handler)
+  {
+    m_table[static_cast<std::size_t>(p_exception)] = p_handler;
+    return *this;
+  }
+
+  /**
+   * @brief Produce the vector table
+   *
+   * @return constexpr vector_table - the completed table
+   */
+  [[nodiscard]] constexpr vector_table build() const
+  {
+    return m_table;
+  }
+
+private:
+  vector_table m_table{};
+};
+
+/// Aligned storage in flash for a table produced by vector_table_builder
+template<vector_table Table>
+alignas(vector_table_alignment) inline constexpr vector_table
+  static_vector_table = Table;
+
+/**
+ * @brief Point VTOR at a vector table
+ *
+ * @param p_table - table aligned to vector_table_alignment
+ */
+void set_vector_table(const interrupt_handler* p_table);
+
+/**
+ * @brief Use a vector table that is fully built at compile time
+ *
+ * The table lives in flash, costs no RAM and cannot be changed at runtime.
+ * Handlers are entered directly from the table with no dispatch overhead.
+ *
+ * @tparam Table - table produced by vector_table_builder
+ */
+template<vector_table Table>
+void use_static_vector_table()
+{
+  set_vector_table(static_vector_table<Table>.data());
+}
+
+/**
+ * @brief Relocate the vector table into RAM to allow runtime installation
+ *
+ * Copies the vector table currently pointed to by VTOR into a RAM table and
+ * points VTOR at it. Calling this more than once has no further effect.
+ *
+ */
+void initialize_ram_vector_table();
+
+/**
+ * @brief Install a handler for an interrupt request
+ *
+ * Works with any vector table located in RAM, including the one created by
+ * hal::cortex_m::interrupt::initialize(). When HAL_STM32F1_ISR_STATISTICS
+ * is 1 the vector holds a trampoline that times p_handler, see
+ * isr_statistics.hpp.
+ *
+ * @param p_irq - interrupt request
+ * @param p_handler - handler to run
+ * @return status - fails with `operation_not_permitted` if the active vector
+ * table is in flash and does not already hold p_handler.
+ */
+status install_handler(irq p_irq, interrupt_handler p_handler);
+
+/**
+ * @brief Install a handler for a system exception
+ *
+ * @param p_exception - system exception
+ * @param p_handler - handler to run
+ * @return status - fails with `operation_not_permitted` if the active vector
+ * table is in flash and does not already hold p_handler.
+ */
+status install_handler(exception p_exception, interrupt_handler p_handler);
+
+/**
+ * @brief Enable an interrupt request within the NVIC
+ *
+ * @param p_irq - interrupt request
+ */
+void enable_interrupt(irq p_irq);
+
+/**
+ * @brief Disable an interrupt request within the NVIC
+ *
+ * @param p_irq - interrupt request
+ */
+void disable_interrupt(irq p_irq);
+
+/**
+ * @brief Determine if an interrupt request is enabled within the NVIC
+ *
+ * @param p_irq - interrupt request
+ * @return true - the interrupt is enabled
+ * @return false - the interrupt is disabled
+ */
+[[nodiscard]] bool is_interrupt_enabled(irq p_irq);
+
+/**
+ * @brief Set how priority bits are split between preempt and sub priority
+ *
+ * Should be called once before assigning priorities, as changing the group
+ * reinterprets every priority already assigned.
+ *
+ * @param p_group - priority grouping
+ */
+void set_priority_grouping(priority_group p_group);
+
+/**
+ * @brief Get the active priority grouping
+ *
+ * @return priority_group - the active priority grouping
+ */
+[[nodiscard]] priority_group get_priority_grouping();
+
+/**
+ * @brief Set the priority of an interrupt request
+ *
+ * Values out of range of the active priority grouping are truncated.
+ *
+ * @param p_irq - interrupt request
+ * @param p_preempt - preemption priority, lower is higher priority
+ * @param p_sub - sub-priority, lower is higher priority
+ */
+void set_priority(irq p_irq, std::uint8_t p_preempt, std::uint8_t p_sub = 0);
+
+/**
+ * @brief Set the priority of a configurable system exception
+ *
+ * @param p_exception - system exception, must be memory_management_fault or
+ * above.
+ * @param p_preempt - preemption priority, lower is higher priority
+ * @param p_sub - sub-priority, lower is higher priority
+ */
+void set_priority(exception p_exception,
+                  std::uint8_t p_preempt,
+                  std::uint8_t p_sub = 0);
+
+/**
+ * @brief Assign a list of interrupt priorities
+ *
+ * Usage:
+ *
+ *     set_priorities(std::array{
+ *       irq_priority{ .id = irq::dma1_channel1, .preempt = 0 },
+ *       irq_priority{ .id = irq::tim2, .preempt = 1 },
+ *       irq_priority{ .id = irq::usart1, .preempt = 3 },
+ *     });
+ *
+ * @param p_priorities - priorities to assign
+ */
+void set_priorities(std::span<const irq_priority> p_priorities);
+
+/**
+ * @brief Encode preempt and sub priorities into an NVIC priority byte
+ *
+ * @param p_group - priority grouping in effect
+ * @param p_preempt - preemption priority
+ * @param p_sub - sub-priority
+ * @return constexpr std::uint8_t - priority byte
+ */
+constexpr std::uint8_t encode_priority(priority_group p_group,
+                                       std::uint8_t p_preempt,
+                                       std::uint8_t p_sub)
+{
+  constexpr std::uint32_t implemented_bits = 4;
+  auto sub_bits = static_cast<std::uint32_t>(p_group) - 3U;
+  auto preempt_bits = implemented_bits - sub_bits;
+  auto preempt = p_preempt & ((1U << preempt_bits) - 1U);
+  auto sub = p_sub & ((1U << sub_bits) - 1U);
+  auto priority = (preempt << sub_bits) | sub;
+  return static_cast<std::uint8_t>(priority << (8 - implemented_bits));
+}
+}  // namespace hal::stm32f1
@@ -0,0 +1,120 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+
+#include "constants.hpp"
+
+/// Set to 1, through the `isr_statistics` package option, to time every
+/// handler installed with install_handler(irq, ...). When 0 the
+/// instrumentation and its table are not compiled.
+#if !defined(HAL_STM32F1_ISR_STATISTICS)
+#define HAL_STM32F1_ISR_STATISTICS 0
+#endif
+
+namespace hal::stm32f1 {
+/// Number of histogram buckets, the last one collects every duration of
+/// 2^(isr_histogram_buckets - 2) cycles or more.
+static constexpr std::size_t isr_histogram_buckets = 16;
+
+/**
+ * @brief Get the histogram bucket of a duration
+ *
+ * Bucket 0 holds durations of 0 cycles and bucket n holds durations from
+ * 2^(n - 1) to 2^n - 1 cycles.
+ *
+ * @param p_cycles - duration in CPU cycles
+ * @return constexpr std::size_t - bucket index
+ */
+constexpr std::size_t isr_histogram_bucket(std::uint32_t p_cycles)
+{
+  return std::min<std::size_t>(std::bit_width(p_cycles),
+                               isr_histogram_buckets - 1);
+}
+
+/// Execution time statistics of one interrupt request
+struct isr_statistics
+{
+  /// Number of times the handler ran
+  std::uint32_t count = 0;
+  /// Longest run in CPU cycles
+  std::uint32_t max_cycles = 0;
+  /// Number of runs per isr_histogram_bucket(), saturating at 65535
+  std::array<std::uint16_t, isr_histogram_buckets> histogram{};
+
+  /**
+   * @brief Add a run of the handler
+   *
+   * @param p_cycles - duration of the run in CPU cycles
+   */
+  constexpr void record(std::uint32_t p_cycles)
+  {
+    count++;
+    max_cycles = std::max(max_cycles, p_cycles);
+    auto& bucket = histogram[isr_histogram_bucket(p_cycles)];
+    if (bucket != std::numeric_limits<std::uint16_t>::max()) {
+      bucket++;
+    }
+  }
+};
+
+#if HAL_STM32F1_ISR_STATISTICS
+/**
+ * @brief Statistics of every interrupt request, indexed by irq value
+ *
+ * Installing a handler with install_handler(irq, ...) places a trampoline in
+ * the vector table that times the handler with the DWT cycle counter. The
+ * duration includes the time spent in interrupts that preempt the handler.
+ * Handlers placed in a static vector table are not timed.
+ *
+ * The table is a plain global so a debugger can read it with
+ * `print hal::stm32f1::isr_statistics_table`. It takes 40 bytes per irq.
+ */
+extern std::array<isr_statistics, static_cast<std::size_t>(irq::max)>
+  isr_statistics_table;
+
+/**
+ * @brief Get the statistics of an interrupt request
+ *
+ * The copy is not atomic, a run recorded while copying can be partially
+ * included.
+ *
+ * @param p_irq - interrupt request
+ * @return isr_statistics - copy of its statistics
+ */
+[[nodiscard]] isr_statistics read_isr_statistics(irq p_irq);
+
+/**
+ * @brief Clear the statistics of every interrupt request
+ *
+ */
+void reset_isr_statistics();
+#else
+[[nodiscard]] inline isr_statistics read_isr_statistics(irq)
+{
+  return {};
+}
+
+inline void reset_isr_statistics()
+{
+}
+#endif
+}  // namespace hal::stm32f1
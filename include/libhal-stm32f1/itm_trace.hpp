@@ -0,0 +1,186 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <array>
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <span>
+
+#include <libhal/error.hpp>
+#include <libhal/units.hpp>
+
+#include "clock.hpp"
+
+namespace hal::stm32f1 {
+/// Number of ITM stimulus ports
+static constexpr std::size_t itm_port_count = 32;
+
+/// Largest event id, ids are 12 bits wide
+static constexpr std::uint16_t max_trace_event_id = 0xFFF;
+
+/// Most arguments a single event can carry
+static constexpr std::size_t max_trace_arguments = 15;
+
+/// Settings of the SWO trace output
+struct itm_trace_settings
+{
+  /// Bit rate of the SWO pin, the probe must be set to the same rate
+  hal::hertz swo_rate = 2.0_MHz;
+  /// Emit ITM local timestamp packets, in CPU cycles, after each event word
+  bool timestamps = true;
+};
+
+/**
+ * @brief Compute the TPIU prescaler for a SWO bit rate
+ *
+ * @param p_cpu_clock_hz - CPU clock rate, which clocks the TPIU
+ * @param p_swo_rate_hz - desired SWO bit rate
+ * @return constexpr std::optional<std::uint16_t> - value of TPIU ACPR, or
+ * nothing if the rate cannot be reached within 3%, the tolerance of a UART
+ * receiver
+ */
+constexpr std::optional<std::uint16_t> calculate_swo_prescaler(
+  std::uint32_t p_cpu_clock_hz,
+  std::uint32_t p_swo_rate_hz)
+{
+  constexpr std::uint64_t max_prescaler = 0x1FFF;
+
+  if (p_swo_rate_hz == 0 || p_cpu_clock_hz < p_swo_rate_hz) {
+    return std::nullopt;
+  }
+
+  std::uint64_t clock = p_cpu_clock_hz;
+  std::uint64_t rate = p_swo_rate_hz;
+  auto divider = (clock + rate / 2) / rate;
+  if (divider - 1 > max_prescaler) {
+    return std::nullopt;
+  }
+
+  // |clock / divider - rate| <= 3% of rate, scaled by 100 * divider
+  auto reached = divider * rate;
+  auto error = clock > reached ? clock - reached : reached - clock;
+  if (error * 100 > reached * 3) {
+    return std::nullopt;
+  }
+
+  return static_cast<std::uint16_t>(divider - 1);
+}
+
+/**
+ * @brief Compute the TPIU prescaler for a SWO bit rate
+ *
+ * @param p_cpu_clock - CPU clock rate, which clocks the TPIU
+ * @param p_swo_rate - desired SWO bit rate, rounded to whole Hz
+ * @return constexpr std::optional<std::uint16_t> - value of TPIU ACPR, or
+ * nothing if the rate cannot be reached within 3%
+ */
+constexpr std::optional<std::uint16_t> calculate_swo_prescaler(
+  hal::hertz p_cpu_clock,
+  hal::hertz p_swo_rate)
+{
+  return calculate_swo_prescaler(to_hz(p_cpu_clock), to_hz(p_swo_rate));
+}
+
+/**
+ * @brief Encode the header word of a trace event
+ *
+ * The header is written to the stimulus port as a 2 byte packet and each
+ * argument as a 4 byte packet, so a decoder can tell them apart by size and
+ * resynchronize after a dropped word.
+ *
+ * @param p_id - event id, up to max_trace_event_id
+ * @param p_argument_count - number of arguments that follow
+ * @return constexpr std::uint16_t - header word
+ */
+constexpr std::uint16_t trace_event_header(std::uint16_t p_id,
+                                           std::size_t p_argument_count)
+{
+  return static_cast<std::uint16_t>((p_id & max_trace_event_id) |
+                                    (p_argument_count << 12));
+}
+
+/**
+ * @brief Route the ITM to the SWO pin
+ *
+ * Sets up the TPIU for NRZ output on PB3, clocked from
+ * frequency(peripheral::cpu), and enables every stimulus port. PB3 is taken
+ * from JTAG with configure_debug_port(debug_port::serial_wire_only), so the
+ * debugger must use SWD. Call again after the CPU clock changes.
+ *
+ * A debugger that configures SWO itself overrides these settings.
+ *
+ * @param p_settings - SWO settings
+ * @return status - fails with `argument_out_of_domain` if the SWO rate
+ * cannot be derived from the CPU clock
+ */
+status start_itm_trace(const itm_trace_settings& p_settings = {});
+
+/**
+ * @brief Write a trace event
+ *
+ * Never waits. If the stimulus port FIFO is full the event, or the rest of
+ * it, is dropped and counted by dropped_trace_events(). Each word of an event
+ * is a separate write, so code that can interrupt other tracing code must
+ * trace to its own port, such as one port per interrupt priority level. The
+ * decoder keeps the ports apart.
+ *
+ * @param p_port - stimulus port, 0 to 31
+ * @param p_id - event id, up to max_trace_event_id
+ * @param p_arguments - up to max_trace_arguments arguments
+ * @return true - the event was written in full
+ * @return false - the event was dropped or truncated
+ */
+bool trace_event(std::uint8_t p_port,
+                 std::uint16_t p_id,
+                 std::span<const std::uint32_t> p_arguments);
+
+/**
+ * @brief Write a trace event
+ *
+ * Usage:
+ *
+ *     enum trace_id : std::uint16_t { adc_sample = 1, dma_done = 2 };
+ *     trace_event(0, adc_sample, channel, reading);
+ *
+ * @param p_port - stimulus port, 0 to 31
+ * @param p_id - event id, up to max_trace_event_id
+ * @param p_arguments - integer arguments, each sent as 32 bits
+ * @return true - the event was written in full
+ * @return false - the event was dropped or truncated
+ */
+template<std::integral... Arguments>
+bool trace_event(std::uint8_t p_port,
+                 std::uint16_t p_id,
+                 Arguments... p_arguments)
+{
+  static_assert(sizeof...(Arguments) <= max_trace_arguments,
+                "Too many arguments for a single trace event");
+
+  const std::array<std::uint32_t, sizeof...(Arguments)> arguments{
+    static_cast<std::uint32_t>(p_arguments)...
+  };
+  return trace_event(p_port, p_id, std::span<const std::uint32_t>(arguments));
+}
+
+/**
+ * @brief Number of events dropped or truncated because a FIFO was full
+ *
+ * @return std::uint32_t - events dropped since reset
+ */
+[[nodiscard]] std::uint32_t dropped_trace_events();
+}  // namespace hal::stm32f1
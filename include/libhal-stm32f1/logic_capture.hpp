@@ -0,0 +1,260 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <span>
+
+#include <libhal/error.hpp>
+#include <libhal/units.hpp>
+
+#include "constants.hpp"
+
+namespace hal::stm32f1 {
+/// Level condition on the pins of a port
+struct capture_trigger
+{
+  /// Pins taking part in the condition, bit n is pin n. 0 matches any sample.
+  std::uint16_t mask = 0;
+  /// Required level of the pins in the mask
+  std::uint16_t level = 0;
+
+  /**
+   * @brief Determine if a sample meets the condition
+   *
+   * @param p_sample - port input levels
+   * @return true - every pin in the mask is at its level
+   * @return false - the sample does not match
+   */
+  [[nodiscard]] constexpr bool matches(std::uint16_t p_sample) const
+  {
+    return (p_sample & mask) == (level & mask);
+  }
+};
+
+/**
+ * @brief Find the first sample meeting a trigger condition
+ *
+ * @param p_samples - samples in chronological order
+ * @param p_trigger - condition
+ * @return constexpr std::optional<std::size_t> - index of the sample or
+ * nothing if no sample matches
+ */
+constexpr std::optional<std::size_t> find_trigger(
+  std::span<const std::uint16_t> p_samples,
+  capture_trigger p_trigger)
+{
+  for (std::size_t index = 0; index < p_samples.size(); index++) {
+    if (p_trigger.matches(p_samples[index])) {
+      return index;
+    }
+  }
+  return std::nullopt;
+}
+
+/// Consecutive samples with the same level
+struct sample_run
+{
+  /// Level of the pins during the run
+  std::uint16_t level;
+  /// Number of samples in the run, runs longer than 65535 are split
+  std::uint16_t length;
+
+  constexpr bool operator==(const sample_run&) const = default;
+};
+
+/**
+ * @brief Compress samples into runs of the same level
+ *
+ * Pins that are left floating toggle at random and break up the runs, so
+ * mask them off.
+ *
+ * @param p_samples - samples in chronological order
+ * @param p_runs - destination
+ * @param p_mask - pins kept in the levels, bit n is pin n
+ * @return constexpr std::span<sample_run> - runs written. If the destination
+ * fills up, the runs only cover the start of the samples.
+ */
+constexpr std::span<sample_run> run_length_encode(
+  std::span<const std::uint16_t> p_samples,
+  std::span<sample_run> p_runs,
+  std::uint16_t p_mask = 0xFFFF)
+{
+  std::size_t count = 0;
+  for (auto sample : p_samples) {
+    auto level = static_cast<std::uint16_t>(sample & p_mask);
+    if (count != 0 && p_runs[count - 1].level == level &&
+        p_runs[count - 1].length != 0xFFFF) {
+      p_runs[count - 1].length++;
+      continue;
+    }
+    if (count == p_runs.size()) {
+      break;
+    }
+    p_runs[count++] = sample_run{ .level = level, .length = 1 };
+  }
+  return p_runs.first(count);
+}
+
+/// Settings of a logic capture
+struct logic_capture_settings
+{
+  /// Samples per second
+  hal::hertz sample_rate;
+  /// Timer pacing the samples, one of peripheral::timer1 to timer8. Its
+  /// update request selects the DMA channel, see gpio_waveform.
+  peripheral timer = peripheral::timer4;
+  /// Condition ending the capture
+  capture_trigger trigger{};
+  /// Samples kept after the trigger, the rest of the ring holds the samples
+  /// before it. Must be smaller than the ring.
+  std::size_t post_trigger_samples = 0;
+};
+
+/**
+ * @brief Timer paced DMA sampling of a GPIO port's input levels
+ *
+ * Each update event of the timer copies the port's IDR register into the
+ * next element of a ring buffer, so the 16 pins are sampled at evenly spaced
+ * points in time without the CPU. The capture runs until poll() finds the
+ * trigger and the post trigger samples have arrived, and the ring then holds
+ * the samples around the trigger.
+ *
+ * Each sample costs the DMA a few bus cycles. Rates above about a tenth of
+ * the CPU clock, or other DMA traffic, cause requests to be missed and the
+ * samples are no longer evenly spaced.
+ *
+ * Usage:
+ *
+ *     std::array<std::uint16_t, 4096> ring;
+ *     auto capture = logic_capture::get('B').value();
+ *     // Stop 1024 samples after PB12 (chip select) goes low
+ *     capture.start(ring, { .sample_rate = 4.0_MHz,
+ *                           .trigger = { .mask = 1 << 12, .level = 0 },
+ *                           .post_trigger_samples = 1024 }).value();
+ *     while (!capture.poll().value()) {
+ *       continue;
+ *     }
+ *     auto runs = run_length_encode(capture.samples(), run_buffer, 0xF000);
+ *
+ */
+class logic_capture
+{
+public:
+  /**
+   * @brief Get a logic capture of a GPIO port
+   *
+   * The pins are left as they are configured, so a capture can observe the
+   * pins of a running peripheral.
+   *
+   * @param p_port - port letter, 'A' to 'G'
+   * @return result<logic_capture> - capture driver, fails with
+   * `invalid_argument` if the port does not exist.
+   */
+  static result<logic_capture> get(std::uint8_t p_port);
+
+  /// A running capture moves with the driver, the source is left stopped
+  logic_capture(logic_capture&& p_other) noexcept;
+  logic_capture& operator=(logic_capture&& p_other) noexcept;
+  logic_capture(const logic_capture&) = delete;
+  logic_capture& operator=(const logic_capture&) = delete;
+  /// Stops a running capture, so the DMA no longer writes the ring
+  ~logic_capture();
+
+  /**
+   * @brief Start sampling into a ring buffer
+   *
+   * Stops the capture in progress. The ring is written by DMA until the
+   * capture completes or stop() is called, so it must stay alive until then.
+   *
+   * @param p_ring - ring buffer, 2 to 65535 samples
+   * @param p_settings - rate, pacing timer and trigger
+   * @return status - fails with `invalid_argument` if the ring size is out of
+   * range, the post trigger samples do not fit in it or the timer has no
+   * update DMA request, `argument_out_of_domain` if the timer cannot produce
+   * the sample rate and `device_or_resource_busy` if the timer or DMA
+   * channel is in use.
+   */
+  status start(std::span<std::uint16_t> p_ring,
+               logic_capture_settings p_settings);
+
+  /**
+   * @brief Search the new samples for the trigger
+   *
+   * Call this often enough that the DMA does not lap the search: less than a
+   * ring of samples may arrive between two calls. A lap is found from the
+   * DMA half and full transfer flags, which is certain while less than one
+   * and a half rings arrive between two calls. Once the post trigger samples
+   * have arrived, the capture stops, its timer and DMA channel are released
+   * and the ring is put in chronological order.
+   *
+   * @return result<bool> - true once the capture is complete, false while it
+   * is still running or if it was never started. Fails with `io_error` and
+   * stops the capture if the DMA overwrote samples that were not searched
+   * yet or the trigger sample.
+   */
+  result<bool> poll();
+
+  /**
+   * @brief Samples of a complete capture
+   *
+   * @return std::span<const std::uint16_t> - samples in chronological order,
+   * empty until the capture completes
+   */
+  [[nodiscard]] std::span<const std::uint16_t> samples() const;
+
+  /**
+   * @brief Position of the trigger within samples()
+   *
+   * @return std::size_t - index of the first sample meeting the trigger
+   * condition
+   */
+  [[nodiscard]] std::size_t trigger_index() const;
+
+  /**
+   * @brief Abandon the capture and release its timer and DMA channel
+   *
+   */
+  void stop();
+
+private:
+  logic_capture(std::uint8_t p_port);
+
+  /// Ring index of the next sample the DMA writes
+  std::size_t write_position();
+  bool track_position();
+  status finish();
+
+  std::uint8_t m_port;
+  std::optional<peripheral> m_timer{};
+  std::span<std::uint16_t> m_ring{};
+  logic_capture_settings m_settings{};
+  /// Ring index of the next sample to search
+  std::size_t m_searched = 0;
+  /// Ring index the DMA had reached at the last poll
+  std::size_t m_position = 0;
+  /// Half and full transfer flags of boundaries passed, not yet read back
+  std::uint32_t m_pending_flags = 0;
+  /// The DMA has passed the end of the ring
+  bool m_wrapped = false;
+  /// Ring index of the trigger, once found
+  std::optional<std::size_t> m_trigger{};
+  std::size_t m_after_trigger = 0;
+  std::span<const std::uint16_t> m_samples{};
+  std::size_t m_trigger_index = 0;
+};
+}  // namespace hal::stm32f1
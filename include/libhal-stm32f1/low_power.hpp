@@ -0,0 +1,164 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <cstdint>
+
+namespace hal::stm32f1 {
+/// Instruction used to enter a low power mode, which also decides what can
+/// wake the device.
+enum class wake_on : std::uint8_t
+{
+  /// WFI, woken by any enabled interrupt
+  interrupt,
+  /// WFE, woken by an EXTI event line or the SEV instruction
+  event,
+};
+
+/// Edges of an EXTI line that trigger a wakeup
+enum class exti_edge : std::uint8_t
+{
+  rising,
+  falling,
+  both,
+};
+
+/// EXTI lines connected to internal sources rather than GPIO pins
+enum class exti_line : std::uint8_t
+{
+  /// Programmable voltage detector output
+  pvd = 16,
+  /// RTC alarm
+  rtc_alarm = 17,
+  /// USB wakeup from suspend
+  usb_wakeup = 18,
+  /// Ethernet wakeup, connectivity line devices only
+  ethernet_wakeup = 19,
+};
+
+/// Stop mode settings
+struct stop_settings
+{
+  /// Put the voltage regulator into low power mode while stopped. Lowers the
+  /// stop current at the cost of a longer wakeup.
+  bool low_power_regulator = true;
+  /// Instruction used to enter stop mode
+  wake_on wake = wake_on::interrupt;
+  /// Call restore_clocks() after waking. When false, the device keeps running
+  /// from the 8MHz HSI.
+  bool restore_clocks = true;
+};
+
+/**
+ * @brief Enter sleep mode
+ *
+ * Stops the CPU clock while peripherals keep running. Returns once the
+ * device wakes.
+ *
+ * @param p_wake - instruction used to enter sleep mode
+ */
+void sleep(wake_on p_wake = wake_on::interrupt);
+
+/**
+ * @brief Return to sleep mode when the last interrupt handler returns
+ *
+ * For fully interrupt driven applications, this avoids the cost of returning
+ * to thread mode and unstacking registers between interrupts.
+ *
+ * @param p_enable - enable or disable sleep on exit
+ */
+void sleep_on_exit(bool p_enable);
+
+/**
+ * @brief Enter stop mode
+ *
+ * Stops all clocks in the 1.8V domain while SRAM and registers are retained.
+ * Only EXTI lines can wake the device, see configure_wakeup(). Returns once
+ * the device wakes.
+ *
+ * @param p_settings - stop mode settings
+ */
+void stop(stop_settings p_settings = {});
+
+/**
+ * @brief Enter standby mode
+ *
+ * Powers down the 1.8V domain. SRAM and register contents are lost, except
+ * for the backup domain. The device wakes through a reset on a rising edge of
+ * the WKUP pin, an RTC alarm, NRST or the independent watchdog. Use
+ * woke_from_standby() after reset to detect this.
+ *
+ */
+void standby();
+
+/**
+ * @brief Enable the WKUP pin (PA0) as a wakeup source from standby
+ *
+ * @param p_enable - enable or disable the wakeup pin
+ */
+void enable_wakeup_pin(bool p_enable);
+
+/**
+ * @brief Determine if the last reset was a wakeup from standby
+ *
+ * Clears the standby flag.
+ *
+ * @return true - device was in standby mode
+ * @return false - device was not in standby mode
+ */
+[[nodiscard]] bool woke_from_standby();
+
+/**
+ * @brief Configure an internal EXTI line as a wakeup source
+ *
+ * The RTC alarm can wake the device from stop mode with
+ * `configure_wakeup(exti_line::rtc_alarm, exti_edge::rising)`.
+ *
+ * @param p_line - EXTI line
+ * @param p_edge - edge that triggers a wakeup
+ * @param p_wake - generate an interrupt or an event, must match the
+ * instruction used to enter the low power mode.
+ */
+void configure_wakeup(exti_line p_line,
+                      exti_edge p_edge,
+                      wake_on p_wake = wake_on::interrupt);
+
+/**
+ * @brief Configure a GPIO pin as a wakeup source
+ *
+ * Only one port can be connected to each EXTI line, so PA3 and PB3 cannot
+ * both be wakeup sources.
+ *
+ * @param p_port - port letter, must be from 'A' to 'G'
+ * @param p_pin - pin number, must be from 0 to 15
+ * @param p_edge - edge that triggers a wakeup
+ * @param p_wake - generate an interrupt or an event, must match the
+ * instruction used to enter the low power mode.
+ */
+void configure_wakeup(std::uint8_t p_port,
+                      std::uint8_t p_pin,
+                      exti_edge p_edge,
+                      wake_on p_wake = wake_on::interrupt);
+
+/**
+ * @brief Clear the pending bit of an EXTI line
+ *
+ * Must be called from the interrupt handler of a line configured with
+ * wake_on::interrupt, otherwise the handler is entered again on return.
+ *
+ * @param p_line - EXTI line from 0 to 19
+ */
+void clear_wakeup_pending(std::uint8_t p_line);
+}  // namespace hal::stm32f1
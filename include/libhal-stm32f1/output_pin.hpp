@@ -22,6 +22,9 @@ namespace hal::stm32f1 {
 /**
  * @brief Output pin implementation for the stm32::f10x
  *
+ * Holds a reference to the clock of its port, which is released when the pin
+ * is destroyed. The pin is move only, as each object owns one reference.
+ *
  */
 class output_pin : public hal::output_pin
 {
@@ -39,6 +42,12 @@ public:
                                 std::uint8_t p_pin,   // NOLINT
                                 output_pin::settings p_settings = {});
 
+  output_pin(output_pin&& p_other) noexcept;
+  output_pin& operator=(output_pin&& p_other) noexcept;
+  output_pin(const output_pin&) = delete;
+  output_pin& operator=(const output_pin&) = delete;
+  ~output_pin();
+
 private:
   output_pin(std::uint8_t p_port,  // NOLINT
              std::uint8_t p_pin    // NOLINT
@@ -0,0 +1,208 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <initializer_list>
+
+#include "constants.hpp"
+
+namespace hal::stm32f1 {
+/// Number of buses with enable and reset registers: AHB, APB1 and APB2
+static constexpr std::uint32_t peripheral_bus_count =
+  beyond_bus / bus_id_offset;
+
+/**
+ * @brief Set of peripherals stored as one bit mask per bus
+ *
+ * The masks line up with the bits of the RCC enable and reset registers, so
+ * a set can be applied with a single write per register. Peripherals outside
+ * of any bus, such as peripheral::cpu, are never members.
+ *
+ * Usage:
+ *
+ *     constexpr peripheral_set board_peripherals{
+ *       peripheral::gpio_a, peripheral::gpio_b, peripheral::spi1,
+ *       peripheral::usart2, peripheral::dma1,
+ *     };
+ *     enable_peripherals(board_peripherals);
+ *
+ */
+class peripheral_set
+{
+public:
+  constexpr peripheral_set() = default;
+
+  /**
+   * @brief Construct a set from a list of peripherals
+   *
+   * @param p_peripherals - members of the set
+   */
+  constexpr peripheral_set(std::initializer_list<peripheral> p_peripherals)
+  {
+    for (auto id : p_peripherals) {
+      add(id);
+    }
+  }
+
+  /**
+   * @brief Add a peripheral to the set
+   *
+   * @param p_peripheral - peripheral to add
+   * @return constexpr peripheral_set& - this set
+   */
+  constexpr peripheral_set& add(peripheral p_peripheral)
+  {
+    auto id = static_cast<std::uint32_t>(p_peripheral);
+    if (id < beyond_bus) {
+      m_masks[id / bus_id_offset] |= 1U << (id % bus_id_offset);
+    }
+    return *this;
+  }
+
+  /**
+   * @brief Remove a peripheral from the set
+   *
+   * @param p_peripheral - peripheral to remove
+   * @return constexpr peripheral_set& - this set
+   */
+  constexpr peripheral_set& remove(peripheral p_peripheral)
+  {
+    auto id = static_cast<std::uint32_t>(p_peripheral);
+    if (id < beyond_bus) {
+      m_masks[id / bus_id_offset] &= ~(1U << (id % bus_id_offset));
+    }
+    return *this;
+  }
+
+  /**
+   * @brief Determine if a peripheral is a member of the set
+   *
+   * @param p_peripheral - peripheral
+   * @return true - the peripheral is a member
+   * @return false - the peripheral is not a member
+   */
+  [[nodiscard]] constexpr bool contains(peripheral p_peripheral) const
+  {
+    auto id = static_cast<std::uint32_t>(p_peripheral);
+    if (id >= beyond_bus) {
+      return false;
+    }
+    return m_masks[id / bus_id_offset] & (1U << (id % bus_id_offset));
+  }
+
+  /**
+   * @brief Bit mask of the members on a bus
+   *
+   * @param p_bus - bus offset, one of ahb_bus, apb1_bus or apb2_bus
+   * @return constexpr std::uint32_t - bits of the RCC registers of that bus
+   */
+  [[nodiscard]] constexpr std::uint32_t mask(std::uint32_t p_bus) const
+  {
+    return m_masks[p_bus / bus_id_offset];
+  }
+
+  /**
+   * @brief Determine if the set has no members
+   *
+   * @return true - the set is empty
+   * @return false - the set has at least one member
+   */
+  [[nodiscard]] constexpr bool empty() const
+  {
+    for (auto bus_mask : m_masks) {
+      if (bus_mask != 0) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  constexpr peripheral_set& operator|=(const peripheral_set& p_other)
+  {
+    for (std::uint32_t i = 0; i < peripheral_bus_count; i++) {
+      m_masks[i] |= p_other.m_masks[i];
+    }
+    return *this;
+  }
+
+  constexpr peripheral_set& operator&=(const peripheral_set& p_other)
+  {
+    for (std::uint32_t i = 0; i < peripheral_bus_count; i++) {
+      m_masks[i] &= p_other.m_masks[i];
+    }
+    return *this;
+  }
+
+  friend constexpr peripheral_set operator|(peripheral_set p_left,
+                                            const peripheral_set& p_right)
+  {
+    return p_left |= p_right;
+  }
+
+  friend constexpr peripheral_set operator&(peripheral_set p_left,
+                                            const peripheral_set& p_right)
+  {
+    return p_left &= p_right;
+  }
+
+  friend constexpr bool operator==(const peripheral_set&,
+                                   const peripheral_set&) = default;
+
+private:
+  std::array<std::uint32_t, peripheral_bus_count> m_masks{};
+};
+
+/**
+ * @brief Enable the clocks of every peripheral in the set
+ *
+ * Writes each RCC enable register at most once. Does not change the
+ * reference counts used by acquire_power(), so this is meant for board
+ * bring-up rather than for drivers.
+ *
+ * @param p_set - peripherals to enable
+ */
+void enable_peripherals(const peripheral_set& p_set);
+
+/**
+ * @brief Gate the clocks of every peripheral in the set
+ *
+ * Writes each RCC enable register at most once.
+ *
+ * @param p_set - peripherals to disable
+ */
+void disable_peripherals(const peripheral_set& p_set);
+
+/**
+ * @brief Reset every peripheral in the set to its reset state
+ *
+ * Asserts and then releases the reset through APB1RSTR and APB2RSTR, with
+ * one write per register for each step. The AHB peripherals cannot be reset,
+ * as AHBRSTR only exists on connectivity line devices and only covers their
+ * USB OTG and Ethernet controllers. AHB members of the set are ignored.
+ *
+ * @param p_set - peripherals to reset
+ */
+void reset_peripherals(const peripheral_set& p_set);
+
+/**
+ * @brief Get the set of peripherals whose clocks are enabled
+ *
+ * @return peripheral_set - enabled peripherals, read from the RCC enable
+ * registers.
+ */
+[[nodiscard]] peripheral_set powered_peripherals();
+}  // namespace hal::stm32f1
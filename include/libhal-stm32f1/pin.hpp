@@ -14,7 +14,282 @@
 
 #pragma once
 
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <initializer_list>
+#include <span>
+
 namespace hal::stm32f1 {
+/**
+ * @brief Map the CONFIG flags for each pin use case
+ *
+ */
+struct pin_config_t
+{
+  /// Configuration bit 1
+  std::uint8_t CNF1;
+  /// Configuration bit 0
+  std::uint8_t CNF0;
+  /// Mode bits
+  std::uint8_t MODE;
+  /// Output data register
+  std::uint8_t PxODR;
+};
+
+/**
+ * @brief Pin select structure
+ *
+ */
+struct pin_select_t
+{
+  /// @brief Port letter, must be a capitol letter from 'A' to 'G'
+  std::uint8_t port;
+  /// @brief Pin number, must be between 0 to 15
+  std::uint8_t pin;
+
+  constexpr bool operator==(const pin_select_t&) const = default;
+};
+
+static constexpr pin_config_t push_pull_gpio_output = {
+  .CNF1 = 0,
+  .CNF0 = 0,
+  .MODE = 0b11,  // Default to high speed 50 MHz
+  .PxODR = 0b0,  // Default to 0 LOW Voltage
+};
+
+static constexpr pin_config_t open_drain_gpio_output = {
+  .CNF1 = 0,
+  .CNF0 = 1,
+  .MODE = 0b11,  // Default to high speed 50 MHz
+  .PxODR = 0b0,  // Default to 0 LOW Voltage
+};
+
+static constexpr pin_config_t push_pull_alternative_output = {
+  .CNF1 = 1,
+  .CNF0 = 0,
+  .MODE = 0b11,  // Default to high speed 50 MHz
+  .PxODR = 0b0,  // Default to 0 LOW Voltage
+};
+
+static constexpr pin_config_t open_drain_alternative_output = {
+  .CNF1 = 1,
+  .CNF0 = 1,
+  .MODE = 0b11,  // Default to high speed 50 MHz
+  .PxODR = 0b0,  // Default to 0 LOW Voltage
+};
+
+static constexpr pin_config_t input_analog = {
+  .CNF1 = 0,
+  .CNF0 = 0,
+  .MODE = 0b00,
+  .PxODR = 0b0,  // Don't care
+};
+
+static constexpr pin_config_t input_float = {
+  .CNF1 = 0,
+  .CNF0 = 1,
+  .MODE = 0b00,
+  .PxODR = 0b0,  // Don't care
+};
+
+static constexpr pin_config_t input_pull_down = {
+  .CNF1 = 1,
+  .CNF0 = 0,
+  .MODE = 0b00,
+  .PxODR = 0b0,  // Pull Down
+};
+
+static constexpr pin_config_t input_pull_up = {
+  .CNF1 = 1,
+  .CNF0 = 0,
+  .MODE = 0b00,
+  .PxODR = 0b1,  // Pull Up
+};
+
+/// Output speed, the slew rate limit of an output pin. Slower edges reduce
+/// ringing and emissions.
+enum class output_speed : std::uint8_t
+{
+  /// Maximum output frequency of 2 MHz
+  low = 0b10,
+  /// Maximum output frequency of 10 MHz
+  medium = 0b01,
+  /// Maximum output frequency of 50 MHz
+  high = 0b11,
+};
+
+/**
+ * @brief Change the output speed of a pin configuration
+ *
+ * @param p_config - output configuration
+ * @param p_speed - output speed
+ * @return constexpr pin_config_t - the configuration with the new speed,
+ * inputs are returned unchanged
+ */
+constexpr pin_config_t with_speed(pin_config_t p_config, output_speed p_speed)
+{
+  if (p_config.MODE != 0b00) {
+    p_config.MODE = static_cast<std::uint8_t>(p_speed);
+  }
+  return p_config;
+}
+
+/// Number of GPIO ports, 'A' to 'G'
+static constexpr std::size_t gpio_port_count = 7;
+
+/// One pin of a pin_map
+struct pin_map_entry
+{
+  pin_select_t pin;
+  pin_config_t config;
+};
+
+/// Register values for the pins of one port in a pin_map
+struct port_configuration
+{
+  /// Bits of CRL belonging to pins in the map
+  std::uint32_t crl_mask = 0;
+  /// CRL bits of the pins in the map
+  std::uint32_t crl = 0;
+  /// Bits of CRH belonging to pins in the map
+  std::uint32_t crh_mask = 0;
+  /// CRH bits of the pins in the map
+  std::uint32_t crh = 0;
+  /// BSRR value setting each pin's ODR bit to its PxODR
+  std::uint32_t bsrr = 0;
+
+  /**
+   * @brief Determine if no pin of the port is in the map
+   *
+   * @return true - the port is untouched
+   * @return false - at least one pin of the port is in the map
+   */
+  [[nodiscard]] constexpr bool empty() const
+  {
+    return crl_mask == 0 && crh_mask == 0;
+  }
+};
+
+/**
+ * @brief Configuration of many pins, folded into register values at compile
+ * time
+ *
+ * Usage:
+ *
+ *     constexpr pin_map board_pins{
+ *       { { .port = 'A', .pin = 9 }, push_pull_alternative_output },
+ *       { { .port = 'A', .pin = 10 }, input_pull_up },
+ *       { { .port = 'C', .pin = 13 },
+ *         with_speed(push_pull_gpio_output, output_speed::low) },
+ *     };
+ *     static_assert(board_pins.valid());
+ *     apply_pin_map(board_pins);
+ *
+ * PxODR sets the initial level of outputs and the pull direction of pulled
+ * inputs.
+ */
+class pin_map
+{
+public:
+  constexpr pin_map() = default;
+
+  /**
+   * @brief Construct a map from a list of pins
+   *
+   * @param p_entries - pins and their configuration
+   */
+  constexpr pin_map(std::initializer_list<pin_map_entry> p_entries)
+  {
+    for (const auto& entry : p_entries) {
+      add(entry.pin, entry.config);
+    }
+  }
+
+  /**
+   * @brief Add a pin to the map
+   *
+   * A pin outside of ports 'A' to 'G' and pins 0 to 15, or a pin added
+   * twice, makes the map invalid.
+   *
+   * @param p_pin - pin to configure
+   * @param p_config - configuration of the pin
+   * @return constexpr pin_map& - this map
+   */
+  constexpr pin_map& add(pin_select_t p_pin, pin_config_t p_config)
+  {
+    if (p_pin.port < 'A' || 'A' + gpio_port_count <= p_pin.port ||
+        p_pin.pin > 15) {
+      m_valid = false;
+      return *this;
+    }
+
+    auto& port = m_ports[p_pin.port - 'A'];
+    auto& mask = p_pin.pin < 8 ? port.crl_mask : port.crh_mask;
+    auto& config = p_pin.pin < 8 ? port.crl : port.crh;
+    auto shift = (p_pin.pin % 8U) * 4U;
+    auto bits = static_cast<std::uint32_t>(((p_config.CNF1 & 1) << 3) |
+                                           ((p_config.CNF0 & 1) << 2) |
+                                           (p_config.MODE & 0b11));
+
+    if (mask & (0xFU << shift)) {
+      m_valid = false;
+    }
+    mask |= 0xFU << shift;
+    config = (config & ~(0xFU << shift)) | (bits << shift);
+
+    std::uint32_t set = 1U << p_pin.pin;
+    std::uint32_t reset = 1U << (p_pin.pin + 16U);
+    port.bsrr &= ~(set | reset);
+    port.bsrr |= p_config.PxODR ? set : reset;
+
+    return *this;
+  }
+
+  /**
+   * @brief Determine if every pin is valid and listed once
+   *
+   * @return true - the map is valid
+   * @return false - a pin is out of range or listed twice
+   */
+  [[nodiscard]] constexpr bool valid() const
+  {
+    return m_valid;
+  }
+
+  /**
+   * @brief Register values for each port
+   *
+   * @return constexpr std::span<const port_configuration, gpio_port_count> -
+   * ports 'A' to 'G'
+   */
+  [[nodiscard]] constexpr std::span<const port_configuration, gpio_port_count>
+  ports() const
+  {
+    return m_ports;
+  }
+
+private:
+  std::array<port_configuration, gpio_port_count> m_ports{};
+  bool m_valid = true;
+};
+
+/**
+ * @brief Apply a pin map
+ *
+ * Powers the ports in the map, with one RCC write, then for each port writes
+ * BSRR once and CRL and CRH at most once each. BSRR is written first so
+ * outputs start at their initial level. CRL and CRH are only read if the map
+ * leaves some of their pins unchanged.
+ *
+ * The ports stay powered for the rest of the program. Each port takes a
+ * single reference the first time a map uses it, however many maps are
+ * applied. Thread mode only.
+ *
+ * @param p_map - pins to configure
+ */
+void apply_pin_map(const pin_map& p_map);
+
 /**
  * @brief Make JTAG pins not associated with SWD available as IO
  *
@@ -22,6 +297,9 @@ namespace hal::stm32f1 {
  * purposes. If you are using SWD and want to use these pins as GPIO or as
  * other alternative functions, this function MUST be called.
  *
+ * Equivalent to configure_debug_port(debug_port::serial_wire_only) from
+ * remap.hpp, which keeps the setting across later remaps.
+ *
  */
 void release_jtag_pins();
 }  // namespace hal::stm32f1
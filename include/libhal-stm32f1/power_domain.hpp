@@ -0,0 +1,104 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <cstdint>
+#include <span>
+
+#include "constants.hpp"
+#include "peripheral_set.hpp"
+
+namespace hal::stm32f1 {
+/**
+ * @brief Acquire a reference to a peripheral's clock
+ *
+ * The clock is enabled when the first reference is acquired. Every call must
+ * be balanced by a call to release_power() once the peripheral is no longer
+ * in use. Peripherals without an enable bit, such as peripheral::cpu, are
+ * ignored. Acquiring a 65536th reference calls hal::halt(), as only a leak of
+ * unreleased references can get there.
+ *
+ * The reference counts are not protected against interrupts, so drivers
+ * should acquire and release peripherals from thread mode.
+ *
+ * @param p_peripheral - peripheral to power on
+ */
+void acquire_power(peripheral p_peripheral);
+
+/**
+ * @brief Release a reference to a peripheral's clock
+ *
+ * The clock is gated when the last reference is released. Releasing a
+ * peripheral with no references has no effect.
+ *
+ * @param p_peripheral - peripheral to release
+ */
+void release_power(peripheral p_peripheral);
+
+/**
+ * @brief Acquire a reference to the clock of every peripheral in a set
+ *
+ * Writes each RCC enable register at most once.
+ *
+ * @param p_set - peripherals to power on
+ */
+void acquire_power(const peripheral_set& p_set);
+
+/**
+ * @brief Release a reference to the clock of every peripheral in a set
+ *
+ * Writes each RCC enable register at most once.
+ *
+ * @param p_set - peripherals to release
+ */
+void release_power(const peripheral_set& p_set);
+
+/**
+ * @brief Get the number of references held on a peripheral's clock
+ *
+ * @param p_peripheral - peripheral
+ * @return std::uint16_t - number of references
+ */
+[[nodiscard]] std::uint16_t power_reference_count(peripheral p_peripheral);
+
+/**
+ * @brief Determine if a peripheral's clock is enabled
+ *
+ * Reads the RCC enable registers, so peripherals enabled without
+ * acquire_power() are included. Peripherals without an enable bit are always
+ * powered.
+ *
+ * @param p_peripheral - peripheral
+ * @return true - the peripheral's clock is enabled
+ * @return false - the peripheral's clock is gated
+ */
+[[nodiscard]] bool is_powered(peripheral p_peripheral);
+
+/**
+ * @brief List the peripherals whose clocks are currently enabled
+ *
+ * Usage:
+ *
+ *     std::array<peripheral, 32> buffer;
+ *     for (auto id : enabled_peripherals(buffer)) {
+ *       // ...
+ *     }
+ *
+ * @param p_buffer - storage for the result
+ * @return std::span<peripheral> - the enabled peripherals within p_buffer,
+ * truncated if p_buffer is too small.
+ */
+std::span<peripheral> enabled_peripherals(std::span<peripheral> p_buffer);
+}  // namespace hal::stm32f1
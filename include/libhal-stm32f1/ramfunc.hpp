@@ -0,0 +1,51 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+/**
+ * @brief Place a function in RAM so it executes without flash wait states
+ *
+ * At 72 MHz the flash requires 2 wait states, which the prefetch buffer only
+ * hides for straight line code. Branch heavy code such as interrupt handlers
+ * runs faster from RAM. The function is copied from flash into the RAM
+ * reserved by `__ramfunc_size` in the device linker script.
+ *
+ * RAM is far outside of the range of a `bl` instruction from flash, so calls
+ * are emitted as long calls. Usage:
+ *
+ *     HAL_STM32F1_RAMFUNC void my_handler();
+ *
+ * The interrupt service routines of this library, such as rtc_interrupt() and
+ * deferred_work_interrupt(), are placed in RAM this way.
+ *
+ * The attribute has no effect when building for the host.
+ */
+#if defined(__arm__)
+#define HAL_STM32F1_RAMFUNC                                                    \
+  __attribute__((section(".ramfunc"), long_call, noinline))
+#else
+#define HAL_STM32F1_RAMFUNC
+#endif
+
+namespace hal::stm32f1 {
+/**
+ * @brief Copy the .ramfunc section from flash into RAM
+ *
+ * This is called automatically before static constructors run. It only needs
+ * to be called manually if a RAM function is used before then.
+ *
+ */
+void initialize_ramfunc_section();
+}  // namespace hal::stm32f1
@@ -0,0 +1,297 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <span>
+
+#include "pin.hpp"
+
+namespace hal::stm32f1 {
+/// Identifies a single pin
+using pin_id = pin_select_t;
+
+/**
+ * @brief One setting of a MAPR remap field and the pins it selects
+ *
+ * `pins` lists the pins of the signals every user of the peripheral needs:
+ * TX and RX for USARTs, SCK, MISO and MOSI for SPI, SCL and SDA for I2C, RX
+ * and TX for CAN and channels 1 to 4 for timers. Optional signals such as
+ * NSS, CTS or break inputs are left out so that they do not report false
+ * conflicts. Copy a remap and trim its pins if only some timer channels are
+ * used.
+ */
+struct pin_remap
+{
+  /// Lowest bit of the field in MAPR
+  std::uint8_t position;
+  /// Width of the field in bits
+  std::uint8_t width;
+  /// Value of the field
+  std::uint8_t value;
+  /// Pins selected, unused entries have a port of 0
+  std::array<pin_id, 4> pins{};
+
+  /**
+   * @brief Get the pins selected by the remap
+   *
+   * @return constexpr std::span<const pin_id> - the used entries of pins
+   */
+  [[nodiscard]] constexpr std::span<const pin_id> used_pins() const
+  {
+    std::size_t count = 0;
+    while (count < pins.size() && pins[count].port != 0) {
+      count++;
+    }
+    return std::span(pins).first(count);
+  }
+
+  /**
+   * @brief Determine if another remap sets the same MAPR field
+   *
+   * @param p_other - remap to compare with
+   * @return true - both remaps set the same field
+   * @return false - the remaps set different fields
+   */
+  [[nodiscard]] constexpr bool same_field(const pin_remap& p_other) const
+  {
+    return position == p_other.position;
+  }
+};
+
+/// MAPR remap settings of the stm32f1, named after the "no remap", "partial
+/// remap" and "full remap" columns of the reference manual
+namespace remap {
+// clang-format off
+inline constexpr pin_remap spi1_none{ .position = 0, .width = 1, .value = 0,
+  .pins = { { { 'A', 5 }, { 'A', 6 }, { 'A', 7 } } } };
+inline constexpr pin_remap spi1_full{ .position = 0, .width = 1, .value = 1,
+  .pins = { { { 'B', 3 }, { 'B', 4 }, { 'B', 5 } } } };
+
+inline constexpr pin_remap i2c1_none{ .position = 1, .width = 1, .value = 0,
+  .pins = { { { 'B', 6 }, { 'B', 7 } } } };
+inline constexpr pin_remap i2c1_full{ .position = 1, .width = 1, .value = 1,
+  .pins = { { { 'B', 8 }, { 'B', 9 } } } };
+
+inline constexpr pin_remap usart1_none{ .position = 2, .width = 1, .value = 0,
+  .pins = { { { 'A', 9 }, { 'A', 10 } } } };
+inline constexpr pin_remap usart1_full{ .position = 2, .width = 1, .value = 1,
+  .pins = { { { 'B', 6 }, { 'B', 7 } } } };
+
+inline constexpr pin_remap usart2_none{ .position = 3, .width = 1, .value = 0,
+  .pins = { { { 'A', 2 }, { 'A', 3 } } } };
+inline constexpr pin_remap usart2_full{ .position = 3, .width = 1, .value = 1,
+  .pins = { { { 'D', 5 }, { 'D', 6 } } } };
+
+inline constexpr pin_remap usart3_none{ .position = 4, .width = 2, .value = 0,
+  .pins = { { { 'B', 10 }, { 'B', 11 } } } };
+inline constexpr pin_remap usart3_partial{ .position = 4, .width = 2,
+  .value = 0b01, .pins = { { { 'C', 10 }, { 'C', 11 } } } };
+inline constexpr pin_remap usart3_full{ .position = 4, .width = 2,
+  .value = 0b11, .pins = { { { 'D', 8 }, { 'D', 9 } } } };
+
+inline constexpr pin_remap timer1_none{ .position = 6, .width = 2, .value = 0,
+  .pins = { { { 'A', 8 }, { 'A', 9 }, { 'A', 10 }, { 'A', 11 } } } };
+inline constexpr pin_remap timer1_partial{ .position = 6, .width = 2,
+  .value = 0b01,
+  .pins = { { { 'A', 8 }, { 'A', 9 }, { 'A', 10 }, { 'A', 11 } } } };
+inline constexpr pin_remap timer1_full{ .position = 6, .width = 2,
+  .value = 0b11,
+  .pins = { { { 'E', 9 }, { 'E', 11 }, { 'E', 13 }, { 'E', 14 } } } };
+
+inline constexpr pin_remap timer2_none{ .position = 8, .width = 2, .value = 0,
+  .pins = { { { 'A', 0 }, { 'A', 1 }, { 'A', 2 }, { 'A', 3 } } } };
+inline constexpr pin_remap timer2_partial1{ .position = 8, .width = 2,
+  .value = 0b01,
+  .pins = { { { 'A', 15 }, { 'B', 3 }, { 'A', 2 }, { 'A', 3 } } } };
+inline constexpr pin_remap timer2_partial2{ .position = 8, .width = 2,
+  .value = 0b10,
+  .pins = { { { 'A', 0 }, { 'A', 1 }, { 'B', 10 }, { 'B', 11 } } } };
+inline constexpr pin_remap timer2_full{ .position = 8, .width = 2,
+  .value = 0b11,
+  .pins = { { { 'A', 15 }, { 'B', 3 }, { 'B', 10 }, { 'B', 11 } } } };
+
+inline constexpr pin_remap timer3_none{ .position = 10, .width = 2, .value = 0,
+  .pins = { { { 'A', 6 }, { 'A', 7 }, { 'B', 0 }, { 'B', 1 } } } };
+inline constexpr pin_remap timer3_partial{ .position = 10, .width = 2,
+  .value = 0b10,
+  .pins = { { { 'B', 4 }, { 'B', 5 }, { 'B', 0 }, { 'B', 1 } } } };
+inline constexpr pin_remap timer3_full{ .position = 10, .width = 2,
+  .value = 0b11,
+  .pins = { { { 'C', 6 }, { 'C', 7 }, { 'C', 8 }, { 'C', 9 } } } };
+
+inline constexpr pin_remap timer4_none{ .position = 12, .width = 1, .value = 0,
+  .pins = { { { 'B', 6 }, { 'B', 7 }, { 'B', 8 }, { 'B', 9 } } } };
+inline constexpr pin_remap timer4_full{ .position = 12, .width = 1, .value = 1,
+  .pins = { { { 'D', 12 }, { 'D', 13 }, { 'D', 14 }, { 'D', 15 } } } };
+
+inline constexpr pin_remap can_none{ .position = 13, .width = 2, .value = 0,
+  .pins = { { { 'A', 11 }, { 'A', 12 } } } };
+inline constexpr pin_remap can_partial{ .position = 13, .width = 2,
+  .value = 0b10, .pins = { { { 'B', 8 }, { 'B', 9 } } } };
+inline constexpr pin_remap can_full{ .position = 13, .width = 2,
+  .value = 0b11, .pins = { { { 'D', 0 }, { 'D', 1 } } } };
+// clang-format on
+}  // namespace remap
+
+/// Serial wire and JTAG debug port configuration, the values are the
+/// MAPR.SWJ_CFG field
+enum class debug_port : std::uint8_t
+{
+  /// JTAG and SWD on PA13, PA14, PA15, PB3 and PB4, the reset state
+  full_swj = 0b000,
+  /// JTAG and SWD without NJTRST, frees PB4
+  swj_without_reset = 0b001,
+  /// SWD only on PA13 and PA14, frees PA15, PB3 and PB4
+  serial_wire_only = 0b010,
+  /// No debug port, frees every debug pin
+  disabled = 0b100,
+};
+
+/**
+ * @brief Get the pins reserved by a debug port configuration
+ *
+ * @param p_port - debug port configuration
+ * @return constexpr std::span<const pin_id> - reserved pins
+ */
+constexpr std::span<const pin_id> debug_pins(debug_port p_port)
+{
+  constexpr std::array<pin_id, 5> pins{ {
+    { 'A', 13 },
+    { 'A', 14 },
+    { 'A', 15 },
+    { 'B', 3 },
+    { 'B', 4 },
+  } };
+
+  switch (p_port) {
+    case debug_port::full_swj:
+      return std::span(pins);
+    case debug_port::swj_without_reset:
+      return std::span(pins).first(4);
+    case debug_port::serial_wire_only:
+      return std::span(pins).first(2);
+    default:
+      return {};
+  }
+}
+
+/// Two remaps that cannot be used together
+struct remap_conflict
+{
+  /// Index of the first remap
+  std::size_t first;
+  /// Index of the second remap, or the number of remaps if the first one
+  /// uses a debug pin
+  std::size_t second;
+  /// Pin used by both, or a default pin_id if both set the same MAPR field
+  /// to different values
+  pin_id pin;
+};
+
+/**
+ * @brief Find the first conflict within a set of remaps
+ *
+ * Remaps conflict if they set the same MAPR field to different values, if
+ * they select the same pin, or if a remap selects a pin reserved by the
+ * debug port. Evaluate it in a static_assert to catch conflicts at compile
+ * time:
+ *
+ *     constexpr std::array board_remaps{
+ *       remap::usart1_full, remap::i2c1_full, remap::timer2_full,
+ *     };
+ *     static_assert(!find_remap_conflict(board_remaps,
+ *                                        debug_port::serial_wire_only));
+ *
+ * @param p_remaps - remaps used by the application
+ * @param p_debug_port - debug port configuration
+ * @return constexpr std::optional<remap_conflict> - the conflict or nothing
+ * if the remaps can be used together
+ */
+constexpr std::optional<remap_conflict> find_remap_conflict(
+  std::span<const pin_remap> p_remaps,
+  debug_port p_debug_port = debug_port::full_swj)
+{
+  for (std::size_t first = 0; first < p_remaps.size(); first++) {
+    const auto& remap = p_remaps[first];
+
+    for (auto pin : remap.used_pins()) {
+      for (auto debug_pin : debug_pins(p_debug_port)) {
+        if (pin == debug_pin) {
+          return remap_conflict{
+            .first = first,
+            .second = p_remaps.size(),
+            .pin = pin,
+          };
+        }
+      }
+    }
+
+    for (std::size_t second = first + 1; second < p_remaps.size(); second++) {
+      const auto& other = p_remaps[second];
+
+      if (remap.same_field(other)) {
+        if (remap.value != other.value) {
+          return remap_conflict{ .first = first, .second = second, .pin = {} };
+        }
+        // The same setting listed twice
+        continue;
+      }
+
+      for (auto pin : remap.used_pins()) {
+        for (auto other_pin : other.used_pins()) {
+          if (pin == other_pin) {
+            return remap_conflict{
+              .first = first,
+              .second = second,
+              .pin = pin,
+            };
+          }
+        }
+      }
+    }
+  }
+
+  return std::nullopt;
+}
+
+/**
+ * @brief Apply a set of remaps with a single write to MAPR
+ *
+ * @param p_remaps - remaps to apply
+ */
+void apply_remaps(std::span<const pin_remap> p_remaps);
+
+/**
+ * @brief Apply a single remap
+ *
+ * @param p_remap - remap to apply
+ */
+void apply_remap(const pin_remap& p_remap);
+
+/**
+ * @brief Select which debug pins stay reserved for the debugger
+ *
+ * The SWJ_CFG field is write only, so it is kept in a shadow of MAPR that
+ * every remap write includes. Writing MAPR any other way resets the debug
+ * port to full SWJ.
+ *
+ * @param p_port - debug port configuration
+ */
+void configure_debug_port(debug_port p_port);
+}  // namespace hal::stm32f1
@@ -0,0 +1,271 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <cstdint>
+
+#include <libhal/error.hpp>
+
+#include "interrupt.hpp"
+#include "ramfunc.hpp"
+
+namespace hal::stm32f1 {
+/// Broken down UTC calendar time
+struct date_time
+{
+  /// Full year, such as 2023
+  std::uint16_t year = 1970;
+  /// Month from 1 to 12
+  std::uint8_t month = 1;
+  /// Day of the month from 1 to 31
+  std::uint8_t day = 1;
+  /// Hour from 0 to 23
+  std::uint8_t hour = 0;
+  /// Minute from 0 to 59
+  std::uint8_t minute = 0;
+  /// Second from 0 to 59
+  std::uint8_t second = 0;
+  /// Day of the week, 0 = Sunday to 6 = Saturday. Ignored by to_epoch().
+  std::uint8_t weekday = 4;
+
+  constexpr bool operator==(const date_time&) const = default;
+};
+
+/**
+ * @brief Convert a date and time to seconds since 1970-01-01 00:00:00 UTC
+ *
+ * @param p_date_time - calendar time from 1970 to 2106
+ * @return constexpr std::uint32_t - seconds since the epoch
+ */
+constexpr std::uint32_t to_epoch(const date_time& p_date_time)
+{
+  // Days from civil, see http://howardhinnant.github.io/date_algorithms.html
+  std::int32_t year = p_date_time.year;
+  std::int32_t month = p_date_time.month;
+  year -= month <= 2;
+  std::int32_t era = (year >= 0 ? year : year - 399) / 400;
+  auto year_of_era = static_cast<std::uint32_t>(year - era * 400);
+  auto shifted_month = static_cast<std::uint32_t>(month > 2 ? month - 3
+                                                            : month + 9);
+  auto day_of_year = (153 * shifted_month + 2) / 5 + p_date_time.day - 1;
+  auto day_of_era =
+    year_of_era * 365 + year_of_era / 4 - year_of_era / 100 + day_of_year;
+  auto days = static_cast<std::int64_t>(era) * 146097 +
+              static_cast<std::int64_t>(day_of_era) - 719468;
+
+  return static_cast<std::uint32_t>(days * 86400 + p_date_time.hour * 3600 +
+                                    p_date_time.minute * 60 +
+                                    p_date_time.second);
+}
+
+/**
+ * @brief Convert seconds since 1970-01-01 00:00:00 UTC to a date and time
+ *
+ * @param p_epoch - seconds since the epoch
+ * @return constexpr date_time - calendar time
+ */
+constexpr date_time to_date_time(std::uint32_t p_epoch)
+{
+  // Civil from days, see http://howardhinnant.github.io/date_algorithms.html
+  std::uint32_t days = p_epoch / 86400;
+  std::uint32_t seconds_of_day = p_epoch % 86400;
+
+  std::uint32_t shifted_days = days + 719468;
+  std::uint32_t era = shifted_days / 146097;
+  std::uint32_t day_of_era = shifted_days - era * 146097;
+  std::uint32_t year_of_era = (day_of_era - day_of_era / 1460 +
+                               day_of_era / 36524 - day_of_era / 146096) /
+                              365;
+  std::uint32_t day_of_year =
+    day_of_era - (365 * year_of_era + year_of_era / 4 - year_of_era / 100);
+  std::uint32_t shifted_month = (5 * day_of_year + 2) / 153;
+  std::uint32_t day = day_of_year - (153 * shifted_month + 2) / 5 + 1;
+  std::uint32_t month =
+    shifted_month < 10 ? shifted_month + 3 : shifted_month - 9;
+  std::uint32_t year = year_of_era + era * 400 + (month <= 2);
+
+  return date_time{
+    .year = static_cast<std::uint16_t>(year),
+    .month = static_cast<std::uint8_t>(month),
+    .day = static_cast<std::uint8_t>(day),
+    .hour = static_cast<std::uint8_t>(seconds_of_day / 3600),
+    .minute = static_cast<std::uint8_t>(seconds_of_day / 60 % 60),
+    .second = static_cast<std::uint8_t>(seconds_of_day % 60),
+    // 1970-01-01 was a Thursday
+    .weekday = static_cast<std::uint8_t>((days + 4) % 7),
+  };
+}
+
+/**
+ * @brief Convert a prescaler divider reading into nanoseconds
+ *
+ * @param p_prescaler - prescaler load value, the RTC clock divided by 1 Hz
+ * minus 1
+ * @param p_divider - value of the DIV register
+ * @return constexpr std::uint32_t - nanoseconds elapsed in the current second
+ */
+constexpr std::uint32_t rtc_subsecond_nanoseconds(std::uint32_t p_prescaler,
+                                                  std::uint32_t p_divider)
+{
+  // DIV counts down from the prescaler load value to 0 once per second
+  auto elapsed = static_cast<std::uint64_t>(p_prescaler - p_divider);
+  return static_cast<std::uint32_t>(elapsed * 1'000'000'000ULL /
+                                    (p_prescaler + 1ULL));
+}
+
+/**
+ * @brief Interrupt service routine for irq::rtcalarm
+ *
+ * Installed by rtc::set_alarm(). Applications using a static vector table
+ * must place it in the table themselves.
+ *
+ */
+HAL_STM32F1_RAMFUNC void rtc_alarm_interrupt();
+
+/**
+ * @brief Interrupt service routine for irq::rtc
+ *
+ * Installed by rtc::on_second(). Applications using a static vector table
+ * must place it in the table themselves.
+ *
+ */
+HAL_STM32F1_RAMFUNC void rtc_interrupt();
+
+/**
+ * @brief Real time clock driver
+ *
+ * Counts seconds since 1970-01-01 UTC in the 32-bit RTC counter, which lasts
+ * until the year 2106. The counter lives in the backup domain, so it keeps
+ * counting through resets and standby, and on VBAT. Set
+ * `clock_tree::rtc_t::preserve_backup_domain` to stop configure_clocks() from
+ * resetting it.
+ *
+ * Reading the time is a handful of register reads with no high speed timer
+ * involved. The driver keeps the backup domain writable for its lifetime, so
+ * its interrupt handlers clear flags with plain register writes.
+ *
+ */
+class rtc
+{
+public:
+  /// Point in time with sub-second resolution
+  struct timestamp
+  {
+    /// Seconds since 1970-01-01 00:00:00 UTC
+    std::uint32_t seconds;
+    /// Nanoseconds within the second, with the resolution of one RTC clock
+    /// cycle
+    std::uint32_t nanoseconds;
+  };
+
+  /**
+   * @brief Get the RTC
+   *
+   * The RTC clock source must have been enabled by configure_clocks(). The
+   * counter is not modified, so a running clock keeps its time.
+   *
+   * @return result<rtc> - RTC driver, fails with `no_such_device` if the RTC
+   * has no clock, `argument_out_of_domain` if the RTC clock is too fast
+   * to be divided down to 1 Hz and `timed_out` if the RTC clock is not
+   * running.
+   */
+  static result<rtc> get();
+
+  /// The clocks and backup domain write access move with the driver
+  rtc(rtc&& p_other) noexcept;
+  rtc& operator=(rtc&& p_other) noexcept;
+  rtc(const rtc&) = delete;
+  rtc& operator=(const rtc&) = delete;
+  /// Cancels the alarm and the second interrupt, the counter keeps running
+  ~rtc();
+
+  /**
+   * @brief Get the current time in seconds
+   *
+   * @return std::uint32_t - seconds since 1970-01-01 00:00:00 UTC
+   */
+  [[nodiscard]] std::uint32_t epoch();
+
+  /**
+   * @brief Get the current time with sub-second resolution
+   *
+   * @return timestamp - the current time
+   */
+  [[nodiscard]] timestamp now();
+
+  /**
+   * @brief Get the current time as a calendar date and time
+   *
+   * @return date_time - the current UTC time
+   */
+  [[nodiscard]] date_time date();
+
+  /**
+   * @brief Set the current time
+   *
+   * @param p_epoch - seconds since 1970-01-01 00:00:00 UTC
+   * @return status - fails with `timed_out` if the RTC clock stopped
+   */
+  status set(std::uint32_t p_epoch);
+
+  /**
+   * @brief Set the current time
+   *
+   * @param p_date_time - UTC calendar time
+   * @return status - fails with `timed_out` if the RTC clock stopped
+   */
+  status set(const date_time& p_date_time);
+
+  /**
+   * @brief Call a handler once the counter reaches a time
+   *
+   * Uses irq::rtcalarm through EXTI line 17, so the alarm also wakes the
+   * device from stop mode. The handler runs in interrupt context after the
+   * alarm flags are cleared. Only one alarm can be pending at a time.
+   *
+   * @param p_epoch - time of the alarm in seconds since the epoch
+   * @param p_handler - handler to call
+   * @return status - fails with `operation_not_permitted` if the vector table
+   * is in flash and does not hold rtc_alarm_interrupt() and `timed_out` if
+   * the RTC clock stopped.
+   */
+  status set_alarm(std::uint32_t p_epoch, interrupt_handler p_handler);
+
+  /**
+   * @brief Cancel a pending alarm
+   *
+   */
+  void cancel_alarm();
+
+  /**
+   * @brief Call a handler at the start of every second
+   *
+   * Uses irq::rtc.
+   *
+   * @param p_handler - handler to call, nullptr disables the interrupt
+   * @return status - fails with `operation_not_permitted` if the vector table
+   * is in flash and does not hold rtc_interrupt().
+   */
+  status on_second(interrupt_handler p_handler);
+
+private:
+  rtc(std::uint32_t p_prescaler);
+  void stop();
+
+  std::uint32_t m_prescaler;
+  /// False once moved from
+  bool m_active = true;
+};
+}  // namespace hal::stm32f1
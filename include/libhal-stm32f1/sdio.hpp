@@ -0,0 +1,214 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <optional>
+#include <span>
+
+#include <libhal/error.hpp>
+#include <libhal/units.hpp>
+
+#include "clock.hpp"
+
+namespace hal::stm32f1 {
+/**
+ * @brief Compute the SDIO clock divider for a maximum card clock
+ *
+ * @param p_hclk_hz - SDIOCLK, which is HCLK
+ * @param p_max_rate_hz - highest allowed SDIO_CK rate
+ * @return constexpr std::optional<std::uint8_t> - CLKCR.CLKDIV value giving
+ * the fastest clock at or below the maximum, or nothing if the maximum cannot
+ * be reached.
+ */
+constexpr std::optional<std::uint8_t> calculate_sdio_clock_divider(
+  std::uint32_t p_hclk_hz,
+  std::uint32_t p_max_rate_hz)
+{
+  constexpr std::uint64_t max_divider = 0xFF;
+
+  if (p_hclk_hz == 0 || p_max_rate_hz == 0) {
+    return std::nullopt;
+  }
+
+  // SDIO_CK = SDIOCLK / (CLKDIV + 2)
+  std::uint64_t hclk = p_hclk_hz;
+  std::uint64_t max_rate = p_max_rate_hz;
+  auto total = (hclk + max_rate - 1) / max_rate;
+  auto divider = total < 2 ? 0 : total - 2;
+  if (divider > max_divider) {
+    return std::nullopt;
+  }
+  return static_cast<std::uint8_t>(divider);
+}
+
+/**
+ * @brief Compute the SDIO clock divider for a maximum card clock
+ *
+ * @param p_hclk - SDIOCLK, which is HCLK
+ * @param p_max_rate - highest allowed SDIO_CK rate, rounded to whole Hz
+ * @return constexpr std::optional<std::uint8_t> - CLKCR.CLKDIV value, or
+ * nothing if the maximum cannot be reached.
+ */
+constexpr std::optional<std::uint8_t> calculate_sdio_clock_divider(
+  hal::hertz p_hclk,
+  hal::hertz p_max_rate)
+{
+  return calculate_sdio_clock_divider(to_hz(p_hclk), to_hz(p_max_rate));
+}
+
+/**
+ * @brief Extract a field of a card specific data (CSD) register
+ *
+ * @param p_csd - CSD as returned in RESP1 to RESP4, bit 127 first
+ * @param p_msb - most significant bit of the field
+ * @param p_lsb - least significant bit of the field
+ * @return constexpr std::uint32_t - field value
+ */
+constexpr std::uint32_t sd_csd_field(const std::array<std::uint32_t, 4>& p_csd,
+                                     std::uint32_t p_msb,
+                                     std::uint32_t p_lsb)
+{
+  std::uint32_t result = 0;
+  for (auto bit = p_msb + 1; bit-- > p_lsb;) {
+    auto word = p_csd[3 - bit / 32];
+    result = (result << 1) | ((word >> (bit % 32)) & 1U);
+  }
+  return result;
+}
+
+/**
+ * @brief Compute the number of 512 byte blocks of a card from its CSD
+ *
+ * @param p_csd - CSD as returned in RESP1 to RESP4, bit 127 first
+ * @return constexpr std::uint32_t - capacity in blocks
+ */
+constexpr std::uint32_t sd_block_count(
+  const std::array<std::uint32_t, 4>& p_csd)
+{
+  if (sd_csd_field(p_csd, 127, 126) == 1) {
+    // CSD version 2.0, SDHC and SDXC
+    return (sd_csd_field(p_csd, 69, 48) + 1) * 1024;
+  }
+
+  // CSD version 1.0, SDSC
+  auto size = sd_csd_field(p_csd, 73, 62) + 1;
+  auto multiplier = sd_csd_field(p_csd, 49, 47) + 2;
+  auto block_length = sd_csd_field(p_csd, 83, 80);
+  return (size << multiplier) << block_length >> 9;
+}
+
+/// SDIO card settings
+struct sdio_settings
+{
+  /// Highest card clock used for data transfers, default speed cards allow
+  /// up to 25MHz.
+  hal::hertz clock_rate = 24'000'000.0f;
+  /// Use the 4-bit bus, otherwise only D0 is used
+  bool wide_bus = true;
+};
+
+/**
+ * @brief SD card on the SDIO host controller
+ *
+ * Available on high density devices. Uses PC8 to PC11 for D0 to D3, PC12 for
+ * CK and PD2 for CMD, each of which needs a pull up resistor. Data moves
+ * through DMA2 channel 4, which is claimed for the duration of each
+ * transfer.
+ *
+ * Supports SDSC, SDHC and SDXC cards. Blocks are always 512 bytes.
+ *
+ * Multi-block writes tell the card the block count up front (ACMD23), so it
+ * can erase ahead of the data. Logging code gets the best throughput by
+ * writing large, block aligned chunks in a single call.
+ *
+ */
+class sdio_card
+{
+public:
+  /// Size of a block in bytes
+  static constexpr std::size_t block_size = 512;
+
+  /**
+   * @brief Initialize the card
+   *
+   * Identifies the card at 400kHz, selects it, switches to the 4-bit bus and
+   * raises the clock to the configured rate. The SDIO clock is derived from
+   * HCLK, so configure_clocks() must be called first.
+   *
+   * @param p_settings - card settings
+   * @return result<sdio_card> - the card, fails with `no_such_device` if no
+   * card responds, `not_supported` if the card does not accept 3.3V,
+   * `timed_out` if the card never finishes powering up, `io_error` on a
+   * CRC failure, and `argument_out_of_domain` if the clock rates cannot be
+   * reached from HCLK.
+   */
+  static result<sdio_card> get(sdio_settings p_settings = {});
+
+  /// The controller moves with the card, the source is left without it
+  sdio_card(sdio_card&& p_other) noexcept;
+  sdio_card& operator=(sdio_card&& p_other) noexcept;
+  sdio_card(const sdio_card&) = delete;
+  sdio_card& operator=(const sdio_card&) = delete;
+  /// Stops the card clock and powers down the controller and its ports
+  ~sdio_card();
+
+  /**
+   * @brief Get the capacity of the card
+   *
+   * @return std::uint32_t - number of blocks
+   */
+  [[nodiscard]] std::uint32_t block_count() const
+  {
+    return m_block_count;
+  }
+
+  /**
+   * @brief Read consecutive blocks
+   *
+   * @param p_block - first block
+   * @param p_data - destination, a whole number of blocks, 4-byte aligned
+   * @return status - fails with `invalid_argument` if the buffer is not a
+   * 4-byte aligned whole number of blocks or extends past the end of the
+   * card, `device_or_resource_busy` if the DMA channel is in use, `timed_out`
+   * or `io_error` if the transfer fails.
+   */
+  status read(std::uint32_t p_block, std::span<hal::byte> p_data);
+
+  /**
+   * @brief Write consecutive blocks
+   *
+   * Returns once the card has finished programming the blocks.
+   *
+   * @param p_block - first block
+   * @param p_data - data, a whole number of blocks, 4-byte aligned
+   * @return status - fails like read()
+   */
+  status write(std::uint32_t p_block, std::span<const hal::byte> p_data);
+
+private:
+  sdio_card(std::uint16_t p_relative_address,
+            std::uint32_t p_block_count,
+            bool p_block_addressed);
+
+  void release();
+
+  std::uint16_t m_relative_address;
+  std::uint32_t m_block_count;
+  bool m_block_addressed;
+  bool m_owner = true;
+};
+}  // namespace hal::stm32f1
@@ -0,0 +1,83 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <cstdint>
+#include <optional>
+
+#include <libhal/units.hpp>
+
+#include "clock.hpp"
+
+namespace hal::stm32f1 {
+/// Prescaler and reload values of a timer's time base
+struct basic_timer_timing
+{
+  /// Value of the PSC register, the timer clock is divided by prescaler + 1
+  std::uint16_t prescaler;
+  /// Value of the ARR register, an update occurs every reload + 1 ticks
+  std::uint16_t reload;
+};
+
+/**
+ * @brief Compute the timer timing for an update rate
+ *
+ * Selects the smallest prescaler able to reach the rate, which keeps the
+ * error from rounding the reload value as small as possible. Applies to the
+ * basic timers as well as the time base of every other timer.
+ *
+ * @param p_rate_hz - update events per second
+ * @param p_clock_hz - timer clock rate, frequency_hz() of the timer
+ * @return constexpr std::optional<basic_timer_timing> - timing or nothing if
+ * the rate is out of range
+ */
+constexpr std::optional<basic_timer_timing> calculate_basic_timer_timing(
+  std::uint32_t p_rate_hz,
+  std::uint32_t p_clock_hz)
+{
+  constexpr std::uint64_t max_count = 0x1'0000;
+
+  if (p_rate_hz == 0 || p_clock_hz < p_rate_hz) {
+    return std::nullopt;
+  }
+
+  auto ticks = (std::uint64_t{ p_clock_hz } + p_rate_hz / 2) / p_rate_hz;
+  auto divider = (ticks + max_count - 1) / max_count;
+  if (divider > max_count) {
+    return std::nullopt;
+  }
+
+  auto count = (ticks + divider / 2) / divider;
+  return basic_timer_timing{
+    .prescaler = static_cast<std::uint16_t>(divider - 1),
+    .reload = static_cast<std::uint16_t>(count - 1),
+  };
+}
+
+/**
+ * @brief Compute the timer timing for an update rate
+ *
+ * @param p_rate - update events per second, rounded to whole Hz
+ * @param p_clock - timer clock rate
+ * @return constexpr std::optional<basic_timer_timing> - timing or nothing if
+ * the rate is out of range
+ */
+constexpr std::optional<basic_timer_timing> calculate_basic_timer_timing(
+  hal::hertz p_rate,
+  hal::hertz p_clock)
+{
+  return calculate_basic_timer_timing(to_hz(p_rate), to_hz(p_clock));
+}
+}  // namespace hal::stm32f1
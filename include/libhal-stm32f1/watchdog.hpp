@@ -0,0 +1,374 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <optional>
+
+#include <libhal/error.hpp>
+#include <libhal/units.hpp>
+
+#include "clock.hpp"
+
+namespace hal::stm32f1 {
+/// Prescaler and reload values of the independent watchdog
+struct independent_watchdog_timing
+{
+  /// Value of the PR register, the LSI is divided by 4 << prescaler
+  std::uint8_t prescaler;
+  /// Value of the RLR register, the counter counts reload + 1 ticks
+  std::uint16_t reload;
+};
+
+/**
+ * @brief Compute the independent watchdog timing for a timeout
+ *
+ * Selects the smallest prescaler able to reach the timeout, which gives the
+ * finest resolution. The timeout is rounded up to the next counter tick.
+ *
+ * @param p_timeout - time from the last feed until the device is reset
+ * @param p_clock_hz - watchdog clock rate, the fastest LSI by default so the
+ * timeout is a lower bound
+ * @return constexpr std::optional<independent_watchdog_timing> - timing or
+ * nothing if the timeout is out of range
+ */
+constexpr std::optional<independent_watchdog_timing>
+calculate_independent_watchdog_timing(
+  hal::time_duration p_timeout,
+  std::uint32_t p_clock_hz = internal_low_speed_oscillator_max_hz)
+{
+  constexpr std::uint64_t max_count = 4096;
+  constexpr std::uint8_t max_prescaler = 6;
+
+  if (p_timeout.count() <= 0) {
+    return std::nullopt;
+  }
+
+  std::uint64_t clock = p_clock_hz;
+  auto ticks = static_cast<std::uint64_t>(p_timeout.count()) * clock;
+
+  for (std::uint8_t prescaler = 0; prescaler <= max_prescaler; prescaler++) {
+    std::uint64_t divider = 1'000'000'000ULL * (4ULL << prescaler);
+    auto count = (ticks + divider - 1) / divider;
+    if (count <= max_count) {
+      return independent_watchdog_timing{
+        .prescaler = prescaler,
+        .reload = static_cast<std::uint16_t>(count == 0 ? 0 : count - 1),
+      };
+    }
+  }
+
+  return std::nullopt;
+}
+
+/**
+ * @brief Compute the independent watchdog timing for a timeout
+ *
+ * @param p_timeout - time from the last feed until the device is reset
+ * @param p_clock - watchdog clock rate, rounded to whole Hz
+ * @return constexpr std::optional<independent_watchdog_timing> - timing or
+ * nothing if the timeout is out of range
+ */
+constexpr std::optional<independent_watchdog_timing>
+calculate_independent_watchdog_timing(hal::time_duration p_timeout,
+                                      hal::hertz p_clock)
+{
+  return calculate_independent_watchdog_timing(p_timeout, to_hz(p_clock));
+}
+
+/// Timer base, counter and window values of the window watchdog
+struct window_watchdog_timing
+{
+  /// Value of CFR.WDGTB, the counter clock is PCLK1 / (4096 << timer_base)
+  std::uint8_t timer_base;
+  /// Value loaded into the counter on each feed, 0x40 to 0x7F
+  std::uint8_t counter;
+  /// Feeding while the counter is above this value resets the device
+  std::uint8_t window;
+};
+
+/**
+ * @brief Compute the window watchdog timing for a timeout and window
+ *
+ * @param p_timeout - time from the last feed until the device is reset
+ * @param p_earliest_feed - time after a feed before the next feed is
+ * allowed, 0 disables the window.
+ * @param p_clock_hz - PCLK1 clock rate,
+ * frequency_hz(peripheral::window_watchdog)
+ * @return constexpr std::optional<window_watchdog_timing> - timing or nothing
+ * if the timeout or window is out of range
+ */
+constexpr std::optional<window_watchdog_timing>
+calculate_window_watchdog_timing(hal::time_duration p_timeout,
+                                 hal::time_duration p_earliest_feed,
+                                 std::uint32_t p_clock_hz)
+{
+  // The device resets when the counter decrements from 0x40 to 0x3F, thus
+  // there are between 1 and 64 ticks available.
+  constexpr std::uint64_t max_ticks = 64;
+  constexpr std::uint64_t reset_value = 0x3F;
+  constexpr std::uint8_t max_timer_base = 3;
+
+  if (p_timeout.count() <= 0 || p_earliest_feed >= p_timeout ||
+      p_earliest_feed.count() < 0) {
+    return std::nullopt;
+  }
+
+  std::uint64_t clock = p_clock_hz;
+  auto timeout = static_cast<std::uint64_t>(p_timeout.count()) * clock;
+  auto earliest = static_cast<std::uint64_t>(p_earliest_feed.count()) * clock;
+
+  for (std::uint8_t base = 0; base <= max_timer_base; base++) {
+    std::uint64_t divider = 1'000'000'000ULL * (4096ULL << base);
+    auto ticks = (timeout + divider - 1) / divider;
+    if (ticks == 0 || max_ticks < ticks) {
+      continue;
+    }
+
+    auto counter = reset_value + ticks;
+    auto window = counter;
+    if (earliest != 0) {
+      auto closed_ticks = (earliest + divider - 1) / divider;
+      if (ticks <= closed_ticks) {
+        return std::nullopt;
+      }
+      window = counter - closed_ticks;
+    }
+
+    return window_watchdog_timing{
+      .timer_base = base,
+      .counter = static_cast<std::uint8_t>(counter),
+      .window = static_cast<std::uint8_t>(window),
+    };
+  }
+
+  return std::nullopt;
+}
+
+/**
+ * @brief Compute the window watchdog timing for a timeout and window
+ *
+ * @param p_timeout - time from the last feed until the device is reset
+ * @param p_earliest_feed - time after a feed before the next feed is
+ * allowed, 0 disables the window.
+ * @param p_clock - PCLK1 clock rate, rounded to whole Hz
+ * @return constexpr std::optional<window_watchdog_timing> - timing or nothing
+ * if the timeout or window is out of range
+ */
+constexpr std::optional<window_watchdog_timing>
+calculate_window_watchdog_timing(hal::time_duration p_timeout,
+                                 hal::time_duration p_earliest_feed,
+                                 hal::hertz p_clock)
+{
+  return calculate_window_watchdog_timing(
+    p_timeout, p_earliest_feed, to_hz(p_clock));
+}
+
+/**
+ * @brief Independent watchdog driver
+ *
+ * Runs from the LSI oscillator and keeps running when the main clocks fail
+ * or the device is in stop mode. The LSI varies between 30kHz and 60kHz
+ * between devices and with temperature. The counter is sized for 60kHz, so
+ * the device is never reset sooner than the timeout, but a slow LSI can
+ * delay the reset to twice the timeout. Once started it cannot be stopped.
+ *
+ */
+class independent_watchdog
+{
+public:
+  /**
+   * @brief Start the independent watchdog
+   *
+   * @param p_timeout - time from the last feed until the device is reset
+   * @return result<independent_watchdog> - watchdog driver, fails with
+   * `argument_out_of_domain` if the timeout cannot be reached, which is the
+   * case beyond about 17 seconds.
+   */
+  static result<independent_watchdog> get(hal::time_duration p_timeout);
+
+  /**
+   * @brief Reload the watchdog counter
+   *
+   */
+  void feed();
+
+private:
+  independent_watchdog() = default;
+};
+
+/**
+ * @brief Window watchdog driver
+ *
+ * Clocked from PCLK1, so the clock tree must be configured before the
+ * watchdog is started. Once started it cannot be stopped.
+ *
+ */
+class window_watchdog
+{
+public:
+  /// Window watchdog settings
+  struct settings
+  {
+    /// Time from the last feed until the device is reset
+    hal::time_duration timeout;
+    /// Feeding sooner than this after the previous feed resets the device.
+    /// Catches tasks stuck in a tight loop around the feed call.
+    hal::time_duration earliest_feed = hal::time_duration(0);
+  };
+
+  /**
+   * @brief Start the window watchdog
+   *
+   * @param p_settings - timeout and window
+   * @return result<window_watchdog> - watchdog driver, fails with
+   * `argument_out_of_domain` if the timeout or window cannot be reached with
+   * the current PCLK1 frequency.
+   */
+  static result<window_watchdog> get(settings p_settings);
+
+  /**
+   * @brief Reload the watchdog counter
+   *
+   */
+  void feed();
+
+private:
+  window_watchdog(std::uint8_t p_counter);
+
+  std::uint8_t m_counter;
+};
+
+/**
+ * @brief Address of the bit-band alias word of a bit in SRAM
+ *
+ * Writing 0 or 1 to the alias word clears or sets the bit in a single bus
+ * transaction, without a read-modify-write.
+ *
+ * @param p_address - address of the word in SRAM
+ * @param p_bit - bit within the word
+ * @return constexpr std::uintptr_t - address of the alias word
+ */
+constexpr std::uintptr_t sram_bit_band_alias(std::uintptr_t p_address,
+                                             std::uint32_t p_bit)
+{
+  constexpr std::uintptr_t sram_base = 0x2000'0000;
+  constexpr std::uintptr_t alias_base = 0x2200'0000;
+  return alias_base + (p_address - sram_base) * 32 + p_bit * 4;
+}
+
+/**
+ * @brief Feeds a watchdog only once every registered task has checked in
+ *
+ * Protects against a single task hanging while others, including the one
+ * feeding the watchdog, keep running.
+ *
+ * Usage:
+ *
+ *     watchdog_check_in check_in;
+ *     auto sensor_task = HAL_CHECK(check_in.add_task());
+ *     auto radio_task = HAL_CHECK(check_in.add_task());
+ *
+ *     // In each task loop or interrupt handler
+ *     sensor_task.check_in();
+ *
+ *     // In a periodic timer
+ *     check_in.feed_if_ready(watchdog);
+ *
+ * The object must be placed in internal SRAM as check-ins are bit-band
+ * stores, and must outlive its tasks.
+ *
+ */
+class watchdog_check_in
+{
+public:
+  /// Handle of a single task
+  class task
+  {
+  public:
+    /**
+     * @brief Record that the task is making progress
+     *
+     * Compiles to a single store and is safe to call from interrupts.
+     *
+     */
+    void check_in()
+    {
+#if defined(__arm__)
+      *m_alias = 1;
+#else
+      m_flags->fetch_or(m_mask, std::memory_order_relaxed);
+#endif
+    }
+
+  private:
+    friend class watchdog_check_in;
+
+    task(std::atomic<std::uint32_t>* p_flags, std::uint32_t p_bit);
+
+#if defined(__arm__)
+    volatile std::uint32_t* m_alias;
+#else
+    std::atomic<std::uint32_t>* m_flags;
+    std::uint32_t m_mask;
+#endif
+  };
+
+  watchdog_check_in() = default;
+  watchdog_check_in(const watchdog_check_in&) = delete;
+  watchdog_check_in& operator=(const watchdog_check_in&) = delete;
+
+  /**
+   * @brief Register a new task which must check in before every feed
+   *
+   * @return result<task> - handle of the task, fails with
+   * `resource_unavailable_try_again` if 32 tasks are already registered.
+   */
+  result<task> add_task();
+
+  /**
+   * @brief Determine if every registered task has checked in
+   *
+   * @return true - all tasks have checked in since the last feed
+   * @return false - at least one task has not checked in
+   */
+  [[nodiscard]] bool ready() const;
+
+  /**
+   * @brief Feed the watchdog if every task has checked in, then clear the
+   * check-ins
+   *
+   * @param p_watchdog - watchdog to feed
+   * @return true - the watchdog was fed
+   * @return false - a task has not checked in, the watchdog was not fed
+   */
+  bool feed_if_ready(auto& p_watchdog)
+  {
+    if (!ready()) {
+      return false;
+    }
+    p_watchdog.feed();
+    clear();
+    return true;
+  }
+
+private:
+  void clear();
+
+  std::atomic<std::uint32_t> m_flags = 0;
+  std::uint32_t m_registered = 0;
+};
+}  // namespace hal::stm32f1
@@ -0,0 +1,329 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <span>
+
+#include <libhal/error.hpp>
+#include <libhal/units.hpp>
+
+#include "constants.hpp"
+
+namespace hal::stm32f1 {
+/**
+ * @brief Build a BSRR word
+ *
+ * A pin in both masks is set, as set takes priority over reset in BSRR.
+ * Writing 0 leaves every pin unchanged, so a zero word holds the outputs for
+ * one step.
+ *
+ * @param p_set - pins to drive high, bit n is pin n
+ * @param p_reset - pins to drive low, bit n is pin n
+ * @return constexpr std::uint32_t - value of BSRR
+ */
+constexpr std::uint32_t bsrr_word(std::uint16_t p_set,
+                                  std::uint16_t p_reset = 0)
+{
+  return (static_cast<std::uint32_t>(p_reset) << 16) | p_set;
+}
+
+/// BSRR words per bit of WS2812 data
+static constexpr std::size_t ws2812_words_per_bit = 3;
+
+/// Step rate of a WS2812 waveform: 3 steps of 417ns make up each 1.25us bit.
+/// A 0 bit is high for one step and a 1 bit for two, both well within the
+/// 150ns tolerance of the datasheet timing.
+static constexpr hal::hertz ws2812_step_rate = 2'400'000.0f;
+
+/**
+ * @brief Number of BSRR words encoding a WS2812 data stream
+ *
+ * @param p_bytes - bytes of the longest strip, 3 per LED
+ * @return constexpr std::size_t - words needed by encode_ws2812()
+ */
+constexpr std::size_t ws2812_word_count(std::size_t p_bytes)
+{
+  return p_bytes * 8 * ws2812_words_per_bit;
+}
+
+/// One WS2812 strip driven by an encoded waveform
+struct ws2812_lane
+{
+  /// Pin number within the waveform's port, 0 to 15
+  std::uint8_t pin;
+  /// Bytes sent to the strip in wire order, which is G, R, B for each LED
+  std::span<const std::uint8_t> data;
+};
+
+/**
+ * @brief Encode WS2812 data for strips on pins of the same port
+ *
+ * Every lane is sent at the same time, so up to 16 strips refresh in the time
+ * of one. Each bit becomes three words: raise every active lane, drop the
+ * lanes sending a 0 and then drop every lane. A lane whose data has run out
+ * stays low.
+ *
+ * The pins end low. Leave them low for at least 300us before the next frame
+ * so the strips latch the data.
+ *
+ * @param p_words - destination, ws2812_word_count() of the longest lane
+ * @param p_lanes - strips to encode
+ * @return constexpr std::span<std::uint32_t> - words written, empty if the
+ * destination is too small
+ */
+constexpr std::span<std::uint32_t> encode_ws2812(
+  std::span<std::uint32_t> p_words,
+  std::span<const ws2812_lane> p_lanes)
+{
+  std::size_t length = 0;
+  for (const auto& lane : p_lanes) {
+    length = std::max(length, lane.data.size());
+  }
+  auto count = ws2812_word_count(length);
+  if (count > p_words.size()) {
+    return {};
+  }
+
+  auto* word = p_words.data();
+  for (std::size_t index = 0; index < length; index++) {
+    for (std::uint32_t bit = 0x80; bit != 0; bit >>= 1) {
+      std::uint16_t active = 0;
+      std::uint16_t zeros = 0;
+      for (const auto& lane : p_lanes) {
+        if (index >= lane.data.size()) {
+          continue;
+        }
+        auto pin_bit = static_cast<std::uint16_t>(1U << lane.pin);
+        active |= pin_bit;
+        if (!(lane.data[index] & bit)) {
+          zeros |= pin_bit;
+        }
+      }
+      *word++ = bsrr_word(active);
+      *word++ = bsrr_word(0, zeros);
+      *word++ = bsrr_word(0, active);
+    }
+  }
+
+  return p_words.first(count);
+}
+
+/**
+ * @brief Encode WS2812 data for a single strip
+ *
+ * @param p_words - destination, ws2812_word_count() of the data
+ * @param p_pin - pin number within the waveform's port
+ * @param p_data - bytes in wire order
+ * @return constexpr std::span<std::uint32_t> - words written, empty if the
+ * destination is too small
+ */
+constexpr std::span<std::uint32_t> encode_ws2812(
+  std::span<std::uint32_t> p_words,
+  std::uint8_t p_pin,
+  std::span<const std::uint8_t> p_data)
+{
+  ws2812_lane lane{ .pin = p_pin, .data = p_data };
+  return encode_ws2812(p_words, std::span<const ws2812_lane>(&lane, 1));
+}
+
+/// Pulse train for a step and direction motor driver
+struct step_pulses
+{
+  /// Pin number of the step input
+  std::uint8_t step_pin;
+  /// Pin number of the direction input
+  std::uint8_t direction_pin;
+  /// Level of the direction pin, true drives it high
+  bool forward = true;
+  /// Number of step pulses
+  std::uint32_t steps = 0;
+  /// Words between the rising edges of two steps, at least 2
+  std::uint32_t words_per_step = 2;
+  /// Words the step pin stays high, from 1 to words_per_step - 1
+  std::uint32_t high_words = 1;
+};
+
+/**
+ * @brief Number of BSRR words encoding a pulse train
+ *
+ * @param p_pulses - pulse train
+ * @return constexpr std::size_t - words needed by encode_step_pulses()
+ */
+constexpr std::size_t step_pulse_word_count(const step_pulses& p_pulses)
+{
+  return 1 + std::size_t{ p_pulses.steps } * p_pulses.words_per_step;
+}
+
+/**
+ * @brief Encode a step and direction pulse train
+ *
+ * The first word sets the direction and lowers the step pin, which gives the
+ * driver one step of direction setup time before the first rising edge. The
+ * step rate is the waveform step rate divided by words_per_step.
+ *
+ * @param p_words - destination, step_pulse_word_count() words
+ * @param p_pulses - pulse train
+ * @return constexpr std::span<std::uint32_t> - words written, empty if the
+ * destination is too small or the pulse timing is invalid
+ */
+constexpr std::span<std::uint32_t> encode_step_pulses(
+  std::span<std::uint32_t> p_words,
+  const step_pulses& p_pulses)
+{
+  if (p_pulses.high_words == 0 ||
+      p_pulses.high_words >= p_pulses.words_per_step) {
+    return {};
+  }
+  auto count = step_pulse_word_count(p_pulses);
+  if (count > p_words.size()) {
+    return {};
+  }
+
+  auto step = static_cast<std::uint16_t>(1U << p_pulses.step_pin);
+  auto direction = static_cast<std::uint16_t>(1U << p_pulses.direction_pin);
+
+  std::fill_n(p_words.begin(), count, 0U);
+  p_words[0] = p_pulses.forward ? bsrr_word(direction, step)
+                                : bsrr_word(0, direction | step);
+  for (std::size_t rise = 1; rise < count; rise += p_pulses.words_per_step) {
+    p_words[rise] = bsrr_word(step);
+    p_words[rise + p_pulses.high_words] = bsrr_word(0, step);
+  }
+
+  return p_words.first(count);
+}
+
+/// Settings of a waveform playback
+struct waveform_settings
+{
+  /// Words written to BSRR per second
+  hal::hertz step_rate;
+  /// Timer pacing the writes, one of peripheral::timer1 to timer8. Its update
+  /// request selects the DMA channel, see gpio_waveform.
+  peripheral timer = peripheral::timer2;
+  /// Restart from the first word after the last one until stop() is called
+  bool repeat = false;
+};
+
+/**
+ * @brief Timer paced DMA output of BSRR words to a GPIO port
+ *
+ * Each update event of the timer moves the next word of a buffer into the
+ * port's BSRR register. Every pin of the port changes on the same bus cycle,
+ * the CPU is free while the waveform plays and interrupts cannot stretch it.
+ * The edges move by a few bus cycles at most, when other DMA channels or the
+ * CPU hold the bus at the time of a request.
+ *
+ * Timers and the DMA channels serving their update requests:
+ *
+ * | timer  | DMA channel   |
+ * |--------|---------------|
+ * | timer1 | dma1 channel5 |
+ * | timer2 | dma1 channel2 |
+ * | timer3 | dma1 channel3 |
+ * | timer4 | dma1 channel7 |
+ * | timer5 | dma2 channel2 |
+ * | timer6 | dma2 channel3 |
+ * | timer7 | dma2 channel4 |
+ * | timer8 | dma2 channel1 |
+ *
+ * timer5 to timer8 and dma2 only exist on high density, XL density and
+ * connectivity line devices.
+ *
+ * Usage:
+ *
+ *     auto leds = gpio_waveform::get('B', 1 << 12).value();
+ *     std::array<std::uint32_t, ws2812_word_count(3 * 8)> words;
+ *     auto encoded = encode_ws2812(words, 12, colors);
+ *     leds.play(encoded, { .step_rate = ws2812_step_rate }).value();
+ *
+ */
+class gpio_waveform
+{
+public:
+  /**
+   * @brief Get a waveform output on a GPIO port
+   *
+   * Configures the pins as push pull outputs driven low.
+   *
+   * @param p_port - port letter, 'A' to 'G'
+   * @param p_pins - pins driven by the waveform, bit n is pin n
+   * @return result<gpio_waveform> - waveform driver, fails with
+   * `invalid_argument` if the port does not exist.
+   */
+  static result<gpio_waveform> get(std::uint8_t p_port, std::uint16_t p_pins);
+
+  /// A playing waveform moves with the driver, the source is left stopped
+  gpio_waveform(gpio_waveform&& p_other) noexcept;
+  gpio_waveform& operator=(gpio_waveform&& p_other) noexcept;
+  gpio_waveform(const gpio_waveform&) = delete;
+  gpio_waveform& operator=(const gpio_waveform&) = delete;
+  /// Stops a playing waveform
+  ~gpio_waveform();
+
+  /**
+   * @brief Play a buffer of BSRR words
+   *
+   * Stops the waveform playing. The first word is written one step after the
+   * call. The buffer is read by DMA while it plays, so it must stay alive
+   * until done() or stop(). Words should only drive the pins passed to get().
+   *
+   * @param p_words - BSRR words, 1 to 65535 of them
+   * @param p_settings - step rate, pacing timer and repetition
+   * @return status - fails with `invalid_argument` if the buffer size is out
+   * of range or the timer has no update DMA request,
+   * `argument_out_of_domain` if the timer cannot produce the step rate and
+   * `device_or_resource_busy` if the timer or DMA channel is in use.
+   */
+  status play(std::span<const std::uint32_t> p_words,
+              waveform_settings p_settings);
+
+  /**
+   * @brief Number of words still to be written
+   *
+   * @return std::size_t - words left in the current pass of the buffer, 0 if
+   * nothing plays
+   */
+  [[nodiscard]] std::size_t remaining();
+
+  /**
+   * @brief Determine if every word has been written
+   *
+   * A repeating waveform is never done.
+   *
+   * @return true - the waveform has ended or was never started
+   * @return false - the waveform is playing
+   */
+  [[nodiscard]] bool done();
+
+  /**
+   * @brief Stop the waveform and release its timer and DMA channel
+   *
+   * The pins hold the level of the last word written.
+   */
+  void stop();
+
+private:
+  gpio_waveform(std::uint8_t p_port);
+
+  std::uint8_t m_port;
+  std::optional<peripheral> m_timer{};
+  bool m_repeat = false;
+};
+}  // namespace hal::stm32f1
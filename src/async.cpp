@@ -0,0 +1,218 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <libhal-stm32f1/async.hpp>
+
+#include <array>
+#include <bit>
+#include <coroutine>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+
+#include "cortex_m_reg.hpp"
+
+namespace hal::stm32f1 {
+namespace {
+struct alignas(std::max_align_t) task_frame
+{
+  std::array<std::byte, task_frame_size> storage;
+};
+
+std::array<task_frame, task_frame_count> frames{};
+/// One bit per frame of the pool, set while the frame is in use
+std::uint32_t used_frames = 0;
+
+/// Masks interrupts for its lifetime
+class critical_section
+{
+public:
+  critical_section()
+    : m_primask(disable_interrupts())
+  {
+  }
+
+  critical_section(const critical_section&) = delete;
+  critical_section& operator=(const critical_section&) = delete;
+
+  ~critical_section()
+  {
+    restore_interrupts(m_primask);
+  }
+
+private:
+  std::uint32_t m_primask;
+};
+
+/// Sleep until an interrupt unless p_condition already holds
+template<typename Condition>
+void sleep_unless(Condition p_condition)
+{
+  // Pending interrupts still wake WFI while masked. They run once the mask
+  // is lifted, after the condition was checked.
+  critical_section masked;
+  if (!p_condition()) {
+    data_synchronization_barrier();
+    wait_for_interrupt();
+  }
+}
+}  // namespace
+
+void* allocate_task_frame(std::size_t p_size) noexcept
+{
+  if (p_size > task_frame_size) {
+    return nullptr;
+  }
+
+  auto free_frames = ~used_frames;
+  auto index = static_cast<std::size_t>(std::countr_zero(free_frames));
+  if (index >= task_frame_count) {
+    return nullptr;
+  }
+
+  used_frames |= 1U << index;
+  return frames[index].storage.data();
+}
+
+void free_task_frame(void* p_frame) noexcept
+{
+  auto* frame = static_cast<task_frame*>(p_frame);
+  auto index = static_cast<std::size_t>(frame - frames.data());
+  used_frames &= ~(1U << index);
+}
+
+std::size_t task_frames_in_use() noexcept
+{
+  return static_cast<std::size_t>(std::popcount(used_frames));
+}
+
+void task::promise_type::unhandled_exception() const noexcept
+{
+  std::terminate();
+}
+
+bool executor::spawn(task&& p_task) noexcept
+{
+  if (!p_task.valid()) {
+    return false;
+  }
+
+  for (auto& slot : m_tasks) {
+    if (slot.valid()) {
+      continue;
+    }
+    p_task.m_handle.promise().m_owner = this;
+    schedule(p_task.m_handle);
+    slot = std::move(p_task);
+    return true;
+  }
+  return false;
+}
+
+void executor::schedule(std::coroutine_handle<> p_handle) noexcept
+{
+  critical_section masked;
+  // Each frame waits on at most one event, so the queue cannot overflow
+  auto tail = (m_ready_head + m_ready_count) % m_ready.size();
+  m_ready[tail] = p_handle;
+  m_ready_count++;
+}
+
+bool executor::run_ready() noexcept
+{
+  std::size_t count = 0;
+  {
+    critical_section masked;
+    count = m_ready_count;
+  }
+
+  for (std::size_t index = 0; index < count; index++) {
+    std::coroutine_handle<> handle;
+    {
+      critical_section masked;
+      handle = m_ready[m_ready_head];
+      m_ready_head = (m_ready_head + 1) % m_ready.size();
+      m_ready_count--;
+    }
+    handle.resume();
+  }
+
+  for (auto& slot : m_tasks) {
+    if (slot.valid() && slot.done()) {
+      slot = task{};
+    }
+  }
+
+  return count != 0;
+}
+
+void executor::run(idle_handler p_idle) noexcept
+{
+  while (tasks() != 0) {
+    if (run_ready()) {
+      continue;
+    }
+    if (p_idle) {
+      p_idle();
+    } else {
+      sleep_unless([this]() { return m_ready_count != 0; });
+    }
+  }
+}
+
+std::size_t executor::tasks() const noexcept
+{
+  std::size_t count = 0;
+  for (const auto& slot : m_tasks) {
+    count += slot.valid() ? 1 : 0;
+  }
+  return count;
+}
+
+void completion::signal() noexcept
+{
+  critical_section masked;
+  m_done = true;
+  if (m_waiter) {
+    m_executor->schedule(std::exchange(m_waiter, nullptr));
+  }
+}
+
+void completion::reset() noexcept
+{
+  critical_section masked;
+  m_done = false;
+  m_waiter = nullptr;
+}
+
+void completion::wait() const noexcept
+{
+  while (!m_done) {
+    sleep_unless([this]() -> bool { return m_done; });
+  }
+}
+
+bool completion::awaiter::await_suspend(
+  std::coroutine_handle<task::promise_type> p_waiter) const noexcept
+{
+  critical_section masked;
+  // Signaled after await_ready() checked, carry on without suspending
+  if (m_completion->m_done) {
+    return false;
+  }
+  m_completion->m_waiter = p_waiter;
+  m_completion->m_executor = p_waiter.promise().owner();
+  return true;
+}
+}  // namespace hal::stm32f1
@@ -0,0 +1,60 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "backup_domain.hpp"
+
+#include <cstdint>
+
+#include <libhal-stm32f1/constants.hpp>
+#include <libhal-stm32f1/power_domain.hpp>
+#include <libhal-util/bit.hpp>
+
+#include "pwr_reg.hpp"
+
+namespace hal::stm32f1 {
+namespace {
+std::uint32_t access_depth = 0;
+}  // namespace
+
+void acquire_backup_domain_write_access()
+{
+  if (access_depth++ == 0) {
+    acquire_power(peripheral::power);
+    bit_modify(pwr->cr)
+      .set<power_control_register::disable_backup_write_protection>();
+  }
+}
+
+void release_backup_domain_write_access()
+{
+  if (access_depth == 0) {
+    return;
+  }
+  if (--access_depth == 0) {
+    bit_modify(pwr->cr)
+      .clear<power_control_register::disable_backup_write_protection>();
+    release_power(peripheral::power);
+  }
+}
+
+backup_domain_write_access::backup_domain_write_access()
+{
+  acquire_backup_domain_write_access();
+}
+
+backup_domain_write_access::~backup_domain_write_access()
+{
+  release_backup_domain_write_access();
+}
+}  // namespace hal::stm32f1
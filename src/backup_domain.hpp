@@ -0,0 +1,52 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+namespace hal::stm32f1 {
+/**
+ * @brief Allow writes to the backup domain
+ *
+ * The RTC, the backup registers and the RCC BDCR register are write
+ * protected after reset. Sets PWR_CR.DBP, which stays set until every
+ * acquire is balanced by release_backup_domain_write_access(). Updates power
+ * references, so it must be called from thread mode.
+ *
+ */
+void acquire_backup_domain_write_access();
+
+/**
+ * @brief Release write access taken by acquire_backup_domain_write_access()
+ *
+ */
+void release_backup_domain_write_access();
+
+/**
+ * @brief Allows writes to the backup domain for the lifetime of the object
+ *
+ * Instances can be nested. Like acquire_backup_domain_write_access(), it
+ * must be used from thread mode. Interrupt handlers rely on access held by
+ * their driver instead.
+ *
+ */
+class backup_domain_write_access
+{
+public:
+  backup_domain_write_access();
+  backup_domain_write_access(const backup_domain_write_access&) = delete;
+  backup_domain_write_access& operator=(const backup_domain_write_access&) =
+    delete;
+  ~backup_domain_write_access();
+};
+}  // namespace hal::stm32f1
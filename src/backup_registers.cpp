@@ -0,0 +1,68 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <libhal-stm32f1/backup_registers.hpp>
+
+#include <cstdint>
+
+#include <libhal-stm32f1/constants.hpp>
+#include <libhal-stm32f1/power_domain.hpp>
+
+#include "backup_domain.hpp"
+#include "bkp_reg.hpp"
+
+namespace hal::stm32f1 {
+namespace {
+volatile std::uint32_t* data_register(std::size_t p_index)
+{
+  if (p_index < bkp->dr1.size()) {
+    return &bkp->dr1[p_index];
+  }
+  p_index -= bkp->dr1.size();
+  if (p_index < bkp->dr11.size()) {
+    return &bkp->dr11[p_index];
+  }
+  return nullptr;
+}
+}  // namespace
+
+void read_backup_registers(std::size_t p_first, std::span<std::uint16_t> p_data)
+{
+  acquire_power(peripheral::backup_clock);
+
+  for (std::size_t i = 0; i < p_data.size(); i++) {
+    auto* reg = data_register(p_first + i);
+    p_data[i] = reg ? static_cast<std::uint16_t>(*reg & 0xFFFF) : 0;
+  }
+
+  release_power(peripheral::backup_clock);
+}
+
+void write_backup_registers(std::size_t p_first,
+                            std::span<const std::uint16_t> p_data)
+{
+  acquire_power(peripheral::backup_clock);
+
+  {
+    backup_domain_write_access backup_access;
+    for (std::size_t i = 0; i < p_data.size(); i++) {
+      if (auto* reg = data_register(p_first + i)) {
+        *reg = p_data[i];
+      }
+    }
+  }
+
+  release_power(peripheral::backup_clock);
+}
+}  // namespace hal::stm32f1
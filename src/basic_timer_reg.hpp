@@ -0,0 +1,97 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+#pragma once
+
+#include <array>
+#include <cstdint>
+
+#include <libhal-util/bit.hpp>
+
+namespace hal::stm32f1 {
+/// Register map of the basic timers TIM6 and TIM7. The general purpose and
+/// advanced timers share this layout up to ARR, so it also covers their time
+/// base.
+struct basic_timer_t
+{
+  volatile std::uint32_t cr1;
+  volatile std::uint32_t cr2;
+  std::uint32_t reserved0;
+  volatile std::uint32_t dier;
+  volatile std::uint32_t sr;
+  volatile std::uint32_t egr;
+  std::array<std::uint32_t, 3> reserved1;
+  volatile std::uint32_t cnt;
+  volatile std::uint32_t psc;
+  volatile std::uint32_t arr;
+};
+
+/// Bit masks for the CR1 register
+struct basic_timer_control1
+{
+  /// Buffer ARR so changes take effect on the next update
+  static constexpr auto auto_reload_preload = bit_mask::from<7>();
+  /// Stop counting at the next update event
+  static constexpr auto one_pulse = bit_mask::from<3>();
+  /// Counter enable
+  static constexpr auto enable = bit_mask::from<0>();
+};
+
+/// Bit masks for the CR2 register
+struct basic_timer_control2
+{
+  /// Master mode, selects the event sent on TRGO
+  static constexpr auto master_mode = bit_mask::from<4, 6>();
+};
+
+/// Values of the CR2 master mode field
+enum class basic_timer_master_mode : std::uint8_t
+{
+  reset = 0b000,
+  enable = 0b001,
+  update = 0b010,
+};
+
+/// Bit masks for the DIER register
+struct basic_timer_interrupt_enable
+{
+  /// Issue a DMA request on every update event
+  static constexpr auto update_dma = bit_mask::from<8>();
+  /// Update interrupt enable
+  static constexpr auto update_interrupt = bit_mask::from<0>();
+};
+
+/// Bit masks for the EGR register
+struct basic_timer_event
+{
+  /// Reinitialize the counter and load PSC and ARR
+  static constexpr auto update = bit_mask::from<0>();
+};
+
+inline basic_timer_t* timer1_reg =
+  reinterpret_cast<basic_timer_t*>(0x4001'2C00);
+inline basic_timer_t* timer2_reg =
+  reinterpret_cast<basic_timer_t*>(0x4000'0000);
+inline basic_timer_t* timer3_reg =
+  reinterpret_cast<basic_timer_t*>(0x4000'0400);
+inline basic_timer_t* timer4_reg =
+  reinterpret_cast<basic_timer_t*>(0x4000'0800);
+inline basic_timer_t* timer5_reg =
+  reinterpret_cast<basic_timer_t*>(0x4000'0C00);
+inline basic_timer_t* timer6_reg =
+  reinterpret_cast<basic_timer_t*>(0x4000'1000);
+inline basic_timer_t* timer7_reg =
+  reinterpret_cast<basic_timer_t*>(0x4000'1400);
+inline basic_timer_t* timer8_reg =
+  reinterpret_cast<basic_timer_t*>(0x4001'3400);
+}  // namespace hal::stm32f1
@@ -0,0 +1,39 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <array>
+#include <cstdint>
+
+namespace hal::stm32f1 {
+/// Backup register map, each data register holds 16 bits
+struct backup_t
+{
+  std::uint32_t reserved0;
+  /// Data registers 1 to 10, available on all devices
+  std::array<volatile std::uint32_t, 10> dr1;
+  /// RTC clock calibration
+  volatile std::uint32_t rtccr;
+  /// Tamper pin control
+  volatile std::uint32_t cr;
+  /// Tamper control and status
+  volatile std::uint32_t csr;
+  std::array<std::uint32_t, 2> reserved1;
+  /// Data registers 11 to 42, high density and connectivity line only
+  std::array<volatile std::uint32_t, 32> dr11;
+};
+
+inline backup_t* bkp = reinterpret_cast<backup_t*>(0x4000'6C00);
+}  // namespace hal::stm32f1
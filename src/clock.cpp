@@ -15,26 +15,98 @@
 #include <libhal-stm32f1/clock.hpp>
 
 #include <array>
+#include <cstdint>
 
 #include <libhal-stm32f1/constants.hpp>
 #include <libhal-util/bit.hpp>
 #include <libhal-util/enum.hpp>
 
+#include "backup_domain.hpp"
 #include "flash_reg.hpp"
 #include "rcc_reg.hpp"
 
 namespace hal::stm32f1 {
 
 namespace {
-hal::hertz m_rtc_clock_rate = 0.0_Hz;
-hal::hertz m_usb_clock_rate = 0.0_Hz;
-hal::hertz m_pll_clock_rate = 0.0_Hz;
-hal::hertz m_ahb_clock_rate = internal_high_speed_oscillator;
-hal::hertz m_apb1_clock_rate = 0.0_Hz;
-hal::hertz m_apb2_clock_rate = 0.0_Hz;
-hal::hertz m_timer_apb1_clock_rate = 0.0_Hz;
-hal::hertz m_timer_apb2_clock_rate = 0.0_Hz;
-hal::hertz m_adc_clock_rate = 0.0_Hz;
+// Rates are kept in integer Hz. Every divider and multiplier of the clock
+// tree is an integer, so the rates are exact and need no soft-float code.
+std::uint32_t m_high_speed_external_rate = 0;
+std::uint32_t m_rtc_clock_rate = 0;
+std::uint32_t m_usb_clock_rate = 0;
+std::uint32_t m_pll_clock_rate = 0;
+std::uint32_t m_ahb_clock_rate = internal_high_speed_oscillator_hz;
+std::uint32_t m_apb1_clock_rate = 0;
+std::uint32_t m_apb2_clock_rate = 0;
+std::uint32_t m_timer_apb1_clock_rate = 0;
+std::uint32_t m_timer_apb2_clock_rate = 0;
+std::uint32_t m_adc_clock_rate = 0;
+clock_tree m_clock_tree{};
+
+std::uint32_t ahb_divisor(ahb_divider p_divider)
+{
+  switch (p_divider) {
+    case ahb_divider::divide_by_1:
+      return 1;
+    case ahb_divider::divide_by_2:
+      return 2;
+    case ahb_divider::divide_by_4:
+      return 4;
+    case ahb_divider::divide_by_8:
+      return 8;
+    case ahb_divider::divide_by_16:
+      return 16;
+    case ahb_divider::divide_by_64:
+      return 64;
+    case ahb_divider::divide_by_128:
+      return 128;
+    case ahb_divider::divide_by_256:
+      return 256;
+    case ahb_divider::divide_by_512:
+      return 512;
+  }
+  return 1;
+}
+
+std::uint32_t apb_divisor(apb_divider p_divider)
+{
+  switch (p_divider) {
+    case apb_divider::divide_by_1:
+      return 1;
+    case apb_divider::divide_by_2:
+      return 2;
+    case apb_divider::divide_by_4:
+      return 4;
+    case apb_divider::divide_by_8:
+      return 8;
+    case apb_divider::divide_by_16:
+      return 16;
+  }
+  return 1;
+}
+
+/// Timers run at twice the APB clock when the APB is divided
+std::uint32_t timer_clock_rate(std::uint32_t p_apb_rate, apb_divider p_divider)
+{
+  if (p_divider == apb_divider::divide_by_1) {
+    return p_apb_rate;
+  }
+  return p_apb_rate * 2;
+}
+
+std::uint32_t adc_divisor(adc_divider p_divider)
+{
+  switch (p_divider) {
+    case adc_divider::divide_by_2:
+      return 2;
+    case adc_divider::divide_by_4:
+      return 4;
+    case adc_divider::divide_by_6:
+      return 6;
+    case adc_divider::divide_by_8:
+      return 8;
+  }
+  return 2;
+}
 }  // namespace
 
 /// @attention If configuration of the system clocks is desired, one should
@@ -50,7 +122,11 @@ hal::hertz m_adc_clock_rate = 0.0_Hz;
 ///      https://www.st.com/resource/en/reference_manual/cd00171190-stm32f101xx-stm32f102xx-stm32f103xx-stm32f105xx-and-stm32f107xx-advanced-arm-based-32-bit-mcus-stmicroelectronics.pdf#page=126
 void configure_clocks(clock_tree p_clock_tree)
 {
-  hal::hertz system_clock = 0.0_Hz;
+  std::uint32_t system_clock = 0;
+  auto high_speed_external = to_hz(p_clock_tree.high_speed_external);
+  auto low_speed_external = to_hz(p_clock_tree.low_speed_external);
+  // BDCR is part of the backup domain and ignores writes without this
+  backup_domain_write_access backup_access;
 
   // =========================================================================
   // Step 1. Select internal clock source for everything.
@@ -61,10 +137,12 @@ void configure_clocks(clock_tree p_clock_tree)
     value(system_clock_select::high_speed_internal));
 
   // Step 1.4 Reset RTC clock registers
-  rtc_register::reg().set(rtc_register::backup_domain_reset);
+  if (!p_clock_tree.rtc.preserve_backup_domain) {
+    rtc_register::reg().set(rtc_register::backup_domain_reset);
 
-  // Manually clear the RTC reset bit
-  rtc_register::reg().clear(rtc_register::backup_domain_reset);
+    // Manually clear the RTC reset bit
+    rtc_register::reg().clear(rtc_register::backup_domain_reset);
+  }
 
   // =========================================================================
   // Step 2. Disable PLL and external clock sources
@@ -79,21 +157,30 @@ void configure_clocks(clock_tree p_clock_tree)
   // Step 3. Enable External Oscillators
   // =========================================================================
   // Step 3.1 Enable High speed external Oscillator
-  if (p_clock_tree.high_speed_external != 0.0_MHz) {
+  if (high_speed_external != 0) {
     clock_control::reg().set(clock_control::external_osc_enable);
 
-    while (!bit_extract<clock_control::external_osc_ready>(
-      clock_control::reg().get())) {
+    while (!bit_extract<clock_control::external_osc_ready>(rcc->cr)) {
       continue;
     }
   }
 
   // Step 3.2 Enable Low speed external Oscillator
-  if (p_clock_tree.low_speed_external != 0.0_MHz) {
+  if (low_speed_external != 0) {
     rtc_register::reg().set(rtc_register::low_speed_osc_enable);
 
-    while (!bit_extract<rtc_register::low_speed_osc_ready>(
-      rtc_register::reg().get())) {
+    while (!bit_extract<rtc_register::low_speed_osc_ready>(rcc->bdcr)) {
+      continue;
+    }
+  }
+
+  // Step 3.3 Enable Low speed internal Oscillator for the RTC. CSR is not
+  //          part of the backup domain, so LSION is cleared by every reset.
+  if (p_clock_tree.rtc.enable &&
+      p_clock_tree.rtc.source == rtc_source::low_speed_internal) {
+    control_status::reg().set(control_status::low_speed_internal_enable);
+
+    while (!bit_extract<control_status::low_speed_internal_ready>(rcc->csr)) {
       continue;
     }
   }
@@ -115,25 +202,24 @@ void configure_clocks(clock_tree p_clock_tree)
 
     clock_control::reg().set(clock_control::pll_enable);
 
-    while (!bit_extract<clock_control::pll_ready>(clock_control::reg().get())) {
+    while (!bit_extract<clock_control::pll_ready>(rcc->cr)) {
       continue;
     }
 
     switch (p_clock_tree.pll.source) {
       case pll_source::high_speed_internal:
-        m_pll_clock_rate = internal_high_speed_oscillator / 2;
+        m_pll_clock_rate = internal_high_speed_oscillator_hz / 2;
         break;
       case pll_source::high_speed_external:
-        m_pll_clock_rate = p_clock_tree.high_speed_external;
+        m_pll_clock_rate = high_speed_external;
         break;
       case pll_source::high_speed_external_divided_by_2:
-        m_pll_clock_rate = p_clock_tree.high_speed_external / 2;
+        m_pll_clock_rate = high_speed_external / 2;
         break;
     }
 
-    // Multiply the PLL clock up to the correct rate.
-    float multiply = value(p_clock_tree.pll.multiply);
-    m_pll_clock_rate = m_pll_clock_rate * (multiply + 2.0f);
+    // Multiply the PLL clock up to the correct rate, PLLMUL = n - 2
+    m_pll_clock_rate *= value(p_clock_tree.pll.multiply) + 2U;
   }
 
   // =========================================================================
@@ -165,10 +251,10 @@ void configure_clocks(clock_tree p_clock_tree)
   //          to be unable to read from flash, resulting in the platform
   //          locking up. See p.60 of RM0008 for the Flash ACR register
   if (p_clock_tree.system_clock == system_clock_select::pll) {
-    if (m_pll_clock_rate <= 24.0_MHz) {
+    if (m_pll_clock_rate <= 24'000'000) {
       // 0 Wait states
       bit_modify(flash->acr).insert<bit_mask::from<0, 2>()>(0b000U);
-    } else if (24.0_MHz <= m_pll_clock_rate && m_pll_clock_rate <= 48.0_MHz) {
+    } else if (m_pll_clock_rate <= 48'000'000) {
       // 1 Wait state
       bit_modify(flash->acr).insert<bit_mask::from<0, 2>()>(0b001U);
     } else {
@@ -184,17 +270,17 @@ void configure_clocks(clock_tree p_clock_tree)
   clock_configuration::reg().insert<clock_configuration::system_clock_select>(
     value(p_clock_tree.system_clock));
 
-  while (bit_extract<clock_configuration::system_clock_status>(
-           clock_configuration::reg().get()) != target_clock_source) {
+  while (bit_extract<clock_configuration::system_clock_status>(rcc->cfgr) !=
+         target_clock_source) {
     continue;
   }
 
   switch (p_clock_tree.system_clock) {
     case system_clock_select::high_speed_internal:
-      system_clock = internal_high_speed_oscillator;
+      system_clock = internal_high_speed_oscillator_hz;
       break;
     case system_clock_select::high_speed_external:
-      system_clock = p_clock_tree.high_speed_external;
+      system_clock = high_speed_external;
       break;
     case system_clock_select::pll:
       system_clock = m_pll_clock_rate;
@@ -210,84 +296,25 @@ void configure_clocks(clock_tree p_clock_tree)
   // =========================================================================
   // Step 8. Define the clock rates for the system
   // =========================================================================
-  switch (p_clock_tree.ahb.divider) {
-    case ahb_divider::divide_by_1:
-      m_ahb_clock_rate = system_clock / 1;
-      break;
-    case ahb_divider::divide_by_2:
-      m_ahb_clock_rate = system_clock / 2;
-      break;
-    case ahb_divider::divide_by_4:
-      m_ahb_clock_rate = system_clock / 4;
-      break;
-    case ahb_divider::divide_by_8:
-      m_ahb_clock_rate = system_clock / 8;
-      break;
-    case ahb_divider::divide_by_16:
-      m_ahb_clock_rate = system_clock / 16;
-      break;
-    case ahb_divider::divide_by_64:
-      m_ahb_clock_rate = system_clock / 64;
-      break;
-    case ahb_divider::divide_by_128:
-      m_ahb_clock_rate = system_clock / 128;
-      break;
-    case ahb_divider::divide_by_256:
-      m_ahb_clock_rate = system_clock / 256;
-      break;
-    case ahb_divider::divide_by_512:
-      m_ahb_clock_rate = system_clock / 512;
-      break;
-  }
-
-  switch (p_clock_tree.ahb.apb1.divider) {
-    case apb_divider::divide_by_1:
-      m_apb1_clock_rate = m_ahb_clock_rate / 1;
-      break;
-    case apb_divider::divide_by_2:
-      m_apb1_clock_rate = m_ahb_clock_rate / 2;
-      break;
-    case apb_divider::divide_by_4:
-      m_apb1_clock_rate = m_ahb_clock_rate / 4;
-      break;
-    case apb_divider::divide_by_8:
-      m_apb1_clock_rate = m_ahb_clock_rate / 8;
-      break;
-    case apb_divider::divide_by_16:
-      m_apb1_clock_rate = m_ahb_clock_rate / 16;
-      break;
-  }
-
-  switch (p_clock_tree.ahb.apb2.divider) {
-    case apb_divider::divide_by_1:
-      m_apb2_clock_rate = m_ahb_clock_rate / 1;
-      break;
-    case apb_divider::divide_by_2:
-      m_apb2_clock_rate = m_ahb_clock_rate / 2;
-      break;
-    case apb_divider::divide_by_4:
-      m_apb2_clock_rate = m_ahb_clock_rate / 4;
-      break;
-    case apb_divider::divide_by_8:
-      m_apb2_clock_rate = m_ahb_clock_rate / 8;
-      break;
-    case apb_divider::divide_by_16:
-      m_apb2_clock_rate = m_ahb_clock_rate / 16;
-      break;
-  }
-
-  switch (p_clock_tree.rtc.source) {
+  m_ahb_clock_rate = system_clock / ahb_divisor(p_clock_tree.ahb.divider);
+  m_apb1_clock_rate =
+    m_ahb_clock_rate / apb_divisor(p_clock_tree.ahb.apb1.divider);
+  m_apb2_clock_rate =
+    m_ahb_clock_rate / apb_divisor(p_clock_tree.ahb.apb2.divider);
+
+  switch (p_clock_tree.rtc.enable ? p_clock_tree.rtc.source
+                                  : rtc_source::no_clock) {
     case rtc_source::no_clock:
-      m_rtc_clock_rate = 0.0_Hz;
+      m_rtc_clock_rate = 0;
       break;
     case rtc_source::low_speed_internal:
-      m_rtc_clock_rate = internal_low_speed_oscillator;
+      m_rtc_clock_rate = internal_low_speed_oscillator_hz;
       break;
     case rtc_source::low_speed_external:
-      m_rtc_clock_rate = p_clock_tree.low_speed_external;
+      m_rtc_clock_rate = low_speed_external;
       break;
     case rtc_source::high_speed_external_divided_by_128:
-      m_rtc_clock_rate = p_clock_tree.high_speed_external / 128;
+      m_rtc_clock_rate = high_speed_external / 128;
       break;
   }
 
@@ -300,50 +327,55 @@ void configure_clocks(clock_tree p_clock_tree)
       break;
   }
 
-  switch (p_clock_tree.ahb.apb1.divider) {
-    case apb_divider::divide_by_1:
-      m_timer_apb1_clock_rate = m_apb1_clock_rate;
-      break;
-    default:
-      m_timer_apb1_clock_rate = m_apb1_clock_rate * 2;
-      break;
+  m_timer_apb1_clock_rate =
+    timer_clock_rate(m_apb1_clock_rate, p_clock_tree.ahb.apb1.divider);
+  m_timer_apb2_clock_rate =
+    timer_clock_rate(m_apb2_clock_rate, p_clock_tree.ahb.apb2.divider);
+  m_adc_clock_rate =
+    m_apb2_clock_rate / adc_divisor(p_clock_tree.ahb.apb2.adc.divider);
+
+  m_high_speed_external_rate = high_speed_external;
+  m_clock_tree = p_clock_tree;
+}
+
+void restore_clocks()
+{
+  if (m_high_speed_external_rate != 0) {
+    clock_control::reg().set(clock_control::external_osc_enable);
+
+    while (!bit_extract<clock_control::external_osc_ready>(rcc->cr)) {
+      continue;
+    }
   }
 
-  switch (p_clock_tree.ahb.apb2.divider) {
-    case apb_divider::divide_by_1:
-      m_timer_apb2_clock_rate = m_apb2_clock_rate;
-      break;
-    default:
-      m_timer_apb2_clock_rate = m_apb2_clock_rate * 2;
-      break;
+  if (m_clock_tree.pll.enable) {
+    clock_control::reg().set(clock_control::pll_enable);
+
+    while (!bit_extract<clock_control::pll_ready>(rcc->cr)) {
+      continue;
+    }
   }
 
-  switch (p_clock_tree.ahb.apb2.adc.divider) {
-    case adc_divider::divide_by_2:
-      m_adc_clock_rate = m_apb2_clock_rate / 2;
-      break;
-    case adc_divider::divide_by_4:
-      m_adc_clock_rate = m_apb2_clock_rate / 4;
-      break;
-    case adc_divider::divide_by_6:
-      m_adc_clock_rate = m_apb2_clock_rate / 6;
-      break;
-    case adc_divider::divide_by_8:
-      m_adc_clock_rate = m_apb2_clock_rate / 8;
-      break;
+  clock_configuration::reg().insert<clock_configuration::system_clock_select>(
+    value(m_clock_tree.system_clock));
+
+  while (bit_extract<clock_configuration::system_clock_status>(rcc->cfgr) !=
+         value(m_clock_tree.system_clock)) {
+    continue;
   }
 }
 
-/// @return the clock rate frequency of a peripheral
-hal::hertz frequency(peripheral p_id)
+std::uint32_t frequency_hz(peripheral p_id)
 {
   switch (p_id) {
     case peripheral::i2s:
       return m_pll_clock_rate;
+    case peripheral::rtc:
+      return m_rtc_clock_rate;
     case peripheral::usb:
       return m_usb_clock_rate;
     case peripheral::flitf:
-      return internal_high_speed_oscillator;
+      return internal_high_speed_oscillator_hz;
 
     // Arm Cortex running clock rate.
     // This code does not utilize the /8 clock for the system timer, thus the
@@ -406,10 +438,15 @@ hal::hertz frequency(peripheral p_id)
         return m_apb2_clock_rate;
       }
 
-      return 0.0_Hz;
+      return 0;
     }
   }
 
-  return 0.0_Hz;
+  return 0;
+}
+
+hal::hertz frequency(peripheral p_id)
+{
+  return static_cast<hal::hertz>(frequency_hz(p_id));
 }
 }  // namespace hal::stm32f1
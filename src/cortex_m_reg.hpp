@@ -0,0 +1,204 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <array>
+#include <cstdint>
+
+#include <libhal-util/bit.hpp>
+
+namespace hal::stm32f1 {
+/// System control block register map
+struct system_control_block_t
+{
+  volatile std::uint32_t cpuid;
+  volatile std::uint32_t icsr;
+  volatile std::uint32_t vtor;
+  volatile std::uint32_t aircr;
+  volatile std::uint32_t scr;
+  volatile std::uint32_t ccr;
+  /// System handler priority bytes for exceptions 4 to 15
+  std::array<volatile std::uint8_t, 12> shp;
+  volatile std::uint32_t shcsr;
+};
+
+/// Nested vectored interrupt controller register map
+struct nested_vectored_interrupt_controller_t
+{
+  std::array<volatile std::uint32_t, 8> iser;
+  std::array<std::uint32_t, 24> reserved0;
+  std::array<volatile std::uint32_t, 8> icer;
+  std::array<std::uint32_t, 24> reserved1;
+  std::array<volatile std::uint32_t, 8> ispr;
+  std::array<std::uint32_t, 24> reserved2;
+  std::array<volatile std::uint32_t, 8> icpr;
+  std::array<std::uint32_t, 24> reserved3;
+  std::array<volatile std::uint32_t, 8> iabr;
+  std::array<std::uint32_t, 56> reserved4;
+  std::array<volatile std::uint8_t, 240> ip;
+};
+
+/// Core debug register map
+struct core_debug_t
+{
+  volatile std::uint32_t dhcsr;
+  volatile std::uint32_t dcrsr;
+  volatile std::uint32_t dcrdr;
+  volatile std::uint32_t demcr;
+};
+
+/// Data watchpoint and trace unit register map, up to the cycle counter
+struct data_watchpoint_trace_t
+{
+  volatile std::uint32_t ctrl;
+  volatile std::uint32_t cyccnt;
+};
+
+/// Bit masks for the DEMCR register
+struct debug_exception_monitor_control
+{
+  /// Enables the DWT and ITM units
+  static constexpr auto trace_enable = bit_mask::from<24>();
+};
+
+/// Bit masks for the DWT CTRL register
+struct dwt_control
+{
+  /// Bit of the cycle counter that triggers synchronization packets
+  static constexpr auto synchronization_tap = bit_mask::from<10, 11>();
+  /// Enables the cycle counter
+  static constexpr auto cycle_counter_enable = bit_mask::from<0>();
+};
+
+/// Bit masks for the ICSR register
+struct interrupt_control_state
+{
+  /// Write 1 to make PendSV pending
+  static constexpr auto pend_sv_set = bit_mask::from<28>();
+  /// Exception number of the active handler, 0 in thread mode
+  static constexpr auto active_vector = bit_mask::from<0, 8>();
+};
+
+/// Bit masks for the AIRCR register
+struct application_interrupt_and_reset_control
+{
+  /// Key that must be written along with any change to AIRCR
+  static constexpr auto vector_key = bit_mask::from<16, 31>();
+  /// Position of the binary point between preempt and sub priority
+  static constexpr auto priority_group = bit_mask::from<8, 10>();
+};
+
+/// Bit masks for the SCR register
+struct system_control
+{
+  /// Pending interrupts, including disabled ones, wake the core from WFE
+  static constexpr auto send_event_on_pend = bit_mask::from<4>();
+  /// Use deep sleep, which is stop or standby mode on the stm32f1
+  static constexpr auto sleep_deep = bit_mask::from<2>();
+  /// Return to sleep after the last interrupt handler returns
+  static constexpr auto sleep_on_exit = bit_mask::from<1>();
+};
+
+/// Value that must be written to AIRCR.VECTKEY for a write to take effect
+static constexpr std::uint32_t aircr_vector_key = 0x05FA;
+
+inline system_control_block_t* scb =
+  reinterpret_cast<system_control_block_t*>(0xE000'ED00);
+
+inline nested_vectored_interrupt_controller_t* nvic =
+  reinterpret_cast<nested_vectored_interrupt_controller_t*>(0xE000'E100);
+
+inline core_debug_t* core_debug =
+  reinterpret_cast<core_debug_t*>(0xE000'EDF0);
+
+inline data_watchpoint_trace_t* dwt =
+  reinterpret_cast<data_watchpoint_trace_t*>(0xE000'1000);
+
+/// Exception number of the active handler
+inline std::uint32_t active_vector()
+{
+#if defined(__arm__)
+  std::uint32_t ipsr = 0;
+  asm volatile("mrs %0, ipsr" : "=r"(ipsr));
+  return ipsr & 0x1FF;
+#else
+  return bit_extract<interrupt_control_state::active_vector>(scb->icsr);
+#endif
+}
+
+/// Start the DWT cycle counter if it is not running already
+inline void enable_cycle_counter()
+{
+  bit_modify(core_debug->demcr)
+    .set<debug_exception_monitor_control::trace_enable>();
+  bit_modify(dwt->ctrl).set<dwt_control::cycle_counter_enable>();
+}
+
+/// Ensure all explicit memory accesses complete before continuing
+inline void data_synchronization_barrier()
+{
+#if defined(__arm__)
+  asm volatile("dsb" ::: "memory");
+#endif
+}
+
+/// Flush the pipeline so that following instructions see prior changes
+inline void instruction_synchronization_barrier()
+{
+#if defined(__arm__)
+  asm volatile("isb" ::: "memory");
+#endif
+}
+
+/// Suspend execution until an interrupt occurs
+inline void wait_for_interrupt()
+{
+#if defined(__arm__)
+  asm volatile("wfi" ::: "memory");
+#endif
+}
+
+/// Mask interrupts and return the previous PRIMASK for restore_interrupts()
+inline std::uint32_t disable_interrupts()
+{
+#if defined(__arm__)
+  std::uint32_t primask = 0;
+  asm volatile("mrs %0, primask\n"
+               "cpsid i"
+               : "=r"(primask)
+               :
+               : "memory");
+  return primask;
+#else
+  return 0;
+#endif
+}
+
+/// Restore the PRIMASK value returned by disable_interrupts()
+inline void restore_interrupts([[maybe_unused]] std::uint32_t p_primask)
+{
+#if defined(__arm__)
+  asm volatile("msr primask, %0" : : "r"(p_primask) : "memory");
+#endif
+}
+
+/// Suspend execution until an event occurs
+inline void wait_for_event()
+{
+#if defined(__arm__)
+  asm volatile("wfe" ::: "memory");
+#endif
+}
+}  // namespace hal::stm32f1
@@ -0,0 +1,176 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <libhal-stm32f1/crc.hpp>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <utility>
+
+#include <libhal-stm32f1/power_domain.hpp>
+#include <libhal-util/bit.hpp>
+#include <libhal-util/enum.hpp>
+
+#include "crc_reg.hpp"
+#include "dma.hpp"
+
+namespace hal::stm32f1 {
+namespace {
+/// CNDTR is 16 bits wide
+constexpr std::size_t max_dma_transfer = 0xFFFF;
+
+void reset_crc()
+{
+  crc_reg->cr = bit_value<std::uint32_t>(0).set<crc_control::reset>().get();
+}
+
+void feed_with_cpu(std::span<const std::uint32_t> p_data)
+{
+  for (auto word : p_data) {
+    crc_reg->dr = word;
+  }
+}
+}  // namespace
+
+result<crc32> crc32::get(settings p_settings)
+{
+  acquire_power(peripheral::crc);
+  return crc32(p_settings);
+}
+
+crc32::crc32(settings p_settings)
+  : m_settings(p_settings)
+{
+}
+
+crc32::crc32(crc32&& p_other) noexcept
+  : m_settings(p_other.m_settings)
+  , m_owner(std::exchange(p_other.m_owner, false))
+{
+}
+
+crc32& crc32::operator=(crc32&& p_other) noexcept
+{
+  if (this != &p_other) {
+    if (m_owner) {
+      release_power(peripheral::crc);
+    }
+    m_settings = p_other.m_settings;
+    m_owner = std::exchange(p_other.m_owner, false);
+  }
+  return *this;
+}
+
+crc32::~crc32()
+{
+  // A moved from driver holds no reference
+  if (m_owner) {
+    release_power(peripheral::crc);
+  }
+}
+
+std::uint32_t crc32::compute(std::span<const std::uint32_t> p_data)
+{
+  reset_crc();
+
+  if (m_settings.dma_threshold != 0 &&
+      p_data.size() >= m_settings.dma_threshold) {
+    feed_with_dma(p_data);
+    return crc_reg->dr;
+  }
+
+  feed_with_cpu(p_data);
+  return crc_reg->dr;
+}
+
+std::uint32_t crc32::compute_reflected(std::span<const hal::byte> p_data)
+{
+  reset_crc();
+
+  // DMA cannot reflect the input, so the CPU feeds the unit one bit reversed
+  // word at a time. RBIT + STR is still several times faster than the table
+  // lookup per byte of the software implementation.
+  auto whole_words = p_data.size() / sizeof(std::uint32_t);
+  for (std::size_t i = 0; i < whole_words; i++) {
+    std::uint32_t word;
+    std::memcpy(&word, &p_data[i * sizeof(word)], sizeof(word));
+    crc_reg->dr = bit_reverse(word);
+  }
+
+  std::uint32_t crc = ~bit_reverse(crc_reg->dr);
+  return software_crc32(p_data.subspan(whole_words * sizeof(std::uint32_t)),
+                        crc);
+}
+
+void crc32::feed_with_dma(std::span<const std::uint32_t> p_data)
+{
+  using ccr = dma_channel_configuration;
+
+  auto select = claim_any_dma_channel();
+  if (!select) {
+    // Every channel is busy, fall back to the CPU
+    feed_with_cpu(p_data);
+    return;
+  }
+
+  auto& channel = dma_channel(*select);
+  channel.cpar = static_cast<std::uint32_t>(
+    reinterpret_cast<std::uintptr_t>(&crc_reg->dr));
+
+  auto remaining = p_data;
+  while (!remaining.empty()) {
+    auto count = std::min(remaining.size(), max_dma_transfer);
+
+    clear_dma_flags(*select);
+    channel.cmar = static_cast<std::uint32_t>(
+      reinterpret_cast<std::uintptr_t>(remaining.data()));
+    channel.cndtr = static_cast<std::uint32_t>(count);
+
+    // In memory to memory mode the "peripheral" side, the CRC data register,
+    // is the destination when direction is set to read from memory.
+    channel.ccr = bit_value<std::uint32_t>(0)
+                    .set<ccr::memory_to_memory>()
+                    .insert<ccr::memory_size>(value(dma_transfer_size::bits32))
+                    .insert<ccr::peripheral_size>(
+                      value(dma_transfer_size::bits32))
+                    .set<ccr::memory_increment>()
+                    .set<ccr::direction>()
+                    .set<ccr::enable>()
+                    .get();
+
+    constexpr auto done =
+      dma_flags::transfer_complete | dma_flags::transfer_error;
+    std::uint32_t flags = 0;
+    while (((flags = dma_flags_of(*select)) & done) == 0) {
+      continue;
+    }
+
+    bit_modify(channel.ccr).clear<ccr::enable>();
+
+    if (flags & dma_flags::transfer_error) {
+      // The transfer stopped part way and it is unknown which words reached
+      // the unit, so start over from the first word with the CPU.
+      release_dma_channel(*select);
+      reset_crc();
+      feed_with_cpu(p_data);
+      return;
+    }
+
+    remaining = remaining.subspan(count);
+  }
+
+  release_dma_channel(*select);
+}
+}  // namespace hal::stm32f1
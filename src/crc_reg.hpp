@@ -0,0 +1,40 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <cstdint>
+
+#include <libhal-util/bit.hpp>
+
+namespace hal::stm32f1 {
+/// CRC calculation unit register map
+struct crc_t
+{
+  /// Writes feed a word into the CRC, reads return the current CRC
+  volatile std::uint32_t dr;
+  /// 8-bit general purpose register, unaffected by reset of the CRC
+  volatile std::uint32_t idr;
+  volatile std::uint32_t cr;
+};
+
+/// Bit masks for the CRC CR register
+struct crc_control
+{
+  /// Writing 1 resets the data register to 0xFFFFFFFF
+  static constexpr auto reset = bit_mask::from<0>();
+};
+
+inline crc_t* crc_reg = reinterpret_cast<crc_t*>(0x4002'3000);
+}  // namespace hal::stm32f1
@@ -0,0 +1,359 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <libhal-stm32f1/dac.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <optional>
+#include <utility>
+
+#include <libhal-stm32f1/clock.hpp>
+#include <libhal-stm32f1/constants.hpp>
+#include <libhal-stm32f1/power_domain.hpp>
+#include <libhal-util/bit.hpp>
+#include <libhal-util/enum.hpp>
+
+#include "basic_timer_reg.hpp"
+#include "dac_reg.hpp"
+#include "dma.hpp"
+#include "pin.hpp"
+#include "timer.hpp"
+
+namespace hal::stm32f1 {
+namespace {
+/// CNDTR is 16 bits wide
+constexpr std::size_t max_stream_length = 0xFFFF;
+
+constexpr dma_channel_select channel1_dma{ .controller = peripheral::dma2,
+                                           .channel = 3 };
+constexpr dma_channel_select channel2_dma{ .controller = peripheral::dma2,
+                                           .channel = 4 };
+
+/// Acquired once per driver, whichever channels it uses
+constexpr peripheral_set dac_power{ peripheral::dac, peripheral::gpio_a };
+
+peripheral timer_peripheral(dac_trigger p_trigger)
+{
+  return p_trigger == dac_trigger::timer7 ? peripheral::timer7
+                                          : peripheral::timer6;
+}
+
+/// Mask of a channel's half of the CR register
+bit_mask channel_control(std::uint8_t p_channel)
+{
+  return { .position = (p_channel - 1U) * dac_channel2_offset, .width = 16 };
+}
+
+void enable_channel(std::uint8_t p_channel, dac_settings p_settings)
+{
+  // The pin must be analog so the digital input stage does not load the
+  // output. Channel 1 is PA4 and channel 2 is PA5.
+  auto pin = static_cast<std::uint8_t>(3 + p_channel);
+  configure_pin({ .port = 'A', .pin = pin }, input_analog);
+
+  auto control = bit_value<std::uint32_t>(0)
+                   .set<dac_control::enable>()
+                   .insert<dac_control::buffer_off>(
+                     static_cast<std::uint32_t>(!p_settings.output_buffer))
+                   .get();
+  bit_modify(dac_reg->cr).insert(channel_control(p_channel), control);
+}
+
+/// Read the CR fields of a channel, shifted down to the channel 1 layout
+bit_value<std::uint32_t> channel_fields(std::uint8_t p_channel)
+{
+  auto mask = channel_control(p_channel);
+  return bit_value<std::uint32_t>(bit_extract(mask, dac_reg->cr));
+}
+
+/// Route the trigger to a channel, with or without a DMA request per trigger
+void enable_trigger(std::uint8_t p_channel, dac_trigger p_trigger, bool p_dma)
+{
+  auto control = channel_fields(p_channel)
+                   .insert<dac_control::trigger_select>(value(p_trigger))
+                   .set<dac_control::trigger_enable>()
+                   .insert<dac_control::dma_enable>(
+                     static_cast<std::uint32_t>(p_dma))
+                   .get();
+  bit_modify(dac_reg->cr).insert(channel_control(p_channel), control);
+}
+
+void disable_trigger(std::uint8_t p_channel)
+{
+  auto control = channel_fields(p_channel)
+                   .clear<dac_control::trigger_enable>()
+                   .clear<dac_control::dma_enable>()
+                   .get();
+  bit_modify(dac_reg->cr).insert(channel_control(p_channel), control);
+}
+
+/// Claim and program a timer for the sample rate, without starting it
+status reserve_timer(dac_trigger p_trigger, hal::hertz p_rate)
+{
+  using cr2 = basic_timer_control2;
+
+  auto timer = timer_peripheral(p_trigger);
+  auto timing =
+    calculate_basic_timer_timing(to_hz(p_rate), frequency_hz(timer));
+  if (!timing) {
+    return hal::new_error(std::errc::argument_out_of_domain);
+  }
+
+  if (!claim_timer(timer)) {
+    return hal::new_error(std::errc::device_or_resource_busy);
+  }
+
+  load_timer_timing(timer, *timing);
+  timer_registers(timer).cr2 =
+    bit_value<std::uint32_t>(0)
+      .insert<cr2::master_mode>(value(basic_timer_master_mode::update))
+      .get();
+
+  return hal::success();
+}
+
+void start_circular_dma(dma_channel_select p_select,
+                        volatile std::uint32_t& p_target,
+                        const void* p_data,
+                        std::size_t p_count,
+                        dma_transfer_size p_memory_size)
+{
+  using ccr = dma_channel_configuration;
+
+  auto& channel = dma_channel(p_select);
+  clear_dma_flags(p_select);
+  channel.cpar =
+    static_cast<std::uint32_t>(reinterpret_cast<std::uintptr_t>(&p_target));
+  channel.cmar =
+    static_cast<std::uint32_t>(reinterpret_cast<std::uintptr_t>(p_data));
+  channel.cndtr = static_cast<std::uint32_t>(p_count);
+
+  // The DAC registers only accept word accesses. A 16-bit memory size with a
+  // 32-bit peripheral size zero extends each sample.
+  channel.ccr = bit_value<std::uint32_t>(0)
+                  .insert<ccr::priority>(0b10U)
+                  .insert<ccr::memory_size>(value(p_memory_size))
+                  .insert<ccr::peripheral_size>(
+                    value(dma_transfer_size::bits32))
+                  .set<ccr::memory_increment>()
+                  .set<ccr::circular>()
+                  .set<ccr::direction>()
+                  .set<ccr::enable>()
+                  .get();
+}
+
+/// Reserve the timer and DMA channel of a stream
+status reserve_stream(std::size_t p_length,
+                      dac_stream_settings p_settings,
+                      dma_channel_select p_dma)
+{
+  if (p_length == 0 || p_length > max_stream_length) {
+    return hal::new_error(std::errc::invalid_argument);
+  }
+
+  HAL_CHECK(reserve_timer(p_settings.trigger, p_settings.sample_rate));
+
+  if (!claim_dma_channel(p_dma)) {
+    release_timer(timer_peripheral(p_settings.trigger));
+    return hal::new_error(std::errc::device_or_resource_busy);
+  }
+
+  return hal::success();
+}
+}  // namespace
+
+result<dac> dac::get(std::uint8_t p_channel, dac_settings p_settings)
+{
+  if (p_channel != 1 && p_channel != 2) {
+    return hal::new_error(std::errc::invalid_argument);
+  }
+
+  acquire_power(dac_power);
+  enable_channel(p_channel, p_settings);
+
+  return dac(p_channel);
+}
+
+dac::dac(std::uint8_t p_channel)
+  : m_channel(p_channel)
+{
+}
+
+dac::dac(dac&& p_other) noexcept
+  : m_channel(p_other.m_channel)
+  , m_trigger(std::exchange(p_other.m_trigger, std::nullopt))
+  , m_owner(std::exchange(p_other.m_owner, false))
+{
+}
+
+dac& dac::operator=(dac&& p_other) noexcept
+{
+  if (this != &p_other) {
+    release();
+    m_channel = p_other.m_channel;
+    m_trigger = std::exchange(p_other.m_trigger, std::nullopt);
+    m_owner = std::exchange(p_other.m_owner, false);
+  }
+  return *this;
+}
+
+dac::~dac()
+{
+  release();
+}
+
+void dac::release()
+{
+  // A moved from driver holds no reference
+  if (!m_owner) {
+    return;
+  }
+
+  stop_stream();
+  release_power(dac_power);
+  m_owner = false;
+}
+
+void dac::write_raw(std::uint16_t p_value)
+{
+  if (m_channel == 1) {
+    dac_reg->dhr12r1 = p_value & 0xFFFU;
+  } else {
+    dac_reg->dhr12r2 = p_value & 0xFFFU;
+  }
+}
+
+status dac::stream(std::span<const std::uint16_t> p_samples,
+                   dac_stream_settings p_settings)
+{
+  stop_stream();
+
+  auto select = m_channel == 1 ? channel1_dma : channel2_dma;
+  HAL_CHECK(reserve_stream(p_samples.size(), p_settings, select));
+  m_trigger = p_settings.trigger;
+
+  auto& target = m_channel == 1 ? dac_reg->dhr12r1 : dac_reg->dhr12r2;
+  start_circular_dma(select,
+                     target,
+                     p_samples.data(),
+                     p_samples.size(),
+                     dma_transfer_size::bits16);
+  enable_trigger(m_channel, p_settings.trigger, true);
+  start_timer(timer_peripheral(p_settings.trigger));
+
+  return hal::success();
+}
+
+void dac::stop_stream()
+{
+  if (!m_trigger) {
+    return;
+  }
+
+  release_timer(timer_peripheral(*m_trigger));
+  release_dma_channel(m_channel == 1 ? channel1_dma : channel2_dma);
+  disable_trigger(m_channel);
+  m_trigger.reset();
+}
+
+result<dac::write_t> dac::driver_write(float p_percentage)
+{
+  constexpr float full_scale = 4095.0f;
+  auto clamped = std::clamp(p_percentage, 0.0f, 1.0f);
+  write_raw(static_cast<std::uint16_t>(std::lround(clamped * full_scale)));
+  return write_t{};
+}
+
+result<dual_dac> dual_dac::get(dac_settings p_settings)
+{
+  acquire_power(dac_power);
+  enable_channel(1, p_settings);
+  enable_channel(2, p_settings);
+
+  return dual_dac();
+}
+
+dual_dac::dual_dac(dual_dac&& p_other) noexcept
+  : m_trigger(std::exchange(p_other.m_trigger, std::nullopt))
+  , m_owner(std::exchange(p_other.m_owner, false))
+{
+}
+
+dual_dac& dual_dac::operator=(dual_dac&& p_other) noexcept
+{
+  if (this != &p_other) {
+    release();
+    m_trigger = std::exchange(p_other.m_trigger, std::nullopt);
+    m_owner = std::exchange(p_other.m_owner, false);
+  }
+  return *this;
+}
+
+dual_dac::~dual_dac()
+{
+  release();
+}
+
+void dual_dac::release()
+{
+  if (!m_owner) {
+    return;
+  }
+
+  stop_stream();
+  release_power(dac_power);
+  m_owner = false;
+}
+
+void dual_dac::write(std::uint16_t p_channel1, std::uint16_t p_channel2)
+{
+  dac_reg->dhr12rd = pack_dac_samples(p_channel1, p_channel2);
+}
+
+status dual_dac::stream(std::span<const std::uint32_t> p_samples,
+                        dac_stream_settings p_settings)
+{
+  stop_stream();
+
+  HAL_CHECK(reserve_stream(p_samples.size(), p_settings, channel1_dma));
+  m_trigger = p_settings.trigger;
+
+  start_circular_dma(channel1_dma,
+                     dac_reg->dhr12rd,
+                     p_samples.data(),
+                     p_samples.size(),
+                     dma_transfer_size::bits32);
+  // Both channels convert on the same trigger, only channel 1 requests DMA
+  enable_trigger(1, p_settings.trigger, true);
+  enable_trigger(2, p_settings.trigger, false);
+  start_timer(timer_peripheral(p_settings.trigger));
+
+  return hal::success();
+}
+
+void dual_dac::stop_stream()
+{
+  if (!m_trigger) {
+    return;
+  }
+
+  release_timer(timer_peripheral(*m_trigger));
+  release_dma_channel(channel1_dma);
+  disable_trigger(1);
+  disable_trigger(2);
+  m_trigger.reset();
+}
+}  // namespace hal::stm32f1
@@ -0,0 +1,65 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+#pragma once
+
+#include <cstdint>
+
+#include <libhal-util/bit.hpp>
+
+namespace hal::stm32f1 {
+/// DAC register map
+struct dac_t
+{
+  volatile std::uint32_t cr;
+  volatile std::uint32_t swtrigr;
+  volatile std::uint32_t dhr12r1;
+  volatile std::uint32_t dhr12l1;
+  volatile std::uint32_t dhr8r1;
+  volatile std::uint32_t dhr12r2;
+  volatile std::uint32_t dhr12l2;
+  volatile std::uint32_t dhr8r2;
+  /// Both channels, 12-bit right aligned, channel 2 in the upper half word
+  volatile std::uint32_t dhr12rd;
+  volatile std::uint32_t dhr12ld;
+  volatile std::uint32_t dhr8rd;
+  volatile std::uint32_t dor1;
+  volatile std::uint32_t dor2;
+};
+
+/// Bit masks for channel 1 in the CR register. Channel 2 uses the same
+/// layout shifted up by dac_channel2_offset bits.
+struct dac_control
+{
+  /// DMA request on each trigger
+  static constexpr auto dma_enable = bit_mask::from<12>();
+  /// Noise mask or triangle amplitude selector
+  static constexpr auto mask_amplitude = bit_mask::from<8, 11>();
+  /// Wave generation, 0b00 = disabled
+  static constexpr auto wave = bit_mask::from<6, 7>();
+  /// Trigger source selection, see dac_trigger
+  static constexpr auto trigger_select = bit_mask::from<3, 5>();
+  /// Trigger enable, DHR is moved to DOR on the trigger rather than after
+  /// one APB1 cycle
+  static constexpr auto trigger_enable = bit_mask::from<2>();
+  /// Disable the output buffer
+  static constexpr auto buffer_off = bit_mask::from<1>();
+  /// Channel enable
+  static constexpr auto enable = bit_mask::from<0>();
+};
+
+/// Distance between the channel 1 and channel 2 fields of CR
+static constexpr std::uint32_t dac_channel2_offset = 16;
+
+inline dac_t* dac_reg = reinterpret_cast<dac_t*>(0x4000'7400);
+}  // namespace hal::stm32f1
@@ -0,0 +1,161 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <libhal-stm32f1/deferred_work.hpp>
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+
+#include <libhal-stm32f1/interrupt.hpp>
+#include <libhal-util/bit.hpp>
+
+#include "cortex_m_reg.hpp"
+
+namespace hal::stm32f1 {
+namespace {
+/// A queue slot. The sequence tells producers and the consumer whose turn
+/// it is: the slot of position p is free for the producer of p while the
+/// sequence equals lap(p) and holds an item for the consumer once it is
+/// lap(p) + 1. Starting at 0 makes every slot free for the first lap.
+struct slot
+{
+  std::atomic<std::uint32_t> sequence;
+  deferred_function function;
+  std::uintptr_t argument;
+};
+
+constexpr std::uint32_t index_mask = deferred_work_capacity - 1;
+
+std::array<slot, deferred_work_capacity> slots{};
+
+/// Position of the next item posted, shared by every producer
+std::atomic<std::uint32_t> post_position{ 0 };
+/// Position of the next item run, only advanced by the PendSV handler
+std::atomic<std::uint32_t> run_position{ 0 };
+
+std::atomic<std::uint32_t> posted{ 0 };
+std::atomic<std::uint32_t> overflows{ 0 };
+std::atomic<std::uint32_t> max_depth{ 0 };
+
+/// Position of the first slot of the lap a position belongs to
+std::uint32_t lap(std::uint32_t p_position)
+{
+  return p_position & ~index_mask;
+}
+
+void record_depth(std::uint32_t p_depth)
+{
+  auto deepest = max_depth.load(std::memory_order_relaxed);
+  while (p_depth > deepest &&
+         !max_depth.compare_exchange_weak(
+           deepest, p_depth, std::memory_order_relaxed)) {
+    continue;
+  }
+}
+
+void pend_deferred_work()
+{
+  // The other ICSR bits ignore writes of 0, no read-modify-write is needed
+  scb->icsr = bit_value<std::uint32_t>(0)
+                .set<interrupt_control_state::pend_sv_set>()
+                .get();
+}
+}  // namespace
+
+HAL_STM32F1_RAMFUNC void deferred_work_interrupt()
+{
+  auto position = run_position.load(std::memory_order_relaxed);
+  while (true) {
+    auto& next = slots[position & index_mask];
+    if (next.sequence.load(std::memory_order_acquire) != lap(position) + 1) {
+      // Empty, or a producer preempted by this handler is still writing the
+      // item. Its post pends PendSV again once the item is complete.
+      break;
+    }
+
+    auto function = next.function;
+    auto argument = next.argument;
+    next.sequence.store(lap(position) + deferred_work_capacity,
+                        std::memory_order_release);
+    position++;
+    run_position.store(position, std::memory_order_relaxed);
+
+    function(argument);
+  }
+}
+
+status start_deferred_work()
+{
+  HAL_CHECK(install_handler(exception::pend_sv, deferred_work_interrupt));
+  // Values beyond the grouping's range truncate to the lowest priority
+  set_priority(exception::pend_sv, 0xFF, 0xFF);
+  return hal::success();
+}
+
+bool post_deferred_work(deferred_function p_function,
+                        std::uintptr_t p_argument)
+{
+  auto position = post_position.load(std::memory_order_relaxed);
+  slot* target = nullptr;
+  while (true) {
+    target = &slots[position & index_mask];
+    auto sequence = target->sequence.load(std::memory_order_acquire);
+    auto lag = static_cast<std::int32_t>(sequence - lap(position));
+    if (lag == 0) {
+      if (post_position.compare_exchange_weak(
+            position, position + 1, std::memory_order_relaxed)) {
+        break;
+      }
+    } else if (lag < 0) {
+      // The slot still holds the item posted one lap earlier
+      overflows.fetch_add(1, std::memory_order_relaxed);
+      return false;
+    } else {
+      position = post_position.load(std::memory_order_relaxed);
+    }
+  }
+
+  target->function = p_function;
+  target->argument = p_argument;
+  target->sequence.store(lap(position) + 1, std::memory_order_release);
+
+  posted.fetch_add(1, std::memory_order_relaxed);
+  record_depth(position + 1 - run_position.load(std::memory_order_relaxed));
+  pend_deferred_work();
+  return true;
+}
+
+std::size_t pending_deferred_work()
+{
+  return post_position.load(std::memory_order_relaxed) -
+         run_position.load(std::memory_order_relaxed);
+}
+
+deferred_work_statistics read_deferred_work_statistics()
+{
+  return deferred_work_statistics{
+    .posted = posted.load(std::memory_order_relaxed),
+    .overflows = overflows.load(std::memory_order_relaxed),
+    .max_depth = max_depth.load(std::memory_order_relaxed),
+  };
+}
+
+void reset_deferred_work_statistics()
+{
+  posted.store(0, std::memory_order_relaxed);
+  overflows.store(0, std::memory_order_relaxed);
+  max_depth.store(0, std::memory_order_relaxed);
+}
+}  // namespace hal::stm32f1
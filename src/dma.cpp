@@ -0,0 +1,112 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "dma.hpp"
+
+#include <cstdint>
+#include <optional>
+
+#include <libhal-stm32f1/power_domain.hpp>
+#include <libhal-util/bit.hpp>
+#include <libhal-util/enum.hpp>
+
+#include "dma_reg.hpp"
+
+namespace hal::stm32f1 {
+namespace {
+/// One bit per channel, dma1 channels in bits 0 to 6, dma2 in bits 7 to 11
+std::uint32_t claimed_channels = 0;
+
+std::uint32_t claim_bit(dma_channel_select p_select)
+{
+  auto index = p_select.channel - 1U;
+  if (p_select.controller == peripheral::dma2) {
+    index += 7;
+  }
+  return 1U << index;
+}
+}  // namespace
+
+dma_t& dma_controller(dma_channel_select p_select)
+{
+  if (p_select.controller == peripheral::dma2) {
+    return *dma2;
+  }
+  return *dma1;
+}
+
+dma_channel_t& dma_channel(dma_channel_select p_select)
+{
+  return dma_controller(p_select).channel[p_select.channel - 1U];
+}
+
+irq dma_irq(dma_channel_select p_select)
+{
+  if (p_select.controller == peripheral::dma2) {
+    // Channels 4 and 5 of dma2 share a vector on all but connectivity line
+    // devices, where dma2_channel5 has its own.
+    if (p_select.channel >= 4) {
+      return irq::dma2_channel4_5;
+    }
+    return static_cast<irq>(value(irq::dma2_channel1) + p_select.channel - 1);
+  }
+  return static_cast<irq>(value(irq::dma1_channel1) + p_select.channel - 1);
+}
+
+std::uint32_t dma_flags_of(dma_channel_select p_select)
+{
+  return (dma_controller(p_select).isr >> dma_flag_offset(p_select.channel)) &
+         dma_flags::all;
+}
+
+void clear_dma_flags(dma_channel_select p_select, std::uint32_t p_flags)
+{
+  // IFCR is write 1 to clear, other bits are unaffected
+  dma_controller(p_select).ifcr = p_flags << dma_flag_offset(p_select.channel);
+}
+
+bool claim_dma_channel(dma_channel_select p_select)
+{
+  auto bit = claim_bit(p_select);
+  if (claimed_channels & bit) {
+    return false;
+  }
+  claimed_channels |= bit;
+  acquire_power(p_select.controller);
+  return true;
+}
+
+std::optional<dma_channel_select> claim_any_dma_channel()
+{
+  // Search from the highest channel down as the lower channels are tied to
+  // the commonly used ADC1, SPI1 and USART3 requests.
+  for (std::uint8_t channel = 7; channel >= 1; channel--) {
+    dma_channel_select select{ .controller = peripheral::dma1,
+                               .channel = channel };
+    if (claim_dma_channel(select)) {
+      return select;
+    }
+  }
+  return std::nullopt;
+}
+
+void release_dma_channel(dma_channel_select p_select)
+{
+  bit_modify(dma_channel(p_select).ccr)
+    .clear<dma_channel_configuration::enable>();
+  clear_dma_flags(p_select);
+  claimed_channels &= ~claim_bit(p_select);
+  release_power(p_select.controller);
+}
+}  // namespace hal::stm32f1
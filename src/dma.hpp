@@ -0,0 +1,106 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <cstdint>
+#include <optional>
+
+#include <libhal-stm32f1/constants.hpp>
+
+#include "dma_reg.hpp"
+
+namespace hal::stm32f1 {
+/**
+ * @brief Selects a single DMA channel
+ *
+ */
+struct dma_channel_select
+{
+  /// Either peripheral::dma1 or peripheral::dma2
+  peripheral controller;
+  /// Channel number, 1 to 7 for dma1 and 1 to 5 for dma2
+  std::uint8_t channel;
+};
+
+/**
+ * @brief Returns the registers of a DMA controller
+ *
+ * @param p_select - channel whose controller to return
+ * @return dma_t& - controller registers
+ */
+dma_t& dma_controller(dma_channel_select p_select);
+
+/**
+ * @brief Returns the registers of a DMA channel
+ *
+ * @param p_select - channel to return
+ * @return dma_channel_t& - channel registers
+ */
+dma_channel_t& dma_channel(dma_channel_select p_select);
+
+/**
+ * @brief Returns the interrupt request number for a DMA channel
+ *
+ * @param p_select - channel
+ * @return irq - interrupt request number
+ */
+irq dma_irq(dma_channel_select p_select);
+
+/**
+ * @brief Read the status flags of a channel
+ *
+ * @param p_select - channel
+ * @return std::uint32_t - flags, see dma_flags
+ */
+std::uint32_t dma_flags_of(dma_channel_select p_select);
+
+/**
+ * @brief Clear status flags of a channel
+ *
+ * @param p_select - channel
+ * @param p_flags - flags to clear, see dma_flags
+ */
+void clear_dma_flags(dma_channel_select p_select,
+                     std::uint32_t p_flags = dma_flags::all);
+
+/**
+ * @brief Claim exclusive use of a DMA channel
+ *
+ * Acquires power for the channel's controller until the channel is released.
+ *
+ * @param p_select - channel to claim
+ * @return true - the channel is now owned by the caller
+ * @return false - the channel is already in use
+ */
+[[nodiscard]] bool claim_dma_channel(dma_channel_select p_select);
+
+/**
+ * @brief Claim any free DMA1 channel
+ *
+ * Intended for memory to memory transfers which are not tied to a
+ * peripheral's request line.
+ *
+ * @return std::optional<dma_channel_select> - the claimed channel or nothing
+ * if every channel is in use.
+ */
+[[nodiscard]] std::optional<dma_channel_select> claim_any_dma_channel();
+
+/**
+ * @brief Stop a channel and return it to the pool of free channels
+ *
+ * @param p_select - channel to release
+ */
+void release_dma_channel(dma_channel_select p_select);
+}  // namespace hal::stm32f1
@@ -0,0 +1,107 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <array>
+#include <cstdint>
+
+#include <libhal-util/bit.hpp>
+
+namespace hal::stm32f1 {
+/// Register map for a single DMA channel
+struct dma_channel_t
+{
+  volatile std::uint32_t ccr;
+  volatile std::uint32_t cndtr;
+  volatile std::uint32_t cpar;
+  volatile std::uint32_t cmar;
+  std::uint32_t reserved;
+};
+
+/// Register map for a DMA controller
+struct dma_t
+{
+  volatile std::uint32_t isr;
+  volatile std::uint32_t ifcr;
+  std::array<dma_channel_t, 7> channel;
+};
+
+/// Bit masks for the CCR register
+struct dma_channel_configuration
+{
+  /// Memory to memory mode, the transfer runs without a peripheral request
+  static constexpr auto memory_to_memory = bit_mask::from<14>();
+  /// Channel priority level
+  static constexpr auto priority = bit_mask::from<12, 13>();
+  /// Memory data size, 0b00 = 8-bits, 0b01 = 16-bits, 0b10 = 32-bits
+  static constexpr auto memory_size = bit_mask::from<10, 11>();
+  /// Peripheral data size, 0b00 = 8-bits, 0b01 = 16-bits, 0b10 = 32-bits
+  static constexpr auto peripheral_size = bit_mask::from<8, 9>();
+  /// Increment the memory address after each transfer
+  static constexpr auto memory_increment = bit_mask::from<7>();
+  /// Increment the peripheral address after each transfer
+  static constexpr auto peripheral_increment = bit_mask::from<6>();
+  /// Restart the transfer from the beginning once it completes
+  static constexpr auto circular = bit_mask::from<5>();
+  /// 0 = read from peripheral, 1 = read from memory
+  static constexpr auto direction = bit_mask::from<4>();
+  /// Transfer error interrupt enable
+  static constexpr auto transfer_error_interrupt = bit_mask::from<3>();
+  /// Half transfer interrupt enable
+  static constexpr auto half_transfer_interrupt = bit_mask::from<2>();
+  /// Transfer complete interrupt enable
+  static constexpr auto transfer_complete_interrupt = bit_mask::from<1>();
+  /// Channel enable
+  static constexpr auto enable = bit_mask::from<0>();
+};
+
+/// Values for the memory_size and peripheral_size fields of CCR
+enum class dma_transfer_size : std::uint8_t
+{
+  bits8 = 0b00,
+  bits16 = 0b01,
+  bits32 = 0b10,
+};
+
+/// Bit masks for a channel's flags within the ISR and IFCR registers. Shift
+/// by dma_flag_offset() to select the channel.
+struct dma_flags
+{
+  /// Transfer error
+  static constexpr std::uint32_t transfer_error = 1 << 3;
+  /// Half of the transfer has completed
+  static constexpr std::uint32_t half_transfer = 1 << 2;
+  /// Transfer complete
+  static constexpr std::uint32_t transfer_complete = 1 << 1;
+  /// Any of the above
+  static constexpr std::uint32_t global = 1 << 0;
+  /// Every flag of a channel
+  static constexpr std::uint32_t all = 0b1111;
+};
+
+/**
+ * @brief Bit offset of a channel's flags in the ISR and IFCR registers
+ *
+ * @param p_channel - channel number starting from 1
+ * @return constexpr std::uint32_t - bit offset
+ */
+constexpr std::uint32_t dma_flag_offset(std::uint8_t p_channel)
+{
+  return (p_channel - 1U) * 4U;
+}
+
+inline dma_t* dma1 = reinterpret_cast<dma_t*>(0x4002'0000);
+inline dma_t* dma2 = reinterpret_cast<dma_t*>(0x4002'0400);
+}  // namespace hal::stm32f1
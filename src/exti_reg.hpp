@@ -0,0 +1,39 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <cstdint>
+
+namespace hal::stm32f1 {
+/// External interrupt/event controller register map, one bit per line
+struct external_interrupt_t
+{
+  /// Interrupt mask, 1 = line generates an interrupt request
+  volatile std::uint32_t imr;
+  /// Event mask, 1 = line generates an event
+  volatile std::uint32_t emr;
+  /// Rising edge trigger selection
+  volatile std::uint32_t rtsr;
+  /// Falling edge trigger selection
+  volatile std::uint32_t ftsr;
+  /// Software interrupt event
+  volatile std::uint32_t swier;
+  /// Pending interrupts, write 1 to clear
+  volatile std::uint32_t pr;
+};
+
+inline external_interrupt_t* exti =
+  reinterpret_cast<external_interrupt_t*>(0x4001'0400);
+}  // namespace hal::stm32f1
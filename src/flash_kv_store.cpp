@@ -0,0 +1,359 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <libhal-stm32f1/flash_kv_store.hpp>
+
+#include <algorithm>
+#include <cstdint>
+#include <span>
+
+namespace hal::stm32f1 {
+namespace {
+/// Marks a page as holding a committed copy of the store ("KV")
+constexpr std::uint16_t page_magic = 0x4B56;
+/// Byte offset of the magic half-word within a page
+constexpr std::uint32_t magic_offset = 0;
+/// Byte offset of the generation half-word within a page
+constexpr std::uint32_t generation_offset = 2;
+/// Byte offset of the first record within a page
+constexpr std::uint32_t first_record_offset = 4;
+/// Set within the length field of a record to mark the key as removed
+constexpr std::uint16_t tombstone = 0x8000;
+/// Largest value length that can be represented within a record
+constexpr std::uint16_t max_length = tombstone - 1;
+constexpr auto erased = flash_page_storage::erased_half_word;
+
+constexpr std::uint16_t value_length(std::uint16_t p_length_field)
+{
+  return p_length_field & max_length;
+}
+
+/// Number of bytes occupied by a record holding p_length bytes of data
+constexpr std::uint32_t record_size(std::uint16_t p_length)
+{
+  // length half-word + data rounded up to half-words + key half-word
+  return sizeof(std::uint16_t) + ((p_length + 1U) & ~1U) +
+         sizeof(std::uint16_t);
+}
+
+constexpr std::uint32_t location(std::uint32_t p_page, std::uint32_t p_offset)
+{
+  return (p_page << 16) | p_offset;
+}
+
+constexpr std::uint32_t location_page(std::uint32_t p_location)
+{
+  return p_location >> 16;
+}
+
+constexpr std::uint32_t location_offset(std::uint32_t p_location)
+{
+  return p_location & 0xFFFF;
+}
+
+/// Returns true if generation p_a was written after generation p_b using
+/// serial number arithmetic so that the counter may wrap around.
+constexpr bool newer(std::uint16_t p_a, std::uint16_t p_b)
+{
+  return static_cast<std::int16_t>(p_a - p_b) > 0;
+}
+}  // namespace
+
+result<flash_kv_store> flash_kv_store::create(flash_page_storage& p_storage,
+                                              std::span<std::uint32_t> p_index)
+{
+  // Locations encode the byte offset within 16-bits and keys must leave room
+  // for the erased key value.
+  if (p_storage.page_count() < 2 || p_storage.page_size() > 0x10000 ||
+      p_storage.page_size() < first_record_offset + record_size(0) ||
+      p_index.size() >= erased) {
+    return hal::new_error(std::errc::invalid_argument);
+  }
+
+  flash_kv_store store(p_storage, p_index);
+  HAL_CHECK(store.mount());
+  return store;
+}
+
+flash_kv_store::flash_kv_store(flash_page_storage& p_storage,
+                               std::span<std::uint32_t> p_index)
+  : m_storage(&p_storage)
+  , m_index(p_index)
+  , m_page_size(p_storage.page_size())
+{
+}
+
+result<std::span<hal::byte>> flash_kv_store::read(
+  key_t p_key,
+  std::span<hal::byte> p_buffer)
+{
+  if (!contains(p_key)) {
+    return hal::new_error(std::errc::no_such_file_or_directory);
+  }
+
+  auto page = location_page(m_index[p_key]);
+  auto offset = location_offset(m_index[p_key]);
+  auto length = value_length(m_storage->read(page, offset));
+
+  if (p_buffer.size() < length) {
+    return hal::new_error(std::errc::message_size);
+  }
+
+  offset += sizeof(std::uint16_t);
+  for (std::uint32_t i = 0; i < length; i += 2, offset += 2) {
+    auto half_word = m_storage->read(page, offset);
+    p_buffer[i] = static_cast<hal::byte>(half_word & 0xFF);
+    if (i + 1 < length) {
+      p_buffer[i + 1] = static_cast<hal::byte>(half_word >> 8);
+    }
+  }
+
+  return p_buffer.first(length);
+}
+
+status flash_kv_store::write(key_t p_key, std::span<const hal::byte> p_value)
+{
+  if (p_key >= m_index.size() || p_value.size() > max_length) {
+    return hal::new_error(std::errc::invalid_argument);
+  }
+
+  return append_record(static_cast<std::uint16_t>(p_value.size()),
+                       p_key,
+                       p_value);
+}
+
+status flash_kv_store::remove(key_t p_key)
+{
+  if (!contains(p_key)) {
+    return hal::success();
+  }
+
+  return append_record(tombstone, p_key, {});
+}
+
+bool flash_kv_store::contains(key_t p_key) const
+{
+  return p_key < m_index.size() && m_index[p_key] != no_record;
+}
+
+std::uint16_t flash_kv_store::size(key_t p_key)
+{
+  if (!contains(p_key)) {
+    return 0;
+  }
+
+  return value_length(m_storage->read(location_page(m_index[p_key]),
+                                      location_offset(m_index[p_key])));
+}
+
+std::uint32_t flash_kv_store::free_space()
+{
+  return m_page_size - m_write_offset;
+}
+
+status flash_kv_store::mount()
+{
+  std::ranges::fill(m_index, no_record);
+
+  // Find the committed page with the latest generation
+  bool found = false;
+  for (std::uint32_t page = 0; page < m_storage->page_count(); page++) {
+    if (m_storage->read(page, magic_offset) != page_magic) {
+      continue;
+    }
+    auto generation = m_storage->read(page, generation_offset);
+    if (!found || newer(generation, m_generation)) {
+      found = true;
+      m_active_page = page;
+      m_generation = generation;
+    }
+  }
+
+  if (!found) {
+    return format(0, 0);
+  }
+
+  // A previous compaction can be interrupted after committing the new page
+  // but before erasing the old one. Finish the job now.
+  for (std::uint32_t page = 0; page < m_storage->page_count(); page++) {
+    if (page != m_active_page &&
+        m_storage->read(page, magic_offset) == page_magic) {
+      HAL_CHECK(m_storage->erase(page));
+    }
+  }
+
+  // Rebuild the index from the log. Later records for a key supersede earlier
+  // ones.
+  std::uint32_t offset = first_record_offset;
+  while (offset + sizeof(std::uint16_t) <= m_page_size) {
+    auto length_field = m_storage->read(m_active_page, offset);
+    if (length_field == erased) {
+      break;
+    }
+
+    auto size = record_size(value_length(length_field));
+    if (offset + size > m_page_size) {
+      // Corrupt length, treat the rest of the page as used so that the next
+      // write compacts into a fresh page.
+      offset = m_page_size;
+      break;
+    }
+
+    auto key = m_storage->read(m_active_page, offset + size - 2);
+    // Records without a key were interrupted before they were committed and
+    // are skipped.
+    if (key < m_index.size()) {
+      if (length_field & tombstone) {
+        m_index[key] = no_record;
+      } else {
+        m_index[key] = location(m_active_page, offset);
+      }
+    }
+
+    offset += size;
+  }
+
+  m_write_offset = offset;
+
+  return hal::success();
+}
+
+status flash_kv_store::erase_if_not_blank(std::uint32_t p_page)
+{
+  // Skipping the erase of blank pages saves an erase cycle each time a
+  // compaction lands on a page that was erased by the previous one.
+  for (std::uint32_t offset = 0; offset < m_page_size; offset += 2) {
+    if (m_storage->read(p_page, offset) != erased) {
+      return m_storage->erase(p_page);
+    }
+  }
+  return hal::success();
+}
+
+status flash_kv_store::format(std::uint32_t p_page, std::uint16_t p_generation)
+{
+  HAL_CHECK(erase_if_not_blank(p_page));
+  HAL_CHECK(m_storage->program(p_page, generation_offset, p_generation));
+  HAL_CHECK(m_storage->program(p_page, magic_offset, page_magic));
+
+  m_active_page = p_page;
+  m_generation = p_generation;
+  m_write_offset = first_record_offset;
+
+  return hal::success();
+}
+
+result<std::uint32_t> flash_kv_store::copy_record(std::uint32_t p_location,
+                                                  std::uint32_t p_page,
+                                                  std::uint32_t p_offset)
+{
+  auto source_page = location_page(p_location);
+  auto source_offset = location_offset(p_location);
+  auto length_field = m_storage->read(source_page, source_offset);
+  auto size = record_size(value_length(length_field));
+
+  // Every half-word, including the key, is copied in order so that the key is
+  // still written last.
+  for (std::uint32_t i = 0; i < size; i += 2) {
+    HAL_CHECK(m_storage->program(
+      p_page, p_offset + i, m_storage->read(source_page, source_offset + i)));
+  }
+
+  return size;
+}
+
+status flash_kv_store::compact()
+{
+  auto source = m_active_page;
+  auto target = (m_active_page + 1) % m_storage->page_count();
+  auto generation = static_cast<std::uint16_t>(m_generation + 1);
+
+  HAL_CHECK(erase_if_not_blank(target));
+  HAL_CHECK(m_storage->program(target, generation_offset, generation));
+
+  std::uint32_t offset = first_record_offset;
+  for (auto record : m_index) {
+    if (record != no_record) {
+      offset += HAL_CHECK(copy_record(record, target, offset));
+    }
+  }
+
+  // Writing the magic commits the new page. Up until this point, a reset will
+  // mount the source page as if the compaction never started.
+  HAL_CHECK(m_storage->program(target, magic_offset, page_magic));
+
+  // Records were copied in index order, so walking the index again yields
+  // their new locations.
+  offset = first_record_offset;
+  for (auto& record : m_index) {
+    if (record != no_record) {
+      auto size = record_size(value_length(m_storage->read(
+        location_page(record), location_offset(record))));
+      record = location(target, offset);
+      offset += size;
+    }
+  }
+
+  m_active_page = target;
+  m_generation = generation;
+  m_write_offset = offset;
+
+  return m_storage->erase(source);
+}
+
+status flash_kv_store::append_record(std::uint16_t p_length_field,
+                                     key_t p_key,
+                                     std::span<const hal::byte> p_value)
+{
+  auto size = record_size(value_length(p_length_field));
+
+  if (first_record_offset + size > m_page_size) {
+    return hal::new_error(std::errc::no_space_on_device);
+  }
+
+  if (m_write_offset + size > m_page_size) {
+    HAL_CHECK(compact());
+    if (m_write_offset + size > m_page_size) {
+      return hal::new_error(std::errc::no_space_on_device);
+    }
+  }
+
+  auto offset = m_write_offset;
+  // Reserve the space up front so a failed append is never overwritten.
+  m_write_offset += size;
+
+  HAL_CHECK(m_storage->program(m_active_page, offset, p_length_field));
+
+  for (std::uint32_t i = 0; i < p_value.size(); i += 2) {
+    std::uint16_t half_word = p_value[i];
+    if (i + 1 < p_value.size()) {
+      half_word |= static_cast<std::uint16_t>(p_value[i + 1] << 8);
+    } else {
+      half_word |= 0xFF00;
+    }
+    HAL_CHECK(m_storage->program(
+      m_active_page, offset + sizeof(std::uint16_t) + i, half_word));
+  }
+
+  HAL_CHECK(m_storage->program(m_active_page, offset + size - 2, p_key));
+
+  if (p_length_field & tombstone) {
+    m_index[p_key] = no_record;
+  } else {
+    m_index[p_key] = location(m_active_page, offset);
+  }
+
+  return hal::success();
+}
+}  // namespace hal::stm32f1
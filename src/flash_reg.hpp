@@ -3,6 +3,8 @@
 #include <array>
 #include <cstdint>
 
+#include <libhal-util/bit.hpp>
+
 namespace hal::stm32f1 {
 struct flash_t
 {
@@ -23,6 +25,40 @@ struct flash_t
   volatile std::uint32_t ar2;
 };
 
+/// Bit masks for the flash SR register
+struct flash_status
+{
+  /// Set by hardware when a flash operation has completed. Cleared by
+  /// writing a 1.
+  static constexpr auto end_of_operation = bit_mask::from<5>();
+  /// Set when attempting to program a write protected address
+  static constexpr auto write_protection_error = bit_mask::from<4>();
+  /// Set when attempting to program an address that was not erased
+  static constexpr auto programming_error = bit_mask::from<2>();
+  /// Indicates that a flash operation is in progress
+  static constexpr auto busy = bit_mask::from<0>();
+};
+
+/// Bit masks for the flash CR register
+struct flash_control
+{
+  /// Locks the FPEC and CR. Cleared by writing the unlock key sequence into
+  /// the KEYR register.
+  static constexpr auto lock = bit_mask::from<7>();
+  /// Starts an erase operation
+  static constexpr auto start = bit_mask::from<6>();
+  /// Selects the page erase operation
+  static constexpr auto page_erase = bit_mask::from<1>();
+  /// Selects the half-word programming operation
+  static constexpr auto program = bit_mask::from<0>();
+};
+
+/// Unlock keys that must be written, in order, to the KEYR register
+static constexpr std::array<std::uint32_t, 2> flash_unlock_keys = {
+  0x4567'0123,
+  0xCDEF'89AB,
+};
+
 /// Pointer to the flash control register
-flash_t* flash = reinterpret_cast<flash_t*>(0x4002'2000);
+inline flash_t* flash = reinterpret_cast<flash_t*>(0x4002'2000);
 }  // namespace hal::stm32f1
@@ -0,0 +1,360 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <libhal-stm32f1/fsmc.hpp>
+
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <initializer_list>
+#include <span>
+#include <utility>
+
+#include <libhal-stm32f1/clock.hpp>
+#include <libhal-stm32f1/constants.hpp>
+#include <libhal-stm32f1/peripheral_set.hpp>
+#include <libhal-stm32f1/power_domain.hpp>
+#include <libhal-util/bit.hpp>
+#include <libhal-util/enum.hpp>
+
+#include "fsmc_reg.hpp"
+#include "pin.hpp"
+
+// Defined by linker_scripts/libhal-stm32f1/external_sram.ld. Declared weak so
+// that applications without external SRAM, and the host, still link.
+extern "C"
+{
+  extern hal::byte __external_sram_start[] __attribute__((weak));  // NOLINT
+  extern hal::byte __external_sram_end[] __attribute__((weak));    // NOLINT
+  extern hal::byte __external_heap_end[] __attribute__((weak));    // NOLINT
+}
+
+namespace hal::stm32f1 {
+namespace {
+constexpr std::uint8_t max_address_lines = 26;
+
+/// FSMC_A0 to FSMC_A25
+constexpr std::array<pin_select_t, max_address_lines> address_pins{ {
+  { .port = 'F', .pin = 0 },  { .port = 'F', .pin = 1 },
+  { .port = 'F', .pin = 2 },  { .port = 'F', .pin = 3 },
+  { .port = 'F', .pin = 4 },  { .port = 'F', .pin = 5 },
+  { .port = 'F', .pin = 12 }, { .port = 'F', .pin = 13 },
+  { .port = 'F', .pin = 14 }, { .port = 'F', .pin = 15 },
+  { .port = 'G', .pin = 0 },  { .port = 'G', .pin = 1 },
+  { .port = 'G', .pin = 2 },  { .port = 'G', .pin = 3 },
+  { .port = 'G', .pin = 4 },  { .port = 'G', .pin = 5 },
+  { .port = 'D', .pin = 11 }, { .port = 'D', .pin = 12 },
+  { .port = 'D', .pin = 13 }, { .port = 'E', .pin = 3 },
+  { .port = 'E', .pin = 4 },  { .port = 'E', .pin = 5 },
+  { .port = 'E', .pin = 6 },  { .port = 'E', .pin = 2 },
+  { .port = 'G', .pin = 13 }, { .port = 'G', .pin = 14 },
+} };
+
+/// FSMC_D0 to FSMC_D15
+constexpr std::array<pin_select_t, 16> data_pins{ {
+  { .port = 'D', .pin = 14 }, { .port = 'D', .pin = 15 },
+  { .port = 'D', .pin = 0 },  { .port = 'D', .pin = 1 },
+  { .port = 'E', .pin = 7 },  { .port = 'E', .pin = 8 },
+  { .port = 'E', .pin = 9 },  { .port = 'E', .pin = 10 },
+  { .port = 'E', .pin = 11 }, { .port = 'E', .pin = 12 },
+  { .port = 'E', .pin = 13 }, { .port = 'E', .pin = 14 },
+  { .port = 'E', .pin = 15 }, { .port = 'D', .pin = 8 },
+  { .port = 'D', .pin = 9 },  { .port = 'D', .pin = 10 },
+} };
+
+/// FSMC_NOE and FSMC_NWE
+constexpr std::array<pin_select_t, 2> strobe_pins{ {
+  { .port = 'D', .pin = 4 },
+  { .port = 'D', .pin = 5 },
+} };
+
+/// FSMC_NBL0 and FSMC_NBL1
+constexpr std::array<pin_select_t, 2> byte_lane_pins{ {
+  { .port = 'E', .pin = 0 },
+  { .port = 'E', .pin = 1 },
+} };
+
+/// FSMC_NE1 to FSMC_NE4
+constexpr std::array<pin_select_t, 4> chip_select_pins{ {
+  { .port = 'D', .pin = 7 },
+  { .port = 'G', .pin = 9 },
+  { .port = 'G', .pin = 10 },
+  { .port = 'G', .pin = 12 },
+} };
+
+std::size_t data_bits(fsmc_data_width p_width)
+{
+  return p_width == fsmc_data_width::bits16 ? 16 : 8;
+}
+
+using pin_group = std::span<const pin_select_t>;
+
+/// Power the FSMC and the ports of the pins, each once however many pins a
+/// port has, then hand the pins to the FSMC
+peripheral_set configure_bus_pins(std::initializer_list<pin_group> p_groups)
+{
+  peripheral_set power{ peripheral::fsmc };
+  for (auto group : p_groups) {
+    for (const auto& pin : group) {
+      power.add(
+        static_cast<peripheral>(value(peripheral::gpio_a) + (pin.port - 'A')));
+    }
+  }
+  acquire_power(power);
+
+  for (auto group : p_groups) {
+    configure_pins(group, push_pull_alternative_output);
+  }
+  return power;
+}
+
+/// Configure and enable a bank for asynchronous mode 1 accesses
+void enable_bank(fsmc_bank p_bank,
+                 fsmc_memory_type p_type,
+                 fsmc_data_width p_width,
+                 const fsmc_timing& p_timing)
+{
+  using bcr = fsmc_bank_control;
+  using btr = fsmc_bank_timing;
+
+  auto& bank = fsmc_reg->bank[value(p_bank)];
+
+  bank.btr = bit_value<std::uint32_t>(0)
+               .insert<btr::bus_turnaround>(p_timing.bus_turnaround)
+               .insert<btr::data_setup>(p_timing.data_setup)
+               .insert<btr::address_hold>(1U)
+               .insert<btr::address_setup>(p_timing.address_setup)
+               .get();
+
+  // Read-modify-write, as the reserved bits must keep their reset value
+  bank.bcr =
+    bit_value<std::uint32_t>(bank.bcr)
+      .clear<bcr::burst_write>()
+      .clear<bcr::extended_mode>()
+      .clear<bcr::wait_enable>()
+      .clear<bcr::burst_read>()
+      .clear<bcr::multiplexed>()
+      .insert<bcr::flash_access>(
+        static_cast<std::uint32_t>(p_type == fsmc_memory_type::nor))
+      .insert<bcr::data_width>(value(p_width))
+      .insert<bcr::memory_type>(value(p_type))
+      .set<bcr::write_enable>()
+      .set<bcr::enable>()
+      .get();
+}
+
+void disable_bank(fsmc_bank p_bank)
+{
+  bit_modify(fsmc_reg->bank[value(p_bank)].bcr)
+    .clear<fsmc_bank_control::enable>();
+}
+}  // namespace
+
+result<fsmc_sram> fsmc_sram::get(fsmc_bank p_bank, const fsmc_device& p_device)
+{
+  // With a 16-bit bus, HADDR[25:1] drives FSMC_A[24:0]
+  auto byte_address_lines = p_device.address_lines;
+  if (p_device.width == fsmc_data_width::bits16) {
+    byte_address_lines++;
+  }
+  if (p_device.address_lines > max_address_lines ||
+      byte_address_lines > max_address_lines) {
+    return hal::new_error(std::errc::invalid_argument);
+  }
+
+  auto timing =
+    calculate_fsmc_timing(p_device, frequency_hz(peripheral::fsmc));
+  if (!timing) {
+    return hal::new_error(std::errc::argument_out_of_domain);
+  }
+
+  // Byte lanes only exist on a 16-bit bus
+  pin_group byte_lanes;
+  if (p_device.width == fsmc_data_width::bits16) {
+    byte_lanes = byte_lane_pins;
+  }
+  auto power = configure_bus_pins({
+    std::span(address_pins).first(p_device.address_lines),
+    std::span(data_pins).first(data_bits(p_device.width)),
+    strobe_pins,
+    byte_lanes,
+    std::span(chip_select_pins).subspan(value(p_bank), 1),
+  });
+
+  enable_bank(p_bank, p_device.type, p_device.width, *timing);
+
+  auto* base = reinterpret_cast<hal::byte*>(fsmc_bank_address(p_bank));
+  return fsmc_sram(p_bank,
+                   power,
+                   std::span(base, std::size_t{ 1 } << byte_address_lines));
+}
+
+fsmc_sram::fsmc_sram(fsmc_bank p_bank,
+                     peripheral_set p_power,
+                     std::span<hal::byte> p_memory)
+  : m_bank(p_bank)
+  , m_power(p_power)
+  , m_memory(p_memory)
+{
+}
+
+fsmc_sram::fsmc_sram(fsmc_sram&& p_other) noexcept
+  : m_bank(p_other.m_bank)
+  , m_power(p_other.m_power)
+  , m_memory(p_other.m_memory)
+  , m_owner(std::exchange(p_other.m_owner, false))
+{
+}
+
+fsmc_sram& fsmc_sram::operator=(fsmc_sram&& p_other) noexcept
+{
+  if (this != &p_other) {
+    release();
+    m_bank = p_other.m_bank;
+    m_power = p_other.m_power;
+    m_memory = p_other.m_memory;
+    m_owner = std::exchange(p_other.m_owner, false);
+  }
+  return *this;
+}
+
+fsmc_sram::~fsmc_sram()
+{
+  release();
+}
+
+void fsmc_sram::release()
+{
+  // A moved from driver holds no reference
+  if (!m_owner) {
+    return;
+  }
+
+  disable_bank(m_bank);
+  release_power(m_power);
+  m_owner = false;
+}
+
+std::span<hal::byte> fsmc_sram::memory()
+{
+  return m_memory;
+}
+
+void initialize_external_sram_section()
+{
+  if (__external_sram_start == nullptr) {
+    return;
+  }
+  std::memset(__external_sram_start,
+              0,
+              static_cast<std::size_t>(__external_sram_end -
+                                       __external_sram_start));
+}
+
+std::span<hal::byte> external_sram_heap()
+{
+  if (__external_sram_end == nullptr) {
+    return {};
+  }
+  return { __external_sram_end, __external_heap_end };
+}
+
+result<fsmc_lcd> fsmc_lcd::get(fsmc_bank p_bank,
+                               const fsmc_lcd_settings& p_settings)
+{
+  // With a 16-bit bus, FSMC_An is driven by bit n + 1 of the byte address
+  auto shift = p_settings.register_select_line + 1U;
+  if (shift >= max_address_lines) {
+    return hal::new_error(std::errc::invalid_argument);
+  }
+
+  fsmc_device device{
+    .type = fsmc_memory_type::sram,
+    .width = fsmc_data_width::bits16,
+    .address_lines = 0,
+    .address_setup = p_settings.address_setup,
+    .data_setup = p_settings.data_setup,
+  };
+  auto timing = calculate_fsmc_timing(device, frequency_hz(peripheral::fsmc));
+  if (!timing) {
+    return hal::new_error(std::errc::argument_out_of_domain);
+  }
+
+  auto power = configure_bus_pins({
+    std::span(address_pins).subspan(p_settings.register_select_line, 1),
+    data_pins,
+    strobe_pins,
+    std::span(chip_select_pins).subspan(value(p_bank), 1),
+  });
+
+  enable_bank(p_bank, device.type, device.width, *timing);
+
+  auto base = fsmc_bank_address(p_bank);
+  auto data = base + (std::uintptr_t{ 1 } << shift);
+
+  return fsmc_lcd(p_bank,
+                  power,
+                  reinterpret_cast<volatile std::uint16_t*>(base),
+                  reinterpret_cast<volatile std::uint16_t*>(data));
+}
+
+fsmc_lcd::fsmc_lcd(fsmc_bank p_bank,
+                   peripheral_set p_power,
+                   volatile std::uint16_t* p_command,
+                   volatile std::uint16_t* p_data)
+  : m_bank(p_bank)
+  , m_power(p_power)
+  , m_command(p_command)
+  , m_data(p_data)
+{
+}
+
+fsmc_lcd::fsmc_lcd(fsmc_lcd&& p_other) noexcept
+  : m_bank(p_other.m_bank)
+  , m_power(p_other.m_power)
+  , m_command(p_other.m_command)
+  , m_data(p_other.m_data)
+  , m_owner(std::exchange(p_other.m_owner, false))
+{
+}
+
+fsmc_lcd& fsmc_lcd::operator=(fsmc_lcd&& p_other) noexcept
+{
+  if (this != &p_other) {
+    release();
+    m_bank = p_other.m_bank;
+    m_power = p_other.m_power;
+    m_command = p_other.m_command;
+    m_data = p_other.m_data;
+    m_owner = std::exchange(p_other.m_owner, false);
+  }
+  return *this;
+}
+
+fsmc_lcd::~fsmc_lcd()
+{
+  release();
+}
+
+void fsmc_lcd::release()
+{
+  if (!m_owner) {
+    return;
+  }
+
+  disable_bank(m_bank);
+  release_power(m_power);
+  m_owner = false;
+}
+}  // namespace hal::stm32f1
@@ -0,0 +1,94 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <array>
+#include <cstdint>
+
+#include <libhal-util/bit.hpp>
+
+namespace hal::stm32f1 {
+/// Control and timing registers of one NOR/SRAM sub-bank
+struct fsmc_bank_control_t
+{
+  /// Chip select control register
+  volatile std::uint32_t bcr;
+  /// Chip select timing register, used for reads and for writes unless
+  /// extended mode is enabled
+  volatile std::uint32_t btr;
+};
+
+/// Write timing register of one NOR/SRAM sub-bank
+struct fsmc_write_timing_t
+{
+  volatile std::uint32_t bwtr;
+  std::uint32_t reserved;
+};
+
+/// FSMC NOR/SRAM controller register map. The NAND and PC Card controllers
+/// are not used by this library.
+struct fsmc_t
+{
+  std::array<fsmc_bank_control_t, 4> bank;
+  std::array<std::uint32_t, 57> reserved0;
+  std::array<fsmc_write_timing_t, 4> write_timing;
+};
+
+/// Bit masks for the BCR registers
+struct fsmc_bank_control
+{
+  /// Write burst enable
+  static constexpr auto burst_write = bit_mask::from<19>();
+  /// Use BWTR for write timings
+  static constexpr auto extended_mode = bit_mask::from<14>();
+  /// Wait signal enable during synchronous bursts
+  static constexpr auto wait_enable = bit_mask::from<13>();
+  /// Allow writes to the bank
+  static constexpr auto write_enable = bit_mask::from<12>();
+  /// Burst read enable
+  static constexpr auto burst_read = bit_mask::from<8>();
+  /// NOR flash access enable
+  static constexpr auto flash_access = bit_mask::from<6>();
+  /// Memory data bus width, 0b00 = 8-bits, 0b01 = 16-bits
+  static constexpr auto data_width = bit_mask::from<4, 5>();
+  /// Memory type, 0b00 = SRAM, 0b01 = PSRAM, 0b10 = NOR flash
+  static constexpr auto memory_type = bit_mask::from<2, 3>();
+  /// Multiplex address and data lines
+  static constexpr auto multiplexed = bit_mask::from<1>();
+  /// Bank enable
+  static constexpr auto enable = bit_mask::from<0>();
+};
+
+/// Bit masks for the BTR and BWTR registers
+struct fsmc_bank_timing
+{
+  /// Access mode used in extended mode
+  static constexpr auto access_mode = bit_mask::from<28, 29>();
+  /// Data latency of synchronous bursts
+  static constexpr auto data_latency = bit_mask::from<24, 27>();
+  /// Clock divide ratio of synchronous bursts
+  static constexpr auto clock_divide = bit_mask::from<20, 23>();
+  /// Bus turnaround phase duration in HCLK cycles, BTR only
+  static constexpr auto bus_turnaround = bit_mask::from<16, 19>();
+  /// Data phase duration in HCLK cycles, 1 to 255
+  static constexpr auto data_setup = bit_mask::from<8, 15>();
+  /// Address hold phase duration in HCLK cycles, multiplexed mode only
+  static constexpr auto address_hold = bit_mask::from<4, 7>();
+  /// Address setup phase duration in HCLK cycles, 0 to 15
+  static constexpr auto address_setup = bit_mask::from<0, 3>();
+};
+
+inline fsmc_t* fsmc_reg = reinterpret_cast<fsmc_t*>(0xA000'0000);
+}  // namespace hal::stm32f1
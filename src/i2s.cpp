@@ -0,0 +1,377 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <libhal-stm32f1/i2s.hpp>
+
+#include <array>
+#include <cstdint>
+#include <utility>
+
+#include <libhal-stm32f1/clock.hpp>
+#include <libhal-stm32f1/constants.hpp>
+#include <libhal-stm32f1/interrupt.hpp>
+#include <libhal-stm32f1/pin.hpp>
+#include <libhal-stm32f1/power_domain.hpp>
+#include <libhal-util/bit.hpp>
+#include <libhal-util/enum.hpp>
+
+#include "dma.hpp"
+#include "pin.hpp"
+#include "spi_reg.hpp"
+
+namespace hal::stm32f1 {
+namespace {
+/// CNDTR is 16 bits wide and the buffer is split in two halves
+constexpr std::size_t max_buffer_length = 0xFFFE;
+
+/// Pins and DMA channels of one bus
+struct i2s_bus_info
+{
+  peripheral spi;
+  dma_channel_select transmit_dma;
+  dma_channel_select receive_dma;
+  pin_select_t word_select;
+  pin_select_t clock;
+  pin_select_t data;
+  pin_select_t master_clock;
+};
+
+constexpr std::array<i2s_bus_info, 2> buses{ {
+  {
+    .spi = peripheral::spi2,
+    .transmit_dma = { .controller = peripheral::dma1, .channel = 5 },
+    .receive_dma = { .controller = peripheral::dma1, .channel = 4 },
+    .word_select = { .port = 'B', .pin = 12 },
+    .clock = { .port = 'B', .pin = 13 },
+    .data = { .port = 'B', .pin = 15 },
+    .master_clock = { .port = 'C', .pin = 6 },
+  },
+  {
+    .spi = peripheral::spi3,
+    .transmit_dma = { .controller = peripheral::dma2, .channel = 2 },
+    .receive_dma = { .controller = peripheral::dma2, .channel = 1 },
+    .word_select = { .port = 'A', .pin = 15 },
+    .clock = { .port = 'B', .pin = 3 },
+    .data = { .port = 'B', .pin = 5 },
+    .master_clock = { .port = 'C', .pin = 7 },
+  },
+} };
+
+/// State of a running stream, read by the interrupt service routines
+struct stream_state
+{
+  std::span<std::uint16_t> buffer{};
+  i2s_buffer_handler handler = nullptr;
+  dma_channel_select dma{};
+};
+
+std::array<stream_state, 2> streams{};
+
+/// Buses owned by a live driver
+std::array<bool, 2> owned_buses{};
+
+spi_t& spi(i2s_bus p_bus)
+{
+  return p_bus == i2s_bus::spi3 ? *spi3_reg : *spi2_reg;
+}
+
+bool is_master(i2s_mode p_mode)
+{
+  return p_mode == i2s_mode::master_transmit ||
+         p_mode == i2s_mode::master_receive;
+}
+
+bool is_transmit(i2s_mode p_mode)
+{
+  return p_mode == i2s_mode::master_transmit ||
+         p_mode == i2s_mode::slave_transmit;
+}
+
+bool uses_master_clock(const i2s_settings& p_settings)
+{
+  return p_settings.master_clock_output && is_master(p_settings.mode);
+}
+
+peripheral port_of(pin_select_t p_pin)
+{
+  return static_cast<peripheral>(value(peripheral::gpio_a) +
+                                 (p_pin.port - 'A'));
+}
+
+/// SPI peripheral and pin ports, each port once however many pins it has
+peripheral_set bus_power(const i2s_bus_info& p_info,
+                         const i2s_settings& p_settings)
+{
+  peripheral_set power{ p_info.spi,
+                        port_of(p_info.word_select),
+                        port_of(p_info.clock),
+                        port_of(p_info.data) };
+  if (uses_master_clock(p_settings)) {
+    power.add(port_of(p_info.master_clock));
+  }
+  return power;
+}
+
+void configure_bus_pins(const i2s_bus_info& p_info,
+                        const i2s_settings& p_settings)
+{
+  // Masters drive the clocks, slaves receive them
+  auto clock_config =
+    is_master(p_settings.mode) ? push_pull_alternative_output : input_float;
+  auto data_config = is_transmit(p_settings.mode)
+                       ? push_pull_alternative_output
+                       : input_float;
+
+  configure_pin(p_info.word_select, clock_config);
+  configure_pin(p_info.clock, clock_config);
+  configure_pin(p_info.data, data_config);
+
+  if (uses_master_clock(p_settings)) {
+    configure_pin(p_info.master_clock, push_pull_alternative_output);
+  }
+}
+
+void handle_dma(stream_state& p_stream)
+{
+  auto flags = dma_flags_of(p_stream.dma);
+  clear_dma_flags(p_stream.dma, flags);
+
+  auto half = p_stream.buffer.size() / 2;
+  if (flags & dma_flags::half_transfer) {
+    p_stream.handler(p_stream.buffer.first(half));
+  }
+  if (flags & dma_flags::transfer_complete) {
+    p_stream.handler(p_stream.buffer.subspan(half));
+  }
+}
+}  // namespace
+
+HAL_STM32F1_RAMFUNC void i2s2_dma_interrupt()
+{
+  handle_dma(streams[value(i2s_bus::spi2)]);
+}
+
+HAL_STM32F1_RAMFUNC void i2s3_dma_interrupt()
+{
+  handle_dma(streams[value(i2s_bus::spi3)]);
+}
+
+result<i2s> i2s::get(i2s_bus p_bus, const i2s_settings& p_settings)
+{
+  using cfg = i2s_configuration;
+  using pr = i2s_prescaler;
+
+  const auto& info = buses[value(p_bus)];
+  if (owned_buses[value(p_bus)]) {
+    return hal::new_error(std::errc::device_or_resource_busy);
+  }
+
+  bool long_channels = p_settings.format != i2s_data_format::bits16;
+
+  std::optional<i2s_clock> clock;
+  if (is_master(p_settings.mode)) {
+    clock = calculate_i2s_clock(frequency_hz(peripheral::i2s),
+                                to_hz(p_settings.sample_rate),
+                                long_channels,
+                                p_settings.master_clock_output);
+    if (!clock) {
+      return hal::new_error(std::errc::argument_out_of_domain);
+    }
+  }
+
+  if (p_bus == i2s_bus::spi3) {
+    release_jtag_pins();
+  }
+  auto power = bus_power(info, p_settings);
+  acquire_power(power);
+  configure_bus_pins(info, p_settings);
+
+  std::uint32_t data_length = 0b00;
+  if (p_settings.format == i2s_data_format::bits24) {
+    data_length = 0b01;
+  } else if (p_settings.format == i2s_data_format::bits32) {
+    data_length = 0b10;
+  }
+
+  auto& reg = spi(p_bus);
+  reg.i2scfgr = 0;
+  if (clock) {
+    reg.i2spr =
+      bit_value<std::uint32_t>(0)
+        .insert<pr::master_clock_output>(
+          static_cast<std::uint32_t>(p_settings.master_clock_output))
+        .insert<pr::odd>(static_cast<std::uint32_t>(clock->odd))
+        .insert<pr::divider>(clock->divider)
+        .get();
+  }
+  reg.i2scfgr = bit_value<std::uint32_t>(0)
+                  .set<cfg::i2s_mode>()
+                  .insert<cfg::mode>(value(p_settings.mode))
+                  .insert<cfg::standard>(value(p_settings.standard))
+                  .insert<cfg::data_length>(data_length)
+                  .insert<cfg::channel_length>(
+                    static_cast<std::uint32_t>(long_channels))
+                  .get();
+
+  hal::hertz rate = 0.0f;
+  float error = 0.0f;
+  if (clock) {
+    rate = clock->sample_rate;
+    error = (rate - p_settings.sample_rate) / p_settings.sample_rate;
+  }
+
+  owned_buses[value(p_bus)] = true;
+  return i2s(p_bus, p_settings.mode, power, rate, error);
+}
+
+i2s::i2s(i2s_bus p_bus,
+         i2s_mode p_mode,
+         peripheral_set p_power,
+         hal::hertz p_sample_rate,
+         float p_sample_rate_error)
+  : m_bus(p_bus)
+  , m_mode(p_mode)
+  , m_power(p_power)
+  , m_sample_rate(p_sample_rate)
+  , m_sample_rate_error(p_sample_rate_error)
+{
+}
+
+i2s::i2s(i2s&& p_other) noexcept
+  : m_bus(p_other.m_bus)
+  , m_mode(p_other.m_mode)
+  , m_power(p_other.m_power)
+  , m_sample_rate(p_other.m_sample_rate)
+  , m_sample_rate_error(p_other.m_sample_rate_error)
+  , m_owner(std::exchange(p_other.m_owner, false))
+{
+}
+
+i2s& i2s::operator=(i2s&& p_other) noexcept
+{
+  if (this != &p_other) {
+    release();
+    m_bus = p_other.m_bus;
+    m_mode = p_other.m_mode;
+    m_power = p_other.m_power;
+    m_sample_rate = p_other.m_sample_rate;
+    m_sample_rate_error = p_other.m_sample_rate_error;
+    m_owner = std::exchange(p_other.m_owner, false);
+  }
+  return *this;
+}
+
+i2s::~i2s()
+{
+  release();
+}
+
+void i2s::release()
+{
+  if (!m_owner) {
+    return;
+  }
+
+  stop();
+  release_power(m_power);
+  owned_buses[value(m_bus)] = false;
+  m_owner = false;
+}
+
+status i2s::stream(std::span<std::uint16_t> p_buffer,
+                   i2s_buffer_handler p_handler)
+{
+  using ccr = dma_channel_configuration;
+
+  if (!m_owner) {
+    return hal::new_error(std::errc::device_or_resource_busy);
+  }
+
+  if (p_buffer.empty() || p_buffer.size() % 2 != 0 ||
+      p_buffer.size() > max_buffer_length || !p_handler) {
+    return hal::new_error(std::errc::invalid_argument);
+  }
+
+  stop();
+
+  const auto& info = buses[value(m_bus)];
+  bool transmit = is_transmit(m_mode);
+  auto select = transmit ? info.transmit_dma : info.receive_dma;
+  auto handler =
+    m_bus == i2s_bus::spi3 ? i2s3_dma_interrupt : i2s2_dma_interrupt;
+
+  HAL_CHECK(install_handler(dma_irq(select), handler));
+  if (!claim_dma_channel(select)) {
+    return hal::new_error(std::errc::device_or_resource_busy);
+  }
+
+  auto& state = streams[value(m_bus)];
+  state = stream_state{
+    .buffer = p_buffer,
+    .handler = p_handler,
+    .dma = select,
+  };
+
+  auto& reg = spi(m_bus);
+  auto& channel = dma_channel(select);
+  clear_dma_flags(select);
+  channel.cpar =
+    static_cast<std::uint32_t>(reinterpret_cast<std::uintptr_t>(&reg.dr));
+  channel.cmar = static_cast<std::uint32_t>(
+    reinterpret_cast<std::uintptr_t>(p_buffer.data()));
+  channel.cndtr = static_cast<std::uint32_t>(p_buffer.size());
+  channel.ccr = bit_value<std::uint32_t>(0)
+                  .insert<ccr::priority>(0b10U)
+                  .insert<ccr::memory_size>(value(dma_transfer_size::bits16))
+                  .insert<ccr::peripheral_size>(
+                    value(dma_transfer_size::bits16))
+                  .set<ccr::memory_increment>()
+                  .set<ccr::circular>()
+                  .insert<ccr::direction>(static_cast<std::uint32_t>(transmit))
+                  .set<ccr::half_transfer_interrupt>()
+                  .set<ccr::transfer_complete_interrupt>()
+                  .set<ccr::enable>()
+                  .get();
+  enable_interrupt(dma_irq(select));
+
+  if (transmit) {
+    bit_modify(reg.cr2).set<spi_control2::transmit_dma>();
+  } else {
+    bit_modify(reg.cr2).set<spi_control2::receive_dma>();
+  }
+  bit_modify(reg.i2scfgr).set<i2s_configuration::enable>();
+
+  return hal::success();
+}
+
+void i2s::stop()
+{
+  if (!m_owner) {
+    return;
+  }
+
+  auto& state = streams[value(m_bus)];
+  if (!state.handler) {
+    return;
+  }
+
+  auto& reg = spi(m_bus);
+  bit_modify(reg.i2scfgr).clear<i2s_configuration::enable>();
+  reg.cr2 = 0;
+
+  disable_interrupt(dma_irq(state.dma));
+  release_dma_channel(state.dma);
+  state = stream_state{};
+}
+}  // namespace hal::stm32f1
@@ -0,0 +1,177 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <libhal-stm32f1/internal_flash.hpp>
+
+#include <cstdint>
+
+#include <libhal-util/bit.hpp>
+
+#include "flash_reg.hpp"
+
+namespace hal::stm32f1 {
+namespace {
+/// Start of the main flash memory
+constexpr std::uint32_t flash_start = 0x0800'0000;
+/// XL density devices control the upper 512 KiB of flash with a second set
+/// of registers.
+constexpr std::uint32_t bank2_start = 0x0808'0000;
+
+/// References to the registers that control a bank of flash
+struct flash_bank
+{
+  volatile std::uint32_t& keyr;
+  volatile std::uint32_t& sr;
+  volatile std::uint32_t& cr;
+  volatile std::uint32_t& ar;
+};
+
+flash_bank bank(std::uint32_t p_address)
+{
+  if (p_address >= bank2_start) {
+    return { flash->keyr2, flash->sr2, flash->cr2, flash->ar2 };
+  }
+  return { flash->keyr, flash->sr, flash->cr, flash->ar };
+}
+
+void wait_while_busy(flash_bank& p_bank)
+{
+  while (bit_extract<flash_status::busy>(p_bank.sr)) {
+    continue;
+  }
+}
+
+void unlock(flash_bank& p_bank)
+{
+  if (bit_extract<flash_control::lock>(p_bank.cr)) {
+    p_bank.keyr = flash_unlock_keys[0];
+    p_bank.keyr = flash_unlock_keys[1];
+  }
+}
+
+status finish(flash_bank& p_bank)
+{
+  auto status_register = p_bank.sr;
+
+  // Status flags are cleared by writing a 1 to them
+  p_bank.sr = bit_value<std::uint32_t>(0)
+                .set<flash_status::end_of_operation>()
+                .set<flash_status::programming_error>()
+                .set<flash_status::write_protection_error>()
+                .get();
+
+  bit_modify(p_bank.cr)
+    .clear<flash_control::program>()
+    .clear<flash_control::page_erase>()
+    .set<flash_control::lock>();
+
+  if (bit_extract<flash_status::programming_error>(status_register) ||
+      bit_extract<flash_status::write_protection_error>(status_register)) {
+    return hal::new_error(std::errc::io_error);
+  }
+
+  return hal::success();
+}
+}  // namespace
+
+result<internal_flash> internal_flash::get(std::uint32_t p_address,
+                                           std::uint32_t p_page_size,
+                                           std::uint32_t p_page_count)
+{
+  if ((p_page_size != 1024 && p_page_size != 2048) ||
+      p_address < flash_start || (p_address - flash_start) % p_page_size != 0 ||
+      p_page_count == 0) {
+    return hal::new_error(std::errc::invalid_argument);
+  }
+
+  return internal_flash(p_address, p_page_size, p_page_count);
+}
+
+internal_flash::internal_flash(std::uint32_t p_address,
+                               std::uint32_t p_page_size,
+                               std::uint32_t p_page_count)
+  : m_address(p_address)
+  , m_page_size(p_page_size)
+  , m_page_count(p_page_count)
+{
+}
+
+std::uint32_t internal_flash::driver_page_size()
+{
+  return m_page_size;
+}
+
+std::uint32_t internal_flash::driver_page_count()
+{
+  return m_page_count;
+}
+
+std::uint16_t internal_flash::driver_read(std::uint32_t p_page,
+                                          std::uint32_t p_offset)
+{
+  auto address = m_address + (p_page * m_page_size) + p_offset;
+  return *reinterpret_cast<const volatile std::uint16_t*>(address);
+}
+
+status internal_flash::driver_program(std::uint32_t p_page,
+                                      std::uint32_t p_offset,
+                                      std::uint16_t p_value)
+{
+  if (p_page >= m_page_count || p_offset >= m_page_size) {
+    return hal::new_error(std::errc::invalid_argument);
+  }
+
+  auto address = m_address + (p_page * m_page_size) + p_offset;
+  auto* half_word = reinterpret_cast<volatile std::uint16_t*>(address);
+
+  // The flash controller refuses to program a half-word that is not erased,
+  // reject it here with the same outcome and without touching the hardware.
+  if (*half_word != erased_half_word) {
+    return hal::new_error(std::errc::io_error);
+  }
+
+  auto controller = bank(address);
+  unlock(controller);
+  wait_while_busy(controller);
+  bit_modify(controller.cr).set<flash_control::program>();
+  *half_word = p_value;
+  wait_while_busy(controller);
+  HAL_CHECK(finish(controller));
+
+  if (*half_word != p_value) {
+    return hal::new_error(std::errc::io_error);
+  }
+
+  return hal::success();
+}
+
+status internal_flash::driver_erase(std::uint32_t p_page)
+{
+  if (p_page >= m_page_count) {
+    return hal::new_error(std::errc::invalid_argument);
+  }
+
+  auto address = m_address + (p_page * m_page_size);
+
+  auto controller = bank(address);
+  unlock(controller);
+  wait_while_busy(controller);
+  bit_modify(controller.cr).set<flash_control::page_erase>();
+  controller.ar = address;
+  bit_modify(controller.cr).set<flash_control::start>();
+  wait_while_busy(controller);
+
+  return finish(controller);
+}
+}  // namespace hal::stm32f1
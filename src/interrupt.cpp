@@ -0,0 +1,183 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <libhal-stm32f1/interrupt.hpp>
+
+#include <cstdint>
+
+#include <libhal-stm32f1/isr_statistics.hpp>
+#include <libhal-util/bit.hpp>
+#include <libhal-util/enum.hpp>
+
+#include "cortex_m_reg.hpp"
+#include "isr_statistics.hpp"
+
+namespace hal::stm32f1 {
+namespace {
+/// Start and end of the SRAM address space
+constexpr std::uintptr_t sram_start = 0x2000'0000;
+constexpr std::uintptr_t sram_end = 0x2010'0000;
+
+alignas(vector_table_alignment) vector_table ram_vector_table{};
+
+interrupt_handler* active_vector_table()
+{
+  // NOLINTNEXTLINE(performance-no-int-to-ptr)
+  return reinterpret_cast<interrupt_handler*>(std::uintptr_t{ scb->vtor });
+}
+
+status install(std::size_t p_index, interrupt_handler p_handler)
+{
+  auto* table = active_vector_table();
+  auto address = reinterpret_cast<std::uintptr_t>(table);
+
+  if (address < sram_start || sram_end <= address) {
+    // Flash tables can't be changed, but a driver asking for the handler the
+    // application already placed in its static table is fine.
+    if (table[p_index] == p_handler) {
+      return hal::success();
+    }
+    return hal::new_error(std::errc::operation_not_permitted);
+  }
+
+#if HAL_STM32F1_ISR_STATISTICS
+  if (p_index >= core_vector_count) {
+    p_handler = time_handler(p_index - core_vector_count, p_handler);
+  }
+#endif
+
+  table[p_index] = p_handler;
+  data_synchronization_barrier();
+  return hal::success();
+}
+
+std::uint32_t irq_register(irq p_irq)
+{
+  return hal::value(p_irq) / 32U;
+}
+
+std::uint32_t irq_bit(irq p_irq)
+{
+  return 1U << (hal::value(p_irq) % 32U);
+}
+}  // namespace
+
+void unhandled_interrupt()
+{
+  hal::halt();
+}
+
+void set_vector_table(const interrupt_handler* p_table)
+{
+  scb->vtor =
+    static_cast<std::uint32_t>(reinterpret_cast<std::uintptr_t>(p_table));
+  data_synchronization_barrier();
+  instruction_synchronization_barrier();
+}
+
+void initialize_ram_vector_table()
+{
+  auto* current = active_vector_table();
+  if (current == ram_vector_table.data()) {
+    return;
+  }
+
+  for (std::size_t i = 0; i < ram_vector_table.size(); i++) {
+    ram_vector_table[i] = current[i];
+  }
+
+  set_vector_table(ram_vector_table.data());
+}
+
+status install_handler(irq p_irq, interrupt_handler p_handler)
+{
+  return install(core_vector_count + hal::value(p_irq), p_handler);
+}
+
+status install_handler(exception p_exception, interrupt_handler p_handler)
+{
+  return install(hal::value(p_exception), p_handler);
+}
+
+void enable_interrupt(irq p_irq)
+{
+  // Writing 0s to ISER and ICER has no effect, so no read-modify-write is
+  // needed.
+  nvic->iser[irq_register(p_irq)] = irq_bit(p_irq);
+}
+
+void disable_interrupt(irq p_irq)
+{
+  nvic->icer[irq_register(p_irq)] = irq_bit(p_irq);
+  data_synchronization_barrier();
+  instruction_synchronization_barrier();
+}
+
+bool is_interrupt_enabled(irq p_irq)
+{
+  return nvic->iser[irq_register(p_irq)] & irq_bit(p_irq);
+}
+
+void set_priority_grouping(priority_group p_group)
+{
+  using aircr = application_interrupt_and_reset_control;
+
+  // VECTKEY reads back as a different value, so it must be inserted on every
+  // write.
+  bit_modify(scb->aircr)
+    .insert<aircr::vector_key>(aircr_vector_key)
+    .insert<aircr::priority_group>(hal::value(p_group));
+}
+
+priority_group get_priority_grouping()
+{
+  using aircr = application_interrupt_and_reset_control;
+
+  auto group = bit_extract<aircr::priority_group>(scb->aircr);
+  // Groups 0 to 3 all leave zero bits for sub-priority on a device with 4
+  // implemented priority bits.
+  if (group < hal::value(priority_group::preempt_4_bits_sub_0_bits)) {
+    return priority_group::preempt_4_bits_sub_0_bits;
+  }
+  return static_cast<priority_group>(group);
+}
+
+void set_priority(irq p_irq, std::uint8_t p_preempt, std::uint8_t p_sub)
+{
+  nvic->ip[hal::value(p_irq)] =
+    encode_priority(get_priority_grouping(), p_preempt, p_sub);
+}
+
+void set_priority(exception p_exception,
+                  std::uint8_t p_preempt,
+                  std::uint8_t p_sub)
+{
+  constexpr auto first_configurable = exception::memory_management_fault;
+  if (p_exception < first_configurable) {
+    return;
+  }
+
+  scb->shp[hal::value(p_exception) - hal::value(first_configurable)] =
+    encode_priority(get_priority_grouping(), p_preempt, p_sub);
+}
+
+void set_priorities(std::span<const irq_priority> p_priorities)
+{
+  auto group = get_priority_grouping();
+  for (const auto& priority : p_priorities) {
+    nvic->ip[hal::value(priority.id)] =
+      encode_priority(group, priority.preempt, priority.sub);
+  }
+}
+}  // namespace hal::stm32f1
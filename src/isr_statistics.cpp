@@ -0,0 +1,64 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <libhal-stm32f1/isr_statistics.hpp>
+
+#if HAL_STM32F1_ISR_STATISTICS
+
+#include <array>
+#include <cstddef>
+
+#include <libhal-stm32f1/ramfunc.hpp>
+#include <libhal-util/enum.hpp>
+
+#include "cortex_m_reg.hpp"
+#include "isr_statistics.hpp"
+
+namespace hal::stm32f1 {
+std::array<isr_statistics, static_cast<std::size_t>(irq::max)>
+  isr_statistics_table{};
+
+namespace {
+std::array<interrupt_handler, static_cast<std::size_t>(irq::max)>
+  timed_handlers{};
+
+HAL_STM32F1_RAMFUNC void timed_interrupt()
+{
+  // Only installed for irqs, so the active vector is never a core exception
+  auto index = active_vector() - core_vector_count;
+  auto start = dwt->cyccnt;
+  timed_handlers[index]();
+  isr_statistics_table[index].record(dwt->cyccnt - start);
+}
+}  // namespace
+
+interrupt_handler time_handler(std::size_t p_irq_index,
+                               interrupt_handler p_handler)
+{
+  enable_cycle_counter();
+  timed_handlers[p_irq_index] = p_handler;
+  return timed_interrupt;
+}
+
+isr_statistics read_isr_statistics(irq p_irq)
+{
+  return isr_statistics_table[hal::value(p_irq)];
+}
+
+void reset_isr_statistics()
+{
+  isr_statistics_table.fill(isr_statistics{});
+}
+}  // namespace hal::stm32f1
+#endif
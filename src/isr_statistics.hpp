@@ -0,0 +1,33 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <cstddef>
+
+#include <libhal-stm32f1/interrupt.hpp>
+
+namespace hal::stm32f1 {
+/**
+ * @brief Wrap a handler so that each run is timed
+ *
+ * Only exists when HAL_STM32F1_ISR_STATISTICS is 1.
+ *
+ * @param p_irq_index - irq value the handler serves
+ * @param p_handler - handler to time
+ * @return interrupt_handler - trampoline to place in the vector table
+ */
+interrupt_handler time_handler(std::size_t p_irq_index,
+                               interrupt_handler p_handler);
+}  // namespace hal::stm32f1
@@ -0,0 +1,96 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <array>
+#include <cstdint>
+
+#include <libhal-util/bit.hpp>
+
+namespace hal::stm32f1 {
+/// Instrumentation trace macrocell register map
+struct itm_t
+{
+  /// Stimulus ports, reading one returns 1 once its FIFO accepts a write
+  std::array<volatile std::uint32_t, 32> stimulus;
+  std::array<std::uint32_t, 864> reserved0;
+  volatile std::uint32_t ter;
+  std::array<std::uint32_t, 15> reserved1;
+  volatile std::uint32_t tpr;
+  std::array<std::uint32_t, 15> reserved2;
+  volatile std::uint32_t tcr;
+  std::array<std::uint32_t, 75> reserved3;
+  volatile std::uint32_t lar;
+};
+
+/// Trace port interface unit register map
+struct tpiu_t
+{
+  volatile std::uint32_t sspsr;
+  volatile std::uint32_t cspsr;
+  std::array<std::uint32_t, 2> reserved0;
+  volatile std::uint32_t acpr;
+  std::array<std::uint32_t, 55> reserved1;
+  volatile std::uint32_t sppr;
+  std::array<std::uint32_t, 131> reserved2;
+  volatile std::uint32_t ffsr;
+  volatile std::uint32_t ffcr;
+};
+
+/// MCU debug component register map
+struct debug_mcu_t
+{
+  volatile std::uint32_t idcode;
+  volatile std::uint32_t cr;
+};
+
+/// Bit masks for the ITM TCR register
+struct itm_trace_control
+{
+  /// ATB ID of the ITM, must not be 0
+  static constexpr auto trace_bus_id = bit_mask::from<16, 22>();
+  /// Emit the DWT packets, which carry the periodic synchronization packets
+  static constexpr auto dwt_forwarding = bit_mask::from<3>();
+  /// Emit synchronization packets
+  static constexpr auto synchronization = bit_mask::from<2>();
+  /// Emit local timestamp packets
+  static constexpr auto timestamps = bit_mask::from<1>();
+  /// Enables the ITM
+  static constexpr auto enable = bit_mask::from<0>();
+};
+
+/// Bit masks for the DBGMCU CR register
+struct debug_mcu_control
+{
+  /// Trace pin assignment, 0 selects asynchronous SWO on PB3
+  static constexpr auto trace_mode = bit_mask::from<6, 7>();
+  /// Enables the trace pins
+  static constexpr auto trace_io_enable = bit_mask::from<5>();
+};
+
+/// Value of TPIU SPPR selecting NRZ (UART) encoding of the SWO pin
+static constexpr std::uint32_t tpiu_protocol_nrz = 0b10;
+
+/// Value of TPIU FFCR that bypasses the formatter, as the formatter is only
+/// needed for the parallel trace port
+static constexpr std::uint32_t tpiu_formatter_bypass = 0x100;
+
+/// Writing this to ITM LAR unlocks the ITM registers
+static constexpr std::uint32_t itm_unlock_key = 0xC5AC'CE55;
+
+inline itm_t* itm = reinterpret_cast<itm_t*>(0xE000'0000);
+inline tpiu_t* tpiu = reinterpret_cast<tpiu_t*>(0xE004'0000);
+inline debug_mcu_t* debug_mcu = reinterpret_cast<debug_mcu_t*>(0xE004'2000);
+}  // namespace hal::stm32f1
@@ -0,0 +1,110 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <libhal-stm32f1/itm_trace.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+
+#include <libhal-stm32f1/clock.hpp>
+#include <libhal-stm32f1/constants.hpp>
+#include <libhal-stm32f1/remap.hpp>
+#include <libhal-util/bit.hpp>
+
+#include "cortex_m_reg.hpp"
+#include "itm_reg.hpp"
+
+namespace hal::stm32f1 {
+namespace {
+std::atomic<std::uint32_t> dropped_events = 0;
+
+bool port_ready(volatile std::uint32_t& p_port)
+{
+  return p_port & 1U;
+}
+}  // namespace
+
+status start_itm_trace(const itm_trace_settings& p_settings)
+{
+  auto prescaler = calculate_swo_prescaler(frequency_hz(peripheral::cpu),
+                                           to_hz(p_settings.swo_rate));
+  if (!prescaler) {
+    return hal::new_error(std::errc::argument_out_of_domain);
+  }
+
+  // TRCENA, which also powers the DWT, comes first
+  enable_cycle_counter();
+  // Periodic synchronization packets every 2^26 cycles
+  bit_modify(dwt->ctrl).insert<dwt_control::synchronization_tap>(0b10U);
+
+  configure_debug_port(debug_port::serial_wire_only);
+  bit_modify(debug_mcu->cr)
+    .set<debug_mcu_control::trace_io_enable>()
+    .insert<debug_mcu_control::trace_mode>(0b00U);
+
+  tpiu->sppr = tpiu_protocol_nrz;
+  tpiu->acpr = *prescaler;
+  tpiu->ffcr = tpiu_formatter_bypass;
+
+  itm->lar = itm_unlock_key;
+  itm->tcr = bit_value<std::uint32_t>(0)
+               .insert<itm_trace_control::trace_bus_id>(1U)
+               .set<itm_trace_control::dwt_forwarding>()
+               .set<itm_trace_control::synchronization>()
+               .insert<itm_trace_control::timestamps>(
+                 static_cast<std::uint32_t>(p_settings.timestamps))
+               .set<itm_trace_control::enable>()
+               .get();
+  // Allow unprivileged code to trace and enable every port
+  itm->tpr = 0;
+  itm->ter = 0xFFFF'FFFF;
+
+  return hal::success();
+}
+
+bool trace_event(std::uint8_t p_port,
+                 std::uint16_t p_id,
+                 std::span<const std::uint32_t> p_arguments)
+{
+  auto& port = itm->stimulus[p_port % itm_port_count];
+  auto arguments =
+    p_arguments.first(std::min(p_arguments.size(), max_trace_arguments));
+
+  // Ports read as 0 while the ITM is disabled, so tracing without a started
+  // trace only costs the read.
+  if (!port_ready(port)) {
+    dropped_events.fetch_add(1, std::memory_order_relaxed);
+    return false;
+  }
+  // A half word write produces the 2 byte packet that marks the header
+  *reinterpret_cast<volatile std::uint16_t*>(&port) =
+    trace_event_header(p_id, arguments.size());
+
+  for (auto argument : arguments) {
+    if (!port_ready(port)) {
+      dropped_events.fetch_add(1, std::memory_order_relaxed);
+      return false;
+    }
+    port = argument;
+  }
+
+  return true;
+}
+
+std::uint32_t dropped_trace_events()
+{
+  return dropped_events.load(std::memory_order_relaxed);
+}
+}  // namespace hal::stm32f1
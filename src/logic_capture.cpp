@@ -0,0 +1,312 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <libhal-stm32f1/logic_capture.hpp>
+
+#include <algorithm>
+#include <cstdint>
+#include <optional>
+#include <utility>
+
+#include <libhal-stm32f1/clock.hpp>
+#include <libhal-stm32f1/constants.hpp>
+#include <libhal-stm32f1/pin.hpp>
+#include <libhal-stm32f1/power_domain.hpp>
+#include <libhal-util/bit.hpp>
+#include <libhal-util/enum.hpp>
+
+#include "basic_timer_reg.hpp"
+#include "dma.hpp"
+#include "pin.hpp"
+#include "timer.hpp"
+
+namespace hal::stm32f1 {
+namespace {
+/// CNDTR is 16 bits wide
+constexpr std::size_t max_ring_length = 0xFFFF;
+/// Flags the DMA sets as it passes the middle and the end of the ring
+constexpr std::uint32_t boundary_flags =
+  dma_flags::half_transfer | dma_flags::transfer_complete;
+
+/// Determine if moving from one ring position to another writes an element
+bool writes_element(std::size_t p_from,
+                    std::size_t p_to,
+                    std::size_t p_element,
+                    std::size_t p_size)
+{
+  return (p_element + p_size - p_from) % p_size <
+         (p_to + p_size - p_from) % p_size;
+}
+
+/// Boundary flags set by the DMA moving from one ring position to another
+std::uint32_t passed_flags(std::size_t p_from,
+                           std::size_t p_to,
+                           std::size_t p_size)
+{
+  // HTIF is set with the write that leaves half of CNDTR, rounded down
+  auto half = p_size - p_size / 2;
+  std::uint32_t flags = 0;
+  if (writes_element(p_from, p_to, half - 1, p_size)) {
+    flags |= dma_flags::half_transfer;
+  }
+  if (writes_element(p_from, p_to, p_size - 1, p_size)) {
+    flags |= dma_flags::transfer_complete;
+  }
+  return flags;
+}
+
+peripheral port_peripheral(std::uint8_t p_port)
+{
+  return static_cast<peripheral>(value(peripheral::gpio_a) + (p_port - 'A'));
+}
+
+void start_dma(dma_channel_select p_select,
+               volatile std::uint32_t& p_source,
+               std::span<std::uint16_t> p_ring)
+{
+  using ccr = dma_channel_configuration;
+
+  auto& channel = dma_channel(p_select);
+  clear_dma_flags(p_select);
+  channel.cpar =
+    static_cast<std::uint32_t>(reinterpret_cast<std::uintptr_t>(&p_source));
+  channel.cmar = static_cast<std::uint32_t>(
+    reinterpret_cast<std::uintptr_t>(p_ring.data()));
+  channel.cndtr = static_cast<std::uint32_t>(p_ring.size());
+
+  // GPIO registers only accept word accesses. A 32-bit peripheral size with
+  // a 16-bit memory size keeps the lower half, which holds the pin levels.
+  channel.ccr =
+    bit_value<std::uint32_t>(0)
+      .insert<ccr::priority>(0b11U)
+      .insert<ccr::memory_size>(value(dma_transfer_size::bits16))
+      .insert<ccr::peripheral_size>(value(dma_transfer_size::bits32))
+      .set<ccr::memory_increment>()
+      .set<ccr::circular>()
+      .set<ccr::enable>()
+      .get();
+}
+}  // namespace
+
+result<logic_capture> logic_capture::get(std::uint8_t p_port)
+{
+  if (p_port < 'A' || p_port >= 'A' + gpio_port_count) {
+    return hal::new_error(std::errc::invalid_argument);
+  }
+  return logic_capture(p_port);
+}
+
+logic_capture::logic_capture(std::uint8_t p_port)
+  : m_port(p_port)
+{
+}
+
+logic_capture::logic_capture(logic_capture&& p_other) noexcept
+  : m_port(p_other.m_port)
+{
+  *this = std::move(p_other);
+}
+
+logic_capture& logic_capture::operator=(logic_capture&& p_other) noexcept
+{
+  if (this != &p_other) {
+    stop();
+    m_port = p_other.m_port;
+    m_timer = std::exchange(p_other.m_timer, std::nullopt);
+    m_ring = p_other.m_ring;
+    m_settings = p_other.m_settings;
+    m_searched = p_other.m_searched;
+    m_position = p_other.m_position;
+    m_pending_flags = p_other.m_pending_flags;
+    m_wrapped = p_other.m_wrapped;
+    m_trigger = p_other.m_trigger;
+    m_after_trigger = p_other.m_after_trigger;
+    m_samples = p_other.m_samples;
+    m_trigger_index = p_other.m_trigger_index;
+  }
+  return *this;
+}
+
+logic_capture::~logic_capture()
+{
+  stop();
+}
+
+status logic_capture::start(std::span<std::uint16_t> p_ring,
+                            logic_capture_settings p_settings)
+{
+  stop();
+  m_samples = {};
+
+  auto select = timer_update_dma(p_settings.timer);
+  if (p_ring.size() < 2 || p_ring.size() > max_ring_length ||
+      p_settings.post_trigger_samples >= p_ring.size() || !select) {
+    return hal::new_error(std::errc::invalid_argument);
+  }
+
+  auto timing = calculate_basic_timer_timing(to_hz(p_settings.sample_rate),
+                                             frequency_hz(p_settings.timer));
+  if (!timing) {
+    return hal::new_error(std::errc::argument_out_of_domain);
+  }
+
+  if (!claim_timer(p_settings.timer)) {
+    return hal::new_error(std::errc::device_or_resource_busy);
+  }
+  if (!claim_dma_channel(*select)) {
+    release_timer(p_settings.timer);
+    return hal::new_error(std::errc::device_or_resource_busy);
+  }
+
+  m_timer = p_settings.timer;
+  m_ring = p_ring;
+  m_settings = p_settings;
+  m_searched = 0;
+  m_position = 0;
+  m_pending_flags = 0;
+  m_wrapped = false;
+  m_trigger.reset();
+  m_after_trigger = 0;
+
+  acquire_power(port_peripheral(m_port));
+
+  load_timer_timing(p_settings.timer, *timing);
+  start_dma(*select, gpio(m_port).idr, p_ring);
+  timer_registers(p_settings.timer).dier =
+    bit_value<std::uint32_t>(0)
+      .set<basic_timer_interrupt_enable::update_dma>()
+      .get();
+  start_timer(p_settings.timer);
+
+  return hal::success();
+}
+
+std::size_t logic_capture::write_position()
+{
+  auto remaining = dma_channel(*timer_update_dma(*m_timer)).cndtr & 0xFFFF;
+  return (m_ring.size() - remaining) % m_ring.size();
+}
+
+/// Advance to the DMA position, false if the DMA lapped the last position
+bool logic_capture::track_position()
+{
+  auto select = *timer_update_dma(*m_timer);
+
+  // Flags are read and cleared before the position is, so each flag read
+  // belongs to a boundary before the position.
+  auto flags = dma_flags_of(select) & boundary_flags;
+  clear_dma_flags(select, flags);
+  auto position = write_position();
+
+  // A boundary passed since the last poll sets its flag once. A flag without
+  // a boundary to account for it means the DMA passed a boundary twice.
+  auto passed = passed_flags(m_position, position, m_ring.size());
+  passed |= m_pending_flags;
+  if (flags & ~passed) {
+    return false;
+  }
+
+  m_pending_flags = passed & ~flags;
+  m_wrapped = m_wrapped || (passed & dma_flags::transfer_complete);
+  m_position = position;
+  return true;
+}
+
+result<bool> logic_capture::poll()
+{
+  if (!m_timer) {
+    return !m_samples.empty();
+  }
+
+  if (!track_position()) {
+    stop();
+    return hal::new_error(std::errc::io_error);
+  }
+
+  while (m_searched != m_position) {
+    auto index = m_searched;
+    m_searched = (m_searched + 1) % m_ring.size();
+
+    if (m_trigger) {
+      m_after_trigger++;
+    } else if (m_settings.trigger.matches(m_ring[index])) {
+      m_trigger = index;
+    }
+
+    if (m_trigger && m_after_trigger >= m_settings.post_trigger_samples) {
+      HAL_CHECK(finish());
+      return true;
+    }
+  }
+  return false;
+}
+
+status logic_capture::finish()
+{
+  auto timer = *m_timer;
+  auto select = *timer_update_dma(timer);
+
+  // Stopping the timer ends the requests, so the position is final. The DMA
+  // kept writing while the samples were searched, which must not have
+  // reached the trigger sample again.
+  release_timer(timer);
+  auto searched_position = m_position;
+  bool intact = track_position() && !writes_element(searched_position,
+                                                    m_position,
+                                                    *m_trigger,
+                                                    m_ring.size());
+  release_dma_channel(select);
+  release_power(port_peripheral(m_port));
+  m_timer.reset();
+
+  if (!intact) {
+    return hal::new_error(std::errc::io_error);
+  }
+
+  auto end = m_position;
+  if (!m_wrapped) {
+    m_samples = m_ring.first(end);
+    m_trigger_index = *m_trigger;
+    return hal::success();
+  }
+
+  // The oldest sample is the next one the DMA would have overwritten
+  std::rotate(m_ring.begin(), m_ring.begin() + end, m_ring.end());
+  m_samples = m_ring;
+  m_trigger_index = (*m_trigger + m_ring.size() - end) % m_ring.size();
+  return hal::success();
+}
+
+std::span<const std::uint16_t> logic_capture::samples() const
+{
+  return m_samples;
+}
+
+std::size_t logic_capture::trigger_index() const
+{
+  return m_trigger_index;
+}
+
+void logic_capture::stop()
+{
+  if (!m_timer) {
+    return;
+  }
+
+  release_timer(*m_timer);
+  release_dma_channel(*timer_update_dma(*m_timer));
+  release_power(port_peripheral(m_port));
+  m_timer.reset();
+}
+}  // namespace hal::stm32f1
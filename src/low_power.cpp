@@ -0,0 +1,151 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <libhal-stm32f1/low_power.hpp>
+
+#include <cstdint>
+
+#include <libhal-stm32f1/clock.hpp>
+#include <libhal-stm32f1/constants.hpp>
+#include <libhal-stm32f1/power_domain.hpp>
+#include <libhal-util/bit.hpp>
+#include <libhal-util/enum.hpp>
+
+#include "cortex_m_reg.hpp"
+#include "exti_reg.hpp"
+#include "pin.hpp"
+#include "pwr_reg.hpp"
+
+namespace hal::stm32f1 {
+namespace {
+void wait(wake_on p_wake)
+{
+  data_synchronization_barrier();
+  if (p_wake == wake_on::event) {
+    wait_for_event();
+  } else {
+    wait_for_interrupt();
+  }
+  instruction_synchronization_barrier();
+}
+
+void configure_line(std::uint32_t p_line, exti_edge p_edge, wake_on p_wake)
+{
+  auto line = bit_mask::from(p_line);
+  bool rising = p_edge != exti_edge::falling;
+  bool falling = p_edge != exti_edge::rising;
+  bool interrupt = p_wake == wake_on::interrupt;
+
+  bit_modify(exti->rtsr).insert(line, rising);
+  bit_modify(exti->ftsr).insert(line, falling);
+  bit_modify(exti->imr).insert(line, interrupt);
+  bit_modify(exti->emr).insert(line, !interrupt);
+}
+}  // namespace
+
+void sleep(wake_on p_wake)
+{
+  bit_modify(scb->scr).clear<system_control::sleep_deep>();
+  wait(p_wake);
+}
+
+void sleep_on_exit(bool p_enable)
+{
+  bit_modify(scb->scr).insert<system_control::sleep_on_exit>(p_enable);
+}
+
+void stop(stop_settings p_settings)
+{
+  acquire_power(peripheral::power);
+
+  bit_modify(pwr->cr)
+    .clear<power_control_register::power_down_deep_sleep>()
+    .insert<power_control_register::low_power_deep_sleep>(
+      p_settings.low_power_regulator)
+    .set<power_control_register::clear_wakeup_flag>();
+  bit_modify(scb->scr).set<system_control::sleep_deep>();
+
+  wait(p_settings.wake);
+
+  // Leave SLEEPDEEP clear so that a later sleep() does not enter stop mode
+  bit_modify(scb->scr).clear<system_control::sleep_deep>();
+
+  if (p_settings.restore_clocks) {
+    restore_clocks();
+  }
+
+  release_power(peripheral::power);
+}
+
+void standby()
+{
+  acquire_power(peripheral::power);
+
+  // A wakeup flag left over from before would wake the device immediately
+  bit_modify(pwr->cr)
+    .set<power_control_register::power_down_deep_sleep>()
+    .set<power_control_register::clear_wakeup_flag>();
+  bit_modify(scb->scr).set<system_control::sleep_deep>();
+
+  wait(wake_on::interrupt);
+}
+
+void enable_wakeup_pin(bool p_enable)
+{
+  acquire_power(peripheral::power);
+  bit_modify(pwr->csr).insert<power_control_status::enable_wakeup_pin>(
+    p_enable);
+  release_power(peripheral::power);
+}
+
+bool woke_from_standby()
+{
+  acquire_power(peripheral::power);
+  bool standby_flag =
+    bit_extract<power_control_status::standby_flag>(pwr->csr);
+  bit_modify(pwr->cr).set<power_control_register::clear_standby_flag>();
+  release_power(peripheral::power);
+  return standby_flag;
+}
+
+void configure_wakeup(exti_line p_line, exti_edge p_edge, wake_on p_wake)
+{
+  configure_line(value(p_line), p_edge, p_wake);
+}
+
+void configure_wakeup(std::uint8_t p_port,
+                      std::uint8_t p_pin,
+                      exti_edge p_edge,
+                      wake_on p_wake)
+{
+  // Each EXTICR register selects the port of 4 lines
+  auto port_mask = bit_mask{
+    .position = static_cast<std::uint32_t>((p_pin % 4) * 4),
+    .width = 4,
+  };
+
+  acquire_power(peripheral::afio);
+  bit_modify(alternative_function_io->exticr[p_pin / 4])
+    .insert(port_mask, static_cast<std::uint32_t>(p_port - 'A'));
+  release_power(peripheral::afio);
+
+  configure_line(p_pin, p_edge, p_wake);
+}
+
+void clear_wakeup_pending(std::uint8_t p_line)
+{
+  // PR is write 1 to clear, other bits are unaffected
+  exti->pr = 1U << p_line;
+}
+}  // namespace hal::stm32f1
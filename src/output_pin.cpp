@@ -16,35 +16,37 @@
 
 #include <cstdint>
 
+#include <libhal-stm32f1/power_domain.hpp>
 #include <libhal-util/bit.hpp>
+#include <libhal-util/enum.hpp>
 
 #include "pin.hpp"
-#include "power.hpp"
 
 namespace hal::stm32f1 {
+namespace {
+bool is_valid_port(std::uint8_t p_port)
+{
+  return 'A' <= p_port && p_port <= 'E';
+}
+
+/// The ids of gpio_a to gpio_e are consecutive
+peripheral port_peripheral(std::uint8_t p_port)
+{
+  return static_cast<peripheral>(value(peripheral::gpio_a) + (p_port - 'A'));
+}
+}  // namespace
+
 result<output_pin> output_pin::get(std::uint8_t p_port,
                                    std::uint8_t p_pin,
                                    output_pin::settings p_settings)
 {
-  output_pin gpio(p_port, p_pin);
-
-  // Ensure that AFIO is powered on before attempting to access it
-  power(peripheral::afio).on();
-
-  if (p_port == 'A') {
-    power(peripheral::gpio_a).on();
-  } else if (p_port == 'B') {
-    power(peripheral::gpio_b).on();
-  } else if (p_port == 'C') {
-    power(peripheral::gpio_c).on();
-  } else if (p_port == 'D') {
-    power(peripheral::gpio_d).on();
-  } else if (p_port == 'E') {
-    power(peripheral::gpio_e).on();
-  } else {
+  if (!is_valid_port(p_port)) {
     return hal::new_error(std::errc::invalid_argument);
   }
 
+  acquire_power(port_peripheral(p_port));
+  output_pin gpio(p_port, p_pin);
+
   // Ignore result as this function is infallible
   (void)gpio.driver_configure(p_settings);
   return gpio;
@@ -58,6 +60,34 @@ output_pin::output_pin(std::uint8_t p_port,  // NOLINT
 {
 }
 
+output_pin::output_pin(output_pin&& p_other) noexcept
+  : m_port(p_other.m_port)
+  , m_pin(p_other.m_pin)
+{
+  p_other.m_port = 0;
+}
+
+output_pin& output_pin::operator=(output_pin&& p_other) noexcept
+{
+  if (this != &p_other) {
+    if (is_valid_port(m_port)) {
+      release_power(port_peripheral(m_port));
+    }
+    m_port = p_other.m_port;
+    m_pin = p_other.m_pin;
+    p_other.m_port = 0;
+  }
+  return *this;
+}
+
+output_pin::~output_pin()
+{
+  // A moved from pin holds no reference
+  if (is_valid_port(m_port)) {
+    release_power(port_peripheral(m_port));
+  }
+}
+
 status output_pin::driver_configure(const settings& p_settings)
 {
   if (!p_settings.open_drain) {
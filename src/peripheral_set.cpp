@@ -0,0 +1,98 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <libhal-stm32f1/peripheral_set.hpp>
+
+#include <cstdint>
+
+#include <libhal-stm32f1/constants.hpp>
+
+#include "rcc_reg.hpp"
+
+namespace hal::stm32f1 {
+namespace {
+volatile std::uint32_t& enable_register(std::uint32_t p_bus)
+{
+  switch (p_bus) {
+    case ahb_bus:
+      return rcc->ahbenr;
+    case apb1_bus:
+      return rcc->apb1enr;
+    default:
+      return rcc->apb2enr;
+  }
+}
+
+template<typename Function>
+void for_each_bus(const peripheral_set& p_set, Function p_function)
+{
+  for (auto bus : { ahb_bus, apb1_bus, apb2_bus }) {
+    if (auto mask = p_set.mask(bus); mask != 0) {
+      p_function(bus, mask);
+    }
+  }
+}
+}  // namespace
+
+void enable_peripherals(const peripheral_set& p_set)
+{
+  for_each_bus(p_set, [](std::uint32_t p_bus, std::uint32_t p_mask) {
+    auto& reg = enable_register(p_bus);
+    reg = reg | p_mask;
+  });
+}
+
+void disable_peripherals(const peripheral_set& p_set)
+{
+  for_each_bus(p_set, [](std::uint32_t p_bus, std::uint32_t p_mask) {
+    auto& reg = enable_register(p_bus);
+    reg = reg & ~p_mask;
+  });
+}
+
+void reset_peripherals(const peripheral_set& p_set)
+{
+  auto apb1 = p_set.mask(apb1_bus);
+  auto apb2 = p_set.mask(apb2_bus);
+
+  // Assert every reset before releasing any, so that peripherals on both
+  // buses come out of reset together.
+  if (apb1 != 0) {
+    rcc->apb1rstr = rcc->apb1rstr | apb1;
+  }
+  if (apb2 != 0) {
+    rcc->apb2rstr = rcc->apb2rstr | apb2;
+  }
+  if (apb1 != 0) {
+    rcc->apb1rstr = rcc->apb1rstr & ~apb1;
+  }
+  if (apb2 != 0) {
+    rcc->apb2rstr = rcc->apb2rstr & ~apb2;
+  }
+}
+
+peripheral_set powered_peripherals()
+{
+  peripheral_set result;
+  for (auto bus : { ahb_bus, apb1_bus, apb2_bus }) {
+    std::uint32_t enabled = enable_register(bus);
+    for (std::uint32_t bit = 0; bit < bus_id_offset; bit++) {
+      if (enabled & (1U << bit)) {
+        result.add(static_cast<peripheral>(bus + bit));
+      }
+    }
+  }
+  return result;
+}
+}  // namespace hal::stm32f1
@@ -15,12 +15,16 @@
 #include <libhal-stm32f1/pin.hpp>
 
 #include <array>
+#include <cstddef>
 #include <cstdint>
 
+#include <libhal-stm32f1/peripheral_set.hpp>
+#include <libhal-stm32f1/power_domain.hpp>
+#include <libhal-stm32f1/remap.hpp>
 #include <libhal-util/bit.hpp>
+#include <libhal-util/enum.hpp>
 
 #include "pin.hpp"
-#include "power.hpp"
 
 namespace hal::stm32f1 {
 namespace {
@@ -43,6 +47,22 @@ volatile uint32_t& config_register(const pin_select_t& p_pin_select)
   }
   return gpio(p_pin_select.port).crh;
 }
+
+/// Write the pins of a config register selected by the mask, with no read if
+/// every pin is selected
+void write_config_register(volatile std::uint32_t& p_register,
+                           std::uint32_t p_mask,
+                           std::uint32_t p_config)
+{
+  if (p_mask == 0) {
+    return;
+  }
+  if (p_mask == 0xFFFF'FFFF) {
+    p_register = p_config;
+    return;
+  }
+  p_register = (p_register & ~p_mask) | p_config;
+}
 }  // namespace
 
 gpio_t& gpio(std::uint8_t p_port)
@@ -81,17 +101,55 @@ void configure_pin(pin_select_t p_pin_select, pin_config_t p_config)
                   .insert<mode>(p_config.MODE)
                   .get();
 
-  config_register(p_pin_select) = bit_modify(config_register(p_pin_select))
-                                    .insert(mask(p_pin_select.pin), config)
-                                    .to<std::uint32_t>();
+  // Pulled inputs take their pull direction from ODR
+  if (p_config.CNF1 && !p_config.CNF0 && p_config.MODE == 0b00) {
+    auto bit = p_config.PxODR ? p_pin_select.pin : p_pin_select.pin + 16U;
+    gpio(p_pin_select.port).bsrr = 1U << bit;
+  }
+
+  bit_modify(config_register(p_pin_select))
+    .insert(mask(p_pin_select.pin), config);
+}
+
+void configure_pins(std::span<const pin_select_t> p_pins,
+                    pin_config_t p_config)
+{
+  for (const auto& pin : p_pins) {
+    configure_pin(pin, p_config);
+  }
+}
+
+void apply_pin_map(const pin_map& p_map)
+{
+  // Pin maps hold one reference per port for the rest of the program, so
+  // applying maps repeatedly does not count up towards the overflow
+  static peripheral_set held_ports;
+
+  peripheral_set ports;
+  for (std::size_t index = 0; index < gpio_port_count; index++) {
+    auto port = static_cast<peripheral>(value(peripheral::gpio_a) + index);
+    if (!p_map.ports()[index].empty() && !held_ports.contains(port)) {
+      ports.add(port);
+    }
+  }
+  acquire_power(ports);
+  held_ports |= ports;
+
+  for (std::size_t index = 0; index < gpio_port_count; index++) {
+    const auto& port = p_map.ports()[index];
+    if (port.empty()) {
+      continue;
+    }
+
+    auto& reg = gpio(static_cast<std::uint8_t>('A' + index));
+    reg.bsrr = port.bsrr;
+    write_config_register(reg.crl, port.crl_mask, port.crl);
+    write_config_register(reg.crh, port.crh_mask, port.crh);
+  }
 }
 
 void release_jtag_pins()
 {
-  // Ensure that AFIO is powered on before attempting to access it
-  power(peripheral::afio).on();
-  // Set the JTAG Release code
-  bit_modify(alternative_function_io->mapr)
-    .insert<bit_mask::from<24, 26>()>(0b010U);
+  configure_debug_port(debug_port::serial_wire_only);
 }
 }  // namespace hal::stm32f1
@@ -16,7 +16,9 @@
 
 #include <array>
 #include <cstdint>
+#include <span>
 
+#include <libhal-stm32f1/pin.hpp>
 #include <libhal/error.hpp>
 
 namespace hal::stm32f1 {
@@ -25,7 +27,7 @@ struct alternative_function_io_t
 {
   volatile std::uint32_t evcr;
   volatile std::uint32_t mapr;
-  volatile std::array<std::uint32_t, 4> exticr;
+  std::array<volatile std::uint32_t, 4> exticr;
   std::uint32_t reserved0;
   volatile std::uint32_t mapr2;
 };
@@ -46,96 +48,24 @@ struct gpio_t
 };
 
 /**
- * @brief Map the CONFIG flags for each pin use case
+ * @brief Construct pin manipulation object
  *
+ * @param p_pin_select - the pin to configure
+ * @param p_config - Configuration to set the pin to
  */
-struct pin_config_t
-{
-  /// Configuration bit 1
-  std::uint8_t CNF1;
-  /// Configuration bit 0
-  std::uint8_t CNF0;
-  /// Mode bits
-  std::uint8_t MODE;
-  /// Output data register
-  std::uint8_t PxODR;
-};
+void configure_pin(pin_select_t p_pin_select, pin_config_t p_config);
 
 /**
- * @brief Pin select structure
+ * @brief Configure every pin of a group the same way
  *
- */
-struct pin_select_t
-{
-  /// @brief Port letter, must be a capitol letter from 'A' to 'G'
-  std::uint8_t port;
-  /// @brief Pin number, must be between 0 to 15
-  std::uint8_t pin;
-};
-
-static constexpr pin_config_t push_pull_gpio_output = {
-  .CNF1 = 0,
-  .CNF0 = 0,
-  .MODE = 0b11,  // Default to high speed 50 MHz
-  .PxODR = 0b0,  // Default to 0 LOW Voltage
-};
-
-static constexpr pin_config_t open_drain_gpio_output = {
-  .CNF1 = 0,
-  .CNF0 = 1,
-  .MODE = 0b11,  // Default to high speed 50 MHz
-  .PxODR = 0b0,  // Default to 0 LOW Voltage
-};
-
-static constexpr pin_config_t push_pull_alternative_output = {
-  .CNF1 = 1,
-  .CNF0 = 0,
-  .MODE = 0b11,  // Default to high speed 50 MHz
-  .PxODR = 0b0,  // Default to 0 LOW Voltage
-};
-
-static constexpr pin_config_t open_drain_alternative_output = {
-  .CNF1 = 1,
-  .CNF0 = 1,
-  .MODE = 0b11,  // Default to high speed 50 MHz
-  .PxODR = 0b0,  // Default to 0 LOW Voltage
-};
-
-static constexpr pin_config_t input_analog = {
-  .CNF1 = 0,
-  .CNF0 = 0,
-  .MODE = 0b00,
-  .PxODR = 0b0,  // Don't care
-};
-
-static constexpr pin_config_t input_float = {
-  .CNF1 = 0,
-  .CNF0 = 1,
-  .MODE = 0b00,
-  .PxODR = 0b0,  // Don't care
-};
-
-static constexpr pin_config_t input_pull_down = {
-  .CNF1 = 1,
-  .CNF0 = 0,
-  .MODE = 0b00,
-  .PxODR = 0b0,  // Pull Down
-};
-
-static constexpr pin_config_t input_pull_up = {
-  .CNF1 = 1,
-  .CNF0 = 0,
-  .MODE = 0b00,
-  .PxODR = 0b1,  // Pull Up
-};
-
-/**
- * @brief Construct pin manipulation object
+ * Used by peripherals with wide buses such as the FSMC. The ports of the pins
+ * must already be powered.
  *
- * @param p_pin_select - the pin to configure
- * @param p_config - Configuration to set the pin to
+ * @param p_pins - the pins to configure
+ * @param p_config - Configuration to set the pins to
  */
-void configure_pin(pin_select_t p_pin_select, pin_config_t p_config);
+void configure_pins(std::span<const pin_select_t> p_pins,
+                    pin_config_t p_config);
 
 /**
  * @brief Returns the gpio register based on the port
@@ -0,0 +1,136 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <libhal-stm32f1/power_domain.hpp>
+
+#include <array>
+#include <cstdint>
+#include <limits>
+
+#include <libhal-stm32f1/constants.hpp>
+#include <libhal-stm32f1/peripheral_set.hpp>
+#include <libhal-util/enum.hpp>
+#include <libhal/error.hpp>
+
+#include "power.hpp"
+
+namespace hal::stm32f1 {
+namespace {
+/// One reference count per enable bit of AHBENR, APB1ENR and APB2ENR
+std::array<std::uint16_t, beyond_bus> reference_counts{};
+
+bool has_enable_bit(peripheral p_peripheral)
+{
+  return value(p_peripheral) < beyond_bus;
+}
+
+void add_reference(std::uint16_t& p_count)
+{
+  // 65535 references can only come from acquires that are never released.
+  // Stop here, as saturating would hide the leak and wrapping would gate a
+  // clock that is in use.
+  if (p_count == std::numeric_limits<std::uint16_t>::max()) {
+    hal::halt();
+  }
+  p_count++;
+}
+}  // namespace
+
+void acquire_power(peripheral p_peripheral)
+{
+  if (!has_enable_bit(p_peripheral)) {
+    return;
+  }
+
+  auto& count = reference_counts[value(p_peripheral)];
+  add_reference(count);
+  if (count == 1) {
+    power(p_peripheral).on();
+  }
+}
+
+void release_power(peripheral p_peripheral)
+{
+  if (!has_enable_bit(p_peripheral)) {
+    return;
+  }
+
+  auto& count = reference_counts[value(p_peripheral)];
+  if (count == 0) {
+    return;
+  }
+  if (--count == 0) {
+    power(p_peripheral).off();
+  }
+}
+
+void acquire_power(const peripheral_set& p_set)
+{
+  peripheral_set first_users;
+  for (std::uint32_t id = 0; id < beyond_bus; id++) {
+    auto candidate = static_cast<peripheral>(id);
+    if (!p_set.contains(candidate)) {
+      continue;
+    }
+    auto& count = reference_counts[id];
+    add_reference(count);
+    if (count == 1) {
+      first_users.add(candidate);
+    }
+  }
+  enable_peripherals(first_users);
+}
+
+void release_power(const peripheral_set& p_set)
+{
+  peripheral_set last_users;
+  for (std::uint32_t id = 0; id < beyond_bus; id++) {
+    auto candidate = static_cast<peripheral>(id);
+    auto& count = reference_counts[id];
+    if (!p_set.contains(candidate) || count == 0) {
+      continue;
+    }
+    if (--count == 0) {
+      last_users.add(candidate);
+    }
+  }
+  disable_peripherals(last_users);
+}
+
+std::uint16_t power_reference_count(peripheral p_peripheral)
+{
+  if (!has_enable_bit(p_peripheral)) {
+    return 0;
+  }
+  return reference_counts[value(p_peripheral)];
+}
+
+bool is_powered(peripheral p_peripheral)
+{
+  return power(p_peripheral).is_on();
+}
+
+std::span<peripheral> enabled_peripherals(std::span<peripheral> p_buffer)
+{
+  std::size_t count = 0;
+  for (std::uint32_t id = 0; id < beyond_bus && count < p_buffer.size();
+       id++) {
+    auto candidate = static_cast<peripheral>(id);
+    if (power(candidate).is_on()) {
+      p_buffer[count++] = candidate;
+    }
+  }
+  return p_buffer.first(count);
+}
+}  // namespace hal::stm32f1
@@ -0,0 +1,62 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <cstdint>
+
+#include <libhal-util/bit.hpp>
+
+namespace hal::stm32f1 {
+/// Power control register map
+struct power_control_t
+{
+  volatile std::uint32_t cr;
+  volatile std::uint32_t csr;
+};
+
+/// Bit masks for the PWR CR register
+struct power_control_register
+{
+  /// Disable backup domain write protection
+  static constexpr auto disable_backup_write_protection = bit_mask::from<8>();
+  /// Programmable voltage detector level
+  static constexpr auto pvd_level = bit_mask::from<5, 7>();
+  /// Programmable voltage detector enable
+  static constexpr auto pvd_enable = bit_mask::from<4>();
+  /// Clear the standby flag, write only
+  static constexpr auto clear_standby_flag = bit_mask::from<3>();
+  /// Clear the wakeup flag after 2 system clock cycles, write only
+  static constexpr auto clear_wakeup_flag = bit_mask::from<2>();
+  /// Enter standby rather than stop when the CPU enters deep sleep
+  static constexpr auto power_down_deep_sleep = bit_mask::from<1>();
+  /// Put the voltage regulator in low power mode during stop mode
+  static constexpr auto low_power_deep_sleep = bit_mask::from<0>();
+};
+
+/// Bit masks for the PWR CSR register
+struct power_control_status
+{
+  /// Enable the WKUP pin (PA0) as a wakeup source from standby
+  static constexpr auto enable_wakeup_pin = bit_mask::from<8>();
+  /// Output of the programmable voltage detector
+  static constexpr auto pvd_output = bit_mask::from<2>();
+  /// Set if the device has been in standby mode
+  static constexpr auto standby_flag = bit_mask::from<1>();
+  /// Set when a wakeup event was received
+  static constexpr auto wakeup_flag = bit_mask::from<0>();
+};
+
+inline power_control_t* pwr = reinterpret_cast<power_control_t*>(0x4000'7000);
+}  // namespace hal::stm32f1
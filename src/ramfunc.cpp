@@ -0,0 +1,55 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <libhal-stm32f1/ramfunc.hpp>
+
+#include <cstdint>
+
+// Defined by linker_scripts/libhal-stm32f1/ramfunc.ld. Declared weak so that
+// applications using their own linker scripts, and the host, still link. In
+// that case every symbol resolves to null and nothing is copied.
+extern "C"
+{
+  extern std::uint32_t __ramfunc_start[] __attribute__((weak));  // NOLINT
+  extern std::uint32_t __ramfunc_end[] __attribute__((weak));    // NOLINT
+  extern std::uint32_t __ramfunc_load[] __attribute__((weak));   // NOLINT
+}
+
+namespace hal::stm32f1 {
+void initialize_ramfunc_section()
+{
+  volatile std::uint32_t* destination = __ramfunc_start;
+  const std::uint32_t* source = __ramfunc_load;
+
+  // The volatile destination keeps the compiler from replacing this loop with
+  // a call to memcpy.
+  while (destination < __ramfunc_end) {
+    *destination++ = *source++;
+  }
+}
+
+}  // namespace hal::stm32f1
+
+#if defined(__arm__)
+// Entries in .preinit_array run after .data and .bss are initialized but
+// before any static constructor, which may already call RAM functions.
+// Nothing references this object file otherwise, so ramfunc.ld names the
+// entry in an EXTERN() to keep the linker from dropping it from the archive.
+extern "C"
+{
+  [[gnu::used, gnu::section(".preinit_array")]] void (
+    *const hal_stm32f1_ramfunc_initializer)() =
+    hal::stm32f1::initialize_ramfunc_section;
+}
+#endif
@@ -16,6 +16,8 @@
 
 #include <cstdint>
 
+#include <libhal-util/bit.hpp>
+
 namespace hal::stm32f1 {
 struct reset_and_clock_control_t
 {
@@ -120,4 +122,18 @@ struct rtc_register
     return hal::bit_modify(rcc->bdcr);
   }
 };
+
+/// Bitmasks for the CSR register
+struct control_status
+{
+  /// Indicates if the LSI is ready for use
+  static constexpr auto low_speed_internal_ready = bit_mask::from<1>();
+  /// Used to enable the LSI
+  static constexpr auto low_speed_internal_enable = bit_mask::from<0>();
+
+  static auto reg()
+  {
+    return hal::bit_modify(rcc->csr);
+  }
+};
 }  // namespace hal::stm32f1
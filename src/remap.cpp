@@ -0,0 +1,85 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <libhal-stm32f1/remap.hpp>
+
+#include <cstdint>
+
+#include <libhal-stm32f1/power_domain.hpp>
+#include <libhal-util/bit.hpp>
+
+#include "pin.hpp"
+
+namespace hal::stm32f1 {
+namespace {
+constexpr auto swj_config = bit_mask::from<24, 26>();
+
+/// Last value written to MAPR. SWJ_CFG reads back as undefined, so MAPR is
+/// never read-modify-written.
+std::uint32_t mapr_shadow = 0;
+bool mapr_shadow_loaded = false;
+
+bit_mask field(const pin_remap& p_remap)
+{
+  return bit_mask{
+    .position = p_remap.position,
+    .width = p_remap.width,
+  };
+}
+
+template<typename Update>
+void update_mapr(Update p_update)
+{
+  // AFIO only needs a clock while its registers are accessed, the remap
+  // stays in effect once the clock is gated.
+  acquire_power(peripheral::afio);
+
+  if (!mapr_shadow_loaded) {
+    // Keep remaps made before the first call, such as by a bootloader
+    mapr_shadow = bit_value<std::uint32_t>(alternative_function_io->mapr)
+                    .clear(swj_config)
+                    .get();
+    mapr_shadow_loaded = true;
+  }
+
+  auto shadow = bit_value<std::uint32_t>(mapr_shadow);
+  p_update(shadow);
+  mapr_shadow = shadow.get();
+  alternative_function_io->mapr = mapr_shadow;
+
+  release_power(peripheral::afio);
+}
+}  // namespace
+
+void apply_remaps(std::span<const pin_remap> p_remaps)
+{
+  update_mapr([p_remaps](bit_value<std::uint32_t>& p_mapr) {
+    for (const auto& remap : p_remaps) {
+      p_mapr.insert(field(remap), static_cast<std::uint32_t>(remap.value));
+    }
+  });
+}
+
+void apply_remap(const pin_remap& p_remap)
+{
+  apply_remaps(std::span(&p_remap, 1));
+}
+
+void configure_debug_port(debug_port p_port)
+{
+  update_mapr([p_port](bit_value<std::uint32_t>& p_mapr) {
+    p_mapr.insert<swj_config>(static_cast<std::uint32_t>(p_port));
+  });
+}
+}  // namespace hal::stm32f1
@@ -0,0 +1,296 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <libhal-stm32f1/rtc.hpp>
+
+#include <cstdint>
+#include <utility>
+
+#include <libhal-stm32f1/clock.hpp>
+#include <libhal-stm32f1/constants.hpp>
+#include <libhal-stm32f1/interrupt.hpp>
+#include <libhal-stm32f1/low_power.hpp>
+#include <libhal-stm32f1/power_domain.hpp>
+#include <libhal-util/bit.hpp>
+#include <libhal-util/enum.hpp>
+
+#include "backup_domain.hpp"
+#include "rtc_reg.hpp"
+
+namespace hal::stm32f1 {
+namespace {
+/// PRL is 20 bits wide
+constexpr std::uint32_t max_prescaler = 0xF'FFFF;
+/// Number of RTOFF or RSF polls, both take a few cycles of the RTC clock,
+/// which is well below a millisecond at 72MHz with the slowest RTC clock
+constexpr std::uint32_t synchronization_attempts = 100'000;
+
+interrupt_handler alarm_handler = nullptr;
+interrupt_handler second_handler = nullptr;
+
+/// Wait for a CRL flag to be set, which needs a running RTC clock
+status wait_for_flag(bit_mask p_flag)
+{
+  for (std::uint32_t attempt = 0; attempt < synchronization_attempts;
+       attempt++) {
+    if (bit_extract(p_flag, rtc_reg->crl)) {
+      return hal::success();
+    }
+  }
+  return hal::new_error(std::errc::timed_out);
+}
+
+// The functions below write the RTC, which needs the backup domain write
+// access that an rtc object holds for its lifetime. Thus the interrupt
+// handlers write the RTC without touching power references.
+
+/// Write a 32-bit value split across the CNT, ALR or PRL register pairs
+status write_split(volatile std::uint32_t& p_high,
+                   volatile std::uint32_t& p_low,
+                   std::uint32_t p_value)
+{
+  HAL_CHECK(wait_for_flag(rtc_control::operation_off));
+  bit_modify(rtc_reg->crl).set<rtc_control::configuration>();
+  p_high = p_value >> 16;
+  p_low = p_value & 0xFFFF;
+  // The writes are only carried out once configuration mode is exited
+  bit_modify(rtc_reg->crl).clear<rtc_control::configuration>();
+  return wait_for_flag(rtc_control::operation_off);
+}
+
+void clear_flag(bit_mask p_flag)
+{
+  constexpr auto flags = bit_mask::from<0, 3>();
+  // The flags are cleared by writing 0, writing 1 has no effect. Writing 1 to
+  // the other flags avoids clearing one that was set after the read.
+  rtc_reg->crl = bit_value<std::uint32_t>(rtc_reg->crl)
+                   .set(flags)
+                   .clear(p_flag)
+                   .get();
+}
+
+void enable_rtc_interrupt(bit_mask p_source, bool p_enable)
+{
+  auto crh = bit_value<std::uint32_t>(rtc_reg->crh);
+  if (p_enable) {
+    crh.set(p_source);
+  } else {
+    crh.clear(p_source);
+  }
+  rtc_reg->crh = crh.get();
+}
+
+std::uint32_t read_split(const volatile std::uint32_t& p_high,
+                         const volatile std::uint32_t& p_low)
+{
+  // The low half can roll over into the high half between the two reads
+  std::uint32_t high = p_high;
+  std::uint32_t low = p_low;
+  if (std::uint32_t high_again = p_high; high_again != high) {
+    high = high_again;
+    low = p_low;
+  }
+  return ((high & 0xFFFF) << 16) | (low & 0xFFFF);
+}
+
+std::uint32_t read_counter()
+{
+  return read_split(rtc_reg->cnth, rtc_reg->cntl);
+}
+
+void acquire_rtc()
+{
+  // The APB interface to the RTC needs both of these clocks
+  acquire_power(peripheral::power);
+  acquire_power(peripheral::backup_clock);
+  acquire_backup_domain_write_access();
+}
+
+void release_rtc()
+{
+  release_backup_domain_write_access();
+  release_power(peripheral::backup_clock);
+  release_power(peripheral::power);
+}
+}  // namespace
+
+HAL_STM32F1_RAMFUNC void rtc_alarm_interrupt()
+{
+  clear_flag(rtc_control::alarm_flag);
+  clear_wakeup_pending(value(exti_line::rtc_alarm));
+  if (alarm_handler) {
+    alarm_handler();
+  }
+}
+
+HAL_STM32F1_RAMFUNC void rtc_interrupt()
+{
+  clear_flag(rtc_control::second_flag);
+  if (second_handler) {
+    second_handler();
+  }
+}
+
+result<rtc> rtc::get()
+{
+  auto clock = frequency_hz(peripheral::rtc);
+  if (clock == 0) {
+    return hal::new_error(std::errc::no_such_device);
+  }
+
+  auto prescaler = clock - 1;
+  if (prescaler > max_prescaler) {
+    return hal::new_error(std::errc::argument_out_of_domain);
+  }
+
+  acquire_rtc();
+
+  // After a reset or a stop of the APB1 clock, reads return stale values
+  // until the registers synchronize with the RTC clock domain.
+  clear_flag(rtc_control::registers_synchronized);
+  auto synchronized = wait_for_flag(rtc_control::registers_synchronized);
+
+  // Writing PRL does not disturb the counter, so a clock preserved across a
+  // reset keeps its time.
+  if (synchronized) {
+    synchronized = write_split(rtc_reg->prlh, rtc_reg->prll, prescaler);
+  }
+
+  if (!synchronized) {
+    release_rtc();
+    return hal::new_error(std::errc::timed_out);
+  }
+
+  return rtc(prescaler);
+}
+
+rtc::rtc(std::uint32_t p_prescaler)
+  : m_prescaler(p_prescaler)
+{
+}
+
+rtc::rtc(rtc&& p_other) noexcept
+  : m_prescaler(p_other.m_prescaler)
+  , m_active(std::exchange(p_other.m_active, false))
+{
+}
+
+rtc& rtc::operator=(rtc&& p_other) noexcept
+{
+  if (this != &p_other) {
+    stop();
+    m_prescaler = p_other.m_prescaler;
+    m_active = std::exchange(p_other.m_active, false);
+  }
+  return *this;
+}
+
+rtc::~rtc()
+{
+  stop();
+}
+
+void rtc::stop()
+{
+  if (!m_active) {
+    return;
+  }
+  // The interrupts are disabled while the RTC can still be written
+  enable_rtc_interrupt(rtc_interrupt_enable::alarm, false);
+  enable_rtc_interrupt(rtc_interrupt_enable::second, false);
+  alarm_handler = nullptr;
+  second_handler = nullptr;
+  release_rtc();
+  m_active = false;
+}
+
+std::uint32_t rtc::epoch()
+{
+  return read_counter();
+}
+
+rtc::timestamp rtc::now()
+{
+  std::uint32_t seconds = 0;
+  std::uint32_t divider = 0;
+
+  // Retry if the counter ticked while reading the divider, as the divider
+  // would then belong to the next second.
+  do {
+    seconds = read_counter();
+    divider = read_split(rtc_reg->divh, rtc_reg->divl);
+  } while (seconds != read_counter());
+
+  return timestamp{
+    .seconds = seconds,
+    .nanoseconds = rtc_subsecond_nanoseconds(m_prescaler, divider),
+  };
+}
+
+date_time rtc::date()
+{
+  return to_date_time(epoch());
+}
+
+status rtc::set(std::uint32_t p_epoch)
+{
+  return write_split(rtc_reg->cnth, rtc_reg->cntl, p_epoch);
+}
+
+status rtc::set(const date_time& p_date_time)
+{
+  return set(to_epoch(p_date_time));
+}
+
+status rtc::set_alarm(std::uint32_t p_epoch, interrupt_handler p_handler)
+{
+  HAL_CHECK(install_handler(irq::rtcalarm, rtc_alarm_interrupt));
+
+  HAL_CHECK(write_split(rtc_reg->alrh, rtc_reg->alrl, p_epoch));
+  alarm_handler = p_handler;
+  clear_flag(rtc_control::alarm_flag);
+
+  configure_wakeup(exti_line::rtc_alarm, exti_edge::rising);
+  enable_rtc_interrupt(rtc_interrupt_enable::alarm, true);
+  enable_interrupt(irq::rtcalarm);
+
+  return hal::success();
+}
+
+void rtc::cancel_alarm()
+{
+  enable_rtc_interrupt(rtc_interrupt_enable::alarm, false);
+  clear_flag(rtc_control::alarm_flag);
+  clear_wakeup_pending(value(exti_line::rtc_alarm));
+  alarm_handler = nullptr;
+}
+
+status rtc::on_second(interrupt_handler p_handler)
+{
+  if (!p_handler) {
+    enable_rtc_interrupt(rtc_interrupt_enable::second, false);
+    second_handler = nullptr;
+    return hal::success();
+  }
+
+  HAL_CHECK(install_handler(irq::rtc, rtc_interrupt));
+
+  second_handler = p_handler;
+  clear_flag(rtc_control::second_flag);
+  enable_rtc_interrupt(rtc_interrupt_enable::second, true);
+  enable_interrupt(irq::rtc);
+
+  return hal::success();
+}
+}  // namespace hal::stm32f1
@@ -0,0 +1,70 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <cstdint>
+
+#include <libhal-util/bit.hpp>
+
+namespace hal::stm32f1 {
+/// Real time clock register map, each register holds 16 bits
+struct real_time_clock_t
+{
+  volatile std::uint32_t crh;
+  volatile std::uint32_t crl;
+  /// Prescaler load, 20 bits split over two registers, write only
+  volatile std::uint32_t prlh;
+  volatile std::uint32_t prll;
+  /// Prescaler divider, counts down from the prescaler load value
+  volatile std::uint32_t divh;
+  volatile std::uint32_t divl;
+  volatile std::uint32_t cnth;
+  volatile std::uint32_t cntl;
+  /// Alarm, write only
+  volatile std::uint32_t alrh;
+  volatile std::uint32_t alrl;
+};
+
+/// Bit masks for the RTC CRH register
+struct rtc_interrupt_enable
+{
+  /// Overflow interrupt enable
+  static constexpr auto overflow = bit_mask::from<2>();
+  /// Alarm interrupt enable
+  static constexpr auto alarm = bit_mask::from<1>();
+  /// Second interrupt enable
+  static constexpr auto second = bit_mask::from<0>();
+};
+
+/// Bit masks for the RTC CRL register
+struct rtc_control
+{
+  /// Set while a write to the RTC registers is in progress
+  static constexpr auto operation_off = bit_mask::from<5>();
+  /// Configuration mode, required to write CNT, ALR and PRL
+  static constexpr auto configuration = bit_mask::from<4>();
+  /// Registers synchronized with the RTC clock domain
+  static constexpr auto registers_synchronized = bit_mask::from<3>();
+  /// Counter overflow flag
+  static constexpr auto overflow_flag = bit_mask::from<2>();
+  /// Alarm flag
+  static constexpr auto alarm_flag = bit_mask::from<1>();
+  /// Second flag
+  static constexpr auto second_flag = bit_mask::from<0>();
+};
+
+inline real_time_clock_t* rtc_reg =
+  reinterpret_cast<real_time_clock_t*>(0x4000'2800);
+}  // namespace hal::stm32f1
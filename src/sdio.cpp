@@ -0,0 +1,554 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <libhal-stm32f1/sdio.hpp>
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <utility>
+
+#include <libhal-stm32f1/clock.hpp>
+#include <libhal-stm32f1/constants.hpp>
+#include <libhal-stm32f1/peripheral_set.hpp>
+#include <libhal-stm32f1/power_domain.hpp>
+#include <libhal-util/bit.hpp>
+#include <libhal-util/enum.hpp>
+
+#include "dma.hpp"
+#include "pin.hpp"
+#include "sdio_reg.hpp"
+
+namespace hal::stm32f1 {
+namespace {
+/// Card identification must run at 400kHz or less
+constexpr std::uint32_t identification_rate_hz = 400'000;
+/// Number of ACMD41 attempts, about one second at 400kHz
+constexpr std::uint32_t power_up_attempts = 5'000;
+/// Number of CMD13 attempts while the card programs or erases
+constexpr std::uint32_t busy_attempts = 1'000'000;
+/// Number of DMA flag polls after the data path ends, emptying the 32 word
+/// FIFO takes far fewer
+constexpr std::uint32_t drain_attempts = 100'000;
+/// Limit of a single transfer, CNDTR counts at most 0xFFFF words
+constexpr std::uint32_t max_transfer_blocks =
+  0xFFFF * 4 / sdio_card::block_size;
+/// DBLOCKSIZE for 512 byte blocks
+constexpr std::uint32_t block_size_exponent = 9;
+
+constexpr dma_channel_select sdio_dma{ .controller = peripheral::dma2,
+                                       .channel = 4 };
+
+/// Held by a card for its lifetime
+constexpr peripheral_set sdio_power_set{ peripheral::sdio,
+                                         peripheral::gpio_c,
+                                         peripheral::gpio_d };
+
+constexpr std::array<pin_select_t, 6> sdio_pins{ {
+  { .port = 'C', .pin = 8 },
+  { .port = 'C', .pin = 9 },
+  { .port = 'C', .pin = 10 },
+  { .port = 'C', .pin = 11 },
+  { .port = 'C', .pin = 12 },
+  { .port = 'D', .pin = 2 },
+} };
+
+/// SD commands used by this driver
+namespace command {
+constexpr std::uint8_t go_idle_state = 0;
+constexpr std::uint8_t all_send_cid = 2;
+constexpr std::uint8_t send_relative_address = 3;
+constexpr std::uint8_t set_bus_width = 6;
+constexpr std::uint8_t select_card = 7;
+constexpr std::uint8_t send_interface_condition = 8;
+constexpr std::uint8_t send_csd = 9;
+constexpr std::uint8_t stop_transmission = 12;
+constexpr std::uint8_t send_status = 13;
+constexpr std::uint8_t set_block_length = 16;
+constexpr std::uint8_t read_single_block = 17;
+constexpr std::uint8_t read_multiple_block = 18;
+constexpr std::uint8_t set_write_block_erase_count = 23;
+constexpr std::uint8_t write_block = 24;
+constexpr std::uint8_t write_multiple_block = 25;
+constexpr std::uint8_t send_operating_condition = 41;
+constexpr std::uint8_t application_command = 55;
+}  // namespace command
+
+/// Values of the CMD.WAITRESP field
+enum class response : std::uint8_t
+{
+  none = 0b00,
+  short_response = 0b01,
+  long_response = 0b11,
+};
+
+/// Card status bits of the R1 response
+struct card_status
+{
+  static constexpr std::uint32_t error_bits = 0xFDF9'8008;
+  static constexpr std::uint32_t ready_for_data = 1U << 8;
+  static constexpr auto current_state = bit_mask::from<9, 12>();
+  static constexpr std::uint32_t transfer_state = 4;
+};
+
+/// OCR bits of the R3 response
+struct operating_condition
+{
+  static constexpr std::uint32_t powered_up = 1U << 31;
+  static constexpr std::uint32_t high_capacity = 1U << 30;
+  /// 3.2V to 3.4V
+  static constexpr std::uint32_t voltage_window = 0x0030'0000;
+};
+
+/// Check pattern and 2.7V to 3.6V supply of CMD8
+constexpr std::uint32_t interface_condition = 0x1AA;
+
+status send_command(std::uint8_t p_index,
+                    std::uint32_t p_argument,
+                    response p_response,
+                    bool p_check_crc = true)
+{
+  using cmd = sdio_command;
+
+  sdio_reg->icr = sdio_status::static_flags;
+  sdio_reg->arg = p_argument;
+  sdio_reg->cmd = bit_value<std::uint32_t>(0)
+                    .insert<cmd::index>(p_index)
+                    .insert<cmd::response>(value(p_response))
+                    .set<cmd::enable>()
+                    .get();
+
+  auto done = sdio_status::command_timeout | sdio_status::command_crc_fail;
+  done |= p_response == response::none ? sdio_status::command_sent
+                                       : sdio_status::command_response;
+  std::uint32_t flags = 0;
+  while (((flags = sdio_reg->sta) & done) == 0) {
+    continue;
+  }
+  sdio_reg->icr = sdio_status::static_flags;
+
+  if (flags & sdio_status::command_timeout) {
+    return hal::new_error(std::errc::timed_out);
+  }
+  // R3 has no CRC, so the controller always reports a CRC failure
+  if (p_check_crc && (flags & sdio_status::command_crc_fail)) {
+    return hal::new_error(std::errc::io_error);
+  }
+  return hal::success();
+}
+
+status send_application_command(std::uint16_t p_relative_address,
+                                std::uint8_t p_index,
+                                std::uint32_t p_argument,
+                                bool p_check_crc = true)
+{
+  HAL_CHECK(send_command(command::application_command,
+                         std::uint32_t{ p_relative_address } << 16,
+                         response::short_response));
+  return send_command(
+    p_index, p_argument, response::short_response, p_check_crc);
+}
+
+/// Send a command with an R1 response and check the card status
+status send_r1_command(std::uint8_t p_index, std::uint32_t p_argument)
+{
+  HAL_CHECK(send_command(p_index, p_argument, response::short_response));
+  if (sdio_reg->resp[0] & card_status::error_bits) {
+    return hal::new_error(std::errc::io_error);
+  }
+  return hal::success();
+}
+
+/// Wait until the card has finished programming and is ready for data
+status wait_until_ready(std::uint16_t p_relative_address)
+{
+  for (std::uint32_t attempt = 0; attempt < busy_attempts; attempt++) {
+    HAL_CHECK(send_r1_command(command::send_status,
+                              std::uint32_t{ p_relative_address } << 16));
+    auto status = sdio_reg->resp[0];
+    if ((status & card_status::ready_for_data) &&
+        bit_extract<card_status::current_state>(status) ==
+          card_status::transfer_state) {
+      return hal::success();
+    }
+  }
+  return hal::new_error(std::errc::timed_out);
+}
+
+void set_clock(std::uint8_t p_divider, bool p_wide_bus)
+{
+  using clkcr = sdio_clock_control;
+
+  sdio_reg->clkcr = bit_value<std::uint32_t>(0)
+                      .insert<clkcr::bus_width>(p_wide_bus ? 0b01U : 0b00U)
+                      .set<clkcr::enable>()
+                      .insert<clkcr::divider>(p_divider)
+                      .get();
+}
+
+/// Program the DMA channel to move a transfer between memory and the FIFO
+void start_dma(void* p_data, std::size_t p_words, bool p_to_card)
+{
+  using ccr = dma_channel_configuration;
+
+  auto& channel = dma_channel(sdio_dma);
+  // The address and count registers are read only while the channel is on
+  channel.ccr = 0;
+  clear_dma_flags(sdio_dma);
+  channel.cpar = static_cast<std::uint32_t>(
+    reinterpret_cast<std::uintptr_t>(&sdio_reg->fifo));
+  channel.cmar =
+    static_cast<std::uint32_t>(reinterpret_cast<std::uintptr_t>(p_data));
+  channel.cndtr = static_cast<std::uint32_t>(p_words);
+  channel.ccr = bit_value<std::uint32_t>(0)
+                  .insert<ccr::priority>(0b11U)
+                  .insert<ccr::memory_size>(value(dma_transfer_size::bits32))
+                  .insert<ccr::peripheral_size>(
+                    value(dma_transfer_size::bits32))
+                  .set<ccr::memory_increment>()
+                  .insert<ccr::direction>(static_cast<std::uint32_t>(p_to_card))
+                  .set<ccr::enable>()
+                  .get();
+}
+
+void start_data_path(std::size_t p_bytes, bool p_to_card)
+{
+  using dctrl = sdio_data_control;
+
+  sdio_reg->dlen = static_cast<std::uint32_t>(p_bytes);
+  sdio_reg->dctrl =
+    bit_value<std::uint32_t>(0)
+      .insert<dctrl::block_size>(block_size_exponent)
+      .set<dctrl::dma_enable>()
+      .insert<dctrl::direction>(static_cast<std::uint32_t>(!p_to_card))
+      .set<dctrl::enable>()
+      .get();
+}
+
+/// Wait for the data path to finish and check for errors
+status wait_for_data_end()
+{
+  constexpr auto done = sdio_status::data_end | sdio_status::data_errors;
+  std::uint32_t flags = 0;
+  while (((flags = sdio_reg->sta) & done) == 0) {
+    continue;
+  }
+
+  if (flags & sdio_status::data_timeout) {
+    return hal::new_error(std::errc::timed_out);
+  }
+  if (flags & sdio_status::data_errors) {
+    return hal::new_error(std::errc::io_error);
+  }
+  return hal::success();
+}
+
+/// Wait for the data path and then the DMA channel to finish
+status wait_for_transfer_end()
+{
+  HAL_CHECK(wait_for_data_end());
+
+  // DATAEND only means the card is done. On reads up to 32 words can still
+  // be in the FIFO, so the channel must not be disabled before it has moved
+  // them to memory.
+  for (std::uint32_t attempt = 0; attempt < drain_attempts; attempt++) {
+    auto flags = dma_flags_of(sdio_dma);
+    if (flags & dma_flags::transfer_error) {
+      return hal::new_error(std::errc::io_error);
+    }
+    if ((flags & dma_flags::transfer_complete) &&
+        !(sdio_reg->sta & sdio_status::receive_data_available)) {
+      return hal::success();
+    }
+  }
+  return hal::new_error(std::errc::timed_out);
+}
+
+/// Owns DMA2 channel 4 for the duration of a transfer
+class transfer_claim
+{
+public:
+  transfer_claim()
+    : m_claimed(claim_dma_channel(sdio_dma))
+  {
+  }
+
+  transfer_claim(const transfer_claim&) = delete;
+  transfer_claim& operator=(const transfer_claim&) = delete;
+
+  ~transfer_claim()
+  {
+    if (m_claimed) {
+      sdio_reg->dctrl = 0;
+      sdio_reg->icr = sdio_status::static_flags;
+      release_dma_channel(sdio_dma);
+    }
+  }
+
+  [[nodiscard]] bool claimed() const
+  {
+    return m_claimed;
+  }
+
+private:
+  bool m_claimed;
+};
+
+/// Validate a transfer and return its length in blocks
+result<std::size_t> transfer_blocks(std::uint32_t p_block,
+                                    const void* p_data,
+                                    std::size_t p_size,
+                                    std::uint32_t p_block_count)
+{
+  auto address = reinterpret_cast<std::uintptr_t>(p_data);
+  if (p_size == 0 || p_size % sdio_card::block_size != 0 ||
+      address % sizeof(std::uint32_t) != 0) {
+    return hal::new_error(std::errc::invalid_argument);
+  }
+
+  auto blocks = p_size / sdio_card::block_size;
+  if (p_block >= p_block_count || blocks > p_block_count - p_block) {
+    return hal::new_error(std::errc::invalid_argument);
+  }
+  return blocks;
+}
+
+/// Finish a multi-block transfer, even if its data failed
+status finish_transfer(std::size_t p_blocks, status p_data)
+{
+  if (p_blocks > 1) {
+    HAL_CHECK(send_r1_command(command::stop_transmission, 0));
+  }
+  return p_data;
+}
+}  // namespace
+
+result<sdio_card> sdio_card::get(sdio_settings p_settings)
+{
+  auto hclk = frequency_hz(peripheral::sdio);
+  auto slow_divider =
+    calculate_sdio_clock_divider(hclk, identification_rate_hz);
+  auto fast_divider =
+    calculate_sdio_clock_divider(hclk, to_hz(p_settings.clock_rate));
+  if (!slow_divider || !fast_divider) {
+    return hal::new_error(std::errc::argument_out_of_domain);
+  }
+
+  acquire_power(sdio_power_set);
+  // Powers the controller back down if identification fails
+  sdio_card card(0, 0, false);
+  configure_pins(sdio_pins, push_pull_alternative_output);
+
+  sdio_reg->power = sdio_power::on;
+  set_clock(*slow_divider, false);
+  sdio_reg->dtimer = 0xFFFF'FFFF;
+
+  // The card needs 74 clock cycles after power up before the first command,
+  // CMD0 itself provides enough of them.
+  HAL_CHECK(send_command(command::go_idle_state, 0, response::none));
+
+  // Only version 2.00 cards answer CMD8
+  bool version2 = false;
+  auto interface = send_command(command::send_interface_condition,
+                                interface_condition,
+                                response::short_response);
+  if (interface) {
+    if ((sdio_reg->resp[0] & 0xFFF) != interface_condition) {
+      return hal::new_error(std::errc::not_supported);
+    }
+    version2 = true;
+  }
+
+  auto request = operating_condition::voltage_window;
+  if (version2) {
+    request |= operating_condition::high_capacity;
+  }
+
+  std::uint32_t ocr = 0;
+  for (std::uint32_t attempt = 0; attempt < power_up_attempts; attempt++) {
+    auto accepted = send_application_command(
+      0, command::send_operating_condition, request, false);
+    if (!accepted) {
+      return hal::new_error(std::errc::no_such_device);
+    }
+    ocr = sdio_reg->resp[0];
+    if (ocr & operating_condition::powered_up) {
+      break;
+    }
+  }
+  if (!(ocr & operating_condition::powered_up)) {
+    return hal::new_error(std::errc::timed_out);
+  }
+  if (!(ocr & operating_condition::voltage_window)) {
+    return hal::new_error(std::errc::not_supported);
+  }
+
+  HAL_CHECK(send_command(command::all_send_cid, 0, response::long_response));
+  HAL_CHECK(send_command(
+    command::send_relative_address, 0, response::short_response));
+  auto relative_address = static_cast<std::uint16_t>(sdio_reg->resp[0] >> 16);
+  auto address_argument = std::uint32_t{ relative_address } << 16;
+
+  HAL_CHECK(
+    send_command(command::send_csd, address_argument, response::long_response));
+  std::array<std::uint32_t, 4> csd{
+    sdio_reg->resp[0],
+    sdio_reg->resp[1],
+    sdio_reg->resp[2],
+    sdio_reg->resp[3],
+  };
+
+  HAL_CHECK(send_r1_command(command::select_card, address_argument));
+  HAL_CHECK(wait_until_ready(relative_address));
+  HAL_CHECK(send_r1_command(command::set_block_length, block_size));
+
+  if (p_settings.wide_bus) {
+    constexpr std::uint32_t four_bit_bus = 0b10;
+    HAL_CHECK(send_application_command(
+      relative_address, command::set_bus_width, four_bit_bus));
+  }
+  set_clock(*fast_divider, p_settings.wide_bus);
+
+  // Allow 250ms for a block, the write timeout of SDHC cards
+  auto card_clock = frequency_hz(peripheral::sdio) / (*fast_divider + 2U);
+  sdio_reg->dtimer = card_clock / 4;
+
+  card.m_relative_address = relative_address;
+  card.m_block_count = sd_block_count(csd);
+  card.m_block_addressed = (ocr & operating_condition::high_capacity) != 0;
+  return card;
+}
+
+sdio_card::sdio_card(std::uint16_t p_relative_address,
+                     std::uint32_t p_block_count,
+                     bool p_block_addressed)
+  : m_relative_address(p_relative_address)
+  , m_block_count(p_block_count)
+  , m_block_addressed(p_block_addressed)
+{
+}
+
+sdio_card::sdio_card(sdio_card&& p_other) noexcept
+  : m_relative_address(p_other.m_relative_address)
+  , m_block_count(p_other.m_block_count)
+  , m_block_addressed(p_other.m_block_addressed)
+  , m_owner(std::exchange(p_other.m_owner, false))
+{
+}
+
+sdio_card& sdio_card::operator=(sdio_card&& p_other) noexcept
+{
+  if (this != &p_other) {
+    release();
+    m_relative_address = p_other.m_relative_address;
+    m_block_count = p_other.m_block_count;
+    m_block_addressed = p_other.m_block_addressed;
+    m_owner = std::exchange(p_other.m_owner, false);
+  }
+  return *this;
+}
+
+sdio_card::~sdio_card()
+{
+  release();
+}
+
+void sdio_card::release()
+{
+  // A moved from card holds no reference
+  if (!m_owner) {
+    return;
+  }
+
+  sdio_reg->clkcr = 0;
+  sdio_reg->power = sdio_power::off;
+  release_power(sdio_power_set);
+  m_owner = false;
+}
+
+status sdio_card::read(std::uint32_t p_block, std::span<hal::byte> p_data)
+{
+  auto blocks =
+    HAL_CHECK(transfer_blocks(
+      p_block, p_data.data(), p_data.size(), m_block_count));
+  transfer_claim claim;
+  if (!claim.claimed()) {
+    return hal::new_error(std::errc::device_or_resource_busy);
+  }
+
+  while (blocks != 0) {
+    auto count = std::min<std::size_t>(blocks, max_transfer_blocks);
+    auto bytes = count * block_size;
+    auto address = m_block_addressed ? p_block : p_block * block_size;
+
+    // Reads must have the data path armed before the command is sent
+    start_dma(p_data.data(), bytes / sizeof(std::uint32_t), false);
+    start_data_path(bytes, false);
+
+    auto index =
+      count == 1 ? command::read_single_block : command::read_multiple_block;
+    HAL_CHECK(send_r1_command(index, address));
+    HAL_CHECK(finish_transfer(count, wait_for_transfer_end()));
+
+    p_block += count;
+    blocks -= count;
+    p_data = p_data.subspan(bytes);
+  }
+
+  return hal::success();
+}
+
+status sdio_card::write(std::uint32_t p_block,
+                        std::span<const hal::byte> p_data)
+{
+  auto blocks =
+    HAL_CHECK(transfer_blocks(
+      p_block, p_data.data(), p_data.size(), m_block_count));
+  transfer_claim claim;
+  if (!claim.claimed()) {
+    return hal::new_error(std::errc::device_or_resource_busy);
+  }
+
+  while (blocks != 0) {
+    auto count = std::min<std::size_t>(blocks, max_transfer_blocks);
+    auto bytes = count * block_size;
+    auto address = m_block_addressed ? p_block : p_block * block_size;
+
+    if (count > 1) {
+      // Lets the card erase the whole range ahead of the data
+      HAL_CHECK(send_application_command(m_relative_address,
+                                         command::set_write_block_erase_count,
+                                         static_cast<std::uint32_t>(count)));
+    }
+
+    auto index =
+      count == 1 ? command::write_block : command::write_multiple_block;
+    HAL_CHECK(send_r1_command(index, address));
+
+    // Writes arm the data path once the card has accepted the command
+    start_dma(const_cast<hal::byte*>(p_data.data()),
+              bytes / sizeof(std::uint32_t),
+              true);
+    start_data_path(bytes, true);
+    HAL_CHECK(finish_transfer(count, wait_for_transfer_end()));
+    HAL_CHECK(wait_until_ready(m_relative_address));
+
+    p_block += count;
+    blocks -= count;
+    p_data = p_data.subspan(bytes);
+  }
+
+  return hal::success();
+}
+}  // namespace hal::stm32f1
@@ -0,0 +1,121 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <array>
+#include <cstdint>
+
+#include <libhal-util/bit.hpp>
+
+namespace hal::stm32f1 {
+/// SDIO register map
+struct sdio_t
+{
+  volatile std::uint32_t power;
+  volatile std::uint32_t clkcr;
+  volatile std::uint32_t arg;
+  volatile std::uint32_t cmd;
+  volatile std::uint32_t respcmd;
+  std::array<volatile std::uint32_t, 4> resp;
+  volatile std::uint32_t dtimer;
+  volatile std::uint32_t dlen;
+  volatile std::uint32_t dctrl;
+  volatile std::uint32_t dcount;
+  volatile std::uint32_t sta;
+  volatile std::uint32_t icr;
+  volatile std::uint32_t mask;
+  std::array<std::uint32_t, 2> reserved0;
+  volatile std::uint32_t fifocnt;
+  std::array<std::uint32_t, 13> reserved1;
+  volatile std::uint32_t fifo;
+};
+
+/// Values of the POWER register
+struct sdio_power
+{
+  static constexpr std::uint32_t off = 0b00;
+  static constexpr std::uint32_t on = 0b11;
+};
+
+/// Bit masks for the CLKCR register
+struct sdio_clock_control
+{
+  /// Hardware flow control, unusable on the stm32f1 due to an erratum
+  static constexpr auto flow_control = bit_mask::from<14>();
+  /// Bus width, 0b00 = 1-bit, 0b01 = 4-bit
+  static constexpr auto bus_width = bit_mask::from<11, 12>();
+  /// Drive SDIO_CK with SDIOCLK directly
+  static constexpr auto bypass = bit_mask::from<10>();
+  /// Only clock the card while the bus is active
+  static constexpr auto power_save = bit_mask::from<9>();
+  /// Clock enable
+  static constexpr auto enable = bit_mask::from<8>();
+  /// SDIO_CK = SDIOCLK / (divider + 2)
+  static constexpr auto divider = bit_mask::from<0, 7>();
+};
+
+/// Bit masks for the CMD register
+struct sdio_command
+{
+  /// Command path state machine enable, sends the command
+  static constexpr auto enable = bit_mask::from<10>();
+  /// Response type, 0b00 = none, 0b01 = short, 0b11 = long
+  static constexpr auto response = bit_mask::from<6, 7>();
+  /// Command index
+  static constexpr auto index = bit_mask::from<0, 5>();
+};
+
+/// Bit masks for the DCTRL register
+struct sdio_data_control
+{
+  /// Data block size as a power of two
+  static constexpr auto block_size = bit_mask::from<4, 7>();
+  /// DMA request enable
+  static constexpr auto dma_enable = bit_mask::from<3>();
+  /// 0 = block transfer, 1 = stream transfer
+  static constexpr auto stream_mode = bit_mask::from<2>();
+  /// 0 = controller to card, 1 = card to controller
+  static constexpr auto direction = bit_mask::from<1>();
+  /// Data transfer enable
+  static constexpr auto enable = bit_mask::from<0>();
+};
+
+/// Bits of the STA, ICR and MASK registers
+struct sdio_status
+{
+  static constexpr std::uint32_t receive_data_available = 1U << 21;
+  static constexpr std::uint32_t transmit_active = 1U << 12;
+  static constexpr std::uint32_t receive_active = 1U << 13;
+  static constexpr std::uint32_t data_block_end = 1U << 10;
+  static constexpr std::uint32_t start_bit_error = 1U << 9;
+  static constexpr std::uint32_t data_end = 1U << 8;
+  static constexpr std::uint32_t command_sent = 1U << 7;
+  static constexpr std::uint32_t command_response = 1U << 6;
+  static constexpr std::uint32_t receive_overrun = 1U << 5;
+  static constexpr std::uint32_t transmit_underrun = 1U << 4;
+  static constexpr std::uint32_t data_timeout = 1U << 3;
+  static constexpr std::uint32_t command_timeout = 1U << 2;
+  static constexpr std::uint32_t data_crc_fail = 1U << 1;
+  static constexpr std::uint32_t command_crc_fail = 1U << 0;
+  /// Every flag that is cleared through ICR
+  static constexpr std::uint32_t static_flags = 0x00C0'07FF;
+  /// Flags ending a data transfer with an error
+  static constexpr std::uint32_t data_errors =
+    start_bit_error | receive_overrun | transmit_underrun | data_timeout |
+    data_crc_fail;
+};
+
+inline sdio_t* sdio_reg = reinterpret_cast<sdio_t*>(0x4001'8000);
+}  // namespace hal::stm32f1
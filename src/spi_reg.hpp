@@ -0,0 +1,79 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <cstdint>
+
+#include <libhal-util/bit.hpp>
+
+namespace hal::stm32f1 {
+/// SPI and I2S register map
+struct spi_t
+{
+  volatile std::uint32_t cr1;
+  volatile std::uint32_t cr2;
+  volatile std::uint32_t sr;
+  volatile std::uint32_t dr;
+  volatile std::uint32_t crcpr;
+  volatile std::uint32_t rxcrcr;
+  volatile std::uint32_t txcrcr;
+  volatile std::uint32_t i2scfgr;
+  volatile std::uint32_t i2spr;
+};
+
+/// Bit masks for the CR2 register
+struct spi_control2
+{
+  /// Request DMA when the transmit buffer is empty
+  static constexpr auto transmit_dma = bit_mask::from<1>();
+  /// Request DMA when the receive buffer is not empty
+  static constexpr auto receive_dma = bit_mask::from<0>();
+};
+
+/// Bit masks for the I2SCFGR register
+struct i2s_configuration
+{
+  /// Select I2S mode instead of SPI mode
+  static constexpr auto i2s_mode = bit_mask::from<11>();
+  /// I2S enable
+  static constexpr auto enable = bit_mask::from<10>();
+  /// Master or slave, transmit or receive
+  static constexpr auto mode = bit_mask::from<8, 9>();
+  /// PCM frame synchronization, 0 = short frame, 1 = long frame
+  static constexpr auto pcm_long_frame = bit_mask::from<7>();
+  /// Audio standard
+  static constexpr auto standard = bit_mask::from<4, 5>();
+  /// Clock idles high
+  static constexpr auto clock_polarity = bit_mask::from<3>();
+  /// Data length, 0b00 = 16-bits, 0b01 = 24-bits, 0b10 = 32-bits
+  static constexpr auto data_length = bit_mask::from<1, 2>();
+  /// Channel length, 0 = 16-bits, 1 = 32-bits
+  static constexpr auto channel_length = bit_mask::from<0>();
+};
+
+/// Bit masks for the I2SPR register
+struct i2s_prescaler
+{
+  /// Output the master clock on MCK
+  static constexpr auto master_clock_output = bit_mask::from<9>();
+  /// Adds 1 to the divider
+  static constexpr auto odd = bit_mask::from<8>();
+  /// Linear prescaler, the clock is divided by 2 * divider + odd
+  static constexpr auto divider = bit_mask::from<0, 7>();
+};
+
+inline spi_t* spi2_reg = reinterpret_cast<spi_t*>(0x4000'3800);
+inline spi_t* spi3_reg = reinterpret_cast<spi_t*>(0x4000'3C00);
+}  // namespace hal::stm32f1
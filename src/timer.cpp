@@ -0,0 +1,126 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "timer.hpp"
+
+#include <cstdint>
+#include <optional>
+
+#include <libhal-stm32f1/peripheral_set.hpp>
+#include <libhal-stm32f1/power_domain.hpp>
+#include <libhal-util/bit.hpp>
+
+#include "basic_timer_reg.hpp"
+#include "dma.hpp"
+
+namespace hal::stm32f1 {
+namespace {
+peripheral_set claimed_timers;
+}  // namespace
+
+basic_timer_t& timer_registers(peripheral p_timer)
+{
+  static basic_timer_t out_of_bounds_result{};
+
+  switch (p_timer) {
+    case peripheral::timer1:
+      return *timer1_reg;
+    case peripheral::timer2:
+      return *timer2_reg;
+    case peripheral::timer3:
+      return *timer3_reg;
+    case peripheral::timer4:
+      return *timer4_reg;
+    case peripheral::timer5:
+      return *timer5_reg;
+    case peripheral::timer6:
+      return *timer6_reg;
+    case peripheral::timer7:
+      return *timer7_reg;
+    case peripheral::timer8:
+      return *timer8_reg;
+    default:
+      return out_of_bounds_result;
+  }
+}
+
+std::optional<dma_channel_select> timer_update_dma(peripheral p_timer)
+{
+  // TIMx_UP request lines, see the DMA request tables of RM0008
+  auto select = [](peripheral p_controller, std::uint8_t p_channel) {
+    return dma_channel_select{ .controller = p_controller,
+                               .channel = p_channel };
+  };
+
+  switch (p_timer) {
+    case peripheral::timer1:
+      return select(peripheral::dma1, 5);
+    case peripheral::timer2:
+      return select(peripheral::dma1, 2);
+    case peripheral::timer3:
+      return select(peripheral::dma1, 3);
+    case peripheral::timer4:
+      return select(peripheral::dma1, 7);
+    case peripheral::timer5:
+      return select(peripheral::dma2, 2);
+    case peripheral::timer6:
+      return select(peripheral::dma2, 3);
+    case peripheral::timer7:
+      return select(peripheral::dma2, 4);
+    case peripheral::timer8:
+      return select(peripheral::dma2, 1);
+    default:
+      return std::nullopt;
+  }
+}
+
+bool claim_timer(peripheral p_timer)
+{
+  if (!timer_update_dma(p_timer) || claimed_timers.contains(p_timer)) {
+    return false;
+  }
+  claimed_timers.add(p_timer);
+  acquire_power(p_timer);
+  return true;
+}
+
+void load_timer_timing(peripheral p_timer, basic_timer_timing p_timing)
+{
+  auto& reg = timer_registers(p_timer);
+  reg.cr1 = 0;
+  reg.psc = p_timing.prescaler;
+  reg.arr = p_timing.reload;
+  // PSC is buffered, the update event loads it before the first period
+  reg.egr = bit_value<std::uint32_t>(0).set<basic_timer_event::update>().get();
+  reg.sr = 0;
+}
+
+void start_timer(peripheral p_timer)
+{
+  bit_modify(timer_registers(p_timer).cr1)
+    .set<basic_timer_control1::enable>();
+}
+
+void release_timer(peripheral p_timer)
+{
+  if (!claimed_timers.contains(p_timer)) {
+    return;
+  }
+  auto& reg = timer_registers(p_timer);
+  reg.cr1 = 0;
+  reg.dier = 0;
+  claimed_timers.remove(p_timer);
+  release_power(p_timer);
+}
+}  // namespace hal::stm32f1
@@ -0,0 +1,79 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <cstdint>
+#include <optional>
+
+#include <libhal-stm32f1/constants.hpp>
+#include <libhal-stm32f1/timer.hpp>
+
+#include "basic_timer_reg.hpp"
+#include "dma.hpp"
+
+namespace hal::stm32f1 {
+/**
+ * @brief Returns the time base registers of a timer
+ *
+ * @param p_timer - one of peripheral::timer1 to peripheral::timer8
+ * @return basic_timer_t& - timer registers, or a dummy block for any other
+ * peripheral
+ */
+basic_timer_t& timer_registers(peripheral p_timer);
+
+/**
+ * @brief Returns the DMA channel serving a timer's update request
+ *
+ * @param p_timer - timer
+ * @return std::optional<dma_channel_select> - channel or nothing if the
+ * peripheral is not one of timer1 to timer8
+ */
+std::optional<dma_channel_select> timer_update_dma(peripheral p_timer);
+
+/**
+ * @brief Claim exclusive use of a timer
+ *
+ * Acquires power for the timer until it is released.
+ *
+ * @param p_timer - one of peripheral::timer1 to peripheral::timer8
+ * @return true - the timer is now owned by the caller
+ * @return false - the timer is already in use or does not exist
+ */
+[[nodiscard]] bool claim_timer(peripheral p_timer);
+
+/**
+ * @brief Program the time base of a stopped timer
+ *
+ * Generates an update event so the prescaler applies from the first period.
+ *
+ * @param p_timer - claimed timer
+ * @param p_timing - prescaler and reload values
+ */
+void load_timer_timing(peripheral p_timer, basic_timer_timing p_timing);
+
+/**
+ * @brief Start the counter of a timer
+ *
+ * @param p_timer - claimed timer
+ */
+void start_timer(peripheral p_timer);
+
+/**
+ * @brief Stop a timer, disable its requests and return it to the pool
+ *
+ * @param p_timer - timer to release
+ */
+void release_timer(peripheral p_timer);
+}  // namespace hal::stm32f1
@@ -0,0 +1,152 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <libhal-stm32f1/watchdog.hpp>
+
+#include <bit>
+#include <cstdint>
+
+#include <libhal-stm32f1/clock.hpp>
+#include <libhal-stm32f1/constants.hpp>
+#include <libhal-stm32f1/power_domain.hpp>
+#include <libhal-util/bit.hpp>
+
+#include "watchdog_reg.hpp"
+
+namespace hal::stm32f1 {
+result<independent_watchdog> independent_watchdog::get(
+  hal::time_duration p_timeout)
+{
+  auto timing = calculate_independent_watchdog_timing(p_timeout);
+  if (!timing) {
+    return hal::new_error(std::errc::argument_out_of_domain);
+  }
+
+  // Starting the watchdog also starts the LSI
+  iwdg->kr = independent_watchdog_key::start;
+  iwdg->kr = independent_watchdog_key::unlock;
+  iwdg->pr = timing->prescaler;
+  iwdg->rlr = timing->reload;
+
+  // The new values cross into the LSI clock domain, which takes a few LSI
+  // cycles. Reloading before then would use the old reload value.
+  while (iwdg->sr != 0) {
+    continue;
+  }
+
+  iwdg->kr = independent_watchdog_key::reload;
+
+  return independent_watchdog();
+}
+
+void independent_watchdog::feed()
+{
+  iwdg->kr = independent_watchdog_key::reload;
+}
+
+result<window_watchdog> window_watchdog::get(settings p_settings)
+{
+  using cfr = window_watchdog_configuration;
+  using cr = window_watchdog_control;
+
+  auto timing =
+    calculate_window_watchdog_timing(p_settings.timeout,
+                                     p_settings.earliest_feed,
+                                     frequency_hz(peripheral::window_watchdog));
+  if (!timing) {
+    return hal::new_error(std::errc::argument_out_of_domain);
+  }
+
+  // Held forever, as the window watchdog cannot be stopped. Taken once, so
+  // calling get() again to change the timing does not count up.
+  static bool powered = false;
+  if (!powered) {
+    acquire_power(peripheral::window_watchdog);
+    powered = true;
+  }
+
+  wwdg->cfr = bit_value<std::uint32_t>(0)
+                .insert<cfr::timer_base>(timing->timer_base)
+                .insert<cfr::window>(timing->window)
+                .get();
+  wwdg->cr = bit_value<std::uint32_t>(0)
+               .set<cr::activate>()
+               .insert<cr::counter>(timing->counter)
+               .get();
+
+  return window_watchdog(timing->counter);
+}
+
+window_watchdog::window_watchdog(std::uint8_t p_counter)
+  : m_counter(p_counter)
+{
+}
+
+void window_watchdog::feed()
+{
+  // WDGA can't be cleared, so writing it back along with the counter is
+  // harmless and saves a read-modify-write.
+  wwdg->cr = bit_value<std::uint32_t>(0)
+               .set<window_watchdog_control::activate>()
+               .insert<window_watchdog_control::counter>(m_counter)
+               .get();
+}
+
+watchdog_check_in::task::task(std::atomic<std::uint32_t>* p_flags,
+                              std::uint32_t p_bit)
+#if defined(__arm__)
+  // NOLINTNEXTLINE(performance-no-int-to-ptr)
+  : m_alias(reinterpret_cast<volatile std::uint32_t*>(
+      sram_bit_band_alias(reinterpret_cast<std::uintptr_t>(p_flags), p_bit)))
+#else
+  : m_flags(p_flags)
+  , m_mask(1U << p_bit)
+#endif
+{
+}
+
+result<watchdog_check_in::task> watchdog_check_in::add_task()
+{
+  if (m_registered == ~std::uint32_t{ 0 }) {
+    return hal::new_error(std::errc::resource_unavailable_try_again);
+  }
+
+  auto bit = static_cast<std::uint32_t>(std::countr_one(m_registered));
+  m_registered |= 1U << bit;
+  return task(&m_flags, bit);
+}
+
+bool watchdog_check_in::ready() const
+{
+  return (m_flags.load(std::memory_order_relaxed) & m_registered) ==
+         m_registered;
+}
+
+void watchdog_check_in::clear()
+{
+  // Clear each bit on its own so that a check-in by another task while this
+  // runs is not lost to a read-modify-write of the whole word.
+  for (std::uint32_t bit = 0; bit < 32; bit++) {
+    if (m_registered & (1U << bit)) {
+#if defined(__arm__)
+      // NOLINTNEXTLINE(performance-no-int-to-ptr)
+      *reinterpret_cast<volatile std::uint32_t*>(sram_bit_band_alias(
+        reinterpret_cast<std::uintptr_t>(&m_flags), bit)) = 0;
+#else
+      m_flags.fetch_and(~(1U << bit), std::memory_order_relaxed);
+#endif
+    }
+  }
+}
+}  // namespace hal::stm32f1
@@ -0,0 +1,86 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <cstdint>
+
+#include <libhal-util/bit.hpp>
+
+namespace hal::stm32f1 {
+/// Independent watchdog register map
+struct independent_watchdog_t
+{
+  /// Key register, write only
+  volatile std::uint32_t kr;
+  /// Prescaler register, divides the LSI by 4 << PR
+  volatile std::uint32_t pr;
+  /// 12-bit reload register
+  volatile std::uint32_t rlr;
+  volatile std::uint32_t sr;
+};
+
+/// Values written to the IWDG key register
+struct independent_watchdog_key
+{
+  /// Reload the counter with RLR
+  static constexpr std::uint32_t reload = 0xAAAA;
+  /// Allow writes to PR and RLR
+  static constexpr std::uint32_t unlock = 0x5555;
+  /// Start the watchdog, it cannot be stopped afterwards
+  static constexpr std::uint32_t start = 0xCCCC;
+};
+
+/// Bit masks for the IWDG SR register
+struct independent_watchdog_status
+{
+  /// A reload value update is in progress
+  static constexpr auto reload_update = bit_mask::from<1>();
+  /// A prescaler value update is in progress
+  static constexpr auto prescaler_update = bit_mask::from<0>();
+};
+
+/// Window watchdog register map
+struct window_watchdog_t
+{
+  volatile std::uint32_t cr;
+  volatile std::uint32_t cfr;
+  volatile std::uint32_t sr;
+};
+
+/// Bit masks for the WWDG CR register
+struct window_watchdog_control
+{
+  /// Enable the watchdog, can only be cleared by a reset
+  static constexpr auto activate = bit_mask::from<7>();
+  /// 7-bit down counter, a reset occurs when bit 6 becomes 0
+  static constexpr auto counter = bit_mask::from<0, 6>();
+};
+
+/// Bit masks for the WWDG CFR register
+struct window_watchdog_configuration
+{
+  /// Early wakeup interrupt enable
+  static constexpr auto early_wakeup_interrupt = bit_mask::from<9>();
+  /// Divides (PCLK1 / 4096) by 1 << WDGTB
+  static constexpr auto timer_base = bit_mask::from<7, 8>();
+  /// Refreshing while the counter is above this value causes a reset
+  static constexpr auto window = bit_mask::from<0, 6>();
+};
+
+inline independent_watchdog_t* iwdg =
+  reinterpret_cast<independent_watchdog_t*>(0x4000'3000);
+inline window_watchdog_t* wwdg =
+  reinterpret_cast<window_watchdog_t*>(0x4000'2C00);
+}  // namespace hal::stm32f1
@@ -0,0 +1,174 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <libhal-stm32f1/waveform.hpp>
+
+#include <cstdint>
+#include <optional>
+#include <utility>
+
+#include <libhal-stm32f1/clock.hpp>
+#include <libhal-stm32f1/constants.hpp>
+#include <libhal-stm32f1/pin.hpp>
+#include <libhal-util/bit.hpp>
+#include <libhal-util/enum.hpp>
+
+#include "basic_timer_reg.hpp"
+#include "dma.hpp"
+#include "pin.hpp"
+#include "timer.hpp"
+
+namespace hal::stm32f1 {
+namespace {
+/// CNDTR is 16 bits wide
+constexpr std::size_t max_waveform_length = 0xFFFF;
+
+void start_dma(dma_channel_select p_select,
+               volatile std::uint32_t& p_target,
+               std::span<const std::uint32_t> p_words,
+               bool p_repeat)
+{
+  using ccr = dma_channel_configuration;
+
+  auto& channel = dma_channel(p_select);
+  clear_dma_flags(p_select);
+  channel.cpar =
+    static_cast<std::uint32_t>(reinterpret_cast<std::uintptr_t>(&p_target));
+  channel.cmar = static_cast<std::uint32_t>(
+    reinterpret_cast<std::uintptr_t>(p_words.data()));
+  channel.cndtr = static_cast<std::uint32_t>(p_words.size());
+
+  // Very high priority keeps other channels from delaying the edges
+  channel.ccr =
+    bit_value<std::uint32_t>(0)
+      .insert<ccr::priority>(0b11U)
+      .insert<ccr::memory_size>(value(dma_transfer_size::bits32))
+      .insert<ccr::peripheral_size>(value(dma_transfer_size::bits32))
+      .set<ccr::memory_increment>()
+      .insert<ccr::circular>(static_cast<std::uint32_t>(p_repeat))
+      .set<ccr::direction>()
+      .set<ccr::enable>()
+      .get();
+}
+}  // namespace
+
+result<gpio_waveform> gpio_waveform::get(std::uint8_t p_port,
+                                         std::uint16_t p_pins)
+{
+  pin_map pins;
+  for (std::uint8_t pin = 0; pin < 16; pin++) {
+    if (p_pins & (1U << pin)) {
+      pins.add({ .port = p_port, .pin = pin }, push_pull_gpio_output);
+    }
+  }
+  if (p_port < 'A' || p_port >= 'A' + gpio_port_count || !pins.valid()) {
+    return hal::new_error(std::errc::invalid_argument);
+  }
+
+  apply_pin_map(pins);
+
+  return gpio_waveform(p_port);
+}
+
+gpio_waveform::gpio_waveform(std::uint8_t p_port)
+  : m_port(p_port)
+{
+}
+
+gpio_waveform::gpio_waveform(gpio_waveform&& p_other) noexcept
+  : m_port(p_other.m_port)
+  , m_timer(std::exchange(p_other.m_timer, std::nullopt))
+  , m_repeat(p_other.m_repeat)
+{
+}
+
+gpio_waveform& gpio_waveform::operator=(gpio_waveform&& p_other) noexcept
+{
+  if (this != &p_other) {
+    stop();
+    m_port = p_other.m_port;
+    m_timer = std::exchange(p_other.m_timer, std::nullopt);
+    m_repeat = p_other.m_repeat;
+  }
+  return *this;
+}
+
+gpio_waveform::~gpio_waveform()
+{
+  stop();
+}
+
+status gpio_waveform::play(std::span<const std::uint32_t> p_words,
+                           waveform_settings p_settings)
+{
+  stop();
+
+  auto select = timer_update_dma(p_settings.timer);
+  if (p_words.empty() || p_words.size() > max_waveform_length || !select) {
+    return hal::new_error(std::errc::invalid_argument);
+  }
+
+  auto timing = calculate_basic_timer_timing(to_hz(p_settings.step_rate),
+                                             frequency_hz(p_settings.timer));
+  if (!timing) {
+    return hal::new_error(std::errc::argument_out_of_domain);
+  }
+
+  if (!claim_timer(p_settings.timer)) {
+    return hal::new_error(std::errc::device_or_resource_busy);
+  }
+  if (!claim_dma_channel(*select)) {
+    release_timer(p_settings.timer);
+    return hal::new_error(std::errc::device_or_resource_busy);
+  }
+  m_timer = p_settings.timer;
+  m_repeat = p_settings.repeat;
+
+  // The update event generated while loading the timing would request a
+  // transfer, so requests are only enabled once it has passed.
+  load_timer_timing(p_settings.timer, *timing);
+  start_dma(*select, gpio(m_port).bsrr, p_words, p_settings.repeat);
+  timer_registers(p_settings.timer).dier =
+    bit_value<std::uint32_t>(0)
+      .set<basic_timer_interrupt_enable::update_dma>()
+      .get();
+  start_timer(p_settings.timer);
+
+  return hal::success();
+}
+
+std::size_t gpio_waveform::remaining()
+{
+  if (!m_timer) {
+    return 0;
+  }
+  return dma_channel(*timer_update_dma(*m_timer)).cndtr & 0xFFFF;
+}
+
+bool gpio_waveform::done()
+{
+  return !m_timer || (!m_repeat && remaining() == 0);
+}
+
+void gpio_waveform::stop()
+{
+  if (!m_timer) {
+    return;
+  }
+
+  release_timer(*m_timer);
+  release_dma_channel(*timer_update_dma(*m_timer));
+  m_timer.reset();
+}
+}  // namespace hal::stm32f1
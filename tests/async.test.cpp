@@ -0,0 +1,157 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <libhal-stm32f1/async.hpp>
+
+#include <array>
+#include <cstdint>
+
+#include <boost/ut.hpp>
+
+namespace hal::stm32f1 {
+namespace {
+std::array<completion, 2> transfers;
+std::array<int, 8> events{};
+std::size_t event_count = 0;
+std::size_t idle_calls = 0;
+
+void record(int p_event)
+{
+  events[event_count++] = p_event;
+}
+
+/// Stands in for the DMA interrupts, which complete one transfer each time
+/// the executor goes idle, the second one first.
+void simulated_interrupts()
+{
+  idle_calls++;
+  if (idle_calls == 1) {
+    transfers[1].signal();
+  } else if (idle_calls == 2) {
+    transfers[0].signal();
+  }
+}
+
+task wait_for_transfer(std::size_t p_index, int p_event)
+{
+  co_await transfers[p_index];
+  record(p_event);
+}
+
+task wait_for_both()
+{
+  record(1);
+  co_await wait_for_transfer(0, 2);
+  co_await transfers[1];
+  record(3);
+}
+
+task count_to_three(int& p_count)
+{
+  p_count++;
+  co_await transfers[0];
+  p_count++;
+  co_await transfers[0];
+  p_count++;
+}
+
+task oversized()
+{
+  std::array<std::uint8_t, task_frame_size * 2> buffer{};
+  co_await transfers[0];
+  buffer[0]++;
+}
+}  // namespace
+
+void async_test()
+{
+  using namespace boost::ut;
+
+  "hal::stm32f1::executor::run with simulated interrupts"_test = []() {
+    for (auto& transfer : transfers) {
+      transfer.reset();
+    }
+    event_count = 0;
+    idle_calls = 0;
+
+    executor tasks;
+    expect(tasks.spawn(wait_for_transfer(1, 10)));
+    expect(tasks.spawn(wait_for_both()));
+    expect(2 == tasks.tasks());
+
+    tasks.run(simulated_interrupts);
+
+    // Transfer 1 finished first, transfer 0 resumed the nested task, which
+    // resumed its parent. Transfer 1 was already done by then.
+    expect(4 == event_count);
+    expect(1 == events[0]);
+    expect(10 == events[1]);
+    expect(2 == events[2]);
+    expect(3 == events[3]);
+    expect(2 == idle_calls);
+    expect(0 == tasks.tasks());
+    expect(0 == task_frames_in_use());
+  };
+
+  "hal::stm32f1::completion reset and wait"_test = []() {
+    transfers[0].reset();
+    int count = 0;
+
+    executor tasks;
+    expect(tasks.spawn(count_to_three(count)));
+    expect(tasks.run_ready());
+    expect(1 == count);
+    expect(!tasks.run_ready());
+
+    // Signaled twice without a reset, the second await does not suspend
+    transfers[0].signal();
+    expect(tasks.run_ready());
+    expect(3 == count);
+    expect(0 == tasks.tasks());
+
+    expect(transfers[0].done());
+    transfers[0].wait();
+    transfers[0].reset();
+    expect(!transfers[0].done());
+  };
+
+  "hal::stm32f1::task frame pool"_test = []() {
+    transfers[0].reset();
+    expect(!oversized().valid());
+
+    int count = 0;
+    std::array<task, task_frame_count> pending{};
+    for (auto& entry : pending) {
+      entry = count_to_three(count);
+      expect(entry.valid());
+    }
+    expect(task_frame_count == task_frames_in_use());
+
+    // Every frame is in use
+    auto extra = count_to_three(count);
+    expect(!extra.valid());
+    executor tasks;
+    expect(!tasks.spawn(std::move(extra)));
+
+    pending[0] = task{};
+    expect(task_frame_count - 1 == task_frames_in_use());
+    expect(tasks.spawn(count_to_three(count)));
+
+    for (auto& entry : pending) {
+      entry = task{};
+    }
+    expect(1 == task_frames_in_use());
+  };
+}
+}  // namespace hal::stm32f1
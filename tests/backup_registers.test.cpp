@@ -0,0 +1,107 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <libhal-stm32f1/backup_registers.hpp>
+
+#include <array>
+
+#include "../src/bkp_reg.hpp"
+#include "../src/pwr_reg.hpp"
+#include "../src/rcc_reg.hpp"
+#include "helper.hpp"
+
+#include <boost/ut.hpp>
+
+namespace hal::stm32f1 {
+namespace {
+struct boot_state
+{
+  std::uint8_t reason;
+  std::uint8_t clock_profile;
+  std::uint32_t boot_count;
+};
+
+using boot_state_store = backup_value<boot_state, 0>;
+using calibration_store =
+  backup_value<std::uint16_t, boot_state_store::end_register>;
+
+static_assert(5 == boot_state_store::register_count);
+static_assert(7 == calibration_store::end_register);
+// Cleared registers must not hold a valid value
+static_assert(0 != backup_check_word(std::array<std::uint16_t, 4>{}));
+}  // namespace
+
+void backup_registers_test()
+{
+  using namespace boost::ut;
+
+  "hal::stm32f1::backup_value store and load"_test = []() {
+    stub_out_registers bkp_stub(&bkp);
+    stub_out_registers pwr_stub(&pwr);
+    stub_out_registers rcc_stub(&rcc);
+
+    expect(!boot_state_store::load().has_value());
+    expect(!calibration_store::load().has_value());
+
+    boot_state_store::store(
+      boot_state{ .reason = 3, .clock_profile = 1, .boot_count = 0x1234'5678 });
+    calibration_store::store(0xBEEF);
+
+    auto state = boot_state_store::load();
+    expect(state.has_value());
+    expect(3 == state->reason);
+    expect(1 == state->clock_profile);
+    expect(0x1234'5678 == state->boot_count);
+    expect(0xBEEF == calibration_store::load().value_or(0));
+
+    // Write protection and clocks are released after the writes
+    expect(0 == pwr->cr);
+    expect(0 == rcc->apb1enr);
+
+    calibration_store::clear();
+    expect(!calibration_store::load().has_value());
+  };
+
+  "hal::stm32f1::backup_value detects corruption"_test = []() {
+    stub_out_registers bkp_stub(&bkp);
+    stub_out_registers pwr_stub(&pwr);
+    stub_out_registers rcc_stub(&rcc);
+
+    calibration_store::store(0x0042);
+    bkp->dr1[5] = bkp->dr1[5] ^ 0x0100;
+
+    expect(!calibration_store::load().has_value());
+  };
+
+  "hal::stm32f1::read_backup_registers spans both banks"_test = []() {
+    stub_out_registers bkp_stub(&bkp);
+    stub_out_registers pwr_stub(&pwr);
+    stub_out_registers rcc_stub(&rcc);
+
+    std::array<std::uint16_t, 3> written{ 1, 2, 3 };
+    write_backup_registers(9, written);
+    expect(1 == bkp->dr1[9]);
+    expect(2 == bkp->dr11[0]);
+    expect(3 == bkp->dr11[1]);
+
+    // Registers past BKP_DR42 read as 0 and ignore writes
+    std::array<std::uint16_t, 3> read{ 0xFFFF, 0xFFFF, 0xFFFF };
+    write_backup_registers(41, written);
+    read_backup_registers(41, read);
+    expect(1 == read[0]);
+    expect(0 == read[1]);
+    expect(0 == read[2]);
+  };
+}
+}  // namespace hal::stm32f1
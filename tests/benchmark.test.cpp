@@ -0,0 +1,79 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "../demos/applications/benchmark.hpp"
+
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <string_view>
+
+#include "../src/flash_reg.hpp"
+#include "../src/pin.hpp"
+#include "../src/pwr_reg.hpp"
+#include "../src/rcc_reg.hpp"
+#include "helper.hpp"
+#include "register_simulator.hpp"
+
+#include <boost/ut.hpp>
+
+namespace hal::stm32f1 {
+void benchmark_test()
+{
+  using namespace boost::ut;
+
+#if HAL_STM32F1_REGISTER_SIMULATOR
+  // Runs the benchmark demo with register accesses in place of CPU cycles.
+  // Unlike cycles, these do not vary from run to run, so a change in the
+  // output is a change in the code. Set HAL_STM32F1_BENCHMARK_OUTPUT to
+  // print the results.
+  "benchmark demo on the register simulator"_test = []() {
+    simulated_registers rcc_sim(&rcc, rcc_model);
+    simulated_registers flash_sim(&flash, flash_model);
+    simulated_registers gpio_sim(&gpio_c_reg, gpio_model);
+    stub_out_registers pwr_stub(&pwr);
+
+    auto register_accesses = []() -> std::uint64_t {
+      return current_register_access_count().total();
+    };
+    std::string output;
+    auto write = [&output](std::string_view p_line) { output += p_line; };
+
+    bool successful = false;
+    (void)record_register_accesses([&]() {
+      successful = static_cast<bool>(
+        benchmark::run_library_benchmarks(register_accesses, write));
+    });
+
+    if (std::getenv("HAL_STM32F1_BENCHMARK_OUTPUT")) {
+      std::fputs(output.c_str(), stdout);
+    }
+
+    expect(successful);
+    expect(output.starts_with("benchmark,iterations,min,median,max\n"));
+    auto has_line = [&output](std::string_view p_line) {
+      return output.find(p_line) != std::string::npos;
+    };
+    expect(has_line("\noutput_pin::level(bool),64,1,1,1\n"));
+    expect(has_line("\noutput_pin::level(),64,1,1,1\n"));
+    expect(has_line("\nacquire_power()+release_power(),64,4,4,4\n"));
+    expect(has_line("\nfrequency(),64,0,0,0\n"));
+
+    release_power(peripheral::gpio_c);
+  };
+#else
+  skip / "benchmark demo on the register simulator"_test = []() {};
+#endif
+}
+}  // namespace hal::stm32f1
@@ -0,0 +1,128 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <libhal-stm32f1/clock.hpp>
+
+#include <algorithm>
+#include <cmath>
+
+#include "../src/flash_reg.hpp"
+#include "../src/pwr_reg.hpp"
+#include "../src/rcc_reg.hpp"
+#include "helper.hpp"
+#include "register_simulator.hpp"
+
+#include <boost/ut.hpp>
+
+namespace hal::stm32f1 {
+void clock_test()
+{
+  using namespace boost::ut;
+
+#if HAL_STM32F1_REGISTER_SIMULATOR
+  "hal::stm32f1::configure_clocks() to 72 MHz"_test = []() {
+    simulated_registers rcc_sim(&rcc, rcc_model);
+    simulated_registers flash_sim(&flash, flash_model);
+    stub_out_registers pwr_stub(&pwr);
+
+    auto accesses = record_register_accesses([]() {
+      configure_clocks(clock_tree{
+        .high_speed_external = 8.0_MHz,
+        .pll = {
+          .enable = true,
+          .source = pll_source::high_speed_external,
+          .multiply = pll_multiply::multiply_by_9,
+        },
+        .system_clock = system_clock_select::pll,
+        .ahb = {
+          .apb1 = { .divider = apb_divider::divide_by_2 },
+        },
+      });
+    });
+
+    // HSE and PLL are locked and the PLL drives the system clock
+    expect(0b11U << 24 == (rcc->cr & (0b11U << 24)));
+    expect(0b1010U == (rcc->cfgr & 0b1111U));
+    expect(std::abs(72.0_MHz - frequency(peripheral::cpu)) < 1.0f);
+
+    // Integer rates are exact
+    expect(72'000'000U == frequency_hz(peripheral::cpu));
+    expect(48'000'000U == frequency_hz(peripheral::usb));
+    expect(36'000'000U == frequency_hz(peripheral::i2c1));
+    expect(72'000'000U == frequency_hz(peripheral::timer2));
+    expect(72'000'000U == frequency_hz(peripheral::timer1));
+    expect(36'000'000U == frequency_hz(peripheral::adc1));
+
+    // Two flash wait states are set before the switch to 72 MHz
+    auto trace = recorded_register_accesses();
+    auto is_acr_write = [](const register_access& p_access) {
+      return p_access.type == register_access_type::write &&
+             p_access.address == 0x4002'2000;
+    };
+    auto is_pll_select = [](const register_access& p_access) {
+      return p_access.type == register_access_type::write &&
+             p_access.address == 0x4002'1004 &&
+             (p_access.value & 0b11U) == 0b10U;
+    };
+    auto wait_states = std::find_if(trace.begin(), trace.end(), is_acr_write);
+    auto pll_select = std::find_if(trace.begin(), trace.end(), is_pll_select);
+    expect(wait_states != trace.end() && pll_select != trace.end());
+    expect(wait_states->sequence < pll_select->sequence);
+    expect(0b010U == (wait_states->value & 0b111U));
+
+    // The ready flags are set on the first poll in the simulator, so this is
+    // the cost of the sequence itself. Polling must not write the register.
+    expect(accesses.reads <= 15);
+    expect(accesses.writes <= 12);
+
+    // Leave the clocks as the other tests expect them
+    configure_clocks(clock_tree{});
+  };
+
+  "hal::stm32f1::frequency_hz() of a stopped RTC is 0"_test = []() {
+    simulated_registers rcc_sim(&rcc, rcc_model);
+    simulated_registers flash_sim(&flash, flash_model);
+    stub_out_registers pwr_stub(&pwr);
+
+    // Disabled RTC, the LSI is left off
+    configure_clocks(clock_tree{});
+    expect(0U == frequency_hz(peripheral::rtc));
+    expect(0U == (rcc->csr & 0b1U));
+
+    // Enabled RTC fed from an LSE that is not fitted
+    configure_clocks(clock_tree{
+      .rtc = { .enable = true, .source = rtc_source::low_speed_external },
+    });
+    expect(0U == frequency_hz(peripheral::rtc));
+
+    // Enabled RTC fed from an HSE that is not fitted
+    configure_clocks(clock_tree{
+      .rtc = { .enable = true,
+               .source = rtc_source::high_speed_external_divided_by_128 },
+    });
+    expect(0U == frequency_hz(peripheral::rtc));
+
+    // Enabled RTC fed from the LSI, which is started
+    configure_clocks(clock_tree{ .rtc = { .enable = true } });
+    expect(40'000U == frequency_hz(peripheral::rtc));
+    expect(0b11U == (rcc->csr & 0b11U));
+
+    configure_clocks(clock_tree{});
+  };
+#else
+  skip / "hal::stm32f1::configure_clocks() to 72 MHz"_test = []() {};
+  skip / "hal::stm32f1::frequency_hz() of a stopped RTC is 0"_test = []() {};
+#endif
+}
+}  // namespace hal::stm32f1
@@ -0,0 +1,114 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <libhal-stm32f1/crc.hpp>
+
+#include <array>
+#include <cstring>
+#include <type_traits>
+#include <utility>
+
+#include <libhal-stm32f1/power_domain.hpp>
+
+#include "../src/crc_reg.hpp"
+#include "../src/dma_reg.hpp"
+#include "../src/rcc_reg.hpp"
+#include "helper.hpp"
+
+#include <boost/ut.hpp>
+
+namespace hal::stm32f1 {
+namespace {
+// The driver owns a power reference to the CRC unit
+static_assert(!std::is_copy_constructible_v<crc32>);
+static_assert(!std::is_copy_assignable_v<crc32>);
+static_assert(std::is_nothrow_move_constructible_v<crc32>);
+static_assert(std::is_nothrow_move_assignable_v<crc32>);
+
+constexpr std::array<hal::byte, 9> check_input{ '1', '2', '3', '4', '5',
+                                                '6', '7', '8', '9' };
+
+constexpr std::array<std::uint32_t, 1> native_input{ 0x1234'5678 };
+
+// Standard check value of CRC-32 and the widely published result of the
+// stm32 CRC unit for the single word 0x12345678
+static_assert(0xCBF4'3926 == software_crc32(check_input));
+static_assert(0xDF8A'8A2B == software_native_crc32(native_input));
+static_assert(0x8000'0000 == bit_reverse(1));
+static_assert(0x0000'0001 == bit_reverse(0x8000'0000));
+}  // namespace
+
+void crc_test()
+{
+  using namespace boost::ut;
+
+  "hal::stm32f1::software_crc32 chaining"_test = []() {
+    auto first = software_crc32(std::span(check_input).first(4));
+    auto chained = software_crc32(std::span(check_input).subspan(4), first);
+    expect(0xCBF4'3926 == chained);
+  };
+
+  "hal::stm32f1::software_native_crc32 reflected equivalence"_test = []() {
+    // Feeding the unit bit reversed words and reversing and inverting its
+    // output yields the reflected CRC-32. compute_reflected() relies on this.
+    std::array<hal::byte, 64> data{};
+    for (std::size_t i = 0; i < data.size(); i++) {
+      data[i] = static_cast<hal::byte>(i * 37 + 11);
+    }
+
+    std::array<std::uint32_t, data.size() / 4> words{};
+    std::memcpy(words.data(), data.data(), data.size());
+    for (auto& word : words) {
+      word = bit_reverse(word);
+    }
+
+    expect(software_crc32(data) ==
+           ~bit_reverse(software_native_crc32(words)));
+  };
+
+  "hal::stm32f1::crc32::compute() recovers from a DMA transfer error"_test =
+    []() {
+      stub_out_registers crc_stub(&crc_reg);
+      stub_out_registers dma_stub(&dma1);
+      stub_out_registers rcc_stub(&rcc);
+
+      // Every channel reports a transfer error as soon as it starts. The stub
+      // ignores IFCR writes, so the flag stays set.
+      dma1->isr = 0x0888'8888;
+
+      auto crc = crc32::get({ .dma_threshold = 1 }).value();
+      std::array<std::uint32_t, 4> words{ 1, 2, 3, 4 };
+      crc.compute(words);
+
+      // The CPU wrote every word after the DMA gave up, ending with the last
+      expect(4U == crc_reg->dr);
+      expect(1U == crc_reg->cr);
+      for (auto& channel : dma1->channel) {
+        expect(0U == (channel.ccr & 1U));
+      }
+    };
+
+  "hal::stm32f1::crc32 releases its power reference"_test = []() {
+    stub_out_registers rcc_stub(&rcc);
+
+    auto references = power_reference_count(peripheral::crc);
+    {
+      auto crc = crc32::get({}).value();
+      auto moved = std::move(crc);
+      expect(references + 1 == power_reference_count(peripheral::crc));
+    }
+    expect(references == power_reference_count(peripheral::crc));
+  };
+}
+}  // namespace hal::stm32f1
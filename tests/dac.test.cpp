@@ -0,0 +1,197 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <libhal-stm32f1/dac.hpp>
+
+#include <array>
+#include <optional>
+#include <type_traits>
+#include <utility>
+
+#include <libhal-stm32f1/power_domain.hpp>
+
+#include "../src/basic_timer_reg.hpp"
+#include "../src/dac_reg.hpp"
+#include "../src/dma_reg.hpp"
+#include "../src/pin.hpp"
+#include "../src/rcc_reg.hpp"
+#include "helper.hpp"
+
+#include <boost/ut.hpp>
+
+namespace hal::stm32f1 {
+using namespace hal::literals;
+
+namespace {
+// 72MHz timer clock
+static_assert(calculate_basic_timer_timing(1.0_MHz, 72.0_MHz)->prescaler ==
+              0);
+static_assert(calculate_basic_timer_timing(1.0_MHz, 72.0_MHz)->reload == 71);
+static_assert(calculate_basic_timer_timing(44.1_kHz, 72.0_MHz)->reload ==
+              1632);
+// Too slow for a 16-bit reload, the prescaler takes the remainder
+static_assert(calculate_basic_timer_timing(100.0_Hz, 72.0_MHz)->prescaler ==
+              10);
+static_assert(!calculate_basic_timer_timing(0.0_Hz, 72.0_MHz));
+static_assert(!calculate_basic_timer_timing(2.0_MHz, 1.0_MHz));
+// Integer Hz, as given by frequency_hz()
+static_assert(calculate_basic_timer_timing(44'100U, 72'000'000U)->reload ==
+              1632);
+static_assert(calculate_basic_timer_timing(100U, 72'000'000U)->prescaler ==
+              10);
+static_assert(!calculate_basic_timer_timing(0U, 72'000'000U));
+static_assert(!calculate_basic_timer_timing(2'000'000U, 1'000'000U));
+
+static_assert(0x0ABC'0123 == pack_dac_samples(0x0123, 0x0ABC));
+static_assert(0x0FFF'0FFF == pack_dac_samples(0xFFFF, 0xFFFF));
+
+// Each driver owns the timer and DMA channel of its stream
+static_assert(!std::is_copy_constructible_v<dac>);
+static_assert(!std::is_copy_assignable_v<dac>);
+static_assert(std::is_nothrow_move_constructible_v<dac>);
+static_assert(!std::is_copy_constructible_v<dual_dac>);
+static_assert(std::is_nothrow_move_assignable_v<dual_dac>);
+}  // namespace
+
+void dac_test()
+{
+  using namespace boost::ut;
+
+  "hal::stm32f1::dac::write"_test = []() {
+    stub_out_registers dac_stub(&dac_reg);
+    stub_out_registers gpio_stub(&gpio_a_reg);
+    stub_out_registers rcc_stub(&rcc);
+
+    auto channel2 = dac::get(2).value();
+    // EN2 with the output buffer on
+    expect(1U << 16 == dac_reg->cr);
+    // PA5 as analog input
+    expect(0 == (gpio_a_reg->crl & (0xFU << 20)));
+
+    channel2.write(1.0f);
+    expect(4095 == dac_reg->dhr12r2);
+    channel2.write(0.5f);
+    expect(2048 == dac_reg->dhr12r2);
+    channel2.write(-1.0f);
+    expect(0 == dac_reg->dhr12r2);
+
+    auto channel1 = dac::get(1, { .output_buffer = false }).value();
+    channel1.write_raw(0xF123);
+    expect(0x123 == dac_reg->dhr12r1);
+    // EN1 and BOFF1 are set, channel 2 is untouched
+    expect((1U << 16 | 0b11U) == dac_reg->cr);
+
+    expect(!dac::get(3));
+  };
+
+  "hal::stm32f1::dual_dac::write"_test = []() {
+    stub_out_registers dac_stub(&dac_reg);
+    stub_out_registers gpio_stub(&gpio_a_reg);
+    stub_out_registers rcc_stub(&rcc);
+
+    auto outputs = dual_dac::get().value();
+    outputs.write(0x0111, 0x0222);
+
+    expect(0x0222'0111 == dac_reg->dhr12rd);
+    expect((1U << 16 | 1U) == dac_reg->cr);
+  };
+
+  "hal::stm32f1::dac::stream rejects bad arguments"_test = []() {
+    stub_out_registers dac_stub(&dac_reg);
+    stub_out_registers gpio_stub(&gpio_a_reg);
+    stub_out_registers dma_stub(&dma2);
+    stub_out_registers timer_stub(&timer6_reg);
+    stub_out_registers rcc_stub(&rcc);
+
+    auto channel1 = dac::get(1).value();
+    std::array<std::uint16_t, 4> samples{ 0, 1024, 2048, 3072 };
+
+    expect(!channel1.stream(std::span<const std::uint16_t>{},
+                            { .sample_rate = 1.0_kHz }));
+    // The timer clock is not running under test, so no rate is reachable
+    expect(!channel1.stream(samples, { .sample_rate = 1.0_kHz }));
+
+    // Nothing is left claimed or triggered after a failure
+    expect(0 == dma2->channel[2].ccr);
+    expect(0 == timer6_reg->cr1);
+    expect(1U == dac_reg->cr);
+  };
+
+  "hal::stm32f1::dac releases its power references"_test = []() {
+    stub_out_registers dac_stub(&dac_reg);
+    stub_out_registers gpio_stub(&gpio_a_reg);
+    stub_out_registers rcc_stub(&rcc);
+
+    auto dac_references = power_reference_count(peripheral::dac);
+    auto port_references = power_reference_count(peripheral::gpio_a);
+
+    {
+      // Both channels are on port A, which is acquired once
+      auto outputs = dual_dac::get().value();
+      expect(dac_references + 1 == power_reference_count(peripheral::dac));
+      expect(port_references + 1 ==
+             power_reference_count(peripheral::gpio_a));
+
+      std::optional<dac> source(dac::get(2).value());
+      auto channel2 = std::move(*source);
+      source.reset();
+      expect(dac_references + 2 == power_reference_count(peripheral::dac));
+      expect(port_references + 2 ==
+             power_reference_count(peripheral::gpio_a));
+    }
+
+    expect(dac_references == power_reference_count(peripheral::dac));
+    expect(port_references == power_reference_count(peripheral::gpio_a));
+  };
+}
+
+/// Runs after dac_test(), which expects the timers to have no clock
+void dac_stream_test()
+{
+  using namespace boost::ut;
+
+  configure_default_clocks();
+
+  "hal::stm32f1::dac moves its stream with it"_test = []() {
+    stub_out_registers dac_stub(&dac_reg);
+    stub_out_registers gpio_stub(&gpio_a_reg);
+    stub_out_registers dma_stub(&dma2);
+    stub_out_registers timer_stub(&timer6_reg);
+    stub_out_registers rcc_stub(&rcc);
+
+    std::array<std::uint16_t, 4> samples{ 0, 1024, 2048, 3072 };
+    std::optional<dac> source(dac::get(1).value());
+    expect(bool{ source->stream(samples, { .sample_rate = 1.0_kHz }) });
+
+    // Destroying the moved from driver leaves the stream running
+    auto channel1 = std::move(*source);
+    source.reset();
+    expect(1U == (timer6_reg->cr1 & 1U));
+    expect(1U == (dma2->channel[2].ccr & 1U));
+
+    // The stream is released exactly once, so it can be claimed again
+    channel1.stop_stream();
+    expect(0U == timer6_reg->cr1);
+    expect(0U == (dma2->channel[2].ccr & 1U));
+    expect(bool{ channel1.stream(samples, { .sample_rate = 1.0_kHz }) });
+
+    // Destroying the driver stops its stream
+    {
+      auto discard = std::move(channel1);
+    }
+    expect(0U == timer6_reg->cr1);
+    expect(0U == (dma2->channel[2].ccr & 1U));
+  };
+}
+}  // namespace hal::stm32f1
@@ -0,0 +1,105 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <libhal-stm32f1/deferred_work.hpp>
+
+#include <array>
+#include <cstdint>
+
+#include "../src/cortex_m_reg.hpp"
+#include "helper.hpp"
+
+#include <boost/ut.hpp>
+
+namespace hal::stm32f1 {
+namespace {
+std::array<std::uintptr_t, deferred_work_capacity * 2> ran{};
+std::size_t ran_count = 0;
+
+void record(std::uintptr_t p_argument)
+{
+  ran[ran_count++] = p_argument;
+}
+
+void post_follow_up(std::uintptr_t p_argument)
+{
+  record(p_argument);
+  post_deferred_work(record, p_argument + 1);
+}
+}  // namespace
+
+void deferred_work_test()
+{
+  using namespace boost::ut;
+
+  "hal::stm32f1::post_deferred_work"_test = []() {
+    stub_out_registers scb_stub(&scb);
+    reset_deferred_work_statistics();
+    ran_count = 0;
+
+    expect(post_deferred_work(record, 1));
+    // Only PENDSVSET is written
+    expect(1U << 28 == scb->icsr);
+    expect(post_deferred_work(record, 2));
+    expect(post_deferred_work(post_follow_up, 3));
+    expect(3 == pending_deferred_work());
+    expect(0 == ran_count);
+
+    deferred_work_interrupt();
+
+    // Work posted by a deferred function runs in the same pass
+    expect(4 == ran_count);
+    expect(1 == ran[0]);
+    expect(2 == ran[1]);
+    expect(3 == ran[2]);
+    expect(4 == ran[3]);
+    expect(0 == pending_deferred_work());
+
+    auto statistics = read_deferred_work_statistics();
+    expect(4 == statistics.posted);
+    expect(0 == statistics.overflows);
+    expect(3 == statistics.max_depth);
+  };
+
+  "hal::stm32f1::post_deferred_work overflow"_test = []() {
+    stub_out_registers scb_stub(&scb);
+    reset_deferred_work_statistics();
+    ran_count = 0;
+
+    for (std::uintptr_t item = 0; item < deferred_work_capacity; item++) {
+      expect(post_deferred_work(record, item));
+    }
+    expect(!post_deferred_work(record, 1000));
+    expect(!post_deferred_work(record, 1001));
+    expect(deferred_work_capacity == pending_deferred_work());
+
+    deferred_work_interrupt();
+    expect(deferred_work_capacity == ran_count);
+    expect(deferred_work_capacity - 1 == ran[deferred_work_capacity - 1]);
+
+    // The slots are free again for the next lap
+    expect(post_deferred_work(record, 2000));
+    deferred_work_interrupt();
+    expect(2000 == ran[deferred_work_capacity]);
+
+    auto statistics = read_deferred_work_statistics();
+    expect(deferred_work_capacity + 1 == statistics.posted);
+    expect(2 == statistics.overflows);
+    expect(deferred_work_capacity == statistics.max_depth);
+
+    reset_deferred_work_statistics();
+    expect(0 == read_deferred_work_statistics().overflows);
+  };
+}
+}  // namespace hal::stm32f1
@@ -0,0 +1,269 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <libhal-stm32f1/flash_kv_store.hpp>
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <vector>
+
+#include <boost/ut.hpp>
+
+namespace hal::stm32f1 {
+namespace {
+/// In memory flash that enforces erase before write
+class flash_model : public flash_page_storage
+{
+public:
+  flash_model(std::uint32_t p_page_size, std::uint32_t p_page_count)
+    : m_page_size(p_page_size)
+    , m_memory(p_page_size / 2 * p_page_count, erased_half_word)
+    , m_erase_count(p_page_count, 0)
+  {
+  }
+
+  std::uint32_t writes_until_power_loss = 0xFFFF'FFFF;
+  std::uint32_t programming_errors = 0;
+
+  std::uint16_t& at(std::uint32_t p_page, std::uint32_t p_offset)
+  {
+    return m_memory[(p_page * m_page_size + p_offset) / 2];
+  }
+
+  std::uint32_t erase_count(std::uint32_t p_page)
+  {
+    return m_erase_count[p_page];
+  }
+
+private:
+  std::uint32_t driver_page_size() override
+  {
+    return m_page_size;
+  }
+
+  std::uint32_t driver_page_count() override
+  {
+    return m_erase_count.size();
+  }
+
+  std::uint16_t driver_read(std::uint32_t p_page,
+                            std::uint32_t p_offset) override
+  {
+    return at(p_page, p_offset);
+  }
+
+  status driver_program(std::uint32_t p_page,
+                        std::uint32_t p_offset,
+                        std::uint16_t p_value) override
+  {
+    if (writes_until_power_loss == 0) {
+      return hal::new_error(std::errc::io_error);
+    }
+    writes_until_power_loss--;
+
+    if (at(p_page, p_offset) != erased_half_word) {
+      programming_errors++;
+      return hal::new_error(std::errc::io_error);
+    }
+    at(p_page, p_offset) = p_value;
+    return hal::success();
+  }
+
+  status driver_erase(std::uint32_t p_page) override
+  {
+    if (writes_until_power_loss == 0) {
+      return hal::new_error(std::errc::io_error);
+    }
+    writes_until_power_loss--;
+
+    auto start = m_memory.begin() + (p_page * m_page_size / 2);
+    std::fill(start, start + (m_page_size / 2), erased_half_word);
+    m_erase_count[p_page]++;
+    return hal::success();
+  }
+
+  std::uint32_t m_page_size;
+  std::vector<std::uint16_t> m_memory;
+  std::vector<std::uint32_t> m_erase_count;
+};
+
+std::array<hal::byte, 4> as_bytes(std::uint32_t p_value)
+{
+  return {
+    static_cast<hal::byte>(p_value >> 0),
+    static_cast<hal::byte>(p_value >> 8),
+    static_cast<hal::byte>(p_value >> 16),
+    static_cast<hal::byte>(p_value >> 24),
+  };
+}
+
+std::uint32_t read_u32(flash_kv_store& p_store, flash_kv_store::key_t p_key)
+{
+  std::array<hal::byte, 4> buffer{};
+  auto value = p_store.read(p_key, buffer).value();
+  std::uint32_t result = 0;
+  for (std::size_t i = 0; i < value.size(); i++) {
+    result |= static_cast<std::uint32_t>(value[i]) << (8 * i);
+  }
+  return result;
+}
+}  // namespace
+
+void flash_kv_store_test()
+{
+  using namespace boost::ut;
+
+  "hal::stm32f1::flash_kv_store write and read"_test = []() {
+    flash_model flash(1024, 2);
+    std::array<std::uint32_t, 8> index{};
+    auto store = flash_kv_store::create(flash, index).value();
+
+    expect(!store.contains(3));
+    store.write(3, as_bytes(0xDEAD'BEEF)).value();
+    store.write(5, std::array<hal::byte, 3>{ 1, 2, 3 }).value();
+
+    std::array<hal::byte, 3> odd{};
+    auto odd_value = store.read(5, odd).value();
+
+    expect(store.contains(3));
+    expect(0xDEAD'BEEF == read_u32(store, 3));
+    expect(3 == odd_value.size());
+    expect(3 == odd_value[2]);
+    expect(3 == store.size(5));
+    expect(!store.read(4, odd));
+    expect(!store.write(8, as_bytes(0)));
+    expect(0 == flash.programming_errors);
+  };
+
+  "hal::stm32f1::flash_kv_store remove"_test = []() {
+    flash_model flash(1024, 2);
+    std::array<std::uint32_t, 8> index{};
+    auto store = flash_kv_store::create(flash, index).value();
+
+    store.write(1, as_bytes(10)).value();
+    store.remove(1).value();
+
+    expect(!store.contains(1));
+
+    auto rebooted = flash_kv_store::create(flash, index).value();
+    expect(!rebooted.contains(1));
+  };
+
+  "hal::stm32f1::flash_kv_store rebuilds index at boot"_test = []() {
+    flash_model flash(1024, 3);
+    std::array<std::uint32_t, 16> index{};
+    {
+      auto store = flash_kv_store::create(flash, index).value();
+      for (std::uint32_t i = 0; i < 208; i++) {
+        store.write(i % 16, as_bytes(i)).value();
+      }
+    }
+
+    std::array<std::uint32_t, 16> rebuilt_index{};
+    auto store = flash_kv_store::create(flash, rebuilt_index).value();
+
+    for (std::uint32_t key = 0; key < 16; key++) {
+      expect(208 - 16 + key == read_u32(store, key));
+    }
+    expect(index == rebuilt_index);
+    expect(0 == flash.programming_errors);
+  };
+
+  "hal::stm32f1::flash_kv_store spreads erases across pages"_test = []() {
+    flash_model flash(1024, 4);
+    std::array<std::uint32_t, 4> index{};
+    auto store = flash_kv_store::create(flash, index).value();
+
+    for (std::uint32_t i = 0; i < 4000; i++) {
+      store.write(i % 4, as_bytes(i)).value();
+    }
+
+    auto least = flash.erase_count(0);
+    auto most = flash.erase_count(0);
+    for (std::uint32_t page = 1; page < 4; page++) {
+      least = std::min(least, flash.erase_count(page));
+      most = std::max(most, flash.erase_count(page));
+    }
+
+    expect(least > 0);
+    expect(most - least <= 1);
+    expect(3999 == read_u32(store, 3));
+    expect(0 == flash.programming_errors);
+  };
+
+  "hal::stm32f1::flash_kv_store ignores uncommitted record"_test = []() {
+    flash_model flash(1024, 2);
+    std::array<std::uint32_t, 4> index{};
+    {
+      auto store = flash_kv_store::create(flash, index).value();
+      store.write(2, as_bytes(7)).value();
+      // length + 2 data half-words are programmed but not the key
+      flash.writes_until_power_loss = 3;
+      expect(!store.write(2, as_bytes(8)));
+    }
+
+    flash.writes_until_power_loss = 0xFFFF'FFFF;
+    auto store = flash_kv_store::create(flash, index).value();
+    expect(7 == read_u32(store, 2));
+
+    store.write(2, as_bytes(9)).value();
+    expect(9 == read_u32(store, 2));
+    expect(0 == flash.programming_errors);
+  };
+
+  "hal::stm32f1::flash_kv_store survives interrupted compaction"_test = []() {
+    for (std::uint32_t budget = 0; budget < 40; budget++) {
+      flash_model flash(64, 2);
+      std::array<std::uint32_t, 4> index{};
+      auto store = flash_kv_store::create(flash, index).value();
+
+      // Fill the page so that the next write compacts
+      for (std::uint32_t i = 0; store.free_space() >= 8; i++) {
+        store.write(i % 4, as_bytes(i)).value();
+      }
+      std::array<std::uint32_t, 4> before{};
+      for (std::uint16_t key = 0; key < 4; key++) {
+        before[key] = read_u32(store, key);
+      }
+
+      flash.writes_until_power_loss = budget;
+      bool written = static_cast<bool>(store.write(0, as_bytes(0xAAAA)));
+      flash.writes_until_power_loss = 0xFFFF'FFFF;
+
+      auto rebooted = flash_kv_store::create(flash, index).value();
+      if (written || read_u32(rebooted, 0) == 0xAAAA) {
+        expect(0xAAAA == read_u32(rebooted, 0));
+      } else {
+        expect(before[0] == read_u32(rebooted, 0));
+      }
+      for (std::uint16_t key = 1; key < 4; key++) {
+        expect(before[key] == read_u32(rebooted, key));
+      }
+      expect(0 == flash.programming_errors);
+    }
+  };
+
+  "hal::stm32f1::flash_kv_store rejects values larger than a page"_test =
+    []() {
+      flash_model flash(64, 2);
+      std::array<std::uint32_t, 4> index{};
+      auto store = flash_kv_store::create(flash, index).value();
+      std::array<hal::byte, 64> big{};
+
+      expect(!store.write(0, big));
+      expect(!store.contains(0));
+    };
+}
+}  // namespace hal::stm32f1
@@ -0,0 +1,148 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <libhal-stm32f1/fsmc.hpp>
+
+#include <chrono>
+#include <type_traits>
+#include <utility>
+
+#include <libhal-stm32f1/power_domain.hpp>
+
+#include "../src/fsmc_reg.hpp"
+#include "../src/pin.hpp"
+#include "../src/rcc_reg.hpp"
+#include "helper.hpp"
+
+#include <boost/ut.hpp>
+
+namespace hal::stm32f1 {
+using namespace hal::literals;
+
+namespace {
+using namespace std::chrono_literals;
+
+// IS61WV51216 style 10ns SRAM at 72MHz, one cycle is 13.9ns
+constexpr fsmc_device fast_sram{
+  .address_setup = 0ns,
+  .data_setup = 10ns,
+  .bus_turnaround = 0ns,
+};
+static_assert(0 == calculate_fsmc_timing(fast_sram, 72.0_MHz)->address_setup);
+static_assert(1 == calculate_fsmc_timing(fast_sram, 72.0_MHz)->data_setup);
+
+// 55ns SRAM with 15ns address setup needs 4 and 2 cycles
+constexpr fsmc_device slow_sram{
+  .address_setup = 15ns,
+  .data_setup = 55ns,
+  .bus_turnaround = 5ns,
+};
+static_assert(2 == calculate_fsmc_timing(slow_sram, 72.0_MHz)->address_setup);
+static_assert(4 == calculate_fsmc_timing(slow_sram, 72.0_MHz)->data_setup);
+static_assert(1 == calculate_fsmc_timing(slow_sram, 72.0_MHz)->bus_turnaround);
+// Integer Hz, as given by frequency_hz()
+static_assert(4 == calculate_fsmc_timing(slow_sram, 72'000'000U)->data_setup);
+static_assert(2 ==
+              calculate_fsmc_timing(slow_sram, 72'000'000U)->address_setup);
+
+// ADDSET is only 4 bits wide
+static_assert(!calculate_fsmc_timing(fsmc_device{ .address_setup = 1us },
+                                     72.0_MHz));
+
+static_assert(0x6000'0000 == fsmc_bank_address(fsmc_bank::ne1));
+static_assert(0x6C00'0000 == fsmc_bank_address(fsmc_bank::ne4));
+
+// Each driver owns its bank and the power references of its pins
+static_assert(!std::is_copy_constructible_v<fsmc_sram>);
+static_assert(!std::is_copy_assignable_v<fsmc_sram>);
+static_assert(std::is_nothrow_move_constructible_v<fsmc_sram>);
+static_assert(!std::is_copy_constructible_v<fsmc_lcd>);
+static_assert(std::is_nothrow_move_assignable_v<fsmc_lcd>);
+}  // namespace
+
+void fsmc_test()
+{
+  using namespace boost::ut;
+
+  "hal::stm32f1::fsmc_sram::get"_test = []() {
+    stub_out_registers fsmc_stub(&fsmc_reg);
+    stub_out_registers gpio_d_stub(&gpio_d_reg);
+    stub_out_registers gpio_e_stub(&gpio_e_reg);
+    stub_out_registers gpio_f_stub(&gpio_f_reg);
+    stub_out_registers gpio_g_stub(&gpio_g_reg);
+    stub_out_registers rcc_stub(&rcc);
+
+    auto sram = fsmc_sram::get(fsmc_bank::ne3, fsmc_device{}).value();
+
+    // 19 address lines of 16-bit words is 1MB
+    expect(0x6800'0000 ==
+           reinterpret_cast<std::uintptr_t>(sram.memory().data()));
+    expect(1024 * 1024 == sram.memory().size());
+
+    // SRAM, 16-bit, write enabled, bank enabled
+    expect(((1U << 12) | (0b01U << 4) | 1U) == fsmc_reg->bank[2].bcr);
+    // FSMC, GPIOD to GPIOG
+    expect(0 != (rcc->ahbenr & (1U << 8)));
+    expect((0b1111U << 5) == (rcc->apb2enr & (0b1111U << 5)));
+    // NE3 on PG10 as alternate function push pull
+    expect(0b1011U == ((gpio_g_reg->crh >> 8) & 0xF));
+
+    expect(!fsmc_sram::get(fsmc_bank::ne1, fsmc_device{ .address_lines = 26 }));
+  };
+
+  "hal::stm32f1::fsmc_lcd::get"_test = []() {
+    stub_out_registers fsmc_stub(&fsmc_reg);
+    stub_out_registers gpio_d_stub(&gpio_d_reg);
+    stub_out_registers gpio_e_stub(&gpio_e_reg);
+    stub_out_registers gpio_g_stub(&gpio_g_reg);
+    stub_out_registers rcc_stub(&rcc);
+
+    auto lcd = fsmc_lcd::get(fsmc_bank::ne4, {}).value();
+
+    // A16 selects data, which is bit 17 of the byte address on a 16-bit bus
+    expect(0x6C02'0000 ==
+           reinterpret_cast<std::uintptr_t>(lcd.data_address()));
+    // A16 on PD11 as alternate function push pull
+    expect(0b1011U == ((gpio_d_reg->crh >> 12) & 0xF));
+
+    expect(!fsmc_lcd::get(fsmc_bank::ne1, { .register_select_line = 25 }));
+  };
+
+  "hal::stm32f1::fsmc_lcd releases its bank"_test = []() {
+    stub_out_registers fsmc_stub(&fsmc_reg);
+    stub_out_registers gpio_d_stub(&gpio_d_reg);
+    stub_out_registers gpio_e_stub(&gpio_e_reg);
+    stub_out_registers gpio_g_stub(&gpio_g_reg);
+    stub_out_registers rcc_stub(&rcc);
+
+    auto fsmc_references = power_reference_count(peripheral::fsmc);
+    auto port_references = power_reference_count(peripheral::gpio_d);
+
+    {
+      auto lcd = fsmc_lcd::get(fsmc_bank::ne4, {}).value();
+      // Port D holds ten of the pins and is acquired once
+      expect(fsmc_references + 1 == power_reference_count(peripheral::fsmc));
+      expect(port_references + 1 ==
+             power_reference_count(peripheral::gpio_d));
+
+      auto moved = std::move(lcd);
+      expect(1U == (fsmc_reg->bank[3].bcr & 1U));
+    }
+
+    expect(0U == (fsmc_reg->bank[3].bcr & 1U));
+    expect(fsmc_references == power_reference_count(peripheral::fsmc));
+    expect(port_references == power_reference_count(peripheral::gpio_d));
+  };
+}
+}  // namespace hal::stm32f1
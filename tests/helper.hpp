@@ -1,5 +1,11 @@
 #pragma once
 
+#include <libhal-stm32f1/clock.hpp>
+
+#include "../src/flash_reg.hpp"
+#include "../src/pwr_reg.hpp"
+#include "../src/rcc_reg.hpp"
+
 namespace hal {
 template<typename T>
 class stub_out_registers
@@ -25,3 +31,20 @@ private:
   T m_stub;
 };
 }  // namespace hal
+
+namespace hal::stm32f1 {
+/**
+ * @brief Configure the default clock tree on stubbed out registers
+ *
+ * Runs every bus and timer from the 8MHz HSI. Tests of timer driven
+ * peripherals call this so they do not depend on the clock test having run,
+ * which needs the register simulator.
+ */
+inline void configure_default_clocks()
+{
+  stub_out_registers rcc_stub(&rcc);
+  stub_out_registers flash_stub(&flash);
+  stub_out_registers pwr_stub(&pwr);
+  configure_clocks(clock_tree{});
+}
+}  // namespace hal::stm32f1
@@ -0,0 +1,128 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <libhal-stm32f1/i2s.hpp>
+
+#include <cmath>
+#include <type_traits>
+#include <utility>
+
+#include <libhal-stm32f1/power_domain.hpp>
+
+#include "../src/pin.hpp"
+#include "../src/rcc_reg.hpp"
+#include "../src/spi_reg.hpp"
+#include "helper.hpp"
+
+#include <boost/ut.hpp>
+
+namespace hal::stm32f1 {
+using namespace hal::literals;
+
+namespace {
+// The bus, its stream and its power references have a single owner
+static_assert(!std::is_copy_constructible_v<i2s>);
+static_assert(!std::is_copy_assignable_v<i2s>);
+static_assert(std::is_nothrow_move_constructible_v<i2s>);
+static_assert(std::is_nothrow_move_assignable_v<i2s>);
+
+// 72MHz / (32 * 47) is 47.872kHz, closer to 48kHz than 72MHz / (32 * 46)
+constexpr auto clock_48k =
+  calculate_i2s_clock(72.0_MHz, 48.0_kHz, false, false).value();
+static_assert(23 == clock_48k.divider);
+static_assert(clock_48k.odd);
+
+// MCK output divides by 256 per sample, 72MHz / (256 * 6) is 46.875kHz
+constexpr auto clock_48k_mck =
+  calculate_i2s_clock(72.0_MHz, 48.0_kHz, false, true).value();
+static_assert(3 == clock_48k_mck.divider);
+static_assert(!clock_48k_mck.odd);
+
+// 32-bit channels halve the divider, 72MHz / (64 * 26) is 43.269kHz
+constexpr auto clock_44k1 =
+  calculate_i2s_clock(72.0_MHz, 44.1_kHz, true, false).value();
+static_assert(13 == clock_44k1.divider);
+static_assert(!clock_44k1.odd);
+
+// The prescaler divides by at least 4 and at most 511
+static_assert(!calculate_i2s_clock(72.0_MHz, 1.0_MHz, false, false));
+static_assert(!calculate_i2s_clock(72.0_MHz, 100.0_Hz, false, true));
+
+// Integer Hz, as given by frequency_hz()
+constexpr auto clock_48k_hz =
+  calculate_i2s_clock(72'000'000U, 48'000U, false, false).value();
+static_assert(23 == clock_48k_hz.divider);
+static_assert(clock_48k_hz.odd);
+static_assert(clock_48k.sample_rate == clock_48k_hz.sample_rate);
+static_assert(!calculate_i2s_clock(72'000'000U, 0U, false, false));
+}  // namespace
+
+void i2s_test()
+{
+  using namespace boost::ut;
+
+  "hal::stm32f1::calculate_i2s_clock"_test = []() {
+    expect(std::abs(47'872.3f - clock_48k.sample_rate) < 1.0f);
+    expect(std::abs(46'875.0f - clock_48k_mck.sample_rate) < 1.0f);
+  };
+
+  "hal::stm32f1::i2s::get slave"_test = []() {
+    stub_out_registers spi_stub(&spi2_reg);
+    stub_out_registers gpio_stub(&gpio_b_reg);
+    stub_out_registers rcc_stub(&rcc);
+
+    auto bus = i2s::get(i2s_bus::spi2,
+                        { .mode = i2s_mode::slave_receive,
+                          .standard = i2s_standard::msb_justified,
+                          .format = i2s_data_format::bits24 })
+                 .value();
+
+    // I2SMOD, slave receive, MSB justified, 24-bit data, 32-bit channels
+    expect(((1U << 11) | (0b01U << 8) | (0b01U << 4) | (0b01U << 1) | 1U) ==
+           spi2_reg->i2scfgr);
+    expect(0.0f == bus.sample_rate());
+    // SPI2 clock
+    expect(0 != (rcc->apb1enr & (1U << 14)));
+    // PB12, PB13 and PB15 are floating inputs
+    expect(0x4044'0000U == (gpio_b_reg->crh & 0xF0FF'0000));
+  };
+
+  "hal::stm32f1::i2s owns its bus"_test = []() {
+    stub_out_registers spi_stub(&spi2_reg);
+    stub_out_registers gpio_stub(&gpio_b_reg);
+    stub_out_registers rcc_stub(&rcc);
+
+    auto spi_references = power_reference_count(peripheral::spi2);
+    auto port_references = power_reference_count(peripheral::gpio_b);
+    constexpr i2s_settings slave{ .mode = i2s_mode::slave_receive };
+
+    {
+      auto bus = i2s::get(i2s_bus::spi2, slave).value();
+      // PB12, PB13 and PB15 share one port reference
+      expect(spi_references + 1 == power_reference_count(peripheral::spi2));
+      expect(port_references + 1 ==
+             power_reference_count(peripheral::gpio_b));
+      expect(!i2s::get(i2s_bus::spi2, slave).has_value());
+
+      auto moved = std::move(bus);
+      expect(!i2s::get(i2s_bus::spi2, slave).has_value());
+      expect(spi_references + 1 == power_reference_count(peripheral::spi2));
+    }
+
+    expect(spi_references == power_reference_count(peripheral::spi2));
+    expect(port_references == power_reference_count(peripheral::gpio_b));
+    expect(i2s::get(i2s_bus::spi2, slave).has_value());
+  };
+}
+}  // namespace hal::stm32f1
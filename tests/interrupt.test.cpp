@@ -0,0 +1,96 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <libhal-stm32f1/interrupt.hpp>
+
+#include <array>
+
+#include "../src/cortex_m_reg.hpp"
+#include "helper.hpp"
+
+#include <boost/ut.hpp>
+
+namespace hal::stm32f1 {
+namespace {
+void dma_handler()
+{
+}
+
+void fault_handler()
+{
+}
+
+constexpr auto test_table = vector_table_builder{}
+                              .set(irq::dma1_channel1, dma_handler)
+                              .set(exception::hard_fault, fault_handler)
+                              .build();
+
+static_assert(test_table[core_vector_count + 11] == dma_handler);
+static_assert(test_table[3] == fault_handler);
+static_assert(test_table[core_vector_count] == unhandled_interrupt);
+}  // namespace
+
+void interrupt_test()
+{
+  using namespace boost::ut;
+
+  "hal::stm32f1::encode_priority"_test = []() {
+    expect(0x00 == encode_priority(priority_group::preempt_4_bits_sub_0_bits,
+                                   0,
+                                   3));
+    expect(0xF0 == encode_priority(priority_group::preempt_4_bits_sub_0_bits,
+                                   15,
+                                   0));
+    expect(0x90 == encode_priority(priority_group::preempt_2_bits_sub_2_bits,
+                                   2,
+                                   1));
+    expect(0x30 == encode_priority(priority_group::preempt_0_bits_sub_4_bits,
+                                   2,
+                                   3));
+  };
+
+  "hal::stm32f1::set_priorities"_test = []() {
+    stub_out_registers scb_stub(&scb);
+    stub_out_registers nvic_stub(&nvic);
+
+    set_priority_grouping(priority_group::preempt_2_bits_sub_2_bits);
+    set_priorities(std::array{
+      irq_priority{ .id = irq::dma1_channel1, .preempt = 0 },
+      irq_priority{ .id = irq::tim2, .preempt = 1, .sub = 1 },
+      irq_priority{ .id = irq::usart1, .preempt = 3 },
+    });
+    set_priority(exception::pend_sv, 3, 3);
+
+    expect(0x05FA'0500 == scb->aircr);
+    expect(priority_group::preempt_2_bits_sub_2_bits ==
+           get_priority_grouping());
+    expect(0x00 == nvic->ip[11]);
+    expect(0x50 == nvic->ip[28]);
+    expect(0xC0 == nvic->ip[37]);
+    expect(0xF0 == scb->shp[10]);
+  };
+
+  "hal::stm32f1::enable_interrupt"_test = []() {
+    stub_out_registers nvic_stub(&nvic);
+
+    enable_interrupt(irq::usart1);
+    disable_interrupt(irq::tim2);
+
+    expect(1U << 5 == nvic->iser[1]);
+    expect(1U << 28 == nvic->icer[0]);
+    expect(is_interrupt_enabled(irq::usart1));
+    expect(!is_interrupt_enabled(irq::usart2));
+  };
+}
+}  // namespace hal::stm32f1
@@ -0,0 +1,92 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <libhal-stm32f1/isr_statistics.hpp>
+
+#include <libhal-util/enum.hpp>
+
+#include "../src/cortex_m_reg.hpp"
+#include "../src/isr_statistics.hpp"
+#include "helper.hpp"
+
+#include <boost/ut.hpp>
+
+namespace hal::stm32f1 {
+namespace {
+static_assert(0 == isr_histogram_bucket(0));
+static_assert(1 == isr_histogram_bucket(1));
+static_assert(2 == isr_histogram_bucket(3));
+static_assert(7 == isr_histogram_bucket(100));
+static_assert(isr_histogram_buckets - 1 == isr_histogram_bucket(0xFFFF'FFFF));
+
+#if HAL_STM32F1_ISR_STATISTICS
+void slow_handler()
+{
+  // Stands in for 500 cycles of work
+  dwt->cyccnt = dwt->cyccnt + 500;
+}
+#endif
+}  // namespace
+
+void isr_statistics_test()
+{
+  using namespace boost::ut;
+
+  "hal::stm32f1::isr_statistics::record()"_test = []() {
+    isr_statistics statistics;
+
+    statistics.record(12);
+    statistics.record(700);
+    statistics.record(9);
+
+    expect(3 == statistics.count);
+    expect(700 == statistics.max_cycles);
+    expect(2 == statistics.histogram[4]);
+    expect(1 == statistics.histogram[10]);
+
+    // Buckets saturate instead of wrapping around
+    statistics.histogram[0] = 0xFFFF;
+    statistics.record(0);
+    expect(0xFFFF == statistics.histogram[0]);
+  };
+
+#if HAL_STM32F1_ISR_STATISTICS
+  "hal::stm32f1::time_handler()"_test = []() {
+    stub_out_registers scb_stub(&scb);
+    stub_out_registers dwt_stub(&dwt);
+    stub_out_registers core_debug_stub(&core_debug);
+    reset_isr_statistics();
+
+    auto trampoline = time_handler(value(irq::usart1), slow_handler);
+    expect(0 != (dwt->ctrl & 1U));
+    expect(0 != (core_debug->demcr & (1U << 24)));
+
+    // Taken as vector 16 + 37
+    scb->icsr = core_vector_count + value(irq::usart1);
+    trampoline();
+    trampoline();
+
+    auto statistics = read_isr_statistics(irq::usart1);
+    expect(2 == statistics.count);
+    expect(500 == statistics.max_cycles);
+    expect(2 == statistics.histogram[isr_histogram_bucket(500)]);
+    expect(0 == read_isr_statistics(irq::usart2).count);
+  };
+#else
+  "hal::stm32f1::read_isr_statistics() when disabled"_test = []() {
+    expect(0 == read_isr_statistics(irq::usart1).count);
+  };
+#endif
+}
+}  // namespace hal::stm32f1
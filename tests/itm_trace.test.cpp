@@ -0,0 +1,142 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <libhal-stm32f1/itm_trace.hpp>
+
+#include <cstddef>
+
+#include "../src/cortex_m_reg.hpp"
+#include "../src/itm_reg.hpp"
+#include "../src/pin.hpp"
+#include "../src/rcc_reg.hpp"
+#include "helper.hpp"
+#include "register_simulator.hpp"
+
+#include <boost/ut.hpp>
+
+namespace hal::stm32f1 {
+namespace {
+static_assert(0xE00 == offsetof(itm_t, ter));
+static_assert(0xE40 == offsetof(itm_t, tpr));
+static_assert(0xE80 == offsetof(itm_t, tcr));
+static_assert(0xFB0 == offsetof(itm_t, lar));
+static_assert(0x010 == offsetof(tpiu_t, acpr));
+static_assert(0x0F0 == offsetof(tpiu_t, sppr));
+static_assert(0x304 == offsetof(tpiu_t, ffcr));
+
+static_assert(35 == calculate_swo_prescaler(72.0_MHz, 2.0_MHz));
+static_assert(3 == calculate_swo_prescaler(8.0_MHz, 2.0_MHz));
+// 72 MHz / 10 = 7.2 MHz is 4% away from 7.5 MHz
+static_assert(!calculate_swo_prescaler(72.0_MHz, 7.5_MHz));
+static_assert(!calculate_swo_prescaler(8.0_MHz, 16.0_MHz));
+// Integer Hz, as given by frequency_hz()
+static_assert(35 == calculate_swo_prescaler(72'000'000U, 2'000'000U));
+static_assert(!calculate_swo_prescaler(72'000'000U, 7'500'000U));
+
+static_assert(0x2123 == trace_event_header(0x123, 2));
+static_assert(0x0FFF == trace_event_header(0xFFFF, 0));
+
+#if HAL_STM32F1_REGISTER_SIMULATOR
+/// Stimulus FIFO that always has room
+constexpr register_model itm_model{
+  .reset = [](void* p_registers) {
+    for (auto& port : static_cast<itm_t*>(p_registers)->stimulus) {
+      port = 1;
+    }
+  },
+  .write = [](void* p_registers, std::uintptr_t p_offset) {
+    if (p_offset < sizeof(itm_t::stimulus)) {
+      static_cast<itm_t*>(p_registers)->stimulus[p_offset / 4] = 1;
+    }
+  },
+};
+
+/// Stimulus FIFO with room for a single word
+constexpr register_model full_itm_model{
+  .reset = itm_model.reset,
+  .write = [](void* p_registers, std::uintptr_t p_offset) {
+    if (p_offset < sizeof(itm_t::stimulus)) {
+      static_cast<itm_t*>(p_registers)->stimulus[p_offset / 4] = 0;
+    }
+  },
+};
+#endif
+}  // namespace
+
+void itm_trace_test()
+{
+  using namespace boost::ut;
+
+  "hal::stm32f1::start_itm_trace()"_test = []() {
+    stub_out_registers itm_stub(&itm);
+    stub_out_registers tpiu_stub(&tpiu);
+    stub_out_registers debug_mcu_stub(&debug_mcu);
+    stub_out_registers dwt_stub(&dwt);
+    stub_out_registers core_debug_stub(&core_debug);
+    stub_out_registers afio_stub(&alternative_function_io);
+    stub_out_registers rcc_stub(&rcc);
+
+    auto prescaler =
+      calculate_swo_prescaler(frequency(peripheral::cpu), 2.0_MHz);
+    auto started = start_itm_trace();
+    expect(prescaler.has_value() == static_cast<bool>(started));
+    if (!started) {
+      return;
+    }
+
+    expect(*prescaler == tpiu->acpr);
+    expect(tpiu_protocol_nrz == tpiu->sppr);
+    expect(itm_unlock_key == itm->lar);
+    expect(0x0001'000F == itm->tcr);
+    expect(0xFFFF'FFFF == itm->ter);
+    // Trace pins enabled in asynchronous mode, SWD only
+    expect(1U << 5 == debug_mcu->cr);
+    expect(0b010U << 24 == (alternative_function_io->mapr & (0b111U << 24)));
+  };
+
+#if HAL_STM32F1_REGISTER_SIMULATOR
+  "hal::stm32f1::trace_event()"_test = []() {
+    simulated_registers itm_sim(&itm, itm_model);
+
+    bool written = false;
+    (void)record_register_accesses([&written]() {
+      written = trace_event(3, 0x42, 7, -1);
+    });
+    expect(written);
+
+    // A ready check before each word, the header then two arguments
+    auto trace = recorded_register_accesses();
+    expect(6 == trace.size());
+    expect(0xE000'000C == trace[1].address);
+    expect(2 * 4096 + 0x42 == trace[1].value);
+    expect(7 == trace[3].value);
+    expect(0xFFFF'FFFF == trace[5].value);
+  };
+
+  "hal::stm32f1::trace_event() drops when the FIFO is full"_test = []() {
+    simulated_registers itm_sim(&itm, full_itm_model);
+    auto dropped = dropped_trace_events();
+
+    // The header fits, the argument does not
+    expect(!trace_event(0, 1, 5));
+    expect(!trace_event(0, 1));
+    expect(dropped + 2 == dropped_trace_events());
+  };
+#else
+  skip / "hal::stm32f1::trace_event()"_test = []() {};
+  skip / "hal::stm32f1::trace_event() drops when the FIFO is full"_test =
+    []() {};
+#endif
+}
+}  // namespace hal::stm32f1
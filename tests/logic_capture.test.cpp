@@ -0,0 +1,244 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <libhal-stm32f1/logic_capture.hpp>
+
+#include <array>
+#include <cstdint>
+#include <type_traits>
+#include <utility>
+
+#include <libhal-stm32f1/power_domain.hpp>
+
+#include "../src/basic_timer_reg.hpp"
+#include "../src/dma_reg.hpp"
+#include "../src/pin.hpp"
+#include "../src/rcc_reg.hpp"
+#include "helper.hpp"
+
+#include <boost/ut.hpp>
+
+namespace hal::stm32f1 {
+using namespace hal::literals;
+
+namespace {
+// The timer, DMA channel and ring of a capture have a single owner
+static_assert(!std::is_copy_constructible_v<logic_capture>);
+static_assert(!std::is_copy_assignable_v<logic_capture>);
+static_assert(std::is_nothrow_move_constructible_v<logic_capture>);
+static_assert(std::is_nothrow_move_assignable_v<logic_capture>);
+
+static_assert(capture_trigger{}.matches(0x1234));
+static_assert(capture_trigger{ .mask = 0x0003, .level = 0x0002 }.matches(
+  0xFFF2));
+static_assert(!capture_trigger{ .mask = 0x0003, .level = 0x0002 }.matches(
+  0x0003));
+
+constexpr std::array<std::uint16_t, 8> bus{ 0x10, 0x10, 0x11, 0x11,
+                                            0x11, 0x13, 0x12, 0x10 };
+static_assert(2 == find_trigger(bus, { .mask = 0x01, .level = 0x01 }));
+static_assert(5 == find_trigger(bus, { .mask = 0x03, .level = 0x03 }));
+static_assert(!find_trigger(bus, { .mask = 0x20, .level = 0x20 }));
+
+static_assert([]() {
+  std::array<sample_run, 8> runs{};
+  auto encoded = run_length_encode(bus, runs);
+  return encoded.size() == 5 &&
+         encoded[0] == sample_run{ .level = 0x10, .length = 2 } &&
+         encoded[1] == sample_run{ .level = 0x11, .length = 3 } &&
+         encoded[4] == sample_run{ .level = 0x10, .length = 1 };
+}());
+// Masking off pin 4 and 1 merges the runs
+static_assert([]() {
+  std::array<sample_run, 8> runs{};
+  auto encoded = run_length_encode(bus, runs, 0x01);
+  return encoded.size() == 3 &&
+         encoded[1] == sample_run{ .level = 0x01, .length = 4 };
+}());
+// A full destination ends the encoding
+static_assert([]() {
+  std::array<sample_run, 2> runs{};
+  auto encoded = run_length_encode(bus, runs);
+  return encoded.size() == 2 &&
+         encoded[1] == sample_run{ .level = 0x11, .length = 3 };
+}());
+// Long runs are split
+static_assert([]() {
+  std::array<std::uint16_t, 0x1'0001> samples{};
+  std::array<sample_run, 2> runs{};
+  auto encoded = run_length_encode(samples, runs);
+  return encoded.size() == 2 && encoded[0].length == 0xFFFF &&
+         encoded[1].length == 2;
+}());
+}  // namespace
+
+void logic_capture_test()
+{
+  using namespace boost::ut;
+
+  configure_default_clocks();
+
+  "hal::stm32f1::logic_capture"_test = []() {
+    stub_out_registers gpio_stub(&gpio_b_reg);
+    stub_out_registers timer_stub(&timer4_reg);
+    stub_out_registers dma_stub(&dma1);
+    stub_out_registers rcc_stub(&rcc);
+
+    auto capture = logic_capture::get('B').value();
+    std::array<std::uint16_t, 8> ring{};
+    auto started =
+      capture.start(ring,
+                    { .sample_rate = 1.0_MHz,
+                      .trigger = { .mask = 1U << 12, .level = 1U << 12 },
+                      .post_trigger_samples = 2 });
+    expect(bool{ started });
+
+    // dma1 channel 7 serves the timer4 update request
+    auto& channel = dma1->channel[6];
+    expect(static_cast<std::uint32_t>(reinterpret_cast<std::uintptr_t>(
+             &gpio_b_reg->idr)) == channel.cpar);
+    expect(8 == channel.cndtr);
+    // Very high priority, 16-bit memory, 32-bit peripheral, memory increment,
+    // circular, from the peripheral and enabled
+    expect(0x36A1U == channel.ccr);
+    expect(1U << 8 == timer4_reg->dier);
+    expect(1U == (timer4_reg->cr1 & 1U));
+
+    // The DMA writes six samples without a trigger
+    for (std::uint16_t index = 0; index < 6; index++) {
+      ring[index] = index;
+    }
+    channel.cndtr = 2;
+    dma1->isr = dma_flags::half_transfer << dma_flag_offset(7);
+    expect(!capture.poll().value());
+    expect(capture.samples().empty());
+
+    // The ring wraps, the trigger is in the sample at index 7
+    ring[6] = 6;
+    ring[7] = 0x1000;
+    ring[0] = 0x1001;
+    channel.cndtr = 7;
+    dma1->isr = dma_flags::transfer_complete << dma_flag_offset(7);
+    expect(!capture.poll().value());
+
+    // The driver cleared the flag it read, the last post trigger sample
+    // arrives
+    dma1->isr = 0;
+    ring[1] = 9;
+    channel.cndtr = 6;
+    expect(capture.poll().value());
+
+    // Oldest first, the trigger keeps its two post trigger samples
+    std::array<std::uint16_t, 8> expected{ 2, 3, 4, 5, 6, 0x1000, 0x1001, 9 };
+    expect(std::equal(expected.begin(),
+                      expected.end(),
+                      capture.samples().begin(),
+                      capture.samples().end()));
+    expect(5 == capture.trigger_index());
+    expect(0 == timer4_reg->cr1);
+    expect(0 == (channel.ccr & 1U));
+    expect(capture.poll().value());
+  };
+
+  "hal::stm32f1::logic_capture before the ring wraps"_test = []() {
+    stub_out_registers gpio_stub(&gpio_b_reg);
+    stub_out_registers timer_stub(&timer4_reg);
+    stub_out_registers dma_stub(&dma1);
+    stub_out_registers rcc_stub(&rcc);
+
+    auto capture = logic_capture::get('B').value();
+    std::array<std::uint16_t, 8> ring{};
+    expect(bool{ capture.start(ring, { .sample_rate = 1.0_MHz }) });
+
+    ring[0] = 0xABCD;
+    dma1->channel[6].cndtr = 7;
+    // Any sample meets the default trigger
+    expect(capture.poll().value());
+    expect(1 == capture.samples().size());
+    expect(0xABCD == capture.samples()[0]);
+    expect(0 == capture.trigger_index());
+  };
+
+  "hal::stm32f1::logic_capture detects the DMA lapping the search"_test =
+    []() {
+      stub_out_registers gpio_stub(&gpio_b_reg);
+      stub_out_registers timer_stub(&timer4_reg);
+      stub_out_registers dma_stub(&dma1);
+      stub_out_registers rcc_stub(&rcc);
+
+      auto capture = logic_capture::get('B').value();
+      std::array<std::uint16_t, 8> ring{};
+      constexpr capture_trigger never{ .mask = 1U << 15, .level = 1U << 15 };
+      expect(bool{ capture.start(
+        ring, { .sample_rate = 1.0_MHz, .trigger = never }) });
+
+      auto& channel = dma1->channel[6];
+      channel.cndtr = 2;
+      dma1->isr = dma_flags::half_transfer << dma_flag_offset(7);
+      expect(!capture.poll().value());
+
+      // Only the end lies between the two positions, yet the middle was
+      // passed again as well
+      channel.cndtr = 7;
+      dma1->isr = (dma_flags::half_transfer | dma_flags::transfer_complete)
+                  << dma_flag_offset(7);
+      expect(!capture.poll());
+      expect(0 == timer4_reg->cr1);
+      expect(0 == (channel.ccr & 1U));
+      expect(!capture.poll().value());
+    };
+
+  "hal::stm32f1::logic_capture stops when destroyed"_test = []() {
+    stub_out_registers gpio_stub(&gpio_b_reg);
+    stub_out_registers timer_stub(&timer4_reg);
+    stub_out_registers dma_stub(&dma1);
+    stub_out_registers rcc_stub(&rcc);
+
+    auto port_references = power_reference_count(peripheral::gpio_b);
+    std::array<std::uint16_t, 8> ring{};
+    {
+      auto capture = logic_capture::get('B').value();
+      expect(bool{ capture.start(ring, { .sample_rate = 1.0_MHz }) });
+
+      // The moved from driver no longer owns the timer
+      auto moved = std::move(capture);
+      capture.stop();
+      expect(1U == (timer4_reg->cr1 & 1U));
+    }
+    expect(0 == timer4_reg->cr1);
+    expect(0 == (dma1->channel[6].ccr & 1U));
+    expect(port_references == power_reference_count(peripheral::gpio_b));
+  };
+
+  "hal::stm32f1::logic_capture rejects bad arguments"_test = []() {
+    stub_out_registers timer_stub(&timer4_reg);
+    stub_out_registers dma_stub(&dma1);
+    stub_out_registers rcc_stub(&rcc);
+
+    expect(!logic_capture::get('Z'));
+
+    auto capture = logic_capture::get('A').value();
+    std::array<std::uint16_t, 4> ring{};
+    expect(
+      !capture.start(std::span(ring).first(1), { .sample_rate = 1.0_MHz }));
+    expect(!capture.start(
+      ring, { .sample_rate = 1.0_MHz, .post_trigger_samples = 4 }));
+    expect(!capture.start(
+      ring, { .sample_rate = 1.0_MHz, .timer = peripheral::timer9 }));
+    expect(!capture.start(ring, { .sample_rate = 1000.0_MHz }));
+    expect(!capture.poll().value());
+    expect(0 == dma1->channel[6].ccr);
+  };
+}
+}  // namespace hal::stm32f1
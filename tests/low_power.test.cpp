@@ -0,0 +1,73 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <libhal-stm32f1/low_power.hpp>
+
+#include "../src/cortex_m_reg.hpp"
+#include "../src/exti_reg.hpp"
+#include "../src/pin.hpp"
+#include "../src/pwr_reg.hpp"
+#include "../src/rcc_reg.hpp"
+#include "helper.hpp"
+
+#include <boost/ut.hpp>
+
+namespace hal::stm32f1 {
+void low_power_test()
+{
+  using namespace boost::ut;
+
+  "hal::stm32f1::stop"_test = []() {
+    stub_out_registers scb_stub(&scb);
+    stub_out_registers pwr_stub(&pwr);
+    stub_out_registers rcc_stub(&rcc);
+
+    stop({ .low_power_regulator = true });
+
+    // Stop, not standby, with the low power regulator
+    expect(0b0101 == pwr->cr);
+    // SLEEPDEEP is cleared again after waking
+    expect(0 == scb->scr);
+    // PWR is only clocked while stop() runs
+    expect(0 == rcc->apb1enr);
+  };
+
+  "hal::stm32f1::standby"_test = []() {
+    stub_out_registers scb_stub(&scb);
+    stub_out_registers pwr_stub(&pwr);
+    stub_out_registers rcc_stub(&rcc);
+
+    standby();
+
+    expect(0b0110 == pwr->cr);
+    expect(0b0100 == scb->scr);
+  };
+
+  "hal::stm32f1::configure_wakeup"_test = []() {
+    stub_out_registers exti_stub(&exti);
+    stub_out_registers afio_stub(&alternative_function_io);
+    stub_out_registers rcc_stub(&rcc);
+
+    configure_wakeup(exti_line::rtc_alarm, exti_edge::rising);
+    configure_wakeup('C', 6, exti_edge::both, wake_on::event);
+
+    expect(((1U << 17) | (1U << 6)) == exti->rtsr);
+    expect(1U << 6 == exti->ftsr);
+    expect(1U << 17 == exti->imr);
+    expect(1U << 6 == exti->emr);
+    // Port C is 2, line 6 is the third field of EXTICR2
+    expect(2U << 8 == alternative_function_io->exticr[1]);
+  };
+}
+}  // namespace hal::stm32f1
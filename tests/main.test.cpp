@@ -14,9 +14,59 @@
 
 namespace hal::stm32f1 {
 extern void output_pin_test();
+extern void flash_kv_store_test();
+extern void interrupt_test();
+extern void crc_test();
+extern void watchdog_test();
+extern void low_power_test();
+extern void power_domain_test();
+extern void peripheral_set_test();
+extern void rtc_test();
+extern void backup_registers_test();
+extern void dac_test();
+extern void fsmc_test();
+extern void sdio_test();
+extern void i2s_test();
+extern void remap_test();
+extern void clock_test();
+extern void benchmark_test();
+extern void isr_statistics_test();
+extern void itm_trace_test();
+extern void pin_test();
+extern void waveform_test();
+extern void logic_capture_test();
+extern void async_test();
+extern void deferred_work_test();
+extern void rtc_driver_test();
+extern void dac_stream_test();
 }  // namespace hal::stm32f1
 
 int main()
 {
   hal::stm32f1::output_pin_test();
+  hal::stm32f1::flash_kv_store_test();
+  hal::stm32f1::interrupt_test();
+  hal::stm32f1::crc_test();
+  hal::stm32f1::watchdog_test();
+  hal::stm32f1::low_power_test();
+  hal::stm32f1::power_domain_test();
+  hal::stm32f1::peripheral_set_test();
+  hal::stm32f1::rtc_test();
+  hal::stm32f1::backup_registers_test();
+  hal::stm32f1::dac_test();
+  hal::stm32f1::fsmc_test();
+  hal::stm32f1::sdio_test();
+  hal::stm32f1::i2s_test();
+  hal::stm32f1::remap_test();
+  hal::stm32f1::clock_test();
+  hal::stm32f1::benchmark_test();
+  hal::stm32f1::isr_statistics_test();
+  hal::stm32f1::itm_trace_test();
+  hal::stm32f1::pin_test();
+  hal::stm32f1::waveform_test();
+  hal::stm32f1::logic_capture_test();
+  hal::stm32f1::async_test();
+  hal::stm32f1::deferred_work_test();
+  hal::stm32f1::rtc_driver_test();
+  hal::stm32f1::dac_stream_test();
 }
\ No newline at end of file
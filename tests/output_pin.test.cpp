@@ -14,8 +14,88 @@
 
 #include <libhal-stm32f1/output_pin.hpp>
 
+#include <optional>
+#include <utility>
+
+#include <libhal-stm32f1/power_domain.hpp>
+
+#include "../src/pin.hpp"
+#include "../src/rcc_reg.hpp"
+#include "register_simulator.hpp"
+
+#include <boost/ut.hpp>
+
 namespace hal::stm32f1 {
 void output_pin_test()
 {
+  using namespace boost::ut;
+
+#if HAL_STM32F1_REGISTER_SIMULATOR
+  "hal::stm32f1::output_pin::get()"_test = []() {
+    simulated_registers rcc_sim(&rcc, rcc_model);
+    simulated_registers gpio_sim(&gpio_d_reg, gpio_model);
+
+    std::optional<output_pin> pin;
+    auto accesses = record_register_accesses([&pin]() {
+      pin.emplace(output_pin::get('D', 13, { .open_drain = true }).value());
+    });
+
+    // Port clock enable, then CRH
+    expect(1 << 5 == (rcc->apb2enr & (1 << 5)));
+    expect(0x4474'4444 == gpio_d_reg->crh);
+    expect(accesses.reads <= 2);
+    expect(accesses.writes <= 2);
+
+    auto trace = recorded_register_accesses();
+    expect(trace.size() == accesses.total());
+    expect(0x4002'1018 == trace.front().address);
+    expect(0x4001'1404 == trace.back().address);
+    expect(register_access_type::write == trace.back().type);
+
+    // Moving the pin hands over its reference, destroying it gives the port
+    // clock up
+    auto moved = std::move(*pin);
+    pin.reset();
+    expect(1 == power_reference_count(peripheral::gpio_d));
+    {
+      auto discard = std::move(moved);
+    }
+    expect(0 == power_reference_count(peripheral::gpio_d));
+    expect(0 == (rcc->apb2enr & (1 << 5)));
+  };
+
+  "hal::stm32f1::output_pin::level()"_test = []() {
+    simulated_registers rcc_sim(&rcc, rcc_model);
+    simulated_registers gpio_sim(&gpio_e_reg, gpio_model);
+    auto pin = output_pin::get('E', 13).value();
+
+    // Setting a level is a single write to BSRR and nothing else
+    auto accesses = record_register_accesses([&pin]() {
+      (void)pin.level(true);
+      (void)pin.level(false);
+      (void)pin.level(true);
+    });
+    expect(0 == accesses.reads);
+    expect(3 == accesses.writes);
+
+    auto trace = recorded_register_accesses();
+    expect(0x4001'1810 == trace[0].address);
+    expect(1U << 13 == trace[0].value);
+    expect(1U << 29 == trace[1].value);
+    expect(1 == trace[2].sequence - trace[1].sequence);
+    expect(1U << 13 == gpio_e_reg->odr);
+
+    // Reading it back is a single read of IDR
+    bool high = false;
+    accesses = record_register_accesses(
+      [&pin, &high]() { high = pin.level().value().state; });
+    expect(high);
+    expect(1 == accesses.reads);
+    expect(0 == accesses.writes);
+  };
+#else
+  skip / "hal::stm32f1::output_pin::get()"_test = []() {};
+  skip / "hal::stm32f1::output_pin::level()"_test = []() {};
+#endif
 }
 }  // namespace hal::stm32f1
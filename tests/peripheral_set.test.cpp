@@ -0,0 +1,96 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <libhal-stm32f1/peripheral_set.hpp>
+#include <libhal-stm32f1/power_domain.hpp>
+
+#include "../src/rcc_reg.hpp"
+#include "helper.hpp"
+
+#include <boost/ut.hpp>
+
+namespace hal::stm32f1 {
+namespace {
+constexpr peripheral_set test_set{
+  peripheral::dma1,   peripheral::crc,    peripheral::spi2,
+  peripheral::usart2, peripheral::gpio_a, peripheral::cpu,
+};
+
+static_assert(((1U << 0) | (1U << 6)) == test_set.mask(ahb_bus));
+static_assert(((1U << 14) | (1U << 17)) == test_set.mask(apb1_bus));
+static_assert((1U << 2) == test_set.mask(apb2_bus));
+static_assert(test_set.contains(peripheral::spi2));
+static_assert(!test_set.contains(peripheral::spi1));
+static_assert(!test_set.contains(peripheral::cpu));
+static_assert(peripheral_set{}.empty());
+static_assert((test_set & peripheral_set{ peripheral::crc }) ==
+              peripheral_set{ peripheral::crc });
+static_assert(peripheral_set(test_set).remove(peripheral::spi2) !=
+              test_set);
+}  // namespace
+
+void peripheral_set_test()
+{
+  using namespace boost::ut;
+
+  "hal::stm32f1::enable_peripherals"_test = []() {
+    stub_out_registers rcc_stub(&rcc);
+    rcc->apb1enr = 1U << 28;
+
+    enable_peripherals(test_set);
+
+    expect(test_set.mask(ahb_bus) == rcc->ahbenr);
+    expect((test_set.mask(apb1_bus) | (1U << 28)) == rcc->apb1enr);
+    expect(test_set.mask(apb2_bus) == rcc->apb2enr);
+    expect(test_set == (powered_peripherals() & test_set));
+
+    disable_peripherals(test_set);
+
+    expect(0 == rcc->ahbenr);
+    expect(1U << 28 == rcc->apb1enr);
+    expect(0 == rcc->apb2enr);
+  };
+
+  "hal::stm32f1::reset_peripherals"_test = []() {
+    stub_out_registers rcc_stub(&rcc);
+    rcc->apb1rstr = 1U << 3;
+
+    reset_peripherals(test_set);
+
+    // Resets are released again and unrelated bits are left alone
+    expect(1U << 3 == rcc->apb1rstr);
+    expect(0 == rcc->apb2rstr);
+    expect(0 == rcc->ahbrstr);
+  };
+
+  "hal::stm32f1::acquire_power(peripheral_set)"_test = []() {
+    stub_out_registers rcc_stub(&rcc);
+
+    acquire_power(peripheral::spi2);
+    acquire_power(test_set);
+
+    expect(2 == power_reference_count(peripheral::spi2));
+    expect(1 == power_reference_count(peripheral::crc));
+    expect(test_set.mask(apb1_bus) == rcc->apb1enr);
+
+    release_power(test_set);
+
+    expect(1U << 14 == rcc->apb1enr);
+    expect(0 == rcc->ahbenr);
+
+    release_power(peripheral::spi2);
+    expect(0 == rcc->apb1enr);
+  };
+}
+}  // namespace hal::stm32f1
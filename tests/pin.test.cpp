@@ -0,0 +1,129 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <libhal-stm32f1/pin.hpp>
+
+#include <libhal-stm32f1/power_domain.hpp>
+
+#include "../src/pin.hpp"
+#include "../src/rcc_reg.hpp"
+#include "helper.hpp"
+#include "register_simulator.hpp"
+
+#include <boost/ut.hpp>
+
+namespace hal::stm32f1 {
+namespace {
+constexpr pin_map board_pins{
+  { { .port = 'A', .pin = 9 }, push_pull_alternative_output },
+  { { .port = 'A', .pin = 10 }, input_pull_up },
+  { { .port = 'A', .pin = 2 }, input_pull_down },
+  { { .port = 'C', .pin = 13 },
+    with_speed(push_pull_gpio_output, output_speed::low) },
+};
+static_assert(board_pins.valid());
+
+// PA2 pull down in CRL, PA9 and PA10 in CRH
+static_assert(0x0000'0F00 == board_pins.ports()[0].crl_mask);
+static_assert(0x0000'0800 == board_pins.ports()[0].crl);
+static_assert(0x0000'0FF0 == board_pins.ports()[0].crh_mask);
+static_assert(0x0000'08B0 == board_pins.ports()[0].crh);
+// PA10 pulled up, PA2 pulled down and PA9 low
+static_assert(((1U << 10) | (1U << 18) | (1U << 25)) ==
+              board_pins.ports()[0].bsrr);
+static_assert(board_pins.ports()[1].empty());
+// PC13 push pull at 2 MHz
+static_assert(0x0020'0000 == board_pins.ports()[2].crh);
+
+static_assert(0b10 ==
+              with_speed(push_pull_gpio_output, output_speed::low).MODE);
+static_assert(0b00 == with_speed(input_float, output_speed::low).MODE);
+
+static_assert(!pin_map{
+  { { .port = 'B', .pin = 3 }, input_float },
+  { { .port = 'B', .pin = 3 }, push_pull_gpio_output },
+}.valid());
+static_assert(!pin_map{ { { .port = 'H', .pin = 0 }, input_float } }.valid());
+static_assert(!pin_map{ { { .port = 'A', .pin = 16 }, input_float } }.valid());
+}  // namespace
+
+void pin_test()
+{
+  using namespace boost::ut;
+
+  "hal::stm32f1::configure_pin() pull up"_test = []() {
+    stub_out_registers gpio_stub(&gpio_b_reg);
+
+    configure_pin({ .port = 'B', .pin = 12 }, input_pull_up);
+
+    expect(0b1000U == ((gpio_b_reg->crh >> 16) & 0xF));
+    expect(1U << 12 == gpio_b_reg->bsrr);
+  };
+
+#if HAL_STM32F1_REGISTER_SIMULATOR
+  "hal::stm32f1::apply_pin_map()"_test = []() {
+    simulated_registers rcc_sim(&rcc, rcc_model);
+    simulated_registers gpio_a_sim(&gpio_a_reg, gpio_model);
+    simulated_registers gpio_c_sim(&gpio_c_reg, gpio_model);
+
+    auto accesses =
+      record_register_accesses([]() { apply_pin_map(board_pins); });
+
+    // Unmapped pins keep their reset state of floating input
+    expect(0x4444'4844 == gpio_a_reg->crl);
+    expect(0x4444'48B4 == gpio_a_reg->crh);
+    expect(0x4424'4444 == gpio_c_reg->crh);
+    expect(1U << 10 == gpio_a_reg->odr);
+    expect(0 == gpio_c_reg->odr);
+
+    // One RCC read and write, then BSRR, CRL and CRH of port A and BSRR and
+    // CRH of port C
+    expect(1 + 2 + 1 == accesses.reads);
+    expect(1 + 3 + 2 == accesses.writes);
+  };
+
+  "hal::stm32f1::apply_pin_map() skips reads of full registers"_test = []() {
+    simulated_registers rcc_sim(&rcc, rcc_model);
+    simulated_registers gpio_sim(&gpio_d_reg, gpio_model);
+    auto references = power_reference_count(peripheral::gpio_d);
+    // Keep the RCC out of the recording
+    acquire_power(peripheral::gpio_d);
+
+    pin_map bus;
+    for (std::uint8_t pin = 0; pin < 8; pin++) {
+      bus.add({ .port = 'D', .pin = pin }, push_pull_gpio_output);
+    }
+
+    auto accesses = record_register_accesses([&bus]() { apply_pin_map(bus); });
+
+    expect(0x3333'3333 == gpio_d_reg->crl);
+    // BSRR and CRL
+    expect(0 == accesses.reads);
+    expect(2 == accesses.writes);
+
+    // The map holds its own reference to the port
+    release_power(peripheral::gpio_d);
+    expect(references + 1 == power_reference_count(peripheral::gpio_d));
+
+    // and does not take another one when applied again
+    apply_pin_map(bus);
+    expect(references + 1 == power_reference_count(peripheral::gpio_d));
+  };
+#else
+  skip / "hal::stm32f1::apply_pin_map()"_test = []() {};
+  skip / "hal::stm32f1::apply_pin_map() skips reads of full registers"_test =
+    []() {};
+#endif
+}
+}  // namespace hal::stm32f1
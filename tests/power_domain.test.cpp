@@ -0,0 +1,71 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <libhal-stm32f1/power_domain.hpp>
+
+#include <array>
+
+#include "../src/rcc_reg.hpp"
+#include "helper.hpp"
+
+#include <boost/ut.hpp>
+
+namespace hal::stm32f1 {
+void power_domain_test()
+{
+  using namespace boost::ut;
+
+  "hal::stm32f1::acquire_power"_test = []() {
+    stub_out_registers rcc_stub(&rcc);
+
+    acquire_power(peripheral::spi2);
+    acquire_power(peripheral::spi2);
+    acquire_power(peripheral::gpio_c);
+
+    expect(2 == power_reference_count(peripheral::spi2));
+    expect(1U << 14 == rcc->apb1enr);
+    expect(1U << 4 == rcc->apb2enr);
+
+    release_power(peripheral::spi2);
+    expect(is_powered(peripheral::spi2));
+
+    release_power(peripheral::spi2);
+    expect(!is_powered(peripheral::spi2));
+    expect(0 == rcc->apb1enr);
+
+    // Extra releases are ignored
+    release_power(peripheral::spi2);
+    expect(0 == power_reference_count(peripheral::spi2));
+
+    release_power(peripheral::gpio_c);
+  };
+
+  "hal::stm32f1::enabled_peripherals"_test = []() {
+    stub_out_registers rcc_stub(&rcc);
+    rcc->ahbenr = (1U << 0) | (1U << 6);
+    rcc->apb2enr = 1U << 2;
+
+    std::array<peripheral, 8> buffer{};
+    auto enabled = enabled_peripherals(buffer);
+
+    expect(3 == enabled.size());
+    expect(peripheral::dma1 == enabled[0]);
+    expect(peripheral::crc == enabled[1]);
+    expect(peripheral::gpio_a == enabled[2]);
+
+    std::array<peripheral, 1> small{};
+    expect(1 == enabled_peripherals(small).size());
+  };
+}
+}  // namespace hal::stm32f1
@@ -0,0 +1,475 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+
+#include "../src/flash_reg.hpp"
+#include "../src/pin.hpp"
+#include "../src/rcc_reg.hpp"
+
+#if defined(__linux__) && defined(__x86_64__)
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <sys/mman.h>
+#include <ucontext.h>
+#include <unistd.h>
+
+/// Register accesses can be traced on this host
+#define HAL_STM32F1_REGISTER_SIMULATOR 1
+#else
+/// Tests that need the simulator are reported as skipped on this host
+#define HAL_STM32F1_REGISTER_SIMULATOR 0
+#endif
+
+namespace hal::stm32f1 {
+/// Direction of a register access
+enum class register_access_type : std::uint8_t
+{
+  read,
+  write,
+};
+
+/// One access to a simulated register
+struct register_access
+{
+  /// Position of the access among all accesses since the trace started
+  std::uint32_t sequence;
+  /// Address of the register on the device
+  std::uintptr_t address;
+  /// Read or write
+  register_access_type type;
+  /// Value read, or value written before the model reacted to it
+  std::uint32_t value;
+};
+
+/// Number of register accesses made by an operation
+struct register_access_count
+{
+  std::size_t reads = 0;
+  std::size_t writes = 0;
+
+  [[nodiscard]] constexpr std::size_t total() const
+  {
+    return reads + writes;
+  }
+};
+
+/**
+ * @brief Behaviour of a simulated peripheral
+ *
+ * `reset` loads the reset values. `write` runs after every write with the
+ * byte offset of the register written and emulates the hardware, such as
+ * setting a ready flag once its enable bit is set.
+ */
+struct register_model
+{
+  void (*reset)(void* p_registers) = nullptr;
+  void (*write)(void* p_registers, std::uintptr_t p_offset) = nullptr;
+};
+
+#if HAL_STM32F1_REGISTER_SIMULATOR
+namespace register_simulator_detail {
+struct region
+{
+  std::uintptr_t begin = 0;
+  std::size_t size = 0;
+  std::uintptr_t device_address = 0;
+  register_model model{};
+};
+
+struct pending_access
+{
+  region* owner = nullptr;
+  std::uintptr_t address = 0;
+  bool write = false;
+};
+
+/// Trap flag of EFLAGS, executes one instruction then raises SIGTRAP
+constexpr long long trap_flag = 0x100;
+/// Page fault error code bit set by writes
+constexpr long long write_fault = 0x2;
+
+inline std::array<region, 16> regions{};
+inline std::array<register_access, 4096> trace{};
+inline std::size_t trace_length = 0;
+inline register_access_count counts{};
+inline std::uint32_t sequence = 0;
+inline bool recording = false;
+inline pending_access pending{};
+inline std::size_t active_regions = 0;
+inline struct sigaction previous_segv_action = {};
+inline struct sigaction previous_trap_action = {};
+
+/// Stop the test run, as a broken simulator would make tests pass silently
+[[noreturn]] inline void simulator_failure(const char* p_reason)
+{
+  std::fprintf(stderr, "register simulator: %s\n", p_reason);
+  std::abort();
+}
+
+inline std::size_t page_size()
+{
+  return static_cast<std::size_t>(sysconf(_SC_PAGESIZE));
+}
+
+inline void protect(const region& p_region, bool p_accessible)
+{
+  mprotect(reinterpret_cast<void*>(p_region.begin),
+           p_region.size,
+           p_accessible ? PROT_READ | PROT_WRITE : PROT_NONE);
+}
+
+inline region* find_region(std::uintptr_t p_address)
+{
+  for (auto& candidate : regions) {
+    if (candidate.size != 0 && candidate.begin <= p_address &&
+        p_address < candidate.begin + candidate.size) {
+      return &candidate;
+    }
+  }
+  return nullptr;
+}
+
+/// The access faulted because the page is protected. Unprotect it and
+/// single step the instruction, on_trap() finishes the access.
+inline void on_fault(int, siginfo_t* p_info, void* p_context)
+{
+  auto address = reinterpret_cast<std::uintptr_t>(p_info->si_addr);
+  auto* owner = find_region(address);
+  if (owner == nullptr) {
+    // A genuine crash, let it fault again into the previous handler
+    sigaction(SIGSEGV, &previous_segv_action, nullptr);
+    return;
+  }
+
+  auto& registers = static_cast<ucontext_t*>(p_context)->uc_mcontext;
+  pending = pending_access{
+    .owner = owner,
+    .address = address & ~std::uintptr_t{ 3 },
+    .write = (registers.gregs[REG_ERR] & write_fault) != 0,
+  };
+  protect(*owner, true);
+  registers.gregs[REG_EFL] |= trap_flag;
+}
+
+inline void on_trap(int p_signal, siginfo_t* p_info, void* p_context)
+{
+  auto& registers = static_cast<ucontext_t*>(p_context)->uc_mcontext;
+  if (pending.owner == nullptr) {
+    if (previous_trap_action.sa_flags & SA_SIGINFO) {
+      previous_trap_action.sa_sigaction(p_signal, p_info, p_context);
+    }
+    return;
+  }
+
+  auto& owner = *pending.owner;
+  auto offset = pending.address - owner.begin;
+  auto value = *reinterpret_cast<std::uint32_t*>(pending.address);
+
+  if (recording) {
+    if (pending.write) {
+      counts.writes++;
+    } else {
+      counts.reads++;
+    }
+    if (trace_length < trace.size()) {
+      trace[trace_length++] = register_access{
+        .sequence = sequence,
+        .address = owner.device_address + offset,
+        .type = pending.write ? register_access_type::write
+                              : register_access_type::read,
+        .value = value,
+      };
+    }
+    sequence++;
+  }
+
+  if (pending.write && owner.model.write) {
+    owner.model.write(reinterpret_cast<void*>(owner.begin), offset);
+  }
+
+  protect(owner, false);
+  pending = pending_access{};
+  registers.gregs[REG_EFL] &= ~trap_flag;
+}
+
+inline void install_handlers()
+{
+  struct sigaction action = {};
+  action.sa_flags = SA_SIGINFO | SA_NODEFER;
+  sigemptyset(&action.sa_mask);
+
+  action.sa_sigaction = on_fault;
+  sigaction(SIGSEGV, &action, &previous_segv_action);
+  action.sa_sigaction = on_trap;
+  sigaction(SIGTRAP, &action, &previous_trap_action);
+}
+
+inline void remove_handlers()
+{
+  sigaction(SIGSEGV, &previous_segv_action, nullptr);
+  sigaction(SIGTRAP, &previous_trap_action, nullptr);
+}
+}  // namespace register_simulator_detail
+
+/**
+ * @brief Replaces a register map with memory that traces every access
+ *
+ * Like stub_out_registers, but the registers live on their own page, which
+ * is kept inaccessible. Each access faults, is carried out with the page
+ * unlocked for a single instruction, and is then recorded with the device
+ * address it would have had on the stm32f1. After a write the model of the
+ * peripheral runs, so status flags such as PLLRDY follow their enable bits
+ * and code that waits on them runs to completion on the host.
+ *
+ * Only available where HAL_STM32F1_REGISTER_SIMULATOR is 1, currently Linux
+ * on x86_64, as it relies on the page fault error code and the trap flag.
+ *
+ * @tparam T - register map type
+ */
+template<class T>
+class simulated_registers
+{
+public:
+  simulated_registers(T** p_register_pointer, register_model p_model = {})
+    : m_register_pointer(p_register_pointer)
+    , m_original(*p_register_pointer)
+  {
+    using namespace register_simulator_detail;
+
+    for (auto& candidate : regions) {
+      if (candidate.size == 0) {
+        m_region = &candidate;
+        break;
+      }
+    }
+    if (m_region == nullptr) {
+      simulator_failure("every region is in use, raise the size of regions");
+    }
+
+    auto page = page_size();
+    auto size = (sizeof(T) + page - 1) / page * page;
+    auto* memory = mmap(nullptr,
+                        size,
+                        PROT_READ | PROT_WRITE,
+                        MAP_PRIVATE | MAP_ANONYMOUS,
+                        -1,
+                        0);
+    if (memory == MAP_FAILED) {
+      simulator_failure("mmap of the register page failed");
+    }
+
+    if (p_model.reset) {
+      p_model.reset(memory);
+    }
+
+    *m_region = region{
+      .begin = reinterpret_cast<std::uintptr_t>(memory),
+      .size = size,
+      .device_address = reinterpret_cast<std::uintptr_t>(m_original),
+      .model = p_model,
+    };
+
+    if (active_regions++ == 0) {
+      install_handlers();
+    }
+    protect(*m_region, false);
+    *m_register_pointer = static_cast<T*>(memory);
+  }
+
+  simulated_registers(const simulated_registers&) = delete;
+  simulated_registers& operator=(const simulated_registers&) = delete;
+
+  ~simulated_registers()
+  {
+    using namespace register_simulator_detail;
+
+    *m_register_pointer = m_original;
+    munmap(reinterpret_cast<void*>(m_region->begin), m_region->size);
+    *m_region = region{};
+    if (--active_regions == 0) {
+      remove_handlers();
+    }
+  }
+
+private:
+  T** m_register_pointer;
+  T* m_original;
+  register_simulator_detail::region* m_region = nullptr;
+};
+
+/**
+ * @brief Record the register accesses made by an operation
+ *
+ * Accesses made outside of an operation, such as test expectations reading
+ * a register, are not recorded.
+ *
+ * @param p_operation - callable to run
+ * @return register_access_count - number of reads and writes made
+ */
+template<class Operation>
+register_access_count record_register_accesses(Operation&& p_operation)
+{
+  using namespace register_simulator_detail;
+
+  trace_length = 0;
+  counts = {};
+  sequence = 0;
+  recording = true;
+  p_operation();
+  recording = false;
+  return counts;
+}
+
+/**
+ * @brief Get the accesses recorded so far by record_register_accesses()
+ *
+ * Can be sampled from within the operation to measure part of it.
+ *
+ * @return register_access_count - reads and writes recorded so far
+ */
+inline register_access_count current_register_access_count()
+{
+  return register_simulator_detail::counts;
+}
+
+/**
+ * @brief Get the accesses recorded by the last record_register_accesses()
+ *
+ * Holds up to the first 4096 accesses.
+ *
+ * @return std::span<const register_access> - accesses in program order
+ */
+inline std::span<const register_access> recorded_register_accesses()
+{
+  using namespace register_simulator_detail;
+  return std::span(trace).first(trace_length);
+}
+#endif
+
+namespace register_simulator_detail {
+/// Hardware sets a ready flag once its enable bit is set
+inline void follow(volatile std::uint32_t& p_register,
+                   std::uint32_t p_enable,
+                   std::uint32_t p_ready)
+{
+  if (p_register & (1U << p_enable)) {
+    p_register = p_register | (1U << p_ready);
+  } else {
+    p_register = p_register & ~(1U << p_ready);
+  }
+}
+}  // namespace register_simulator_detail
+
+/// RCC with oscillators and the PLL that lock as soon as they are enabled
+inline constexpr register_model rcc_model{
+  .reset =
+    [](void* p_registers) {
+      auto& reg = *static_cast<reset_and_clock_control_t*>(p_registers);
+      // HSI on and ready, calibration at its midpoint
+      reg.cr = 0x0000'0083;
+      reg.csr = 0x0C00'0000;
+    },
+  .write =
+    [](void* p_registers, std::uintptr_t p_offset) {
+      using register_simulator_detail::follow;
+      auto& reg = *static_cast<reset_and_clock_control_t*>(p_registers);
+
+      switch (p_offset) {
+        case offsetof(reset_and_clock_control_t, cr):
+          follow(reg.cr, 0, 1);    // HSION -> HSIRDY
+          follow(reg.cr, 16, 17);  // HSEON -> HSERDY
+          follow(reg.cr, 24, 25);  // PLLON -> PLLRDY
+          break;
+        case offsetof(reset_and_clock_control_t, cfgr): {
+          // SWS follows SW
+          auto select = reg.cfgr & 0b11U;
+          if (select != 0b11U) {
+            reg.cfgr = (reg.cfgr & ~0b1100U) | (select << 2);
+          }
+          break;
+        }
+        case offsetof(reset_and_clock_control_t, bdcr):
+          if (reg.bdcr & (1U << 16)) {
+            // BDRST resets the backup domain
+            reg.bdcr = 1U << 16;
+          }
+          follow(reg.bdcr, 0, 1);  // LSEON -> LSERDY
+          break;
+        case offsetof(reset_and_clock_control_t, csr):
+          follow(reg.csr, 0, 1);  // LSION -> LSIRDY
+          break;
+        default:
+          break;
+      }
+    },
+};
+
+/// Flash interface, only the reset value of ACR is modelled
+inline constexpr register_model flash_model{
+  .reset =
+    [](void* p_registers) {
+      static_cast<flash_t*>(p_registers)->acr = 0x30;
+    },
+};
+
+/// GPIO port with every output looped back to its input
+inline constexpr register_model gpio_model{
+  .reset =
+    [](void* p_registers) {
+      auto& reg = *static_cast<gpio_t*>(p_registers);
+      // Every pin a floating input
+      reg.crl = 0x4444'4444;
+      reg.crh = 0x4444'4444;
+    },
+  .write =
+    [](void* p_registers, std::uintptr_t p_offset) {
+      auto& reg = *static_cast<gpio_t*>(p_registers);
+
+      switch (p_offset) {
+        case offsetof(gpio_t, bsrr): {
+          std::uint32_t request = reg.bsrr;
+          // Set wins when a pin is both set and reset
+          reg.odr = ((reg.odr & ~(request >> 16)) | request) & 0xFFFF;
+          reg.bsrr = 0;
+          break;
+        }
+        case offsetof(gpio_t, brr):
+          reg.odr = reg.odr & ~reg.brr;
+          reg.brr = 0;
+          break;
+        default:
+          break;
+      }
+      reg.idr = reg.odr;
+    },
+};
+
+/// AFIO, where SWJ_CFG is write only and reads as 0
+inline constexpr register_model afio_model{
+  .write =
+    [](void* p_registers, std::uintptr_t p_offset) {
+      auto& reg = *static_cast<alternative_function_io_t*>(p_registers);
+      if (p_offset == offsetof(alternative_function_io_t, mapr)) {
+        reg.mapr = reg.mapr & ~(0b111U << 24);
+      }
+    },
+};
+}  // namespace hal::stm32f1
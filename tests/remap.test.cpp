@@ -0,0 +1,96 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <libhal-stm32f1/remap.hpp>
+
+#include <array>
+#include <cstdint>
+
+#include <libhal-stm32f1/pin.hpp>
+
+#include "../src/pin.hpp"
+#include "../src/rcc_reg.hpp"
+#include "helper.hpp"
+
+#include <boost/ut.hpp>
+
+namespace hal::stm32f1 {
+namespace {
+constexpr std::array board_remaps{
+  remap::usart1_full,
+  remap::i2c1_full,
+  remap::timer2_full,
+  remap::spi1_none,
+};
+static_assert(!find_remap_conflict(board_remaps,
+                                   debug_port::serial_wire_only));
+
+// timer2_full takes PA15 and PB3 from JTAG
+static_assert(find_remap_conflict(board_remaps)->pin == pin_id{ 'A', 15 });
+
+// USART1 remapped onto the default I2C1 pins
+constexpr std::array shared_pins{ remap::usart1_full, remap::i2c1_none };
+static_assert(find_remap_conflict(shared_pins)->pin == pin_id{ 'B', 6 });
+
+// Two settings of the same field
+constexpr std::array same_field{ remap::usart3_partial, remap::usart3_full };
+static_assert(find_remap_conflict(same_field)->second == 1);
+
+// The same setting requested by two drivers
+constexpr std::array same_setting{ remap::can_partial, remap::can_partial };
+static_assert(!find_remap_conflict(same_setting));
+
+static_assert(2 == remap::usart1_full.used_pins().size());
+static_assert(debug_pins(debug_port::disabled).empty());
+
+constexpr std::uint32_t swj_config = 0b111U << 24;
+}  // namespace
+
+void remap_test()
+{
+  using namespace boost::ut;
+
+  "hal::stm32f1::apply_remaps()"_test = []() {
+    stub_out_registers afio_stub(&alternative_function_io);
+    stub_out_registers rcc_stub(&rcc);
+
+    apply_remaps(board_remaps);
+
+    // USART1 bit 2, I2C1 bit 1, TIM2 bits 8-9, SPI1 bit 0 cleared
+    expect(((1U << 2) | (1U << 1) | (0b11U << 8)) ==
+           (alternative_function_io->mapr & ~swj_config));
+    // AFIO only needs a clock during the write
+    expect(0 == rcc->apb2enr);
+  };
+
+  "hal::stm32f1::configure_debug_port() survives later remaps"_test = []() {
+    stub_out_registers afio_stub(&alternative_function_io);
+    stub_out_registers rcc_stub(&rcc);
+
+    release_jtag_pins();
+    expect((0b010U << 24) ==
+           (alternative_function_io->mapr & swj_config));
+
+    // SWJ_CFG reads back as 0, a read-modify-write would lose it
+    alternative_function_io->mapr = 0;
+    apply_remap(remap::usart1_none);
+    expect((0b010U << 24) ==
+           (alternative_function_io->mapr & swj_config));
+    expect(0 == (alternative_function_io->mapr & (1U << 2)));
+
+    configure_debug_port(debug_port::full_swj);
+    expect(0 == (alternative_function_io->mapr & swj_config));
+  };
+}
+}  // namespace hal::stm32f1
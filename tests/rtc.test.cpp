@@ -0,0 +1,175 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <libhal-stm32f1/rtc.hpp>
+
+#include <cstdint>
+#include <utility>
+
+#include <libhal-stm32f1/clock.hpp>
+#include <libhal-stm32f1/power_domain.hpp>
+
+#include "../src/flash_reg.hpp"
+#include "../src/pwr_reg.hpp"
+#include "../src/rcc_reg.hpp"
+#include "../src/rtc_reg.hpp"
+#include "register_simulator.hpp"
+
+#include <boost/ut.hpp>
+
+namespace hal::stm32f1 {
+namespace {
+constexpr date_time leap_day{
+  .year = 2024,
+  .month = 2,
+  .day = 29,
+  .hour = 13,
+  .minute = 37,
+  .second = 42,
+  .weekday = 4,
+};
+
+static_assert(0 == to_epoch(date_time{}));
+static_assert(date_time{} == to_date_time(0));
+static_assert(1'709'213'862 == to_epoch(leap_day));
+static_assert(leap_day == to_date_time(1'709'213'862));
+// Last second representable by the 32-bit counter
+static_assert(date_time{ .year = 2106,
+                         .month = 2,
+                         .day = 7,
+                         .hour = 6,
+                         .minute = 28,
+                         .second = 15,
+                         .weekday = 0 } == to_date_time(0xFFFF'FFFF));
+
+// 32.768kHz LSE with a prescaler of 32767
+static_assert(0 == rtc_subsecond_nanoseconds(32767, 32767));
+static_assert(500'000'000 == rtc_subsecond_nanoseconds(32767, 16383));
+static_assert(999'969'482 == rtc_subsecond_nanoseconds(32767, 0));
+
+/// RTC whose writes complete at once and whose registers are always
+/// synchronized
+constexpr register_model rtc_model{
+  .reset =
+    [](void* p_registers) {
+      static_cast<real_time_clock_t*>(p_registers)->crl = 0b10'1000;
+    },
+  .write =
+    [](void* p_registers, std::uintptr_t) {
+      auto& reg = *static_cast<real_time_clock_t*>(p_registers);
+      reg.crl = reg.crl | 0b10'1000;
+    },
+};
+
+/// RTC without a clock, whose registers never synchronize
+constexpr register_model stopped_rtc_model{
+  .reset =
+    [](void* p_registers) {
+      static_cast<real_time_clock_t*>(p_registers)->crl = 0b10'0000;
+    },
+};
+}  // namespace
+
+void rtc_test()
+{
+  using namespace boost::ut;
+
+  "hal::stm32f1::to_date_time round trip"_test = []() {
+    for (std::uint32_t epoch = 0; epoch < 0xFFFF'0000; epoch += 86'399 * 7) {
+      expect(epoch == to_epoch(to_date_time(epoch)));
+    }
+  };
+}
+
+/// Runs after the tests that expect the clock tree to be unconfigured
+void rtc_driver_test()
+{
+  using namespace boost::ut;
+
+#if HAL_STM32F1_REGISTER_SIMULATOR
+  "hal::stm32f1::rtc writes only with backup write access"_test = []() {
+    simulated_registers rcc_sim(&rcc, rcc_model);
+    simulated_registers pwr_sim(&pwr);
+    simulated_registers rtc_sim(&rtc_reg, rtc_model);
+    simulated_registers flash_sim(&flash, flash_model);
+
+    // The RTC runs from the 40kHz LSI by default, which is started for it
+    configure_clocks(clock_tree{ .rtc = { .enable = true } });
+    expect(40'000U == frequency_hz(peripheral::rtc));
+    expect(0b11U == (rcc->csr & 0b11U));
+
+    auto power_before = power_reference_count(peripheral::power);
+    std::uint32_t prescaler = 0;
+    (void)record_register_accesses([&prescaler]() {
+      auto clock = rtc::get().value();
+      expect(clock.set(1'700'000'000).has_value());
+      (void)clock.on_second(nullptr);
+      prescaler = (rtc_reg->prlh << 16) | rtc_reg->prll;
+
+      // The handler clears its flag without taking power references
+      auto power_references = power_reference_count(peripheral::power);
+      rtc_interrupt();
+      expect(power_references == power_reference_count(peripheral::power));
+
+      // Write access and the clocks move with the driver
+      auto moved = std::move(clock);
+      expect(0U != (pwr->cr & (1U << 8)));
+    });
+    expect(39'999U == prescaler);
+
+    // Every RTC write happens while PWR_CR.DBP is set
+    constexpr std::uintptr_t pwr_cr = 0x4000'7000;
+    constexpr std::uintptr_t rtc_begin = 0x4000'2800;
+    constexpr std::uintptr_t rtc_end = rtc_begin + sizeof(real_time_clock_t);
+    bool write_access = false;
+    std::size_t rtc_writes = 0;
+    for (const auto& access : recorded_register_accesses()) {
+      if (access.type != register_access_type::write) {
+        continue;
+      }
+      if (access.address == pwr_cr) {
+        write_access = access.value & (1U << 8);
+      } else if (rtc_begin <= access.address && access.address < rtc_end) {
+        rtc_writes++;
+        expect(write_access);
+      }
+    }
+    expect(rtc_writes >= 6);
+    expect(!write_access);
+    expect(0U == (pwr->cr & (1U << 8)));
+    expect(0 == power_reference_count(peripheral::backup_clock));
+    expect(power_before == power_reference_count(peripheral::power));
+  };
+
+  "hal::stm32f1::rtc fails when its clock is not running"_test = []() {
+    simulated_registers rcc_sim(&rcc, rcc_model);
+    simulated_registers pwr_sim(&pwr);
+    simulated_registers rtc_sim(&rtc_reg, stopped_rtc_model);
+    simulated_registers flash_sim(&flash, flash_model);
+    configure_clocks(clock_tree{ .rtc = { .enable = true } });
+
+    auto clock = rtc::get();
+
+    expect(!clock.has_value());
+    expect(0 == power_reference_count(peripheral::backup_clock));
+    expect(0U == (pwr->cr & (1U << 8)));
+  };
+#else
+  skip / "hal::stm32f1::rtc writes only with backup write access"_test =
+    []() {};
+  skip / "hal::stm32f1::rtc fails when its clock is not running"_test =
+    []() {};
+#endif
+}
+}  // namespace hal::stm32f1
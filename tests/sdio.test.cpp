@@ -0,0 +1,106 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <libhal-stm32f1/sdio.hpp>
+
+#include <array>
+#include <type_traits>
+
+#include <libhal-stm32f1/power_domain.hpp>
+
+#include "../src/pin.hpp"
+#include "../src/rcc_reg.hpp"
+#include "../src/sdio_reg.hpp"
+#include "helper.hpp"
+
+#include <boost/ut.hpp>
+
+namespace hal::stm32f1 {
+using namespace hal::literals;
+
+namespace {
+// 72MHz HCLK
+static_assert(178 == calculate_sdio_clock_divider(72.0_MHz, 400.0_kHz));
+static_assert(1 == calculate_sdio_clock_divider(72.0_MHz, 24.0_MHz));
+static_assert(0 == calculate_sdio_clock_divider(48.0_MHz, 25.0_MHz));
+// 8MHz / 257 is still above 25kHz
+static_assert(!calculate_sdio_clock_divider(8.0_MHz, 25.0_kHz));
+static_assert(!calculate_sdio_clock_divider(0.0_MHz, 400.0_kHz));
+// Integer Hz, as given by frequency_hz()
+static_assert(178 == calculate_sdio_clock_divider(72'000'000U, 400'000U));
+static_assert(1 == calculate_sdio_clock_divider(72'000'000U, 24'000'000U));
+static_assert(!calculate_sdio_clock_divider(8'000'000U, 25'000U));
+
+// 8GB SDHC card, C_SIZE = 0x3B37
+constexpr std::array<std::uint32_t, 4> sdhc_csd{
+  0x400E'0032,
+  0x5B59'0000,
+  0x3B37'7F80,
+  0x0A40'4000,
+};
+static_assert(1 == sd_csd_field(sdhc_csd, 127, 126));
+static_assert(0x3B37 == sd_csd_field(sdhc_csd, 69, 48));
+static_assert((0x3B37 + 1) * 1024 == sd_block_count(sdhc_csd));
+
+// 1GB SDSC card, C_SIZE = 0xF2F spanning RESP2 and RESP3, C_SIZE_MULT = 7,
+// READ_BL_LEN = 9
+constexpr std::array<std::uint32_t, 4> sdsc_csd{
+  0x0000'0000,
+  0x0009'03CB,
+  0xC003'8000,
+  0x0000'0000,
+};
+static_assert(0 == sd_csd_field(sdsc_csd, 127, 126));
+static_assert(0xF2F == sd_csd_field(sdsc_csd, 73, 62));
+static_assert(7 == sd_csd_field(sdsc_csd, 49, 47));
+static_assert(0xF30 * 512 == sd_block_count(sdsc_csd));
+
+// A card owns the controller and its power references
+static_assert(!std::is_copy_constructible_v<sdio_card>);
+static_assert(!std::is_copy_assignable_v<sdio_card>);
+static_assert(std::is_nothrow_move_constructible_v<sdio_card>);
+static_assert(std::is_nothrow_move_assignable_v<sdio_card>);
+}  // namespace
+
+void sdio_test()
+{
+  using namespace boost::ut;
+
+  "hal::stm32f1::sd_csd_field"_test = []() {
+    std::array<std::uint32_t, 4> csd{ 0x8000'0000, 0, 0, 0x0000'0001 };
+    expect(1 == sd_csd_field(csd, 127, 127));
+    expect(1 == sd_csd_field(csd, 0, 0));
+    expect(0b10 == sd_csd_field(csd, 127, 126));
+    expect(0 == sd_csd_field(csd, 126, 1));
+  };
+
+  "hal::stm32f1::sdio_card::get powers down when no card answers"_test =
+    []() {
+      stub_out_registers sdio_stub(&sdio_reg);
+      stub_out_registers gpio_c_stub(&gpio_c_reg);
+      stub_out_registers gpio_d_stub(&gpio_d_reg);
+      stub_out_registers rcc_stub(&rcc);
+
+      auto references = power_reference_count(peripheral::sdio);
+      // Every command times out
+      sdio_reg->sta = sdio_status::command_timeout;
+
+      expect(!sdio_card::get());
+      // Identification started before failing
+      expect(0xFFFF'FFFF == sdio_reg->dtimer);
+      expect(sdio_power::off == sdio_reg->power);
+      expect(references == power_reference_count(peripheral::sdio));
+    };
+}
+}  // namespace hal::stm32f1
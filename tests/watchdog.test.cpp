@@ -0,0 +1,143 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <libhal-stm32f1/watchdog.hpp>
+
+#include <chrono>
+
+#include "../src/watchdog_reg.hpp"
+#include "helper.hpp"
+
+#include <boost/ut.hpp>
+
+namespace hal::stm32f1 {
+namespace {
+using namespace std::chrono_literals;
+
+// 1s at 40kHz is 40000 ticks, which needs a divider of 16 to fit in 4096
+constexpr auto one_second =
+  calculate_independent_watchdog_timing(1s, 40'000.0f).value();
+static_assert(2 == one_second.prescaler);
+static_assert(2499 == one_second.reload);
+static_assert(!calculate_independent_watchdog_timing(60s, 40'000.0f));
+static_assert(!calculate_independent_watchdog_timing(0s, 40'000.0f));
+// Integer Hz, as given by frequency_hz()
+static_assert(2499 ==
+              calculate_independent_watchdog_timing(1s, 40'000U)->reload);
+
+// By default the timing is sized for the fastest LSI, 60kHz, so 1s is 60000
+// ticks, which needs a divider of 16 for 3750 ticks.
+constexpr auto one_second_default =
+  calculate_independent_watchdog_timing(1s).value();
+static_assert(2 == one_second_default.prescaler);
+static_assert(3749 == one_second_default.reload);
+static_assert(calculate_independent_watchdog_timing(17s));
+static_assert(!calculate_independent_watchdog_timing(18s));
+
+/// The reset never comes sooner than requested, even with the fastest LSI
+constexpr bool never_resets_early(hal::time_duration p_timeout)
+{
+  auto timing = calculate_independent_watchdog_timing(p_timeout).value();
+  auto ticks = (timing.reload + 1ULL) * (4ULL << timing.prescaler);
+  auto fastest_reset_ns =
+    ticks * 1'000'000'000ULL / internal_low_speed_oscillator_max_hz;
+  return static_cast<std::uint64_t>(p_timeout.count()) <= fastest_reset_ns;
+}
+static_assert(never_resets_early(1ms));
+static_assert(never_resets_early(7ms));
+static_assert(never_resets_early(333ms));
+static_assert(never_resets_early(1s));
+static_assert(never_resets_early(17s));
+
+// 36MHz PCLK1 / 4096 = 8789Hz, 20ms = 175.8 ticks, which needs a timer base
+// of 2 (2197Hz) for 44 ticks.
+constexpr auto twenty_milliseconds =
+  calculate_window_watchdog_timing(20ms, 0ms, 36'000'000.0f).value();
+static_assert(2 == twenty_milliseconds.timer_base);
+static_assert(0x3F + 44 == twenty_milliseconds.counter);
+static_assert(twenty_milliseconds.counter == twenty_milliseconds.window);
+
+constexpr auto windowed =
+  calculate_window_watchdog_timing(20ms, 10ms, 36'000'000.0f).value();
+static_assert(windowed.counter - 22 == windowed.window);
+static_assert(!calculate_window_watchdog_timing(20ms, 20ms, 36'000'000.0f));
+static_assert(!calculate_window_watchdog_timing(100ms, 0ms, 36'000'000.0f));
+// Integer Hz, as given by frequency_hz()
+static_assert(
+  0x3F + 44 ==
+  calculate_window_watchdog_timing(20ms, 0ms, 36'000'000U)->counter);
+static_assert(!calculate_window_watchdog_timing(100ms, 0ms, 36'000'000U));
+
+static_assert(0x2200'0000 == sram_bit_band_alias(0x2000'0000, 0));
+static_assert(0x2200'0084 == sram_bit_band_alias(0x2000'0004, 1));
+
+struct fake_watchdog
+{
+  void feed()
+  {
+    feeds++;
+  }
+  int feeds = 0;
+};
+}  // namespace
+
+void watchdog_test()
+{
+  using namespace boost::ut;
+
+  "hal::stm32f1::independent_watchdog::get"_test = []() {
+    stub_out_registers iwdg_stub(&iwdg);
+
+    auto watchdog = independent_watchdog::get(1s);
+    auto expected = calculate_independent_watchdog_timing(1s).value();
+
+    expect(bool{ watchdog });
+    expect(independent_watchdog_key::reload == iwdg->kr);
+    expect(expected.prescaler == iwdg->pr);
+    expect(expected.reload == iwdg->rlr);
+  };
+
+  "hal::stm32f1::watchdog_check_in"_test = []() {
+    fake_watchdog watchdog;
+    watchdog_check_in check_in;
+    auto first = check_in.add_task().value();
+    auto second = check_in.add_task().value();
+
+    expect(!check_in.feed_if_ready(watchdog));
+
+    first.check_in();
+    expect(!check_in.ready());
+    expect(!check_in.feed_if_ready(watchdog));
+
+    second.check_in();
+    expect(check_in.ready());
+    expect(check_in.feed_if_ready(watchdog));
+    expect(1 == watchdog.feeds);
+
+    // Check-ins are consumed by a feed
+    expect(!check_in.ready());
+    second.check_in();
+    expect(!check_in.feed_if_ready(watchdog));
+    expect(1 == watchdog.feeds);
+  };
+
+  "hal::stm32f1::watchdog_check_in limit"_test = []() {
+    watchdog_check_in check_in;
+    for (int i = 0; i < 32; i++) {
+      expect(bool{ check_in.add_task() });
+    }
+    expect(!check_in.add_task());
+  };
+}
+}  // namespace hal::stm32f1
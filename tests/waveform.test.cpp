@@ -0,0 +1,237 @@
+// Copyright 2023 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <libhal-stm32f1/waveform.hpp>
+
+#include <array>
+#include <cstdint>
+#include <type_traits>
+#include <utility>
+
+#include "../src/basic_timer_reg.hpp"
+#include "../src/dma_reg.hpp"
+#include "../src/pin.hpp"
+#include "../src/rcc_reg.hpp"
+#include "helper.hpp"
+
+#include <boost/ut.hpp>
+
+namespace hal::stm32f1 {
+using namespace hal::literals;
+
+namespace {
+// The timer and DMA channel of a waveform have a single owner
+static_assert(!std::is_copy_constructible_v<gpio_waveform>);
+static_assert(!std::is_copy_assignable_v<gpio_waveform>);
+static_assert(std::is_nothrow_move_constructible_v<gpio_waveform>);
+static_assert(std::is_nothrow_move_assignable_v<gpio_waveform>);
+
+static_assert(0x0004'0001 == bsrr_word(1U << 0, 1U << 2));
+static_assert(0 == bsrr_word(0));
+
+constexpr auto single_strip = []() {
+  std::array<std::uint32_t, ws2812_word_count(1)> words{};
+  std::array<std::uint8_t, 1> data{ 0b1000'0000 };
+  encode_ws2812(words, 3, data);
+  return words;
+}();
+// A 1 bit stays high for two steps
+static_assert(bsrr_word(1U << 3) == single_strip[0]);
+static_assert(0 == single_strip[1]);
+static_assert(bsrr_word(0, 1U << 3) == single_strip[2]);
+// A 0 bit drops after one step
+static_assert(bsrr_word(1U << 3) == single_strip[3]);
+static_assert(bsrr_word(0, 1U << 3) == single_strip[4]);
+static_assert(bsrr_word(0, 1U << 3) == single_strip[5]);
+
+constexpr auto parallel_strips = []() {
+  std::array<std::uint32_t, ws2812_word_count(2)> words{};
+  std::array<std::uint8_t, 1> first{ 0xFF };
+  std::array<std::uint8_t, 2> second{ 0x00, 0xFF };
+  std::array<ws2812_lane, 2> lanes{
+    ws2812_lane{ .pin = 0, .data = first },
+    ws2812_lane{ .pin = 1, .data = second },
+  };
+  auto encoded = encode_ws2812(words, lanes);
+  return std::pair(words, encoded.size());
+}();
+static_assert(48 == parallel_strips.second);
+static_assert(bsrr_word(0b11) == parallel_strips.first[0]);
+static_assert(bsrr_word(0, 0b10) == parallel_strips.first[1]);
+static_assert(bsrr_word(0, 0b11) == parallel_strips.first[2]);
+// The first lane has run out and stays low
+static_assert(bsrr_word(0b10) == parallel_strips.first[24]);
+static_assert(0 == parallel_strips.first[25]);
+static_assert(bsrr_word(0, 0b10) == parallel_strips.first[26]);
+
+static_assert([]() {
+  std::array<std::uint32_t, ws2812_word_count(2) - 1> words{};
+  std::array<std::uint8_t, 2> data{};
+  return encode_ws2812(words, 0, data).empty();
+}());
+
+constexpr step_pulses two_steps{ .step_pin = 0,
+                                 .direction_pin = 1,
+                                 .forward = true,
+                                 .steps = 2,
+                                 .words_per_step = 4,
+                                 .high_words = 2 };
+static_assert(9 == step_pulse_word_count(two_steps));
+static_assert([]() {
+  std::array<std::uint32_t, 9> words{};
+  encode_step_pulses(words, two_steps);
+  return words;
+}() == std::array<std::uint32_t, 9>{ bsrr_word(0b10, 0b01),
+                                     bsrr_word(0b01),
+                                     0,
+                                     bsrr_word(0, 0b01),
+                                     0,
+                                     bsrr_word(0b01),
+                                     0,
+                                     bsrr_word(0, 0b01),
+                                     0 });
+static_assert([]() {
+  std::array<std::uint32_t, 9> words{};
+  auto reverse = two_steps;
+  reverse.forward = false;
+  encode_step_pulses(words, reverse);
+  return words[0];
+}() == bsrr_word(0, 0b11));
+static_assert([]() {
+  std::array<std::uint32_t, 9> words{};
+  auto always_high = two_steps;
+  always_high.high_words = 4;
+  return encode_step_pulses(words, always_high).empty();
+}());
+}  // namespace
+
+void waveform_test()
+{
+  using namespace boost::ut;
+
+  configure_default_clocks();
+
+  "hal::stm32f1::gpio_waveform::play"_test = []() {
+    stub_out_registers gpio_stub(&gpio_b_reg);
+    stub_out_registers timer_stub(&timer3_reg);
+    stub_out_registers dma_stub(&dma1);
+    stub_out_registers rcc_stub(&rcc);
+
+    auto waveform = gpio_waveform::get('B', 0b11U << 12).value();
+    // PB12 and PB13 as push pull outputs driven low
+    expect(0x0033'0000 == (gpio_b_reg->crh & 0x00FF'0000));
+    expect(0b11U << 28 == gpio_b_reg->bsrr);
+
+    std::array<std::uint32_t, 3> words{ bsrr_word(1U << 12),
+                                        bsrr_word(1U << 13, 1U << 12),
+                                        bsrr_word(0, 1U << 13) };
+    auto started = waveform.play(
+      words, { .step_rate = 1.0_MHz, .timer = peripheral::timer3 });
+
+    expect(bool{ started });
+    auto& channel = dma1->channel[2];
+    expect(static_cast<std::uint32_t>(reinterpret_cast<std::uintptr_t>(
+             &gpio_b_reg->bsrr)) == channel.cpar);
+    expect(static_cast<std::uint32_t>(reinterpret_cast<std::uintptr_t>(
+             words.data())) == channel.cmar);
+    expect(3 == channel.cndtr);
+    // Very high priority, 32-bit transfers, memory increment, from memory,
+    // enabled and not circular
+    expect(0x3A91U == channel.ccr);
+    expect(1U << 8 == timer3_reg->dier);
+    expect(1U == (timer3_reg->cr1 & 1U));
+    expect(!waveform.done());
+    expect(3 == waveform.remaining());
+
+    // A second waveform cannot take the timer
+    auto other = gpio_waveform::get('B', 1U << 14).value();
+    expect(!other.play(words,
+                       { .step_rate = 1.0_MHz, .timer = peripheral::timer3 }));
+
+    channel.cndtr = 0;
+    expect(waveform.done());
+
+    waveform.stop();
+    expect(0 == timer3_reg->cr1);
+    expect(0 == timer3_reg->dier);
+    expect(0 == (channel.ccr & 1U));
+    expect(0 == waveform.remaining());
+  };
+
+  "hal::stm32f1::gpio_waveform::play repeat"_test = []() {
+    stub_out_registers gpio_stub(&gpio_c_reg);
+    stub_out_registers timer_stub(&timer2_reg);
+    stub_out_registers dma_stub(&dma1);
+    stub_out_registers rcc_stub(&rcc);
+
+    auto waveform = gpio_waveform::get('C', 1U << 0).value();
+    std::array<std::uint32_t, 2> words{ bsrr_word(1), bsrr_word(0, 1) };
+    expect(bool{ waveform.play(words,
+                               { .step_rate = 100.0_kHz, .repeat = true }) });
+
+    // dma1 channel 2 serves the timer2 update request
+    expect(1U == ((dma1->channel[1].ccr >> 5) & 1U));
+    dma1->channel[1].cndtr = 0;
+    expect(!waveform.done());
+
+    waveform.stop();
+    expect(waveform.done());
+  };
+
+  "hal::stm32f1::gpio_waveform stops when destroyed"_test = []() {
+    stub_out_registers gpio_stub(&gpio_b_reg);
+    stub_out_registers timer_stub(&timer3_reg);
+    stub_out_registers dma_stub(&dma1);
+    stub_out_registers rcc_stub(&rcc);
+
+    std::array<std::uint32_t, 2> words{ bsrr_word(1U << 12),
+                                        bsrr_word(0, 1U << 12) };
+    constexpr waveform_settings settings{ .step_rate = 1.0_MHz,
+                                          .timer = peripheral::timer3 };
+    {
+      auto waveform = gpio_waveform::get('B', 1U << 12).value();
+      expect(bool{ waveform.play(words, settings) });
+
+      // The moved from driver no longer owns the timer
+      auto moved = std::move(waveform);
+      waveform.stop();
+      expect(1U == (timer3_reg->cr1 & 1U));
+      expect(!moved.done());
+    }
+    expect(0 == timer3_reg->cr1);
+    expect(0 == (dma1->channel[2].ccr & 1U));
+
+    // The timer and DMA channel are free for the next waveform
+    auto again = gpio_waveform::get('B', 1U << 12).value();
+    expect(bool{ again.play(words, settings) });
+    again.stop();
+  };
+
+  "hal::stm32f1::gpio_waveform rejects bad arguments"_test = []() {
+    stub_out_registers gpio_stub(&gpio_a_reg);
+    stub_out_registers rcc_stub(&rcc);
+
+    expect(!gpio_waveform::get('H', 1));
+
+    auto waveform = gpio_waveform::get('A', 1).value();
+    std::array<std::uint32_t, 1> words{};
+    expect(!waveform.play(std::span<const std::uint32_t>{},
+                          { .step_rate = 1.0_MHz }));
+    expect(!waveform.play(
+      words, { .step_rate = 1.0_MHz, .timer = peripheral::timer9 }));
+    expect(!waveform.play(words, { .step_rate = 1000.0_MHz }));
+    expect(waveform.done());
+  };
+}
+}  // namespace hal::stm32f1
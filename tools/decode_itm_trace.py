@@ -0,0 +1,185 @@
+#!/usr/bin/env python3
+#
+# Copyright 2023 Google LLC
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#      http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+"""Decode trace events written by hal::stm32f1::trace_event().
+
+Reads a raw SWO byte stream captured with the TPIU formatter bypassed, as
+start_itm_trace() sets it up, for example with OpenOCD:
+
+    tpiu config internal swo.bin uart off 72000000 2000000
+
+Each event is a 2 byte stimulus packet holding the id in bits 0 to 11 and
+the argument count in bits 12 to 15, followed by one 4 byte packet per
+argument. Events are tracked per stimulus port, so ports written from
+different interrupt priorities never mix.
+
+Output is one line per event:
+
+    <cycles> <port> <name> <arguments...>
+
+<cycles> is the sum of the ITM local timestamps seen so far, in CPU cycles,
+or "-" if timestamps are disabled. Pass --cpu-frequency to print seconds.
+Truncated events are printed with a trailing "(truncated)".
+"""
+
+import argparse
+import sys
+
+
+def read_names(path):
+    """Read "<id> <name>" lines, ids may be decimal or 0x prefixed hex."""
+    names = {}
+    with open(path, encoding="utf-8") as file:
+        for line in file:
+            line = line.split("#", 1)[0].strip()
+            if not line:
+                continue
+            event_id, name = line.split(None, 1)
+            names[int(event_id, 0)] = name.strip()
+    return names
+
+
+def packets(data):
+    """Yield ("source", port, size, value), ("timestamp", delta) and
+    ("overflow",) tuples from an ITM byte stream."""
+    index = 0
+    while index < len(data):
+        header = data[index]
+        index += 1
+
+        if header == 0x00:
+            # Synchronization: at least 5 zero bytes then 0x80
+            while index < len(data) and data[index] == 0x00:
+                index += 1
+            index += 1
+        elif header == 0x70:
+            yield ("overflow",)
+        elif header & 0x0F == 0x00:
+            # Local timestamp, format 2 is a single byte
+            if header & 0x80 == 0:
+                yield ("timestamp", (header >> 4) & 0x7)
+                continue
+            delta = 0
+            shift = 0
+            while index < len(data):
+                byte = data[index]
+                index += 1
+                delta |= (byte & 0x7F) << shift
+                shift += 7
+                if byte & 0x80 == 0:
+                    break
+            yield ("timestamp", delta)
+        elif header & 0x0B == 0x08:
+            # Extension packet, skip its continuation bytes
+            if header & 0x80:
+                while index < len(data) and data[index] & 0x80:
+                    index += 1
+                index += 1
+        elif header & 0x03:
+            size = {1: 1, 2: 2, 3: 4}[header & 0x03]
+            payload = data[index:index + size]
+            index += size
+            if len(payload) < size:
+                return
+            # Hardware source packets come from the DWT
+            if header & 0x04 == 0:
+                yield ("source", header >> 3, size,
+                       int.from_bytes(payload, "little"))
+
+
+class decoder:
+    def __init__(self, names, cpu_frequency, output):
+        self.names = names
+        self.cpu_frequency = cpu_frequency
+        self.output = output
+        self.cycles = None
+        # Per port: [id, argument count, arguments]
+        self.pending = {}
+        self.events = 0
+        self.truncated = 0
+        self.overflows = 0
+
+    def time(self):
+        if self.cycles is None:
+            return "-"
+        if self.cpu_frequency:
+            return f"{self.cycles / self.cpu_frequency:.9f}"
+        return str(self.cycles)
+
+    def emit(self, port, truncated=False):
+        event_id, _, arguments = self.pending.pop(port)
+        name = self.names.get(event_id, f"event_{event_id}")
+        fields = [self.time(), str(port), name]
+        fields += [f"0x{argument:08x}" for argument in arguments]
+        if truncated:
+            fields.append("(truncated)")
+            self.truncated += 1
+        else:
+            self.events += 1
+        print(" ".join(fields), file=self.output)
+
+    def feed(self, packet):
+        kind = packet[0]
+        if kind == "timestamp":
+            self.cycles = (self.cycles or 0) + packet[1]
+        elif kind == "overflow":
+            self.overflows += 1
+        elif kind == "source":
+            _, port, size, value = packet
+            if size == 2:
+                if port in self.pending:
+                    self.emit(port, truncated=True)
+                self.pending[port] = [value & 0xFFF, value >> 12, []]
+            elif size == 4 and port in self.pending:
+                self.pending[port][2].append(value)
+            else:
+                # Not part of an event, such as single byte text output
+                return
+
+            if len(self.pending[port][2]) == self.pending[port][1]:
+                self.emit(port)
+
+    def finish(self):
+        for port in list(self.pending):
+            self.emit(port, truncated=True)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.split("\n")[0])
+    parser.add_argument("capture", help="raw SWO byte stream, - for stdin")
+    parser.add_argument("--names", help="file of '<id> <name>' lines")
+    parser.add_argument("--cpu-frequency", type=float,
+                        help="CPU clock in Hz, prints times in seconds")
+    arguments = parser.parse_args()
+
+    if arguments.capture == "-":
+        data = sys.stdin.buffer.read()
+    else:
+        with open(arguments.capture, "rb") as file:
+            data = file.read()
+
+    names = read_names(arguments.names) if arguments.names else {}
+    trace = decoder(names, arguments.cpu_frequency, sys.stdout)
+    for packet in packets(data):
+        trace.feed(packet)
+    trace.finish()
+
+    print(f"{trace.events} events, {trace.truncated} truncated, "
+          f"{trace.overflows} overflows", file=sys.stderr)
+
+
+if __name__ == "__main__":
+    main()